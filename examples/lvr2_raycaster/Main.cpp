@@ -429,6 +429,76 @@ double realTest(RaycasterBasePtr rc, size_t num_rays=984543)
     return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 }
 
+/**
+ * Compares the rays per second of the BVHRaycaster with and without ray
+ * packets for random directions and for coherent directions as they are
+ * cast for a camera image.
+ */
+void benchmarkPackets(MeshBufferPtr mesh, size_t num_rays=984543)
+{
+    BVHRaycaster rc(mesh);
+
+    Vector3f origin = {0.0,0.0,0.0};
+    std::vector<Vector3f > random_rays(num_rays);
+    std::vector<Vector3f > image_rays(num_rays);
+
+    for(int i=0; i<num_rays; i++)
+    {
+        random_rays[i] = Vector3f(
+            floatInRange(-1.0, 1.0),
+            floatInRange(-1.0, 1.0),
+            floatInRange(-1.0, 1.0)
+        ).normalized();
+    }
+
+    // row by row through a 90 degree field of view
+    size_t width = sqrt(num_rays);
+    for(int i=0; i<num_rays; i++)
+    {
+        float u = float(i % width) / width - 0.5;
+        float v = float(i / width) / width - 0.5;
+        image_rays[i] = Vector3f(1.0, u * 2.0, v * 2.0).normalized();
+    }
+
+    std::vector<std::pair<std::string, std::vector<Vector3f>* > > tests = {
+        {"random", &random_rays},
+        {"image", &image_rays}
+    };
+
+    for(auto& test : tests)
+    {
+        std::vector<Vector3f > intersections[2];
+        std::vector<uint8_t> hits[2];
+        double seconds[2];
+
+        for(int packets=0; packets<2; packets++)
+        {
+            rc.setPacketTraversal(packets);
+
+            auto start = std::chrono::steady_clock::now();
+            rc.castRays(origin, *test.second, intersections[packets], hits[packets]);
+            auto end = std::chrono::steady_clock::now();
+
+            seconds[packets] = std::chrono::duration<double>(end - start).count();
+        }
+
+        size_t mismatches = 0;
+        for(int i=0; i<num_rays; i++)
+        {
+            if(hits[0][i] != hits[1][i]
+                || (hits[0][i] && (intersections[0][i] - intersections[1][i]).norm() > 1e-4))
+            {
+                mismatches++;
+            }
+        }
+
+        std::cout << test.first << " rays: "
+                  << num_rays / seconds[0] << " rays/s single, "
+                  << num_rays / seconds[1] << " rays/s packets of " << BVH_PACKET_SIZE << ", "
+                  << mismatches << " mismatches" << std::endl;
+    }
+}
+
 int main(int argc, char** argv)
 {
     int num_rays = 1000000;
@@ -444,6 +514,7 @@ int main(int argc, char** argv)
         std::cout << "Testing BVHRaycaster" << std::endl;
         raycaster.reset(new BVHRaycaster(buffer));
         std::cout << realTest(raycaster, num_rays) << " ms" << std::endl;
+        benchmarkPackets(buffer, num_rays);
 
         // GPU test
         #if defined LVR2_USE_OPENCL
@@ -40,6 +40,10 @@
 #include "lvr2/io/hdf5/HDF5FeatureBase.hpp"
 #include "lvr2/io/hdf5/ChunkIO.hpp"
 
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
 #include <list>
 #include <unordered_map>
 
@@ -64,6 +68,44 @@ class ChunkGeomtryChannelVisitor : public boost::static_visitor<FloatChannelOpti
     }
 };
 
+/**
+ * @brief visitor that returns the number of bytes held by the channels of a chunk
+ */
+class ChunkMemoryVisitor : public boost::static_visitor<size_t>
+{
+    struct ChannelMemoryVisitor : public boost::static_visitor<size_t>
+    {
+        template <typename T>
+        size_t operator()(const Channel<T>& channel) const
+        {
+            return channel.numElements() * channel.width() * sizeof(T);
+        }
+    };
+
+  public:
+    template <typename BufferPtrT>
+    size_t operator()(const BufferPtrT& buffer) const
+    {
+        size_t bytes = 0;
+        if (buffer)
+        {
+            for (const auto& channel : *buffer)
+            {
+                bytes += boost::apply_visitor(ChannelMemoryVisitor(), channel.second);
+            }
+        }
+        return bytes;
+    }
+};
+
+/**
+ * @brief LRU cache of chunks that are stored persistently in an HDF5 file
+ *
+ * Loading, storing and querying chunks is thread-safe, so several consumers may share one
+ * grid. Lookups and evictions are O(1). HDF5 access is serialized separately from the cache,
+ * so cache hits are not blocked by running reads. Chunks around a region of interest can be loaded in the
+ * background with prefetch().
+ */
 class ChunkHashGrid
 {
   public:
@@ -88,6 +130,11 @@ class ChunkHashGrid
                   BoundingBox<BaseVector<float>> boundingBox,
                   float chunkSize);
 
+    /**
+     * @brief stops the prefetch thread
+     */
+    virtual ~ChunkHashGrid();
+
     /**
      * @brief sets a chunk of a given layer in hashgrid
      *
@@ -162,6 +209,60 @@ class ChunkHashGrid
      */
     bool isChunkLoaded(std::string layer, int x, int y, int z);
 
+    /**
+     * @brief indicates if wether or not a chunk is in the local cache or in persistent storage
+     *
+     * @param layer layer of chunk
+     * @param x x coordinate of chunk in chunk coordinates
+     * @param y y coordinate of chunk in chunk coordinates
+     * @param z z coordinate of chunk in chunk coordinates
+     *
+     * @return true if chunk exists; else false
+     */
+    bool chunkExists(std::string layer, int x, int y, int z);
+
+    /**
+     * @brief loads the chunks of a layer that intersect the given area in a background thread
+     *
+     * Chunks closest to the center of the area are loaded first. At most as many chunks as fit
+     * into the cache are requested. Pending requests of previous calls are discarded, so callers
+     * can simply pass the current region of interest (e.g. the bounding box of a view frustum)
+     * whenever it changes.
+     *
+     * @tparam T type of the chunks in the layer
+     * @param layer layer of chunks
+     * @param area area in world coordinates
+     */
+    template <typename T>
+    void prefetch(std::string layer, const BoundingBox<BaseVector<float>>& area);
+
+    /**
+     * @brief loads the given chunks of a layer in a background thread
+     *
+     * Chunks are loaded in the given order. Pending requests of previous calls are discarded.
+     *
+     * @tparam T type of the chunks in the layer
+     * @param layer layer of chunks
+     * @param chunks chunk coordinates in order of priority
+     */
+    template <typename T>
+    void prefetch(std::string layer, const std::vector<BaseVector<int>>& chunks);
+
+    /**
+     * @brief sets the maximum number of bytes held by cached chunks
+     *
+     * Least recently used chunks are evicted until both the chunk count and the memory limit are
+     * satisfied. The most recently used chunk is always kept.
+     *
+     * @param bytes memory limit in bytes, 0 disables the limit
+     */
+    void setCacheMemory(size_t bytes);
+
+    /**
+     * @brief returns the number of bytes currently held by cached chunks
+     */
+    size_t getCacheMemoryUsage();
+
     /**
      * @brief Calculates the hash value for the given index triple
      *
@@ -221,13 +322,9 @@ class ChunkHashGrid
 
   protected:
     /**
-     * @brief regenerates cache hash grid
-     *
-     * @param oldChunkAmount previous amount of chunks
-     * @param oldChunkIndexOffset previous offset for chunk indices
+     * @brief regenerates cache hash grid after the chunk amount or offset changed
      */
-    void rehashCache(const BaseVector<std::size_t>& oldChunkAmount,
-                     const BaseVector<std::size_t>& oldChunkIndexOffset);
+    void rehashCache();
 
     void expandBoundingBox(const val_type& data);
 
@@ -240,10 +337,12 @@ class ChunkHashGrid
      * @param y y coordinate of chunk in chunk coordinates
      * @param z z coordinate of chunk in chunk coordinates
      *
-     * @return true if chunk has been loaded; false if chunk does not exist in persistend storage
+     * @return the chunk data (also if it was already cached); none if chunk does not exist in
+     *         persistent storage. The data is returned even if it has been evicted from the cache
+     *         right away.
      */
     template <typename T>
-    bool loadChunk(std::string layer, int x, int y, int z);
+    boost::optional<T> loadChunk(std::string layer, int x, int y, int z);
 
     /**
      * @brief loads given chunk data into cache
@@ -267,7 +366,10 @@ class ChunkHashGrid
      */
     void setChunkSize(float chunkSize)
     {
+        boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
         m_chunkSize = chunkSize;
+
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
         m_io.saveChunkSize(m_chunkSize);
     }
 
@@ -276,6 +378,19 @@ class ChunkHashGrid
     BoundingBox<BaseVector<float>> m_boundingBox;
 
   private:
+    struct CacheEntry
+    {
+        std::string layer;
+        int x;
+        int y;
+        int z;
+        size_t hash;
+        val_type data;
+        size_t bytes;
+    };
+
+    using entry_list = std::list<CacheEntry>;
+
     /**
      * @brief sets the amount of chunks in x y and z direction in this container and in persistent
      * storage
@@ -285,18 +400,89 @@ class ChunkHashGrid
     void setChunkAmountAndOffset(const BaseVector<std::size_t>& chunkAmount,
                                  const BaseVector<std::size_t>& chunkIndexOffset);
 
+    /**
+     * @brief returns a cached chunk and marks it as most recently used
+     */
+    template <typename T>
+    boost::optional<T> findChunk(const std::string& layer, int x, int y, int z);
+
+    /**
+     * @brief adds new chunk data to the cache in front of the given position
+     */
+    void insertChunk(const std::string& layer, int x, int y, int z, const val_type& data,
+                     entry_list::iterator position);
+
+    /**
+     * @brief evicts least recently used chunks until the cache limits are satisfied
+     */
+    void evictChunks();
+
+    /**
+     * @brief loads a chunk on behalf of the prefetch thread
+     *
+     * Prefetched chunks are queued behind the previously prefetched chunk, so farther chunks
+     * never evict nearer ones.
+     *
+     * @return false if the cache is full and prefetching should stop
+     */
+    template <typename T>
+    bool prefetchChunk(const std::string& layer, int x, int y, int z);
+
+    /**
+     * @brief replaces the pending prefetch requests and starts the prefetch thread if needed
+     */
+    void setPrefetchQueue(std::deque<boost::function<bool()>> requests);
+
+    /**
+     * @brief main loop of the prefetch thread
+     */
+    void prefetchWorker();
+
   private:
     // chunkIO for the HDF5 file-IO
     io m_io;
 
+    // serializes all access to m_io
+    boost::mutex m_ioMutex;
+
+    // guards the cache and the chunk grid geometry
+    boost::recursive_mutex m_cacheMutex;
+
     // number of chunks that will be cached before deleting old chunks
     size_t m_cacheSize;
 
-    // ordered list to save recently used hashValues for the lru cache
-    std::list<std::pair<std::string, size_t>> m_items;
+    // number of bytes that may be cached before deleting old chunks, 0 means unlimited
+    size_t m_cacheBytes;
+
+    // number of bytes currently held by cached chunks
+    size_t m_usedBytes;
+
+    // cached chunks ordered from most to least recently used
+    entry_list m_items;
+
+    // hash map from layer and chunk hash to the cache entry
+    std::unordered_map<std::string, std::unordered_map<size_t, entry_list::iterator>> m_hashGrid;
+
+    // pending prefetch requests, nearest chunk first
+    std::deque<boost::function<bool()>> m_prefetchQueue;
+
+    // incremented whenever the pending prefetch requests are replaced
+    size_t m_prefetchGeneration;
+
+    // guards m_prefetchQueue, m_prefetchGeneration and m_stopPrefetch
+    boost::mutex m_prefetchMutex;
+
+    // signals new prefetch requests
+    boost::condition_variable m_prefetchCondition;
+
+    // background thread loading prefetched chunks, started on first request
+    boost::thread m_prefetchThread;
+
+    // tells the prefetch thread to exit
+    bool m_stopPrefetch;
 
-    // hash map containing chunked meshes
-    std::unordered_map<std::string, std::unordered_map<size_t, val_type>> m_hashGrid;
+    // layer and coordinates of the last chunk inserted by the current prefetch request
+    boost::optional<std::pair<std::string, BaseVector<int>>> m_lastPrefetched;
 
     // size of chunks
     float m_chunkSize;
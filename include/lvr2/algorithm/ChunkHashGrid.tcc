@@ -5,7 +5,12 @@ template <typename T>
 void ChunkHashGrid::setGeometryChunk(std::string layer, int x, int y, int z, T data)
 {
     // store chunk persistently
-    m_io.saveChunk<T>(data, layer, x, y, z);
+    {
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
+        m_io.saveChunk<T>(data, layer, x, y, z);
+    }
+
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
 
     // update bounding box based on channel geometry 
     expandBoundingBox(data);
@@ -18,7 +23,12 @@ template <typename T>
 void ChunkHashGrid::setChunk(std::string layer, int x, int y, int z, T data)
 {
     // store chunk persistently
-    m_io.saveChunk<T>(data, layer, x, y, z);
+    {
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
+        m_io.saveChunk<T>(data, layer, x, y, z);
+    }
+
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
 
     // update bounding box based on chunk index 
     if(x > getChunkMaxChunkIndex().x || y > getChunkMaxChunkIndex().y || z > getChunkMaxChunkIndex().z ||
@@ -36,48 +46,179 @@ void ChunkHashGrid::setChunk(std::string layer, int x, int y, int z, T data)
 template <typename T>
 boost::optional<T> ChunkHashGrid::getChunk(std::string layer, int x, int y, int z)
 {
-    // skip if the Coordinates are too large or too negative
-    if(x > getChunkMaxChunkIndex().x || y > getChunkMaxChunkIndex().y || z > getChunkMaxChunkIndex().z ||
-        x < getChunkMinChunkIndex().x || y < getChunkMinChunkIndex().y || z < getChunkMinChunkIndex().z)
     {
-        return boost::optional<T>{};
+        boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
+        // skip if the Coordinates are too large or too negative
+        if(x > getChunkMaxChunkIndex().x || y > getChunkMaxChunkIndex().y || z > getChunkMaxChunkIndex().z ||
+            x < getChunkMinChunkIndex().x || y < getChunkMinChunkIndex().y || z < getChunkMinChunkIndex().z)
+        {
+            return boost::optional<T>{};
+        }
+
+        boost::optional<T> chunk = findChunk<T>(layer, x, y, z);
+        if (chunk)
+        {
+            return chunk;
+        }
     }
-    std::size_t chunkHash = hashValue(x, y, z);
 
-    if (isChunkLoaded(layer, chunkHash))
+    // the cache is not locked while reading, other consumers can still be served from it.
+    // The loaded data is returned directly, since other threads may evict it from the
+    // cache before it could be looked up again.
+    return loadChunk<T>(layer, x, y, z);
+}
+
+template <typename T>
+boost::optional<T> ChunkHashGrid::findChunk(const std::string& layer, int x, int y, int z)
+{
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
+    auto layerIt = m_hashGrid.find(layer);
+    if (layerIt != m_hashGrid.end())
     {
-        // move chunk to the front of the cache queue
-        m_items.remove({layer, chunkHash});
-        m_items.push_front({layer, chunkHash});
+        auto chunkIt = layerIt->second.find(hashValue(x, y, z));
+        if (chunkIt != layerIt->second.end())
+        {
+            // move chunk to the front of the cache queue
+            m_items.splice(m_items.begin(), m_items, chunkIt->second);
+
+            return boost::get<T>(chunkIt->second->data);
+        }
+    }
 
-        return boost::get<T>(m_hashGrid[layer][chunkHash]);
+    return boost::optional<T>{};
+}
+
+template <typename T>
+boost::optional<T> ChunkHashGrid::loadChunk(std::string layer, int x, int y, int z)
+{
+    boost::optional<T> cached = findChunk<T>(layer, x, y, z);
+    if (cached)
+    {
+        return cached;
     }
 
-    if (loadChunk<T>(layer, x, y, z))
+    T data;
+    {
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
+        data = m_io.loadChunk<T>(layer, x, y, z);
+    }
+    if (data == nullptr)
     {
-        return boost::get<T>(m_hashGrid[layer][chunkHash]);
+        return boost::optional<T>{};
     }
 
-    return boost::optional<T>{};
+    loadChunk(layer, x, y, z, data);
+
+    return data;
 }
 
 template <typename T>
-bool ChunkHashGrid::loadChunk(std::string layer, int x, int y, int z)
+void ChunkHashGrid::prefetch(std::string layer, const BoundingBox<BaseVector<float>>& area)
+{
+    std::vector<BaseVector<int>> chunks;
+    {
+        boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
+        BaseVector<int> minIndex = getChunkMinChunkIndex();
+        BaseVector<int> maxIndex = getChunkMaxChunkIndex();
+        BaseVector<int> areaMin, areaMax;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // same truncation as the chunk coordinates of the ChunkManager
+            areaMin[axis] = std::max(minIndex[axis], static_cast<int>(area.getMin()[axis] / m_chunkSize));
+            areaMax[axis] = std::min(maxIndex[axis], static_cast<int>(area.getMax()[axis] / m_chunkSize));
+        }
+
+        for (int i = areaMin.x; i <= areaMax.x; i++)
+        {
+            for (int j = areaMin.y; j <= areaMax.y; j++)
+            {
+                for (int k = areaMin.z; k <= areaMax.z; k++)
+                {
+                    chunks.push_back(BaseVector<int>(i, j, k));
+                }
+            }
+        }
+    }
+
+    // nearest chunks first
+    BaseVector<float> center = area.getCentroid() / m_chunkSize;
+    auto distance = [&center](const BaseVector<int>& chunk) {
+        return (BaseVector<float>(chunk.x + 0.5f, chunk.y + 0.5f, chunk.z + 0.5f) - center).length2();
+    };
+    std::sort(chunks.begin(), chunks.end(), [&distance](const BaseVector<int>& a, const BaseVector<int>& b) {
+        return distance(a) < distance(b);
+    });
+
+    prefetch<T>(layer, chunks);
+}
+
+template <typename T>
+void ChunkHashGrid::prefetch(std::string layer, const std::vector<BaseVector<int>>& chunks)
+{
+    // requesting more chunks than the cache holds would evict the first ones again
+    size_t numRequests = std::min(chunks.size(), m_cacheSize);
+
+    std::deque<boost::function<bool()>> requests;
+    for (size_t i = 0; i < numRequests; i++)
+    {
+        BaseVector<int> chunk = chunks[i];
+        requests.push_back([this, layer, chunk]() {
+            return prefetchChunk<T>(layer, chunk.x, chunk.y, chunk.z);
+        });
+    }
+
+    setPrefetchQueue(std::move(requests));
+}
+
+template <typename T>
+bool ChunkHashGrid::prefetchChunk(const std::string& layer, int x, int y, int z)
 {
     if (isChunkLoaded(layer, x, y, z))
     {
         return true;
     }
 
-    T data = m_io.loadChunk<T>(layer, x, y, z);
+    T data;
+    {
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
+        data = m_io.loadChunk<T>(layer, x, y, z);
+    }
     if (data == nullptr)
     {
-        return false;
+        return true;
     }
 
-    loadChunk(layer, x, y, z, data);
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
+    // a consumer may have loaded the chunk in the meantime
+    if (isChunkLoaded(layer, x, y, z))
+    {
+        return true;
+    }
+
+    entry_list::iterator position = m_items.begin();
+    if (m_lastPrefetched)
+    {
+        const BaseVector<int>& last = m_lastPrefetched->second;
+        auto layerIt = m_hashGrid.find(m_lastPrefetched->first);
+        if (layerIt != m_hashGrid.end())
+        {
+            auto chunkIt = layerIt->second.find(hashValue(last.x, last.y, last.z));
+            if (chunkIt != layerIt->second.end())
+            {
+                position = std::next(chunkIt->second);
+            }
+        }
+    }
+
+    insertChunk(layer, x, y, z, data, position);
+    m_lastPrefetched = std::make_pair(layer, BaseVector<int>(x, y, z));
 
-    return true;
+    // the chunk was evicted right away, the cache is filled with chunks of higher priority
+    return isChunkLoaded(layer, x, y, z);
 }
 
 } // namespace lvr2
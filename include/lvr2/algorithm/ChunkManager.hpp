@@ -169,7 +169,79 @@ class ChunkManager : public ChunkHashGrid
      */
     void loadAllChunks(std::string layer = std::string("mesh"));
 
+    /**
+     * @brief reduceChunks reduces the mesh of a layer chunk by chunk and stores the result as a
+     * new layer
+     *
+     * Every chunk is loaded on its own, reduced with quadricMeshReduction and stored at the same
+     * position in targetLayer. The chunks are reduced in parallel. The vertices on the chunk
+     * borders (the first num_duplicates vertices of a chunk) are locked, so the reduced chunks
+     * still fit together and can be stitched by extractArea. Only the chunks that are currently
+     * reduced and the cached chunks are held in memory, so the memory usage depends on the chunk
+     * size and the cache limits (see setCacheMemory), but not on the size of the mesh.
+     *
+     * Because of the locked borders, the mesh stays dense along the seams. If reduceSeams is set,
+     * a second pass merges blocks of 2x2x2 chunks and reduces the faces around the seams inside
+     * each block, while the vertices shared with chunks outside of the block stay locked. Two
+     * rounds with shifted blocks cover all seams between face-adjacent chunks.
+     *
+     * Chunks without faces and chunks that can't be reduced are copied to targetLayer unchanged,
+     * so targetLayer contains every chunk of layer.
+     *
+     * @param reductionRatio share of the edges of each chunk to collapse, between 0 and 1
+     * @param targetLayer layer to store the reduced chunks in
+     * @param layer layer of the chunks to reduce
+     * @param reduceSeams whether to reduce the seams in a second pass
+     *
+     * @return number of collapsed edges
+     *
+     * @throws std::runtime_error if a stored chunk can't be loaded
+     */
+    std::size_t reduceChunks(float reductionRatio,
+                             std::string targetLayer,
+                             std::string layer = std::string("mesh"),
+                             bool reduceSeams = false);
+
   private:
+    /**
+     * @brief returns a chunk of a layer and distinguishes missing from unreadable chunks
+     *
+     * @param layer layer of the chunk
+     * @param coord chunk coordinates of the chunk
+     *
+     * @return the chunk; none if no chunk is stored at the coordinates
+     *
+     * @throws std::runtime_error if the chunk is stored but can't be loaded
+     */
+    boost::optional<MeshBufferPtr> getStoredChunk(const std::string& layer,
+                                                  const BaseVector<int>& coord);
+
+    /**
+     * @brief merges chunks to one mesh without duplicated vertices
+     *
+     * The border vertices of the chunks are stitched by their positions and stored in front of
+     * all other vertices of the merged mesh. The faces of the chunks are stored in the given order.
+     *
+     * @param chunks chunks with at least one vertex
+     * @param numSeamVertices set to the number of stitched border vertices
+     * @return merged mesh
+     */
+    MeshBufferPtr mergeChunks(const std::vector<MeshBufferPtr>& chunks,
+                              std::size_t& numSeamVertices);
+
+    /**
+     * @brief reduces the faces around the seams inside a block of 2x2x2 chunks of a layer
+     *
+     * @param first chunk coordinates of the first chunk of the block
+     * @param reductionRatio share of the edges around the seams to collapse
+     * @param layer layer of the chunks
+     *
+     * @return number of collapsed edges
+     */
+    std::size_t reduceSeamBlock(const BaseVector<int>& first,
+                                float reductionRatio,
+                                const std::string& layer);
+
     /**
      * @brief initBoundingBox calculates a bounding box of the original mesh
      *
@@ -234,16 +306,16 @@ class ChunkManager : public ChunkHashGrid
      * @param staticVertexIndexOffset amount of duplicate vertices in the combined mesh
      * @param numVertices amount of vertices in the combined mesh
      * @param numFaces amount of faces in the combined mesh
-     * @param areaVertexIndices mapping from old vertex index to new vertex index per chunk
+     * @param areaVertexIndices new vertex index of each duplicate vertex per chunk
      */
     template <typename T>
     ChannelPtr<T> extractChannelOfArea(
-        std::unordered_map<std::size_t, MeshBufferPtr>& chunks,
+        const std::vector<MeshBufferPtr>& chunks,
         std::string channelName,
         std::size_t staticVertexIndexOffset,
         std::size_t numVertices,
         std::size_t numFaces,
-        std::vector<std::unordered_map<std::size_t, std::size_t>>& areaVertexIndices);
+        const std::vector<std::vector<std::size_t>>& areaVertexIndices);
 
     /**
      * @brief applies given filter arrays to one channel
@@ -3,21 +3,22 @@ namespace lvr2
 
 template <typename T>
 ChannelPtr<T> ChunkManager::extractChannelOfArea(
-    std::unordered_map<std::size_t, MeshBufferPtr>& chunks,
+    const std::vector<MeshBufferPtr>& chunks,
     std::string channelName,
     std::size_t staticVertexIndexOffset,
     std::size_t numVertices,
     std::size_t numFaces,
-    std::vector<std::unordered_map<std::size_t, std::size_t>>& areaVertexIndices)
+    const std::vector<std::vector<std::size_t>>& areaVertexIndices)
 {
     ChannelPtr<T> channel = nullptr;
 
-    auto areaVertexIndicesIt   = areaVertexIndices.begin();
+    // offset of the first element of each chunk that is not a duplicate vertex
+    std::vector<long> indexOffsets(chunks.size(), -1);
     std::size_t dynIndexOffset = 0;
 
-    for (auto chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    for (std::size_t c = 0; c < chunks.size(); ++c)
     {
-        MeshBufferPtr chunk                           = chunkIt->second;
+        MeshBufferPtr chunk                           = chunks[c];
         typename Channel<T>::Optional chunkChannelOpt = chunk->getChannel<T>(channelName);
 
         if (chunkChannelOpt)
@@ -50,48 +51,15 @@ ChannelPtr<T> ChunkManager::extractChannelOfArea(
 
             if (chunkChannel.numElements() == chunk->numVertices())
             {
-                // add data to vertex attribute
-
-                std::size_t numDuplicates = *chunk->getAtomic<unsigned int>("num_duplicates");
-                std::size_t indexOffset = staticVertexIndexOffset - numDuplicates + dynIndexOffset;
+                // add data to vertex attribute, duplicate vertices are written below
+                std::size_t numDuplicates = areaVertexIndices[c].size();
+                indexOffsets[c] = staticVertexIndexOffset + dynIndexOffset;
                 dynIndexOffset += chunkChannel.numElements() - numDuplicates;
-
-                for (unsigned int i = 0; i < chunkChannel.numElements(); i++)
-                {
-                    size_t index = 0;
-
-                    auto it = (*areaVertexIndicesIt).find(i);
-                    if (it != (*areaVertexIndicesIt).end())
-                    {
-                        index = it->second;
-                    }
-                    else
-                    {
-                        index = i + indexOffset;
-                    }
-
-                    for (unsigned int j = 0; j < channel->width(); j++)
-                    {
-                        channel->dataPtr()[index * channel->width() + j]
-                            = chunkChannel.dataPtr()[i * channel->width() + j];
-                    }
-                }
             }
             else if (chunkChannel.numElements() == chunk->numFaces())
             {
                 // add data to face attribute
-
-                for (unsigned int i = 0; i < chunkChannel.numElements(); i++)
-                {
-                    size_t index = dynIndexOffset + i;
-
-                    for (unsigned int j = 0; j < channel->width(); j++)
-                    {
-                        channel->dataPtr()[index * channel->width() + j]
-                            = chunkChannel.dataPtr()[i * channel->width() + j];
-                    }
-                }
-
+                indexOffsets[c] = dynIndexOffset;
                 dynIndexOffset += chunkChannel.numElements();
             }
             else
@@ -108,8 +76,55 @@ ChannelPtr<T> ChunkManager::extractChannelOfArea(
                 }
             }
         }
+    }
+
+    if (!channel)
+    {
+        return channel;
+    }
+
+    // vertex and face ranges of the chunks are disjoint
+    const std::size_t width = channel->width();
+    #pragma omp parallel for schedule(dynamic)
+    for (std::size_t c = 0; c < chunks.size(); ++c)
+    {
+        if (indexOffsets[c] < 0)
+        {
+            continue;
+        }
+
+        Channel<T> chunkChannel = *chunks[c]->getChannel<T>(channelName);
+        std::size_t first = 0;
+        if (chunkChannel.numElements() == chunks[c]->numVertices())
+        {
+            first = areaVertexIndices[c].size();
+        }
 
-        ++areaVertexIndicesIt;
+        std::copy(chunkChannel.dataPtr().get() + first * width,
+                  chunkChannel.dataPtr().get() + chunkChannel.numElements() * width,
+                  channel->dataPtr().get() + indexOffsets[c] * width);
+    }
+
+    // duplicate vertices are shared between chunks, the last chunk in order wins
+    for (std::size_t c = 0; c < chunks.size(); ++c)
+    {
+        if (indexOffsets[c] < 0 || areaVertexIndices[c].empty())
+        {
+            continue;
+        }
+
+        Channel<T> chunkChannel = *chunks[c]->getChannel<T>(channelName);
+        if (chunkChannel.numElements() != chunks[c]->numVertices())
+        {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < areaVertexIndices[c].size(); i++)
+        {
+            std::copy(chunkChannel.dataPtr().get() + i * width,
+                      chunkChannel.dataPtr().get() + (i + 1) * width,
+                      channel->dataPtr().get() + areaVertexIndices[c][i] * width);
+        }
     }
 
     return channel;
@@ -39,6 +39,8 @@
 
 #include <boost/optional.hpp>
 
+#include "lvr2/util/ClusterBiMap.hpp"
+
 
 
 namespace lvr2
@@ -78,14 +80,108 @@ size_t iterativeEdgeCollapse(
     CostF collapseCost
 );
 
+/**
+ * @brief Parallel variant of `iterativeEdgeCollapse`.
+ *
+ * The edges are collapsed in rounds. Each round takes the cheapest entries
+ * from the queue and keeps an edge only if its one-ring (both vertices and
+ * all their neighbors) does not overlap the one-ring of an edge already
+ * chosen in this round. The chosen edges are collapsed, then the costs of
+ * all vertices around the new midpoints are recomputed with all OpenMP
+ * threads. Rejected candidates stay in the queue for the next round.
+ *
+ * Quality compared to the serial greedy order:
+ *  - Every collapsed edge is among the `2 * r` cheapest queue entries at the
+ *    start of its round, where `r` is the number of edges collapsed per
+ *    round (`roundFraction` of the queue, at least 1).
+ *  - Because the one-rings are disjoint, a collapse does not change the
+ *    faces around the vertices of another edge of the same round. If
+ *    `collapseCost` only depends on the faces around `from` and `to`, the
+ *    cost of every collapsed edge is therefore exact, just as in the
+ *    serial algorithm.
+ *  - Edges that become cheap through a collapse are only considered in the
+ *    next round, so the order differs from the serial one by at most one
+ *    round. With `roundFraction = 0`, every round collapses a single edge,
+ *    which is the serial greedy order. (Unlike `iterativeEdgeCollapse`, the
+ *    face normals around a midpoint are updated before its costs are.)
+ *
+ * Like the serial algorithm, it stops when `count` many edges have been
+ * collapsed or no collapsable edge is left.
+ *
+ * @param[in] count Number of edges to collapse
+ * @param[in, out] faceNormals See `iterativeEdgeCollapse`
+ * @param[in] collapseCost See `iterativeEdgeCollapse`. It is called from
+ *                         several threads at once, but never while the mesh
+ *                         or `faceNormals` is changed.
+ * @param[in] roundFraction Fraction of the queued vertices that may be
+ *                          collapsed in one round.
+ *
+ * @return The number of edges actually collapsed.
+ */
+template<typename BaseVecT, typename CostF>
+size_t parallelEdgeCollapse(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    CostF collapseCost,
+    float roundFraction = 0.01
+);
+
 /**
  * @brief Like `iterativeEdgeCollapse` but with a fixed cost function.
+ *
+ * @param[in] parallel Use `parallelEdgeCollapse` instead
  */
 template<typename BaseVecT>
 size_t simpleMeshReduction(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
-    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    bool parallel = false
+);
+
+/**
+ * @brief Collapses `count` many edges of `mesh` ranked by the quadric error
+ *        metric.
+ *
+ * Based on: Garland, Michael, and Paul S. Heckbert. "Surface simplification
+ * using quadric error metrics." SIGGRAPH 1997.
+ *
+ * Every vertex stores the sum of the (area weighted) quadrics of the planes
+ * of its faces. The cost of collapsing an edge is the error of the summed
+ * quadric of both vertices at the position that minimizes it, and the
+ * remaining vertex is moved to this position. After a collapse, the
+ * remaining vertex keeps the summed quadric, so costs are recomputed from
+ * the cached quadrics instead of from the surrounding faces. Collapses that
+ * would flip or degenerate a face are rejected.
+ *
+ * Boundary edges and, if `clusters` is given, edges between faces of
+ * different clusters get an additional, heavily weighted plane
+ * perpendicular to their face. This keeps boundaries and cluster borders
+ * in place, while their vertices may still slide along them.
+ *
+ * This algorithm stops when either `count` many edges have been collapsed or
+ * if there are no collapsable edges left.
+ *
+ * @param[in] count Number of edges to collapse
+ * @param[in, out] faceNormals A face map storing valid normals of all faces in
+ *                             the mesh. This map is altered by this algorithm
+ *                             according to the changes done in the mesh.
+ * @param[in] clusters Optional clustering of the faces whose borders should be
+ *                     preserved. It is only read before the first collapse.
+ * @param[in] fixedVertices Optional map of vertices that must neither move nor
+ *                          be removed. Edges touching one of them are never
+ *                          collapsed.
+ *
+ * @return The number of edges actually collapsed.
+ */
+template<typename BaseVecT>
+size_t quadricMeshReduction(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    const ClusterBiMap<FaceHandle>* clusters = nullptr,
+    const VertexMap<bool>* fixedVertices = nullptr
 );
 
 } // namespace lvr2
@@ -29,9 +29,13 @@
  * ReductionAlgorithms.tcc
  */
 
+#include <algorithm>
+#include <cmath>
 #include <unordered_set>
 #include <vector>
 
+#include <Eigen/Dense>
+
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/algorithm/NormalAlgorithms.hpp"
 #include "lvr2/geometry/Handles.hpp"
@@ -56,6 +60,76 @@ struct DirEdge
     }
 };
 
+/**
+ * @brief Symmetric 4x4 matrix of the quadric error metric, only the upper
+ *        triangle is stored.
+ */
+struct Quadric
+{
+    // a², ab, ac, ad, b², bc, bd, c², cd, d²
+    double q[10];
+
+    Quadric()
+    {
+        std::fill(q, q + 10, 0.0);
+    }
+
+    /// Weighted quadric of the plane ax + by + cz + d = 0 with unit normal
+    Quadric(double a, double b, double c, double d, double weight)
+    {
+        q[0] = a * a; q[1] = a * b; q[2] = a * c; q[3] = a * d;
+        q[4] = b * b; q[5] = b * c; q[6] = b * d;
+        q[7] = c * c; q[8] = c * d;
+        q[9] = d * d;
+        for (auto& v: q)
+        {
+            v *= weight;
+        }
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            q[i] += other.q[i];
+        }
+        return *this;
+    }
+
+    Quadric operator+(const Quadric& other) const
+    {
+        Quadric ret = *this;
+        ret += other;
+        return ret;
+    }
+
+    /// Sum of the weighted squared distances of the point to all planes
+    double error(double x, double y, double z) const
+    {
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+             + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+             + q[7] * z * z + 2 * q[8] * z
+             + q[9];
+    }
+
+    /// Calculates the point with the smallest error if it is unique
+    boost::optional<Eigen::Vector3d> minimum() const
+    {
+        Eigen::Matrix3d a;
+        a << q[0], q[1], q[2],
+             q[1], q[4], q[5],
+             q[2], q[5], q[7];
+
+        // The matrix is singular for flat or straight neighborhoods
+        double det = a.determinant();
+        if (std::abs(det) <= 1e-12 * std::pow(a.cwiseAbs().maxCoeff(), 3))
+        {
+            return boost::none;
+        }
+        return Eigen::Vector3d(a.inverse() * Eigen::Vector3d(-q[3], -q[6], -q[8]));
+    }
+};
+
 } // namespace lvr2
 
 
@@ -237,22 +311,235 @@ size_t iterativeEdgeCollapse(
     return collapsedEdgeCount;
 }
 
+template<typename BaseVecT, typename CostF>
+size_t parallelEdgeCollapse(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    CostF collapseCost,
+    float roundFraction
+)
+{
+    std::cout << timestamp << "Reduce mesh by collapsing " << count << " edges in parallel" << std::endl;
+
+    Meap<VertexHandle, float> queue(mesh.nextVertexIndex());
+    DenseVertexMap<VertexHandle> bestEdge;
+    bestEdge.reserve(mesh.nextVertexIndex());
+
+    const auto& constFaceNormals = faceNormals;
+
+    // Finds the outgoing edge with the best score for each given vertex. The
+    // mesh is only read, so this runs on all threads. The second vertex is
+    // the vertex itself if no outgoing edge is collapsable.
+    vector<VertexHandle> bestToH;
+    vector<float> bestCost;
+    auto findBestEdges = [&](const vector<VertexHandle>& fromHs)
+    {
+        bestToH.resize(fromHs.size(), VertexHandle(0));
+        bestCost.resize(fromHs.size());
+
+        #pragma omp parallel
+        {
+            vector<VertexHandle> neighbors;
+
+            #pragma omp for schedule(dynamic, 256)
+            for (long i = 0; i < (long)fromHs.size(); i++)
+            {
+                const auto fromH = fromHs[i];
+                neighbors.clear();
+                mesh.getNeighboursOfVertex(fromH, neighbors);
+
+                bestToH[i] = fromH;
+                bestCost[i] = std::numeric_limits<float>::max();
+                for (const auto toH: neighbors)
+                {
+                    auto maybeCost = collapseCost(fromH, toH, constFaceNormals);
+                    if (maybeCost && *maybeCost < bestCost[i])
+                    {
+                        bestCost[i] = *maybeCost;
+                        bestToH[i] = toH;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < fromHs.size(); i++)
+        {
+            if (bestToH[i] != fromHs[i])
+            {
+                queue.insert(fromHs[i], bestCost[i]);
+                bestEdge.insert(fromHs[i], bestToH[i]);
+            }
+            else
+            {
+                queue.erase(fromHs[i]);
+            }
+        }
+    };
+
+    // Calculate initial costs of all edges
+    std::cout << timestamp << "Computing all costs for all edges" << std::endl;
+    vector<VertexHandle> updates;
+    updates.reserve(mesh.numVertices());
+    for (const auto vH: mesh.vertices())
+    {
+        updates.push_back(vH);
+    }
+    findBestEdges(updates);
+
+    // Output
+    string msg = timestamp.getElapsedTime()
+        + "Collapsing up to "
+        + std::to_string(count)
+        + "of the edges ";
+    ProgressBar progress(count + 1, msg);
+    ++progress;
+
+    // Round in which a vertex was last part of a chosen one-ring
+    vector<size_t> lockedInRound(mesh.nextVertexIndex(), 0);
+    size_t round = 0;
+
+    vector<std::pair<VertexHandle, VertexHandle>> chosen;
+    vector<MeapPair<VertexHandle, float>> deferred;
+    vector<VertexHandle> ring;
+    vector<VertexHandle> neighbors;
+    vector<FaceHandle> facesAroundMidpoint;
+
+    size_t collapsedEdgeCount = 0;
+
+    while (collapsedEdgeCount < count && !queue.isEmpty())
+    {
+        round++;
+        size_t roundSize = std::max<size_t>(1, queue.numValues() * roundFraction);
+        roundSize = std::min(roundSize, count - collapsedEdgeCount);
+
+        // Choose the cheapest edges with disjoint one-rings
+        chosen.clear();
+        deferred.clear();
+        while (chosen.size() < roundSize && deferred.size() < roundSize && !queue.isEmpty())
+        {
+            auto entry = queue.popMin();
+            const auto fromH = entry.key();
+            const auto toH = bestEdge[fromH];
+            const auto edgeMin = mesh.getEdgeBetween(fromH, toH).unwrap();
+
+            if (!mesh.isCollapsable(edgeMin))
+            {
+                // If we can't collapse this edge, we will just ignore it.
+                continue;
+            }
+
+            ring.clear();
+            ring.push_back(fromH);
+            ring.push_back(toH);
+            mesh.getNeighboursOfVertex(fromH, ring);
+            mesh.getNeighboursOfVertex(toH, ring);
+
+            bool free = true;
+            for (const auto vH: ring)
+            {
+                free &= lockedInRound[vH.idx()] != round;
+            }
+            if (!free)
+            {
+                deferred.push_back(entry);
+                continue;
+            }
+
+            for (const auto vH: ring)
+            {
+                lockedInRound[vH.idx()] = round;
+            }
+            chosen.push_back(std::make_pair(fromH, toH));
+        }
+
+        // Collapse the chosen edges. They do not share any face, so the
+        // order does not matter.
+        updates.clear();
+        for (const auto& edge: chosen)
+        {
+            const auto fromH = edge.first;
+            const auto toH = edge.second;
+
+            auto toPos = mesh.getVertexPosition(toH);
+            auto result = mesh.collapseEdge(mesh.getEdgeBetween(fromH, toH).unwrap());
+            collapsedEdgeCount += 1;
+            ++progress;
+
+            // Set correct position of the new vertex
+            mesh.getVertexPosition(result.midPoint) = toPos;
+
+            // If the `to` vertex was really removed, we have to remove it from
+            // the queue.
+            if (result.midPoint != toH)
+            {
+                queue.erase(toH);
+            }
+
+            // We update the normal of all faces touching the midpoint.
+            facesAroundMidpoint.clear();
+            mesh.getFacesOfVertex(result.midPoint, facesAroundMidpoint);
+            for (auto fH: facesAroundMidpoint)
+            {
+                auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(fH));
+                auto normal = maybeNormal
+                    ? *maybeNormal
+                    : Normal<typename BaseVecT::CoordType>(0, 0, 1);
+
+                faceNormals[fH] = normal;
+            }
+
+            // Remove all entries from that map that belong to now invalid handles
+            for (auto neighbor: result.neighbors)
+            {
+                if (neighbor)
+                {
+                    faceNormals.erase(neighbor->removedFace);
+                }
+            }
+
+            // The best edges of the midpoint and all its neighbors change
+            updates.push_back(result.midPoint);
+            mesh.getNeighboursOfVertex(result.midPoint, updates);
+        }
+
+        // Recompute the changed costs on all threads
+        findBestEdges(updates);
+
+        // Candidates that were skipped because of an overlapping one-ring
+        // keep their cost, unless it has just been recomputed.
+        for (const auto& entry: deferred)
+        {
+            if (lockedInRound[entry.key().idx()] != round)
+            {
+                queue.insert(entry.key(), entry.value());
+            }
+        }
+    }
+
+    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges..." << endl;
+
+    return collapsedEdgeCount;
+}
+
 template<typename BaseVecT>
 size_t simpleMeshReduction(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
-    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    bool parallel
 )
 {
-    vector<EdgeHandle> edgesAroundFrom;
-    vector<FaceHandle> facesAroundFrom;
-
-    return iterativeEdgeCollapse(mesh, count, faceNormals, [&](
+    auto cost = [&](
         VertexHandle fromH,
         VertexHandle toH,
         const FaceMap<Normal<typename BaseVecT::CoordType>>& normals
     ) -> boost::optional<float>
     {
+        // Buffers are reused between calls, one per thread for parallelEdgeCollapse
+        static thread_local vector<EdgeHandle> edgesAroundFrom;
+        static thread_local vector<FaceHandle> facesAroundFrom;
+
         // The minimal value of the dot product between two normals that is allowed.
         const float MIN_NORMAL_DIFF = 0.5;
 
@@ -353,7 +640,290 @@ size_t simpleMeshReduction(
         auto length = mesh.getVertexPosition(fromH).distanceFrom(mesh.getVertexPosition(toH));
 
         return length * curvature;
-    });
+    };
+
+    if (parallel)
+    {
+        return parallelEdgeCollapse(mesh, count, faceNormals, cost);
+    }
+    return iterativeEdgeCollapse(mesh, count, faceNormals, cost);
+}
+
+template<typename BaseVecT>
+size_t quadricMeshReduction(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    const ClusterBiMap<FaceHandle>* clusters,
+    const VertexMap<bool>* fixedVertices
+)
+{
+    using CoordT = typename BaseVecT::CoordType;
+
+    // Weight of the planes that keep boundaries and cluster borders in place
+    const double BORDER_WEIGHT = 1000.0;
+
+    // The minimal value of the dot product between the old and the new
+    // normal of a face that is allowed.
+    const float MIN_NORMAL_DIFF = 0.0;
+
+    std::cout << timestamp << "Reduce mesh by collapsing " << count << " edges using quadrics" << std::endl;
+
+    // Sum the quadrics of all faces at their vertices
+    DenseVertexMap<Quadric> quadrics(mesh.nextVertexIndex(), Quadric());
+    for (const auto fH: mesh.faces())
+    {
+        auto vertices = mesh.getVerticesOfFace(fH);
+        auto positions = mesh.getVertexPositionsOfFace(fH);
+        auto normal = faceNormals[fH];
+        double area = (positions[1] - positions[0]).cross(positions[2] - positions[0]).length() / 2;
+        double d = -normal.dot(positions[0]);
+
+        Quadric quadric(normal.getX(), normal.getY(), normal.getZ(), d, area);
+        for (auto vH: vertices)
+        {
+            quadrics[vH] += quadric;
+        }
+    }
+
+    // Add a plane perpendicular to the face at each boundary or cluster border
+    for (const auto eH: mesh.edges())
+    {
+        auto faces = mesh.getFacesOfEdge(eH);
+        bool border = !faces[0] || !faces[1];
+        if (!border && clusters)
+        {
+            border = clusters->getClusterOf(faces[0].unwrap()) != clusters->getClusterOf(faces[1].unwrap());
+        }
+        if (!border)
+        {
+            continue;
+        }
+
+        auto vertices = mesh.getVerticesOfEdge(eH);
+        auto p0 = mesh.getVertexPosition(vertices[0]);
+        auto edge = mesh.getVertexPosition(vertices[1]) - p0;
+        for (auto fH: faces)
+        {
+            if (!fH)
+            {
+                continue;
+            }
+            auto n = edge.cross(faceNormals[fH.unwrap()]);
+            if (n.length() == 0)
+            {
+                continue;
+            }
+            n.normalize();
+
+            Quadric quadric(n.x, n.y, n.z, -n.dot(p0), BORDER_WEIGHT * edge.length2());
+            quadrics[vertices[0]] += quadric;
+            quadrics[vertices[1]] += quadric;
+        }
+    }
+
+    Meap<VertexHandle, float> queue(mesh.nextVertexIndex());
+    DenseVertexMap<VertexHandle> bestEdge;
+    bestEdge.reserve(mesh.nextVertexIndex());
+    DenseVertexMap<BaseVecT> bestPosition;
+    bestPosition.reserve(mesh.nextVertexIndex());
+
+    // Checks whether moving `vH` to `pos` would flip or degenerate one of
+    // its faces. Faces that also contain `otherH` are removed by the
+    // collapse and ignored.
+    vector<FaceHandle> facesAroundVertex;
+    auto keepsFaces = [&](VertexHandle vH, VertexHandle otherH, const BaseVecT& pos)
+    {
+        facesAroundVertex.clear();
+        mesh.getFacesOfVertex(vH, facesAroundVertex);
+        for (auto fH: facesAroundVertex)
+        {
+            auto vertices = mesh.getVerticesOfFace(fH);
+            if (vertices[0] == otherH || vertices[1] == otherH || vertices[2] == otherH)
+            {
+                continue;
+            }
+
+            std::array<BaseVecT, 3> positions;
+            for (int i = 0; i < 3; i++)
+            {
+                positions[i] = vertices[i] == vH ? pos : mesh.getVertexPosition(vertices[i]);
+            }
+
+            auto newNormal = getFaceNormal(positions);
+            if (!newNormal || newNormal->dot(faceNormals[fH]) < MIN_NORMAL_DIFF)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Finds the outgoing edge with the smallest error, like `updateVertex`
+    // in `iterativeEdgeCollapse`.
+    vector<VertexHandle> neighbors;
+    auto isFixed = [&](VertexHandle vH)
+    {
+        return fixedVertices && (*fixedVertices)[vH];
+    };
+    auto updateVertex = [&](VertexHandle fromH)
+    {
+        if (isFixed(fromH))
+        {
+            return;
+        }
+
+        neighbors.clear();
+        mesh.getNeighboursOfVertex(fromH, neighbors);
+
+        auto bestToH = fromH;
+        auto bestCost = std::numeric_limits<double>::max();
+        BaseVecT bestPos;
+
+        auto fromPos = mesh.getVertexPosition(fromH);
+        for (const auto toH: neighbors)
+        {
+            if (isFixed(toH))
+            {
+                continue;
+            }
+
+            Quadric quadric = quadrics[fromH] + quadrics[toH];
+            auto toPos = mesh.getVertexPosition(toH);
+
+            // Use the optimal position, or the best of both ends and the
+            // middle of the edge if it is not unique
+            BaseVecT pos;
+            double cost;
+            auto minimum = quadric.minimum();
+            if (minimum)
+            {
+                pos = BaseVecT((*minimum)[0], (*minimum)[1], (*minimum)[2]);
+                cost = quadric.error(pos.x, pos.y, pos.z);
+            }
+            else
+            {
+                cost = std::numeric_limits<double>::max();
+                for (auto candidate: { fromPos, toPos, (fromPos + toPos) / 2 })
+                {
+                    double candidateCost = quadric.error(candidate.x, candidate.y, candidate.z);
+                    if (candidateCost < cost)
+                    {
+                        cost = candidateCost;
+                        pos = candidate;
+                    }
+                }
+            }
+
+            if (cost < bestCost && keepsFaces(fromH, toH, pos) && keepsFaces(toH, fromH, pos))
+            {
+                bestCost = cost;
+                bestToH = toH;
+                bestPos = pos;
+            }
+        }
+
+        if (bestToH != fromH)
+        {
+            queue.insert(fromH, bestCost);
+            bestEdge.insert(fromH, bestToH);
+            bestPosition.insert(fromH, bestPos);
+        }
+        else
+        {
+            queue.erase(fromH);
+        }
+    };
+
+    // Output
+    string msg_init = timestamp.getElapsedTime()
+        + "Computing all costs for all edges ";
+    ProgressBar progress_init(mesh.numVertices() + 1, msg_init);
+    ++progress_init;
+
+    // Calculate initial costs of all edges
+    for (const auto fromH: mesh.vertices())
+    {
+        updateVertex(fromH);
+        ++progress_init;
+    }
+
+    // Output
+    string msg = timestamp.getElapsedTime()
+        + "Collapsing up to "
+        + std::to_string(count)
+        + "of the edges ";
+    ProgressBar progress(count + 1, msg);
+    ++progress;
+
+    vector<FaceHandle> facesAroundMidpoint;
+    vector<VertexHandle> midpointNeighbors;
+    size_t collapsedEdgeCount = 0;
+
+    while (collapsedEdgeCount < count && !queue.isEmpty())
+    {
+        const auto fromH = queue.popMin().key();
+        const auto toH = bestEdge[fromH];
+        const auto edgeMin = mesh.getEdgeBetween(fromH, toH).unwrap();
+
+        if (!mesh.isCollapsable(edgeMin))
+        {
+            // If we can't collapse this edge, we will just ignore it.
+            continue;
+        }
+
+        ++progress;
+
+        auto pos = bestPosition[fromH];
+        Quadric quadric = quadrics[fromH] + quadrics[toH];
+        auto result = mesh.collapseEdge(edgeMin);
+        collapsedEdgeCount += 1;
+
+        // The remaining vertex is moved to the optimal position and keeps
+        // the quadrics of both vertices
+        mesh.getVertexPosition(result.midPoint) = pos;
+        quadrics[result.midPoint] = quadric;
+
+        auto removedH = result.midPoint == toH ? fromH : toH;
+        queue.erase(removedH);
+        quadrics.erase(removedH);
+
+        // We update the normal of all faces touching the midpoint.
+        facesAroundMidpoint.clear();
+        mesh.getFacesOfVertex(result.midPoint, facesAroundMidpoint);
+        for (auto fH: facesAroundMidpoint)
+        {
+            auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(fH));
+            auto normal = maybeNormal
+                ? *maybeNormal
+                : Normal<CoordT>(0, 0, 1);
+
+            faceNormals[fH] = normal;
+        }
+
+        // Remove all entries from that map that belong to now invalid handles
+        for (auto neighbor: result.neighbors)
+        {
+            if (neighbor)
+            {
+                faceNormals.erase(neighbor->removedFace);
+            }
+        }
+
+        // Now we just need to update the best edge for the midpoint and all
+        // its neighbors.
+        updateVertex(result.midPoint);
+        midpointNeighbors.clear();
+        mesh.getNeighboursOfVertex(result.midPoint, midpointNeighbors);
+        for (const auto vH: midpointNeighbors)
+        {
+            updateVertex(vH);
+        }
+    }
+
+    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges..." << endl;
+
+    return collapsedEdgeCount;
 }
 
 } // namespace lvr2
@@ -146,28 +146,40 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
     {
         UCharChannel colors = *(surface.pointBuffer()->getUCharChannel("colors"));
 
-        // For each texel find the color of the nearest point
-        #pragma omp parallel for schedule(dynamic,1) collapse(2)
+        // Positions of all texels
+        size_t numTexels = (size_t)sizeX * sizeY;
+        vector<BaseVecT> texelPos(numTexels);
+
+        #pragma omp parallel for collapse(2)
         for (int y = 0; y < sizeY; y++)
         {
             for (int x = 0; x < sizeX; x++)
             {
-                int k = 1; // k-nearest-neighbors
-
-                vector<size_t> cv;
-
-                BaseVecT currentPos =
+                texelPos[(size_t)y * sizeX + x] =
                     boundingRect.m_supportVector
                     + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
                     + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+            }
+        }
 
-                surface.searchTree()->kSearch(currentPos, k, cv);
+        // For each texel find the color of the nearest point
+        const int k = 1; // k-nearest-neighbors
+        vector<size_t> cv(numTexels * k);
+        vector<typename BaseVecT::CoordType> distances(numTexels * k);
+        surface.searchTree()->kSearchMany(texelPos.data(), numTexels, k, cv.data(), distances.data());
+
+        #pragma omp parallel for schedule(dynamic,64) collapse(2)
+        for (int y = 0; y < sizeY; y++)
+        {
+            for (int x = 0; x < sizeX; x++)
+            {
+                size_t texel = (size_t)y * sizeX + x;
 
                 uint8_t r = 0, g = 0, b = 0;
 
-                for (size_t pointIdx : cv)
+                for (int j = 0; j < k; j++)
                 {
-                    auto cur_color = colors[pointIdx];
+                    auto cur_color = colors[cv[texel * k + j]];
                     r += cur_color[0];
                     g += cur_color[1];
                     b += cur_color[2];
@@ -47,6 +47,22 @@
 #define PI 3.14159265
 #define BVH_STACK_SIZE 128
 
+// Number of rays that traverse the BVH together. The packet loops are
+// written for OpenMP SIMD, so one packet fills a vector register of the
+// widest instruction set the library is compiled for. Without SIMD
+// support, every ray traverses the BVH on its own.
+#ifndef BVH_PACKET_SIZE
+#if defined(__AVX512F__)
+#define BVH_PACKET_SIZE 16
+#elif defined(__AVX2__) || defined(__AVX__)
+#define BVH_PACKET_SIZE 8
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+#define BVH_PACKET_SIZE 4
+#else
+#define BVH_PACKET_SIZE 1
+#endif
+#endif
+
 namespace lvr2
 {
 
@@ -80,6 +96,19 @@ public:
         std::vector<uint8_t>& hits
     );
 
+    /**
+     * @brief Enables or disables the traversal of the BVH with packets of
+     *        BVH_PACKET_SIZE rays in castRays (enabled by default). Rays with
+     *        consecutive indices should point in similar directions to benefit.
+     *        Has no effect if BVH_PACKET_SIZE is 1.
+     */
+    void setPacketTraversal(bool enabled) { m_packetTraversal = enabled; }
+
+    /**
+     * @brief Returns true if castRays traverses the BVH with ray packets
+     */
+    bool packetTraversal() const { return m_packetTraversal && BVH_PACKET_SIZE > 1; }
+
 
     /**
      * @struct Ray
@@ -103,11 +132,35 @@ public:
         Vector3f pointHit;
         float hitDist;
     };
+
+    /**
+     * @struct RayPacket
+     * @brief Rays that traverse the BVH together, stored as structure of arrays
+     */
+    struct RayPacket {
+        alignas(64) float ox[BVH_PACKET_SIZE];
+        alignas(64) float oy[BVH_PACKET_SIZE];
+        alignas(64) float oz[BVH_PACKET_SIZE];
+        alignas(64) float dx[BVH_PACKET_SIZE];
+        alignas(64) float dy[BVH_PACKET_SIZE];
+        alignas(64) float dz[BVH_PACKET_SIZE];
+        alignas(64) float invx[BVH_PACKET_SIZE];
+        alignas(64) float invy[BVH_PACKET_SIZE];
+        alignas(64) float invz[BVH_PACKET_SIZE];
+
+        /// Squared distance to the closest hit so far
+        alignas(64) float bestDist[BVH_PACKET_SIZE];
+        alignas(64) float hitx[BVH_PACKET_SIZE];
+        alignas(64) float hity[BVH_PACKET_SIZE];
+        alignas(64) float hitz[BVH_PACKET_SIZE];
+    };
     
 
 protected:
     BVHTree<BaseVector<float> > m_bvh;
 
+    bool m_packetTraversal;
+
 private:
 
 
@@ -131,6 +184,63 @@ private:
      */
     bool rayIntersectsBox(Vector3f origin, Ray ray, const float* boxPtr);
 
+    /**
+     * @brief Calculates whether any ray of a packet intersects a box before
+     *        its closest hit so far
+     * @param packet    The rays
+     * @param boxPtr    A pointer to the box data
+     * @return          A boolean indicating whether the box has to be visited
+     */
+    bool packetIntersectsBox(const RayPacket& packet, const float* boxPtr);
+
+    /**
+     * @brief Calculates the closest intersections of a packet of rays with a scene
+     *        of triangles, given a bounding volume hierarchy. Subtrees are skipped
+     *        as soon as all rays of the packet have a closer hit.
+     *
+     * @param packet                        The rays. The closest hits are stored in the packet,
+     *                                      bestDist stays at its maximum for rays without hit.
+     * @param clBVHindicesOrTriLists        Compressed BVH Node data, see intersectTrianglesBVH
+     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
+     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
+     * @param clTriIdxList                  List of triangle indices
+     */
+    void intersectPacketBVH(
+        RayPacket& packet,
+        const unsigned int* clBVHindicesOrTriLists,
+        const float* clBVHlimits,
+        const float* clTriangleIntersectionData,
+        const unsigned int* clTriIdxList
+    );
+
+    /**
+     * @brief Casts rays in packets of BVH_PACKET_SIZE consecutive rays. The last
+     *        packet is filled up with copies of the last ray.
+     *
+     * @param ray_origin                    Origin of all rays or one origin per ray
+     * @param multi_origin                  True if ray_origin contains one origin per ray
+     * @param rays                          Directions of the rays
+     * @param num_rays                      Number of rays
+     * @param clBVHindicesOrTriLists        Compressed BVH Node data, see intersectTrianglesBVH
+     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
+     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
+     * @param clTriIdxList                  List of triangle indices
+     * @param result                        Result point positions
+     * @param result_hits                   Result hits, where for each ray is stored whether it has hit a triangle
+     */
+    void cast_rays_packets(
+        const float* ray_origin,
+        bool multi_origin,
+        const float* rays,
+        size_t num_rays,
+        const unsigned int* clBVHindicesOrTriLists,
+        const float* clBVHlimits,
+        const float* clTriangleIntersectionData,
+        const unsigned int* clTriIdxList,
+        float* result,
+        uint8_t* result_hits
+    );
+
     /**
      * @brief Calculates the closest intersection of a raycast into a scene of triangles, given a bounding volume hierarchy
      *
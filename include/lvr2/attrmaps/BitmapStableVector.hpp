@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * BitmapStableVector.hpp
+ */
+
+#ifndef LVR2_ATTRMAPS_BITMAPSTABLEVECTOR_H_
+#define LVR2_ATTRMAPS_BITMAPSTABLEVECTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/shared_array.hpp>
+
+using std::move;
+using std::vector;
+
+
+#include "lvr2/util/BaseHandle.hpp"
+#include "lvr2/geometry/Handles.hpp"
+
+
+namespace lvr2
+{
+
+template<typename HandleT, typename ElemT>
+class BitmapStableVector;
+
+/**
+ * @brief Iterator over handles in a BitmapStableVector, which skips deleted
+ *        elements
+ *
+ * Only the deletion bitmap is read while iterating, runs of 64 deleted
+ * elements are skipped at once.
+ *
+ * Important: This is NOT a fail fast iterator. If the vector is changed while
+ * using an instance of this iterator the behavior is undefined!
+ */
+template<typename HandleT, typename ElemT>
+class BitmapStableVectorIterator
+{
+private:
+    /// The vector this iterator belongs to
+    const BitmapStableVector<HandleT, ElemT>* m_vector;
+
+    /// Current position in the vector
+    size_t m_pos;
+public:
+    BitmapStableVectorIterator(const BitmapStableVector<HandleT, ElemT>* vector, bool startAtEnd = false);
+
+    bool operator==(const BitmapStableVectorIterator& other) const;
+    bool operator!=(const BitmapStableVectorIterator& other) const;
+
+    BitmapStableVectorIterator& operator++();
+
+    bool isAtEnd() const;
+
+    HandleT operator*() const;
+};
+
+/**
+ * @brief A StableVector which keeps the deletion markers in a separate bitmap.
+ *
+ * `StableVector` stores a `boost::optional` per element, so each element
+ * carries a flag plus padding and every deletion check touches the element
+ * itself. This variant stores the elements densely without any per-element
+ * overhead and marks used slots in a bitmap with one bit per element. Thus,
+ * iterating over the handles only reads the bitmap.
+ *
+ * The interface is the same as the one of `StableVector`, so both can be used
+ * interchangeably (e.g. as storage of the `HalfEdgeMesh`). Deleted elements
+ * are not destroyed until the vector is cleared or destroyed.
+ *
+ * @tparam HandleT This handle type contains the actual index. It has to be
+ *                 derived from `BaseHandle`!
+ * @tparam ElemT Type of elements in the vector.
+ */
+template<typename HandleT, typename ElemT>
+class BitmapStableVector
+{
+    static_assert(
+        std::is_base_of<BaseHandle<Index>, HandleT>::value,
+        "HandleT must inherit from BaseHandle!"
+    );
+
+public:
+
+    using ElementType = ElemT;
+    using HandleType = HandleT;
+    using iterator = BitmapStableVectorIterator<HandleT, ElemT>;
+
+    /**
+     * @brief Creates an empty BitmapStableVector.
+     */
+    BitmapStableVector() : m_usedCount(0) {};
+
+    /**
+     * @brief Creates a BitmapStableVector with `countElements` many copies of
+     *        `defaultValue`.
+     */
+    BitmapStableVector(size_t countElements, const ElementType& defaultValue);
+
+    BitmapStableVector(size_t countElements, const boost::shared_array<ElementType>& sharedArray);
+
+    /// @see StableVector::push(const ElementType&)
+    HandleType push(const ElementType& elem);
+
+    /// @see StableVector::push(ElementType&&)
+    HandleType push(ElementType&& elem);
+
+    /**
+     * @brief Increases the size of the vector to the length of `upTo`.
+     *
+     * The new elements are default constructed and marked as deleted.
+     *
+     * @see StableVector::increaseSize(HandleType)
+     */
+    void increaseSize(HandleType upTo);
+
+    /// @see StableVector::increaseSize(HandleType, const ElementType&)
+    void increaseSize(HandleType upTo, const ElementType& elem);
+
+    /// @see StableVector::nextHandle()
+    HandleType nextHandle() const;
+
+    /// @see StableVector::erase()
+    void erase(HandleType handle);
+
+    /// @see StableVector::clear()
+    void clear();
+
+    /// @see StableVector::get()
+    boost::optional<ElementType&> get(HandleType handle);
+
+    /// @see StableVector::get()
+    boost::optional<const ElementType&> get(HandleType handle) const;
+
+    /// @see StableVector::set()
+    void set(HandleType handle, const ElementType& elem);
+
+    /// @see StableVector::set()
+    void set(HandleType handle, ElementType&& elem);
+
+    /// @see StableVector::operator[]()
+    ElementType& operator[](HandleType handle);
+
+    /// @see StableVector::operator[]()
+    const ElementType& operator[](HandleType handle) const;
+
+    /**
+     * @brief Absolute size of the vector (including deleted elements).
+     */
+    size_t size() const;
+
+    /**
+     * @brief Number of not deleted elements.
+     */
+    size_t numUsed() const;
+
+    /**
+     * @brief Returns true if the element behind `handle` exists.
+     */
+    bool isUsed(HandleType handle) const;
+
+    /**
+     * @brief Returns an iterator to the first element of this vector.
+     */
+    iterator begin() const;
+
+    /**
+     * @brief Returns an iterator to the element after the last element of
+     *        this vector.
+     */
+    iterator end() const;
+
+    /**
+     * @brief Increase the capacity of the vector to a value that's greater
+     *        or equal to newCap.
+     *
+     * @see StableVector::reserve(size_t)
+     */
+    void reserve(size_t newCap);
+
+private:
+    /// Count of used elements in elements vector
+    size_t m_usedCount;
+
+    /// Vector for stored elements
+    vector<ElemT> m_elements;
+
+    /// One bit per element, set if the element is not deleted
+    vector<uint64_t> m_used;
+
+    void checkAccess(HandleType handle) const;
+
+    void setUsed(size_t idx, bool used);
+
+    template<typename, typename> friend class BitmapStableVectorIterator;
+};
+
+} // namespace lvr2
+
+#include "lvr2/attrmaps/BitmapStableVector.tcc"
+
+#endif /* LVR2_ATTRMAPS_BITMAPSTABLEVECTOR_H_ */
@@ -0,0 +1,362 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * BitmapStableVector.tcc
+ */
+
+#include "lvr2/util/Panic.hpp"
+#include <boost/shared_array.hpp>
+
+#include <sstream>
+#include <string>
+
+
+namespace lvr2
+{
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::checkAccess(HandleType handle) const
+{
+    // Make sure the handle is not OOB
+    if (handle.idx() >= size())
+    {
+        std::stringstream ss;
+        ss << "lookup with an out of bounds handle (" << handle.idx() << ") in BitmapStableVector";
+        panic(ss.str());
+    }
+
+    // You cannot access deleted or uninitialized elements!
+    if (!isUsed(handle))
+    {
+        panic("attempt to access a deleted value in BitmapStableVector");
+    }
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::setUsed(size_t idx, bool used)
+{
+    if (used)
+    {
+        m_used[idx / 64] |= uint64_t(1) << (idx % 64);
+    }
+    else
+    {
+        m_used[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVector<HandleT, ElemT>::BitmapStableVector(size_t countElements, const ElementType& defaultValue)
+    : m_usedCount(countElements),
+      m_elements(countElements, defaultValue),
+      m_used((countElements + 63) / 64, ~uint64_t(0))
+{
+    if (countElements % 64)
+    {
+        m_used.back() = (uint64_t(1) << (countElements % 64)) - 1;
+    }
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVector<HandleT, ElemT>::BitmapStableVector(size_t countElements, const boost::shared_array<ElementType>& sharedArray)
+    : m_usedCount(countElements),
+      m_elements(sharedArray.get(), sharedArray.get() + countElements),
+      m_used((countElements + 63) / 64, ~uint64_t(0))
+{
+    if (countElements % 64)
+    {
+        m_used.back() = (uint64_t(1) << (countElements % 64)) - 1;
+    }
+}
+
+template<typename HandleT, typename ElemT>
+HandleT BitmapStableVector<HandleT, ElemT>::push(const ElementType& elem)
+{
+    m_elements.push_back(elem);
+    if (m_used.size() * 64 < m_elements.size())
+    {
+        m_used.push_back(0);
+    }
+    setUsed(m_elements.size() - 1, true);
+    ++m_usedCount;
+    return HandleT(size() - 1);
+}
+
+template<typename HandleT, typename ElemT>
+HandleT BitmapStableVector<HandleT, ElemT>::push(ElementType&& elem)
+{
+    m_elements.push_back(move(elem));
+    if (m_used.size() * 64 < m_elements.size())
+    {
+        m_used.push_back(0);
+    }
+    setUsed(m_elements.size() - 1, true);
+    ++m_usedCount;
+    return HandleT(size() - 1);
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::increaseSize(HandleType upTo)
+{
+    if (upTo.idx() < size())
+    {
+        panic("call to increaseSize() with a valid handle!");
+    }
+
+    m_elements.resize(upTo.idx());
+    m_used.resize((upTo.idx() + 63) / 64, 0);
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::increaseSize(HandleType upTo, const ElementType& elem)
+{
+    if (upTo.idx() < size())
+    {
+        panic("call to increaseSize() with a valid handle!");
+    }
+
+    size_t oldSize = size();
+    m_elements.resize(upTo.idx(), elem);
+    m_used.resize((upTo.idx() + 63) / 64, 0);
+    for (size_t i = oldSize; i < size(); i++)
+    {
+        setUsed(i, true);
+    }
+    m_usedCount += size() - oldSize;
+}
+
+template <typename HandleT, typename ElemT>
+HandleT BitmapStableVector<HandleT, ElemT>::nextHandle() const
+{
+    return HandleT(size());
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::erase(HandleType handle)
+{
+    checkAccess(handle);
+
+    setUsed(handle.idx(), false);
+    --m_usedCount;
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::clear()
+{
+    m_elements.clear();
+    m_used.clear();
+    m_usedCount = 0;
+}
+
+template<typename HandleT, typename ElemT>
+boost::optional<ElemT&> BitmapStableVector<HandleT, ElemT>::get(HandleType handle)
+{
+    if (handle.idx() >= size() || !isUsed(handle))
+    {
+        return boost::none;
+    }
+    return m_elements[handle.idx()];
+}
+
+template<typename HandleT, typename ElemT>
+boost::optional<const ElemT&> BitmapStableVector<HandleT, ElemT>::get(HandleType handle) const
+{
+    if (handle.idx() >= size() || !isUsed(handle))
+    {
+        return boost::none;
+    }
+    return m_elements[handle.idx()];
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::set(HandleType handle, const ElementType& elem)
+{
+    // check access
+    if (handle.idx() >= size())
+    {
+        panic("attempt to append new element in BitmapStableVector with set() -> use push()!");
+    }
+
+    // insert element
+    if (!isUsed(handle))
+    {
+        setUsed(handle.idx(), true);
+        ++m_usedCount;
+    }
+    m_elements[handle.idx()] = elem;
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::set(HandleType handle, ElementType&& elem)
+{
+    // check access
+    if (handle.idx() >= size())
+    {
+        panic("attempt to append new element in BitmapStableVector with set() -> use push()!");
+    }
+
+    // insert element
+    if (!isUsed(handle))
+    {
+        setUsed(handle.idx(), true);
+        ++m_usedCount;
+    }
+    m_elements[handle.idx()] = move(elem);
+}
+
+template<typename HandleT, typename ElemT>
+ElemT& BitmapStableVector<HandleT, ElemT>::operator[](HandleType handle)
+{
+    checkAccess(handle);
+    return m_elements[handle.idx()];
+}
+
+template<typename HandleT, typename ElemT>
+const ElemT& BitmapStableVector<HandleT, ElemT>::operator[](HandleType handle) const
+{
+    checkAccess(handle);
+    return m_elements[handle.idx()];
+}
+
+template<typename HandleT, typename ElemT>
+size_t BitmapStableVector<HandleT, ElemT>::size() const
+{
+    return m_elements.size();
+}
+
+template<typename HandleT, typename ElemT>
+size_t BitmapStableVector<HandleT, ElemT>::numUsed() const
+{
+    return m_usedCount;
+}
+
+template<typename HandleT, typename ElemT>
+bool BitmapStableVector<HandleT, ElemT>::isUsed(HandleType handle) const
+{
+    return (m_used[handle.idx() / 64] >> (handle.idx() % 64)) & 1;
+}
+
+template<typename HandleT, typename ElemT>
+void BitmapStableVector<HandleT, ElemT>::reserve(size_t newCap)
+{
+    m_elements.reserve(newCap);
+    m_used.reserve((newCap + 63) / 64);
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVectorIterator<HandleT, ElemT> BitmapStableVector<HandleT, ElemT>::begin() const
+{
+    return BitmapStableVectorIterator<HandleT, ElemT>(this);
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVectorIterator<HandleT, ElemT> BitmapStableVector<HandleT, ElemT>::end() const
+{
+    return BitmapStableVectorIterator<HandleT, ElemT>(this, true);
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVectorIterator<HandleT, ElemT>::BitmapStableVectorIterator(
+    const BitmapStableVector<HandleT, ElemT>* vector,
+    bool startAtEnd
+)
+    : m_vector(vector), m_pos(startAtEnd ? vector->size() : 0)
+{
+    if (m_pos == 0 && vector->size() > 0 && !vector->isUsed(HandleT(0)))
+    {
+        ++(*this);
+    }
+}
+
+template<typename HandleT, typename ElemT>
+bool BitmapStableVectorIterator<HandleT, ElemT>::operator==(
+    const BitmapStableVectorIterator<HandleT, ElemT>& other
+) const
+{
+    return m_pos == other.m_pos && m_vector == other.m_vector;
+}
+
+template<typename HandleT, typename ElemT>
+bool BitmapStableVectorIterator<HandleT, ElemT>::operator!=(
+    const BitmapStableVectorIterator<HandleT, ElemT>& other
+) const
+{
+    return !(*this == other);
+}
+
+template<typename HandleT, typename ElemT>
+BitmapStableVectorIterator<HandleT, ElemT>& BitmapStableVectorIterator<HandleT, ElemT>::operator++()
+{
+    const size_t size = m_vector->size();
+    const vector<uint64_t>& used = m_vector->m_used;
+
+    // If not at the end, advance by one element
+    if (m_pos < size)
+    {
+        m_pos++;
+    }
+
+    // Advance to the next used element or to the end of the vector. Words
+    // without any used element are skipped completely.
+    while (m_pos < size)
+    {
+        uint64_t word = used[m_pos / 64] >> (m_pos % 64);
+        if (word == 0)
+        {
+            m_pos = (m_pos / 64 + 1) * 64;
+            continue;
+        }
+        while (!(word & 1))
+        {
+            word >>= 1;
+            m_pos++;
+        }
+        break;
+    }
+
+    if (m_pos > size)
+    {
+        m_pos = size;
+    }
+
+    return *this;
+}
+
+template<typename HandleT, typename ElemT>
+bool BitmapStableVectorIterator<HandleT, ElemT>::isAtEnd() const
+{
+    return m_pos == m_vector->size();
+}
+
+template<typename HandleT, typename ElemT>
+HandleT BitmapStableVectorIterator<HandleT, ElemT>::operator*() const
+{
+    return HandleT(m_pos);
+}
+
+} // namespace lvr2
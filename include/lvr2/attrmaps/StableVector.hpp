@@ -112,6 +112,7 @@ public:
 
     using ElementType = ElemT;
     using HandleType = HandleT;
+    using iterator = StableVectorIterator<HandleT, ElemT>;
 
     /**
      * @brief Creates an empty StableVector.
@@ -72,6 +72,9 @@ struct convert<lvr2::LSROptions>
         node["smallRegionThreshold"] = options.smallRegionThreshold;
         node["retesselate"] = options.retesselate;
         node["lineFusionThreshold"] = options.lineFusionThreshold;
+        node["parallelPartitions"] = options.parallelPartitions;
+        node["partitionMemoryBudget"] = options.partitionMemoryBudget;
+        node["gridDirectory"] = options.gridDirectory;
 
         return node;
     }
@@ -203,6 +206,21 @@ struct convert<lvr2::LSROptions>
             options.lineFusionThreshold = node["lineFusionThreshold"].as<float>();
         }
 
+        if (node["parallelPartitions"])
+        {
+            options.parallelPartitions = node["parallelPartitions"].as<uint>();
+        }
+
+        if (node["partitionMemoryBudget"])
+        {
+            options.partitionMemoryBudget = node["partitionMemoryBudget"].as<size_t>();
+        }
+
+        if (node["gridDirectory"])
+        {
+            options.gridDirectory = node["gridDirectory"].as<std::string>();
+        }
+
         return true;
     }
 };
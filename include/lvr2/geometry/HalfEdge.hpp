@@ -95,7 +95,7 @@ private:
     HalfEdge() : target(0), next(0), twin(0) {}
 
     /// Several methods of HEM need to invoke the unsafe ctor.
-    template <typename BaseVecT>
+    template <typename BaseVecT, template<typename, typename> class VectorT>
     friend class HalfEdgeMesh;
 };
 
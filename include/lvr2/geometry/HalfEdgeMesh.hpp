@@ -38,6 +38,7 @@
 #include <cstdint>
 #include <utility>
 #include "lvr2/attrmaps/StableVector.hpp"
+#include "lvr2/attrmaps/BitmapStableVector.hpp"
 #include <array>
 #include <vector>
 
@@ -65,8 +66,13 @@ namespace lvr2
  * primarily intended for non-triangle meshes (variable number of edges per
  * face). Using it for triangle meshes might be overkill and results in a
  * memory overhead.
+ *
+ * @tparam VectorT  Storage of the edges, faces and vertices. Either
+ *                  `StableVector` or `BitmapStableVector`. The latter keeps
+ *                  the deletion markers in a separate bitmap, which makes
+ *                  the elements smaller and iterating over handles cheaper.
  */
-template<typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT = StableVector>
 class HalfEdgeMesh : public BaseMesh<BaseVecT>
 {
 public:
@@ -74,9 +80,49 @@ public:
     using Face = HalfEdgeFace;
     using Vertex = HalfEdgeVertex<BaseVecT>;
 
+    using EdgeVector = VectorT<HalfEdgeHandle, Edge>;
+    using FaceVector = VectorT<FaceHandle, Face>;
+    using VertexVector = VectorT<VertexHandle, Vertex>;
+
     HalfEdgeMesh();
     HalfEdgeMesh(MeshBufferPtr ptr);
 
+    /**
+     * @brief Builds the mesh from an indexed face set.
+     *
+     * Twin edges are paired by bucketing all directed edges by their smaller
+     * vertex index instead of searching the edge ring of each vertex, so
+     * building large meshes takes linear time. The resulting handles are the
+     * same as when adding all vertices and faces one by one. If the input is
+     * not an oriented manifold, the faces are added one by one with
+     * `addFace()` and faces rejected by it are omitted with a warning.
+     *
+     * @param vertices      Vertex positions (3 floats per vertex)
+     * @param numVertices   Number of vertices
+     * @param indices       Vertex indices (3 per face)
+     * @param numFaces      Number of faces
+     */
+    HalfEdgeMesh(floatArr vertices, size_t numVertices, indexArray indices, size_t numFaces);
+
+    /**
+     * @brief Adds all given faces to a mesh that contains vertices only.
+     *
+     * Directed edges are sorted by their smaller vertex index to find the
+     * twins, afterwards all edges and faces are written in one pass. Handles
+     * are assigned in the same order `addFace()` would assign them, i.e. the
+     * i-th face gets the handle `FaceHandle(i)`.
+     *
+     * @param indices   Vertex handle indices (3 per face)
+     * @param numFaces  Number of faces
+     *
+     * @return  False if the mesh already contains faces or the faces do not
+     *          form an oriented manifold (an edge is used by more than two
+     *          faces or twice in the same direction, a face is degenerated or
+     *          the faces around a vertex can't be ordered). The mesh is
+     *          unchanged in this case.
+     */
+    bool addFacesFromIndices(const unsigned int* indices, size_t numFaces);
+
     // ========================================================================
     // = Implementing the `BaseMesh` interface (see BaseMesh for docs)
     // ========================================================================
@@ -145,10 +191,24 @@ public:
 
     bool debugCheckMeshIntegrity() const;
 
+    /**
+     * @brief Removes the gaps left by deleted elements and renumbers all
+     *        handles.
+     *
+     * Deleted vertices, faces and edges are never freed by the element
+     * vectors. After heavy edge collapsing this wastes memory and makes
+     * every iteration skip lots of deleted entries. This method moves all
+     * remaining elements to the front, keeping their relative order.
+     *
+     * All handles obtained before and all attribute maps using them are
+     * invalidated by this call!
+     */
+    void compact();
+
 private:
-    StableVector<HalfEdgeHandle, Edge> m_edges;
-    StableVector<FaceHandle, Face> m_faces;
-    StableVector<VertexHandle, Vertex> m_vertices;
+    EdgeVector m_edges;
+    FaceVector m_faces;
+    VertexVector m_vertices;
 
     // ========================================================================
     // = Private helper methods
@@ -258,31 +318,33 @@ private:
     // ========================================================================
     // = Friends
     // ========================================================================
-    template<typename> friend class HemEdgeIterator;
+    template<typename, template<typename, typename> class> friend class HemEdgeIterator;
 };
 
 /// Implementation of the MeshHandleIterator for the HalfEdgeMesh
-template<typename HandleT, typename ElemT>
+template<typename HandleT, typename IteratorT>
 class HemFevIterator : public MeshHandleIterator<HandleT>
 {
 public:
-    HemFevIterator(StableVectorIterator<HandleT, ElemT> iterator) : m_iterator(iterator) {};
+    HemFevIterator(IteratorT iterator) : m_iterator(iterator) {};
     HemFevIterator& operator++();
     bool operator==(const MeshHandleIterator<HandleT>& other) const;
     bool operator!=(const MeshHandleIterator<HandleT>& other) const;
     HandleT operator*() const;
 
 private:
-    StableVectorIterator<HandleT, ElemT> m_iterator;
+    IteratorT m_iterator;
 };
 
-template<typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT = StableVector>
 class HemEdgeIterator : public MeshHandleIterator<EdgeHandle>
 {
 public:
+    using IteratorT = typename HalfEdgeMesh<BaseVecT, VectorT>::EdgeVector::iterator;
+
     HemEdgeIterator(
-        StableVectorIterator<HalfEdgeHandle, HalfEdge> iterator,
-        const HalfEdgeMesh<BaseVecT>& mesh
+        IteratorT iterator,
+        const HalfEdgeMesh<BaseVecT, VectorT>& mesh
     ) : m_iterator(iterator), m_mesh(mesh) {};
 
     HemEdgeIterator& operator++();
@@ -291,8 +353,8 @@ public:
     EdgeHandle operator*() const;
 
 private:
-    StableVectorIterator<HalfEdgeHandle, HalfEdge> m_iterator;
-    const HalfEdgeMesh<BaseVecT>& m_mesh;
+    IteratorT m_iterator;
+    const HalfEdgeMesh<BaseVecT, VectorT>& m_mesh;
 };
 
 } // namespace lvr2
@@ -36,6 +36,7 @@
 #include <array>
 #include <utility>
 #include <iostream>
+#include <limits>
 
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/util/Panic.hpp"
@@ -45,20 +46,25 @@
 namespace lvr2
 {
 
-template<typename BaseVecT>
-HalfEdgeMesh<BaseVecT>::HalfEdgeMesh()
+template<typename BaseVecT, template<typename, typename> class VectorT>
+HalfEdgeMesh<BaseVecT, VectorT>::HalfEdgeMesh()
 {
 }
 
-template<typename BaseVecT>
-HalfEdgeMesh<BaseVecT>::HalfEdgeMesh(MeshBufferPtr ptr)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+HalfEdgeMesh<BaseVecT, VectorT>::HalfEdgeMesh(MeshBufferPtr ptr)
+    : HalfEdgeMesh(ptr->getVertices(), ptr->numVertices(), ptr->getFaceIndices(), ptr->numFaces())
 {
-    size_t numFaces = ptr->numFaces();
-    size_t numVertices = ptr->numVertices();
-
-    floatArr vertices = ptr->getVertices();
-    indexArray indices = ptr->getFaceIndices();
+}
 
+template<typename BaseVecT, template<typename, typename> class VectorT>
+HalfEdgeMesh<BaseVecT, VectorT>::HalfEdgeMesh(
+    floatArr vertices,
+    size_t numVertices,
+    indexArray indices,
+    size_t numFaces)
+{
+    m_vertices.reserve(numVertices);
     for(size_t i = 0; i < numVertices; i++)
     {
         size_t pos = 3 * i;
@@ -68,6 +74,13 @@ HalfEdgeMesh<BaseVecT>::HalfEdgeMesh(MeshBufferPtr ptr)
                             vertices[pos + 2]));
     }
 
+    if(addFacesFromIndices(indices.get(), numFaces))
+    {
+        return;
+    }
+
+    // Non-manifold input: add the faces one by one and let addFace() decide
+    // which of them can be inserted.
     for(size_t i = 0; i < numFaces; i++)
     {
         size_t pos = 3 * i;
@@ -91,16 +104,16 @@ HalfEdgeMesh<BaseVecT>::HalfEdgeMesh(MeshBufferPtr ptr)
 // = Interface methods
 // ========================================================================
 
-template <typename BaseVecT>
-VertexHandle HalfEdgeMesh<BaseVecT>::addVertex(BaseVecT pos)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+VertexHandle HalfEdgeMesh<BaseVecT, VectorT>::addVertex(BaseVecT pos)
 {
     Vertex v;
     v.pos = pos;
     return m_vertices.push(v);
 }
 
-template <typename BaseVecT>
-FaceHandle HalfEdgeMesh<BaseVecT>::addFace(VertexHandle v1H, VertexHandle v2H, VertexHandle v3H)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+FaceHandle HalfEdgeMesh<BaseVecT, VectorT>::addFace(VertexHandle v1H, VertexHandle v2H, VertexHandle v3H)
 {
     using std::make_tuple;
 
@@ -431,8 +444,8 @@ FaceHandle HalfEdgeMesh<BaseVecT>::addFace(VertexHandle v1H, VertexHandle v2H, V
     return newFaceH;
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::removeFace(FaceHandle handle)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::removeFace(FaceHandle handle)
 {
     // Marker vertices, to save the vertices and edges which will be deleted
     vector<HalfEdgeHandle> edgesToRemove;
@@ -548,75 +561,75 @@ void HalfEdgeMesh<BaseVecT>::removeFace(FaceHandle handle)
     m_faces.erase(handle);
 }
 
-template <typename BaseVecT>
-size_t HalfEdgeMesh<BaseVecT>::numVertices() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+size_t HalfEdgeMesh<BaseVecT, VectorT>::numVertices() const
 {
     return m_vertices.numUsed();
 }
 
-template <typename BaseVecT>
-size_t HalfEdgeMesh<BaseVecT>::numFaces() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+size_t HalfEdgeMesh<BaseVecT, VectorT>::numFaces() const
 {
     return m_faces.numUsed();
 }
 
-template <typename BaseVecT>
-size_t HalfEdgeMesh<BaseVecT>::numEdges() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+size_t HalfEdgeMesh<BaseVecT, VectorT>::numEdges() const
 {
     return m_edges.numUsed() / 2;
 }
 
-template <typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::containsVertex(VertexHandle vH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::containsVertex(VertexHandle vH) const
 {
     return static_cast<bool>(m_vertices.get(vH));
 }
 
-template <typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::containsFace(FaceHandle fH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::containsFace(FaceHandle fH) const
 {
     return static_cast<bool>(m_faces.get(fH));
 }
 
-template <typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::containsEdge(EdgeHandle eH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::containsEdge(EdgeHandle eH) const
 {
     return static_cast<bool>(m_edges.get(HalfEdgeHandle::oneHalfOf(eH)));
 }
 
-template <typename BaseVecT>
-Index HalfEdgeMesh<BaseVecT>::nextVertexIndex() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+Index HalfEdgeMesh<BaseVecT, VectorT>::nextVertexIndex() const
 {
     return m_vertices.nextHandle().idx();
 }
 
-template <typename BaseVecT>
-Index HalfEdgeMesh<BaseVecT>::nextFaceIndex() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+Index HalfEdgeMesh<BaseVecT, VectorT>::nextFaceIndex() const
 {
     return m_faces.nextHandle().idx();
 }
 
-template <typename BaseVecT>
-Index HalfEdgeMesh<BaseVecT>::nextEdgeIndex() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+Index HalfEdgeMesh<BaseVecT, VectorT>::nextEdgeIndex() const
 {
     return m_edges.nextHandle().idx();
 }
 
 
-template <typename BaseVecT>
-BaseVecT HalfEdgeMesh<BaseVecT>::getVertexPosition(VertexHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+BaseVecT HalfEdgeMesh<BaseVecT, VectorT>::getVertexPosition(VertexHandle handle) const
 {
     return getV(handle).pos;
 }
 
-template <typename BaseVecT>
-BaseVecT& HalfEdgeMesh<BaseVecT>::getVertexPosition(VertexHandle handle)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+BaseVecT& HalfEdgeMesh<BaseVecT, VectorT>::getVertexPosition(VertexHandle handle)
 {
     return getV(handle).pos;
 }
 
-template <typename BaseVecT>
-array<VertexHandle, 3> HalfEdgeMesh<BaseVecT>::getVerticesOfFace(FaceHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+array<VertexHandle, 3> HalfEdgeMesh<BaseVecT, VectorT>::getVerticesOfFace(FaceHandle handle) const
 {
     auto face = getF(handle);
 
@@ -627,8 +640,8 @@ array<VertexHandle, 3> HalfEdgeMesh<BaseVecT>::getVerticesOfFace(FaceHandle hand
     return {e1.target, e2.target, e3.target};
 }
 
-template <typename BaseVecT>
-array<EdgeHandle, 3> HalfEdgeMesh<BaseVecT>::getEdgesOfFace(FaceHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+array<EdgeHandle, 3> HalfEdgeMesh<BaseVecT, VectorT>::getEdgesOfFace(FaceHandle handle) const
 {
     auto innerEdges = getInnerEdges(handle);
     return {
@@ -638,8 +651,8 @@ array<EdgeHandle, 3> HalfEdgeMesh<BaseVecT>::getEdgesOfFace(FaceHandle handle) c
     };
 }
 
-template <typename BaseVecT>
-array<HalfEdgeHandle, 3> HalfEdgeMesh<BaseVecT>::getInnerEdges(FaceHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+array<HalfEdgeHandle, 3> HalfEdgeMesh<BaseVecT, VectorT>::getInnerEdges(FaceHandle handle) const
 {
     auto face = getF(handle);
 
@@ -650,8 +663,8 @@ array<HalfEdgeHandle, 3> HalfEdgeMesh<BaseVecT>::getInnerEdges(FaceHandle handle
     return {face.edge, e1.next, e2.next};
 }
 
-template <typename BaseVecT>
-OptionalFaceHandle HalfEdgeMesh<BaseVecT>::getOppositeFace(FaceHandle faceH, VertexHandle vertexH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+OptionalFaceHandle HalfEdgeMesh<BaseVecT, VectorT>::getOppositeFace(FaceHandle faceH, VertexHandle vertexH) const
 {
   auto e = getE(getF(faceH).edge);
   for(size_t i=0; i<3; i++)
@@ -664,8 +677,8 @@ OptionalFaceHandle HalfEdgeMesh<BaseVecT>::getOppositeFace(FaceHandle faceH, Ver
   return OptionalFaceHandle();
 }
 
-template <typename BaseVecT>
-OptionalEdgeHandle HalfEdgeMesh<BaseVecT>::getOppositeEdge(FaceHandle faceH, VertexHandle vertexH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+OptionalEdgeHandle HalfEdgeMesh<BaseVecT, VectorT>::getOppositeEdge(FaceHandle faceH, VertexHandle vertexH) const
 {
   auto eH = getF(faceH).edge;
   for(size_t i=0; i<3; i++)
@@ -678,8 +691,8 @@ OptionalEdgeHandle HalfEdgeMesh<BaseVecT>::getOppositeEdge(FaceHandle faceH, Ver
   return OptionalEdgeHandle();
 }
 
-template <typename BaseVecT>
-OptionalVertexHandle HalfEdgeMesh<BaseVecT>::getOppositeVertex(FaceHandle faceH, EdgeHandle edgeH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+OptionalVertexHandle HalfEdgeMesh<BaseVecT, VectorT>::getOppositeVertex(FaceHandle faceH, EdgeHandle edgeH) const
 {
   auto e1 = getE(HalfEdgeHandle::oneHalfOf(edgeH));
   if(e1.face && e1.face.unwrap() == faceH)
@@ -693,8 +706,8 @@ OptionalVertexHandle HalfEdgeMesh<BaseVecT>::getOppositeVertex(FaceHandle faceH,
     return OptionalVertexHandle();
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::getNeighboursOfFace(
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::getNeighboursOfFace(
     FaceHandle handle,
     vector<FaceHandle>& facesOut
 ) const
@@ -726,8 +739,8 @@ void HalfEdgeMesh<BaseVecT>::getNeighboursOfFace(
     }
 }
 
-template<typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::isBorderEdge(EdgeHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::isBorderEdge(EdgeHandle handle) const
 {
     HalfEdgeHandle h = HalfEdgeHandle::oneHalfOf(handle);
 
@@ -744,24 +757,24 @@ bool HalfEdgeMesh<BaseVecT>::isBorderEdge(EdgeHandle handle) const
 }
 
 
-template <typename BaseVecT>
-array<VertexHandle, 2> HalfEdgeMesh<BaseVecT>::getVerticesOfEdge(EdgeHandle edgeH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+array<VertexHandle, 2> HalfEdgeMesh<BaseVecT, VectorT>::getVerticesOfEdge(EdgeHandle edgeH) const
 {
     auto oneEdgeH = HalfEdgeHandle::oneHalfOf(edgeH);
     auto oneEdge = getE(oneEdgeH);
     return { oneEdge.target, getE(oneEdge.twin).target };
 }
 
-template <typename BaseVecT>
-array<OptionalFaceHandle, 2> HalfEdgeMesh<BaseVecT>::getFacesOfEdge(EdgeHandle edgeH) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+array<OptionalFaceHandle, 2> HalfEdgeMesh<BaseVecT, VectorT>::getFacesOfEdge(EdgeHandle edgeH) const
 {
     auto oneEdgeH = HalfEdgeHandle::oneHalfOf(edgeH);
     auto oneEdge = getE(oneEdgeH);
     return { oneEdge.face, getE(oneEdge.twin).face };
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::getFacesOfVertex(
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::getFacesOfVertex(
     VertexHandle handle,
     vector<FaceHandle>& facesOut
 ) const
@@ -777,8 +790,8 @@ void HalfEdgeMesh<BaseVecT>::getFacesOfVertex(
     });
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::getEdgesOfVertex(
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::getEdgesOfVertex(
     VertexHandle handle,
     vector<EdgeHandle>& edgesOut
 ) const
@@ -799,8 +812,8 @@ void HalfEdgeMesh<BaseVecT>::getEdgesOfVertex(
 }
 
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::getNeighboursOfVertex(
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::getNeighboursOfVertex(
     VertexHandle handle,
     vector<VertexHandle>& verticesOut
 ) const
@@ -819,8 +832,8 @@ void HalfEdgeMesh<BaseVecT>::getNeighboursOfVertex(
  * @param vH2
  * @return a vector with the common neighbors
  */
-template <typename BaseVecT>
-vector<VertexHandle> HalfEdgeMesh<BaseVecT>::findCommonNeigbours(VertexHandle vH1, VertexHandle vH2){
+template<typename BaseVecT, template<typename, typename> class VectorT>
+vector<VertexHandle> HalfEdgeMesh<BaseVecT, VectorT>::findCommonNeigbours(VertexHandle vH1, VertexHandle vH2){
     vector<VertexHandle> vH1nb = this->getNeighboursOfVertex(vH1);
     vector<VertexHandle> vH2nb = this->getNeighboursOfVertex(vH2);
 
@@ -850,8 +863,8 @@ vector<VertexHandle> HalfEdgeMesh<BaseVecT>::findCommonNeigbours(VertexHandle vH
  * @param faceH
  * @return
  */
-template <typename BaseVecT>
-std::pair<BaseVecT, float> HalfEdgeMesh<BaseVecT>::triCircumCenter(FaceHandle faceH) {
+template<typename BaseVecT, template<typename, typename> class VectorT>
+std::pair<BaseVecT, float> HalfEdgeMesh<BaseVecT, VectorT>::triCircumCenter(FaceHandle faceH) {
     //get vertices of the face
     auto vertices = getVerticesOfFace(faceH);
     BaseVecT a = getV(vertices[0]).pos;
@@ -882,8 +895,8 @@ std::pair<BaseVecT, float> HalfEdgeMesh<BaseVecT>::triCircumCenter(FaceHandle fa
  * @param edgeH
  * @return a result containg the newly added vertex and the new faces
  */
-template <typename BaseVecT>
-EdgeSplitResult HalfEdgeMesh<BaseVecT>::splitEdge(EdgeHandle edgeH) {
+template<typename BaseVecT, template<typename, typename> class VectorT>
+EdgeSplitResult HalfEdgeMesh<BaseVecT, VectorT>::splitEdge(EdgeHandle edgeH) {
 
     if(this->isBorderEdge(edgeH))
     {
@@ -1059,8 +1072,8 @@ EdgeSplitResult HalfEdgeMesh<BaseVecT>::splitEdge(EdgeHandle edgeH) {
  * @param vertexToBeSplitH
  * @return a struct containing the new vertex and the added faces
  */
-template <typename BaseVecT>
-VertexSplitResult HalfEdgeMesh<BaseVecT>::splitVertex(VertexHandle vertexToBeSplitH)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+VertexSplitResult HalfEdgeMesh<BaseVecT, VectorT>::splitVertex(VertexHandle vertexToBeSplitH)
 {
 
     HalfEdge longestOutgoingEdge;
@@ -1162,8 +1175,8 @@ VertexSplitResult HalfEdgeMesh<BaseVecT>::splitVertex(VertexHandle vertexToBeSpl
 }
 
 
-template <typename BaseVecT>
-EdgeCollapseResult HalfEdgeMesh<BaseVecT>::collapseEdge(EdgeHandle edgeH)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+EdgeCollapseResult HalfEdgeMesh<BaseVecT, VectorT>::collapseEdge(EdgeHandle edgeH)
 {
     if (!BaseMesh<BaseVecT>::isCollapsable(edgeH))
     {
@@ -1444,8 +1457,8 @@ EdgeCollapseResult HalfEdgeMesh<BaseVecT>::collapseEdge(EdgeHandle edgeH)
  * @param handle
  * @return if the edge is flippable
  */
-template<typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::isFlippable(EdgeHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::isFlippable(EdgeHandle handle) const
 {
     auto adjFaces = getFacesOfEdge(handle);
     if (!adjFaces[0] || !adjFaces[1])
@@ -1489,8 +1502,8 @@ bool HalfEdgeMesh<BaseVecT>::isFlippable(EdgeHandle handle) const
     return diffCount == 1;
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::flipEdge(EdgeHandle edgeH)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::flipEdge(EdgeHandle edgeH)
 {
     if (!BaseMesh<BaseVecT>::isFlippable(edgeH))
     {
@@ -1609,8 +1622,8 @@ void HalfEdgeMesh<BaseVecT>::flipEdge(EdgeHandle edgeH)
     }
 }
 
-template <typename BaseVecT>
-void HalfEdgeMesh<BaseVecT>::splitVertex(EdgeHandle eH,
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::splitVertex(EdgeHandle eH,
                                          VertexHandle vH,
                                          BaseVecT pos1,
                                          BaseVecT pos2)
@@ -1745,8 +1758,8 @@ void HalfEdgeMesh<BaseVecT>::splitVertex(EdgeHandle eH,
     getE(newEdgeC.first).face  = newFace2H;
 }
 
-template <typename BaseVecT>
-EdgeHandle HalfEdgeMesh<BaseVecT>::halfToFullEdgeHandle(HalfEdgeHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+EdgeHandle HalfEdgeMesh<BaseVecT, VectorT>::halfToFullEdgeHandle(HalfEdgeHandle handle) const
 {
     auto twin = getE(handle).twin;
     // return the handle with the smaller index of the given half edge and its twin
@@ -1756,8 +1769,8 @@ EdgeHandle HalfEdgeMesh<BaseVecT>::halfToFullEdgeHandle(HalfEdgeHandle handle) c
 // ========================================================================
 // = Other public methods
 // ========================================================================
-template <typename BaseVecT>
-bool HalfEdgeMesh<BaseVecT>::debugCheckMeshIntegrity() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::debugCheckMeshIntegrity() const
 {
     using std::endl;
 
@@ -1856,55 +1869,121 @@ bool HalfEdgeMesh<BaseVecT>::debugCheckMeshIntegrity() const
     return error;
 }
 
+template<typename BaseVecT, template<typename, typename> class VectorT>
+void HalfEdgeMesh<BaseVecT, VectorT>::compact()
+{
+    const Index NONE = std::numeric_limits<Index>::max();
+
+    // Compute new indices of all remaining elements
+    vector<Index> newVertex(m_vertices.size(), NONE);
+    vector<Index> newFace(m_faces.size(), NONE);
+    vector<Index> newEdge(m_edges.size(), NONE);
+
+    Index count = 0;
+    for (auto vH: m_vertices)
+    {
+        newVertex[vH.idx()] = count++;
+    }
+    count = 0;
+    for (auto fH: m_faces)
+    {
+        newFace[fH.idx()] = count++;
+    }
+    count = 0;
+    for (auto eH: m_edges)
+    {
+        newEdge[eH.idx()] = count++;
+    }
+
+    // Move the elements and update all handles they contain
+    VertexVector vertices;
+    vertices.reserve(m_vertices.numUsed());
+    for (auto vH: m_vertices)
+    {
+        Vertex v = m_vertices[vH];
+        if (v.outgoing)
+        {
+            v.outgoing = HalfEdgeHandle(newEdge[v.outgoing.unwrap().idx()]);
+        }
+        vertices.push(std::move(v));
+    }
+
+    FaceVector faces;
+    faces.reserve(m_faces.numUsed());
+    for (auto fH: m_faces)
+    {
+        faces.push(Face(HalfEdgeHandle(newEdge[m_faces[fH].edge.idx()])));
+    }
+
+    EdgeVector edges;
+    edges.reserve(m_edges.numUsed());
+    for (auto eH: m_edges)
+    {
+        Edge e = m_edges[eH];
+        if (e.face)
+        {
+            e.face = FaceHandle(newFace[e.face.unwrap().idx()]);
+        }
+        e.target = VertexHandle(newVertex[e.target.idx()]);
+        e.next = HalfEdgeHandle(newEdge[e.next.idx()]);
+        e.twin = HalfEdgeHandle(newEdge[e.twin.idx()]);
+        edges.push(std::move(e));
+    }
+
+    m_vertices = std::move(vertices);
+    m_faces = std::move(faces);
+    m_edges = std::move(edges);
+}
+
 // ========================================================================
 // = Private helper methods
 // ========================================================================
 
-template<typename BaseVecT>
-typename HalfEdgeMesh<BaseVecT>::Edge&
-    HalfEdgeMesh<BaseVecT>::getE(HalfEdgeHandle handle)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+typename HalfEdgeMesh<BaseVecT, VectorT>::Edge&
+    HalfEdgeMesh<BaseVecT, VectorT>::getE(HalfEdgeHandle handle)
 {
     return m_edges[handle];
 }
 
-template<typename BaseVecT>
-const typename HalfEdgeMesh<BaseVecT>::Edge&
-    HalfEdgeMesh<BaseVecT>::getE(HalfEdgeHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+const typename HalfEdgeMesh<BaseVecT, VectorT>::Edge&
+    HalfEdgeMesh<BaseVecT, VectorT>::getE(HalfEdgeHandle handle) const
 {
     return m_edges[handle];
 }
 
-template<typename BaseVecT>
-typename HalfEdgeMesh<BaseVecT>::Face&
-    HalfEdgeMesh<BaseVecT>::getF(FaceHandle handle)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+typename HalfEdgeMesh<BaseVecT, VectorT>::Face&
+    HalfEdgeMesh<BaseVecT, VectorT>::getF(FaceHandle handle)
 {
     return m_faces[handle];
 }
 
-template<typename BaseVecT>
-const typename HalfEdgeMesh<BaseVecT>::Face&
-    HalfEdgeMesh<BaseVecT>::getF(FaceHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+const typename HalfEdgeMesh<BaseVecT, VectorT>::Face&
+    HalfEdgeMesh<BaseVecT, VectorT>::getF(FaceHandle handle) const
 {
     return m_faces[handle];
 }
 
-template<typename BaseVecT>
-typename HalfEdgeMesh<BaseVecT>::Vertex&
-    HalfEdgeMesh<BaseVecT>::getV(VertexHandle handle)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+typename HalfEdgeMesh<BaseVecT, VectorT>::Vertex&
+    HalfEdgeMesh<BaseVecT, VectorT>::getV(VertexHandle handle)
 {
     return m_vertices[handle];
 }
 
-template<typename BaseVecT>
-const typename HalfEdgeMesh<BaseVecT>::Vertex&
-    HalfEdgeMesh<BaseVecT>::getV(VertexHandle handle) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+const typename HalfEdgeMesh<BaseVecT, VectorT>::Vertex&
+    HalfEdgeMesh<BaseVecT, VectorT>::getV(VertexHandle handle) const
 {
     return m_vertices[handle];
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 OptionalHalfEdgeHandle
-    HalfEdgeMesh<BaseVecT>::edgeBetween(VertexHandle fromH, VertexHandle toH)
+    HalfEdgeMesh<BaseVecT, VectorT>::edgeBetween(VertexHandle fromH, VertexHandle toH)
 {
     auto twinOut = findEdgeAroundVertex(fromH, [&, this](auto edgeH)
     {
@@ -1920,9 +1999,9 @@ OptionalHalfEdgeHandle
     }
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 HalfEdgeHandle
-    HalfEdgeMesh<BaseVecT>::findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle toH)
+    HalfEdgeMesh<BaseVecT, VectorT>::findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle toH)
 {
     DOINDEBUG(dout() << "# findOrCreateEdgeBetween: " << fromH << " --> " << toH << endl);
     auto foundEdge = edgeBetween(fromH, toH);
@@ -1938,9 +2017,9 @@ HalfEdgeHandle
     }
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 HalfEdgeHandle
-HalfEdgeMesh<BaseVecT>::findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle toH, bool& added)
+HalfEdgeMesh<BaseVecT, VectorT>::findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle toH, bool& added)
 {
   DOINDEBUG(dout() << "# findOrCreateEdgeBetween: " << fromH << " --> " << toH << endl);
   auto foundEdge = edgeBetween(fromH, toH);
@@ -1958,9 +2037,9 @@ HalfEdgeMesh<BaseVecT>::findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle
   }
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 template <typename Visitor>
-void HalfEdgeMesh<BaseVecT>::circulateAroundVertex(VertexHandle vH, Visitor visitor) const
+void HalfEdgeMesh<BaseVecT, VectorT>::circulateAroundVertex(VertexHandle vH, Visitor visitor) const
 {
     auto outgoing = getV(vH).outgoing;
     if (outgoing)
@@ -1969,9 +2048,9 @@ void HalfEdgeMesh<BaseVecT>::circulateAroundVertex(VertexHandle vH, Visitor visi
     }
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 template <typename Visitor>
-void HalfEdgeMesh<BaseVecT>::circulateAroundVertex(HalfEdgeHandle startEdgeH, Visitor visitor) const
+void HalfEdgeMesh<BaseVecT, VectorT>::circulateAroundVertex(HalfEdgeHandle startEdgeH, Visitor visitor) const
 {
     auto loopEdgeH = startEdgeH;
 
@@ -2014,10 +2093,10 @@ void HalfEdgeMesh<BaseVecT>::circulateAroundVertex(HalfEdgeHandle startEdgeH, Vi
     }
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 template <typename Pred>
 OptionalHalfEdgeHandle
-    HalfEdgeMesh<BaseVecT>::findEdgeAroundVertex(VertexHandle vH, Pred pred) const
+    HalfEdgeMesh<BaseVecT, VectorT>::findEdgeAroundVertex(VertexHandle vH, Pred pred) const
 {
     // This function simply follows `next` and `twin` handles to visit all
     // edges around a vertex.
@@ -2033,9 +2112,9 @@ OptionalHalfEdgeHandle
     return findEdgeAroundVertex(getE(v.outgoing.unwrap()).twin, pred);
 }
 
-template <typename BaseVecT>
+template<typename BaseVecT, template<typename, typename> class VectorT>
 template <typename Pred>
-OptionalHalfEdgeHandle HalfEdgeMesh<BaseVecT>::findEdgeAroundVertex(
+OptionalHalfEdgeHandle HalfEdgeMesh<BaseVecT, VectorT>::findEdgeAroundVertex(
     HalfEdgeHandle startEdgeH,
     Pred pred
 ) const
@@ -2076,8 +2155,8 @@ OptionalHalfEdgeHandle HalfEdgeMesh<BaseVecT>::findEdgeAroundVertex(
     return out;
 }
 
-template <typename BaseVecT>
-pair<HalfEdgeHandle, HalfEdgeHandle> HalfEdgeMesh<BaseVecT>::addEdgePair(VertexHandle v1H, VertexHandle v2H)
+template<typename BaseVecT, template<typename, typename> class VectorT>
+pair<HalfEdgeHandle, HalfEdgeHandle> HalfEdgeMesh<BaseVecT, VectorT>::addEdgePair(VertexHandle v1H, VertexHandle v2H)
 {
     // This method adds two new half edges, called "a" and "b".
     //
@@ -2107,39 +2186,289 @@ pair<HalfEdgeHandle, HalfEdgeHandle> HalfEdgeMesh<BaseVecT>::addEdgePair(VertexH
     return std::make_pair(aH, bH);
 }
 
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HalfEdgeMesh<BaseVecT, VectorT>::addFacesFromIndices(const unsigned int* indices, size_t numFaces)
+{
+    if (m_edges.size() > 0 || m_faces.size() > 0)
+    {
+        return false;
+    }
+
+    const size_t numVertices = m_vertices.size();
+    const size_t numDirected = 3 * numFaces;
+    const Index NONE = std::numeric_limits<Index>::max();
+
+    // Directed edge d = 3 * f + c points from corner c to corner c + 1 of
+    // face f.
+    auto from = [&](size_t d) { return indices[d]; };
+    auto to = [&](size_t d) { return indices[d - d % 3 + (d % 3 + 1) % 3]; };
+
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        const unsigned int* v = indices + 3 * f;
+        if (v[0] >= numVertices || v[1] >= numVertices || v[2] >= numVertices
+            || v[0] == v[1] || v[1] == v[2] || v[2] == v[0]
+            || !m_vertices.get(VertexHandle(v[0]))
+            || !m_vertices.get(VertexHandle(v[1]))
+            || !m_vertices.get(VertexHandle(v[2])))
+        {
+            return false;
+        }
+    }
+
+    // =======================================================================
+    // = Pair twins
+    // =======================================================================
+    // Bucket all directed edges by their smaller vertex (counting sort) and
+    // sort each bucket by the larger vertex. Both halves of an edge end up
+    // next to each other.
+    vector<Index> bucketStart(numVertices + 1, 0);
+    for (size_t d = 0; d < numDirected; d++)
+    {
+        bucketStart[std::min(from(d), to(d)) + 1]++;
+    }
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        bucketStart[v + 1] += bucketStart[v];
+    }
+
+    vector<Index> sorted(numDirected);
+    {
+        vector<Index> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t d = 0; d < numDirected; d++)
+        {
+            sorted[fill[std::min(from(d), to(d))]++] = d;
+        }
+    }
+
+    vector<Index> partner(numDirected, NONE);
+    bool manifold = true;
+
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(&&:manifold)
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        auto first = sorted.begin() + bucketStart[v];
+        auto last = sorted.begin() + bucketStart[v + 1];
+        std::sort(first, last, [&](Index a, Index b)
+        {
+            auto ha = std::max(from(a), to(a));
+            auto hb = std::max(from(b), to(b));
+            return ha < hb || (ha == hb && a < b);
+        });
+
+        for (auto it = first; it != last; )
+        {
+            auto hi = std::max(from(*it), to(*it));
+            auto end = it + 1;
+            while (end != last && std::max(from(*end), to(*end)) == hi)
+            {
+                end++;
+            }
+
+            // More than two faces share this edge or two faces use it in
+            // the same direction.
+            if (end - it > 2 || (end - it == 2 && from(it[0]) == from(it[1])))
+            {
+                manifold = false;
+            }
+            else if (end - it == 2)
+            {
+                partner[it[0]] = it[1];
+                partner[it[1]] = it[0];
+            }
+            it = end;
+        }
+    }
+
+    if (!manifold)
+    {
+        return false;
+    }
+
+    // Edge pairs are numbered by the first face using them, exactly like
+    // addFace() creates them. The half edge with the even index has the
+    // direction of its first use.
+    vector<Index> halfEdge(numDirected);
+    size_t numHalfEdges = 0;
+    for (size_t d = 0; d < numDirected; d++)
+    {
+        if (partner[d] == NONE || partner[d] > d)
+        {
+            halfEdge[d] = numHalfEdges;
+            numHalfEdges += 2;
+        }
+        else
+        {
+            halfEdge[d] = halfEdge[partner[d]] + 1;
+        }
+    }
+
+    // =======================================================================
+    // = Create edges
+    // =======================================================================
+    vector<Edge> edges(numHalfEdges, Edge());
+    vector<Index> faceCount(numVertices, 0);
+    vector<OptionalHalfEdgeHandle> outgoing(numVertices);
+
+    // Boundary half edges, linked per source vertex
+    vector<Index> firstBoundary(numVertices, NONE);
+    vector<Index> nextBoundary(numHalfEdges, NONE);
+
+    for (size_t d = 0; d < numDirected; d++)
+    {
+        size_t f = d / 3;
+        Index eH = halfEdge[d];
+
+        auto& e = edges[eH];
+        e.face = FaceHandle(f);
+        e.target = VertexHandle(to(d));
+        e.next = HalfEdgeHandle(halfEdge[3 * f + (d + 1) % 3]);
+        e.twin = HalfEdgeHandle(eH ^ 1);
+
+        if (partner[d] == NONE)
+        {
+            auto& b = edges[eH ^ 1];
+            b.target = VertexHandle(from(d));
+            b.twin = HalfEdgeHandle(eH);
+
+            nextBoundary[eH ^ 1] = firstBoundary[to(d)];
+            firstBoundary[to(d)] = eH ^ 1;
+        }
+
+        faceCount[from(d)]++;
+        if (!outgoing[from(d)])
+        {
+            outgoing[from(d)] = HalfEdgeHandle(eH);
+        }
+    }
+
+    // =======================================================================
+    // = Connect boundary edges
+    // =======================================================================
+    // Every fan of faces around a vertex starts with an outgoing and ends
+    // with an ingoing boundary edge. The end of each fan is linked to the
+    // start of the next one. If the fans do not contain all faces of the
+    // vertex, it can't be represented by a half edge mesh.
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(&&:manifold)
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        if (!outgoing[v])
+        {
+            continue;
+        }
+
+        size_t visited = 0;
+        if (firstBoundary[v] == NONE)
+        {
+            // Inner vertex: circulate once around the closed fan
+            Index start = edges[outgoing[v].unwrap().idx()].twin.idx();
+            Index eH = start;
+            while (edges[eH].face && visited <= faceCount[v])
+            {
+                visited++;
+                eH = edges[edges[eH].next.idx()].twin.idx();
+                if (eH == start)
+                {
+                    break;
+                }
+            }
+            if (eH != start)
+            {
+                manifold = false;
+            }
+        }
+        else
+        {
+            Index fanEnd = NONE;
+            for (Index bH = firstBoundary[v]; bH != NONE; bH = nextBoundary[bH])
+            {
+                // Walk from the outgoing boundary edge to the ingoing one
+                Index eH = edges[bH].twin.idx();
+                while (edges[eH].face && visited <= faceCount[v])
+                {
+                    visited++;
+                    eH = edges[edges[eH].next.idx()].twin.idx();
+                }
+
+                if (fanEnd != NONE)
+                {
+                    edges[fanEnd].next = HalfEdgeHandle(bH);
+                }
+                fanEnd = eH;
+            }
+            edges[fanEnd].next = HalfEdgeHandle(firstBoundary[v]);
+        }
+
+        if (visited != faceCount[v])
+        {
+            manifold = false;
+        }
+    }
+
+    if (!manifold)
+    {
+        return false;
+    }
+
+    // =======================================================================
+    // = Commit
+    // =======================================================================
+    m_edges.reserve(numHalfEdges);
+    for (auto& e: edges)
+    {
+        m_edges.push(std::move(e));
+    }
+
+    m_faces.reserve(numFaces);
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        m_faces.push(Face(HalfEdgeHandle(halfEdge[3 * f])));
+    }
+
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        if (outgoing[v])
+        {
+            m_vertices[VertexHandle(v)].outgoing = outgoing[v];
+        }
+    }
+
+    return true;
+}
+
 
 // ========================================================================
 // = Iterator stuff
 // ========================================================================
-template<typename HandleT, typename ElemT>
-HemFevIterator<HandleT, ElemT>& HemFevIterator<HandleT, ElemT>::operator++()
+template<typename HandleT, typename IteratorT>
+HemFevIterator<HandleT, IteratorT>& HemFevIterator<HandleT, IteratorT>::operator++()
 {
     ++m_iterator;
     return *this;
 }
 
-template<typename HandleT, typename ElemT>
-bool HemFevIterator<HandleT, ElemT>::operator==(const MeshHandleIterator<HandleT>& other) const
+template<typename HandleT, typename IteratorT>
+bool HemFevIterator<HandleT, IteratorT>::operator==(const MeshHandleIterator<HandleT>& other) const
 {
-    auto cast = dynamic_cast<const HemFevIterator<HandleT, ElemT>*>(&other);
+    auto cast = dynamic_cast<const HemFevIterator<HandleT, IteratorT>*>(&other);
     return cast && m_iterator == cast->m_iterator;
 }
 
-template<typename HandleT, typename ElemT>
-bool HemFevIterator<HandleT, ElemT>::operator!=(const MeshHandleIterator<HandleT>& other) const
+template<typename HandleT, typename IteratorT>
+bool HemFevIterator<HandleT, IteratorT>::operator!=(const MeshHandleIterator<HandleT>& other) const
 {
-    auto cast = dynamic_cast<const HemFevIterator<HandleT, ElemT>*>(&other);
+    auto cast = dynamic_cast<const HemFevIterator<HandleT, IteratorT>*>(&other);
     return !cast || m_iterator != cast->m_iterator;
 }
 
-template<typename HandleT, typename ElemT>
-HandleT HemFevIterator<HandleT, ElemT>::operator*() const
+template<typename HandleT, typename IteratorT>
+HandleT HemFevIterator<HandleT, IteratorT>::operator*() const
 {
     return *m_iterator;
 }
 
-template<typename BaseVecT>
-HemEdgeIterator<BaseVecT>& HemEdgeIterator<BaseVecT>::operator++()
+template<typename BaseVecT, template<typename, typename> class VectorT>
+HemEdgeIterator<BaseVecT, VectorT>& HemEdgeIterator<BaseVecT, VectorT>::operator++()
 {
     ++m_iterator;
 
@@ -2153,71 +2482,71 @@ HemEdgeIterator<BaseVecT>& HemEdgeIterator<BaseVecT>::operator++()
     return *this;
 }
 
-template<typename BaseVecT>
-bool HemEdgeIterator<BaseVecT>::operator==(const MeshHandleIterator<EdgeHandle>& other) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HemEdgeIterator<BaseVecT, VectorT>::operator==(const MeshHandleIterator<EdgeHandle>& other) const
 {
-    auto cast = dynamic_cast<const HemEdgeIterator<BaseVecT>*>(&other);
+    auto cast = dynamic_cast<const HemEdgeIterator<BaseVecT, VectorT>*>(&other);
     return cast && m_iterator == cast->m_iterator;
 }
 
-template<typename BaseVecT>
-bool HemEdgeIterator<BaseVecT>::operator!=(const MeshHandleIterator<EdgeHandle>& other) const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+bool HemEdgeIterator<BaseVecT, VectorT>::operator!=(const MeshHandleIterator<EdgeHandle>& other) const
 {
-    auto cast = dynamic_cast<const HemEdgeIterator<BaseVecT>*>(&other);
+    auto cast = dynamic_cast<const HemEdgeIterator<BaseVecT, VectorT>*>(&other);
     return !cast || m_iterator != cast->m_iterator;
 }
 
-template<typename BaseVecT>
-EdgeHandle HemEdgeIterator<BaseVecT>::operator*() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+EdgeHandle HemEdgeIterator<BaseVecT, VectorT>::operator*() const
 {
     return m_mesh.halfToFullEdgeHandle(*m_iterator);
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT>::verticesBegin() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT, VectorT>::verticesBegin() const
 {
     return MeshHandleIteratorPtr<VertexHandle>(
-        std::make_unique<HemFevIterator<VertexHandle, Vertex>>(this->m_vertices.begin())
+        std::make_unique<HemFevIterator<VertexHandle, typename VertexVector::iterator>>(this->m_vertices.begin())
     );
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT>::verticesEnd() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT, VectorT>::verticesEnd() const
 {
     return MeshHandleIteratorPtr<VertexHandle>(
-        std::make_unique<HemFevIterator<VertexHandle, Vertex>>(this->m_vertices.end())
+        std::make_unique<HemFevIterator<VertexHandle, typename VertexVector::iterator>>(this->m_vertices.end())
     );
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT>::facesBegin() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT, VectorT>::facesBegin() const
 {
     return MeshHandleIteratorPtr<FaceHandle>(
-        std::make_unique<HemFevIterator<FaceHandle, Face>>(this->m_faces.begin())
+        std::make_unique<HemFevIterator<FaceHandle, typename FaceVector::iterator>>(this->m_faces.begin())
     );
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT>::facesEnd() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT, VectorT>::facesEnd() const
 {
     return MeshHandleIteratorPtr<FaceHandle>(
-        std::make_unique<HemFevIterator<FaceHandle, Face>>(this->m_faces.end())
+        std::make_unique<HemFevIterator<FaceHandle, typename FaceVector::iterator>>(this->m_faces.end())
     );
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT>::edgesBegin() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT, VectorT>::edgesBegin() const
 {
     return MeshHandleIteratorPtr<EdgeHandle>(
-        std::make_unique<HemEdgeIterator<BaseVecT>>(this->m_edges.begin(), *this)
+        std::make_unique<HemEdgeIterator<BaseVecT, VectorT>>(this->m_edges.begin(), *this)
     );
 }
 
-template <typename BaseVecT>
-MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT>::edgesEnd() const
+template<typename BaseVecT, template<typename, typename> class VectorT>
+MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT, VectorT>::edgesEnd() const
 {
     return MeshHandleIteratorPtr<EdgeHandle>(
-        std::make_unique<HemEdgeIterator<BaseVecT>>(this->m_edges.end(), *this)
+        std::make_unique<HemEdgeIterator<BaseVecT, VectorT>>(this->m_edges.end(), *this)
     );
 }
 
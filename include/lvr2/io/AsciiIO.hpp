@@ -80,6 +80,8 @@ class AsciiIO : public BaseIO
          *              respective parameters given to this function. Each line may
          *              consist of more attributes, but only the ones specified are
          *              parsed. Not existing attributes are indicated by -1.
+         *              The file is memory mapped and parsed in parallel in
+         *              line aligned ranges independent of the current locale.
          *
          * @param filename  The file to parse
          * @param x         The colum number containing the x-coordinate of a point
@@ -60,6 +60,9 @@ namespace lvr2
  * The PLYIO class provides functionalities for reading and writing the Polygon
  * File Format, also known as Stanford Triangle Format. Both binary and ascii
  * modes are supported. For the actual file handling the RPly library is used.
+ * Binary little endian files whose properties match the layout listed below
+ * are read and written block-wise without calling into RPly for every single
+ * value. Other property types and list layouts are still handled by RPly.
  * \n \n
  * The following list is a short description of all handled elements and
  * properties of ply files. In short the elements \c vertex and \c face
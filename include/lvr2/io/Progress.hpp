@@ -38,6 +38,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <atomic>
 
 using std::stringstream;
 using std::cout;
@@ -111,19 +112,27 @@ protected:
     /// Prints the output
     void print_bar();
 
+    /// Prints all percent steps up to the current counter value
+    void update();
+
+    /// Returns the progress in percent for the given counter value
+    int percentOf(size_t val) const;
+
     /// The prefix string
     string 			m_prefix;
 
     /// The number of iterations
     size_t			m_maxVal;
 
-        /// The current counter
-    size_t	 		m_currentVal;
+    /// The current counter. Incremented without locking, so that
+    /// parallel loops do not serialize on the progress bar.
+    std::atomic<size_t>	m_currentVal;
 
-    /// A mutex object for counter increment (for parallel executions)
+    /// A mutex object for output generation. Only taken by the thread
+    /// whose increment crosses a percent step.
     boost::mutex 	m_mutex;
 
-    /// The current progress in percent
+    /// The current progress in percent (guarded by m_mutex)
     int			m_percent;
 
     /// A string stream for output generation
@@ -163,8 +172,8 @@ public:
 
 protected:
 
-    /// Prints the current state
-    void print_progress();
+    /// Prints the given counter value
+    void print_progress(size_t val);
 
     /// The prefix string
     string 			m_prefix;
@@ -172,10 +181,14 @@ protected:
     /// The step value for output generation
     size_t			m_stepVal;
 
-    /// The current counter value
-    size_t			m_currentVal;
+    /// The current counter value. Incremented without locking.
+    std::atomic<size_t>	m_currentVal;
+
+    /// The last printed counter value (guarded by m_mutex)
+    size_t			m_printedVal;
 
-    /// A mutex object for counter increment (for parallel executions)
+    /// A mutex object for output generation. Only taken every
+    /// m_stepVal operations.
     boost::mutex 	m_mutex;
 
     /// A string stream for output generation
@@ -239,19 +252,26 @@ protected:
 	/// Prints the output
 	void print_bar();
 
+	/// Prints all percent steps up to the current counter value
+	void update();
+
+	/// Returns the progress in percent for the given counter value
+	int percentOf(size_t val) const;
+
 	/// The prefix string
 	string 			m_prefix;
 
 	/// The number of iterations
 	size_t			m_maxVal;
 
-        /// The current counter
-    size_t	 		m_currentVal;
+	/// The current counter. Incremented without locking.
+	std::atomic<size_t>	m_currentVal;
 
-	/// A mutex object for counter increment (for parallel executions)
+	/// A mutex object for output generation. Only taken by the thread
+	/// whose increment crosses a percent step.
 	boost::mutex 	m_mutex;
 
-	/// The current progress in percent
+	/// The current progress in percent (guarded by m_mutex)
 	int				m_percent;
 
 	// bar length
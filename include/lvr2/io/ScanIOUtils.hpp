@@ -153,25 +153,40 @@ void saveScan(
     const size_t& positionNumber,
     const size_t& scanNumber);
 
+/**
+ * @brief Load a Scan struct.
+ *
+ * @param root                  Project root directory
+ * @param scan                  The scan object to fill
+ * @param positionDirectory     The name of the scan position directory
+ * @param scanDirectory         The name of the scan directory
+ * @param scanName              The name of the scan file without extension
+ * @param loadPoints            If false, only the meta data is read. scanRoot and
+ *                              scanFile point to the scan data, so the points can be
+ *                              read later, e.g. by a ScanProjectPointStream.
+ */
 bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const std::string& positionDirectory,
     const std::string& scanDirectory,
-    const std::string& scanName);
+    const std::string& scanName,
+    bool loadPoints = true);
 
 bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const std::string& positionDirectory,
     const std::string& scanDirectory,
-    const size_t& scanNumber);
+    const size_t& scanNumber,
+    bool loadPoints = true);
 
 bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const size_t& positionNumber,
-    const size_t& scanNumber);
+    const size_t& scanNumber,
+    bool loadPoints = true);
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -200,12 +215,14 @@ void saveScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const std::string& positionDirectory);
+    const std::string& positionDirectory,
+    bool loadPoints = true);
 
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const size_t& positionNumber);
+    const size_t& positionNumber,
+    bool loadPoints = true);
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -222,9 +239,18 @@ void saveScanProject(
     const boost::filesystem::path& root,
     const ScanProject& scanProj);
 
+/**
+ * @brief Load a ScanProject struct.
+ *
+ * @param root                  Project root directory
+ * @param scanProj              The scanproject object to fill
+ * @param loadPoints            If false, the points of the scans are not read,
+ *                              see loadScan
+ */
 bool loadScanProject(
     const boost::filesystem::path& root,
-    ScanProject& scanProj);
+    ScanProject& scanProj,
+    bool loadPoints = true);
 
 
 // std::set<size_t> loadPositionIdsFromDirectory(
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LVR2_IO_SCANPROJECTPOINTSTREAM_HPP
+#define LVR2_IO_SCANPROJECTPOINTSTREAM_HPP
+
+#include "lvr2/io/DataStruct.hpp"
+#include "lvr2/types/ScanTypes.hpp"
+
+#include <boost/thread.hpp>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Reads the points of all scans of a ScanProject in blocks of a
+ *        fixed size.
+ *
+ * The scans are read one after another by a background thread, which
+ * transforms the points into project coordinates using the registration
+ * of each scan and stays at most two blocks ahead of the consumer. Scans
+ * whose points are not in memory are read from their scan file (see
+ * loadScan with loadPoints = false) and released after they have been
+ * split into blocks. The memory needed therefore depends on the largest
+ * single scan and the block size, not on the size of the project.
+ *
+ * Usage:
+ * @code
+ * ScanProjectPointStream stream(project, 1 << 20);
+ * while (ScanProjectPointStream::BlockPtr block = stream.next())
+ * {
+ *     // block->points contains block->numPoints registered points
+ * }
+ * @endcode
+ */
+class ScanProjectPointStream
+{
+public:
+
+    /// A part of the points of one scan in project coordinates
+    struct Block
+    {
+        /// numPoints * 3 registered coordinates
+        floatArr points;
+
+        /// numPoints * 3 rotated normals or empty if the scan has none
+        floatArr normals;
+
+        /// numPoints * 3 colors or empty if the scan has no RGB colors
+        ucharArr colors;
+
+        /// Number of points in this block
+        size_t numPoints;
+
+        /// Index of the scan position within the project
+        size_t position;
+
+        /// Index of the scan within the scan position
+        size_t scan;
+    };
+
+    using BlockPtr = std::shared_ptr<Block>;
+
+    /**
+     * @brief Starts reading the given project.
+     *
+     * @param project       The scan project
+     * @param blockSize     Maximum number of points per block
+     * @param positions     If not empty, only the positions i with positions[i] == true
+     *                      are read. Missing entries count as false.
+     * @param firstScanOnly Only read the first scan of every position
+     */
+    ScanProjectPointStream(
+        ScanProjectPtr project,
+        size_t blockSize = 1 << 20,
+        const std::vector<bool>& positions = std::vector<bool>(),
+        bool firstScanOnly = false);
+
+    /**
+     * @brief Stops the reading thread
+     */
+    ~ScanProjectPointStream();
+
+    ScanProjectPointStream(const ScanProjectPointStream&) = delete;
+    ScanProjectPointStream& operator=(const ScanProjectPointStream&) = delete;
+
+    /**
+     * @brief Returns the next block. Blocks while it is being read.
+     *
+     * @return The next block or nullptr if all scans have been read
+     *
+     * @throws Rethrows exceptions that occurred while reading a scan
+     */
+    BlockPtr next();
+
+    /**
+     * @brief Returns the number of points read so far by next()
+     */
+    size_t numPoints() const { return m_numPoints; }
+
+private:
+
+    /// Splits all selected scans into blocks and queues them
+    void readScans();
+
+    /// Queues the given block. Returns false if the stream was stopped.
+    bool push(BlockPtr block);
+
+    /// Number of blocks that may be queued ahead of the consumer
+    static constexpr size_t m_maxQueued = 2;
+
+    ScanProjectPtr m_project;
+
+    size_t m_blockSize;
+
+    std::vector<bool> m_positions;
+
+    bool m_firstScanOnly;
+
+    size_t m_numPoints;
+
+    /// Blocks that have been read but not requested yet
+    std::deque<BlockPtr> m_queue;
+
+    /// Set when the reading thread has queued its last block
+    bool m_finished;
+
+    /// Tells the reading thread to exit
+    bool m_stop;
+
+    /// Exception thrown by the reading thread
+    std::exception_ptr m_error;
+
+    /// Guards m_queue, m_finished, m_stop and m_error
+    boost::mutex m_mutex;
+
+    /// Signals changes of the queue to both threads
+    boost::condition_variable m_condition;
+
+    boost::thread m_thread;
+};
+
+} // namespace lvr2
+
+#endif // LVR2_IO_SCANPROJECTPOINTSTREAM_HPP
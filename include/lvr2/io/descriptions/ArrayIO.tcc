@@ -19,6 +19,24 @@ doubleArr ArrayIO<FeatureBase>::loadDoubleArray(const std::string &group, const
     return m_featureBase->m_kernel->loadDoubleArray(group, container, dims);
 }
 
+template<typename FeatureBase>
+ucharArr ArrayIO<FeatureBase>::loadUCharArray(const std::string &group, const std::string &container, const ArraySelection& selection, std::vector<size_t> &dims) const
+{
+    return m_featureBase->m_kernel->loadUCharArraySelection(group, container, selection, dims);
+}
+
+template<typename FeatureBase>
+floatArr ArrayIO<FeatureBase>::loadFloatArray(const std::string &group, const std::string &container, const ArraySelection& selection, std::vector<size_t> &dims) const
+{
+    return m_featureBase->m_kernel->loadFloatArraySelection(group, container, selection, dims);
+}
+
+template<typename FeatureBase>
+doubleArr ArrayIO<FeatureBase>::loadDoubleArray(const std::string &group, const std::string &container, const ArraySelection& selection, std::vector<size_t> &dims) const
+{
+    return m_featureBase->m_kernel->loadDoubleArraySelection(group, container, selection, dims);
+}
+
 template<typename FeatureBase>
 void ArrayIO<FeatureBase>::saveFloatArray(const std::string& groupName, const std::string& datasetName, const std::vector<size_t> &dimensions, const boost::shared_array<float>& data) const
 {
@@ -0,0 +1,235 @@
+#ifndef ARRAY_SELECTION_HPP
+#define ARRAY_SELECTION_HPP
+
+#include <stdexcept>
+#include <vector>
+#include <boost/shared_array.hpp>
+#include <boost/variant/static_visitor.hpp>
+
+#include "lvr2/io/PointBuffer.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Selects a regular subset (a hyperslab) of an n-dimensional array
+ *
+ * In every dimension d, count[d] elements are selected, starting at offset[d]
+ * and advancing by stride[d]. Dimensions without an entry in 'offset' or
+ * 'stride' start at 0 and use a stride of 1. Dimensions without an entry in
+ * 'count' select as many elements as remain. A default constructed selection
+ * therefore selects the whole array.
+ *
+ * Example: Every 10th point of the first million points of a N x 3 array
+ * @code
+ * ArraySelection sel = ArraySelection::rows(0, 100000, 10);
+ * @endcode
+ */
+struct ArraySelection
+{
+    std::vector<size_t> offset;
+    std::vector<size_t> count;
+    std::vector<size_t> stride;
+
+    /**
+     * @brief Selects 'count' entries of the first dimension, starting at 'first'
+     *        and taking every 'stride'-th one. All other dimensions are selected completely.
+     */
+    static ArraySelection rows(size_t first, size_t count, size_t stride = 1)
+    {
+        return ArraySelection{ {first}, {count}, {stride} };
+    }
+
+    /**
+     * @brief Returns a selection that only keeps the constraints on the first dimension
+     */
+    ArraySelection firstDimension() const
+    {
+        ArraySelection ret;
+        if (!offset.empty()) ret.offset.push_back(offset[0]);
+        if (!count.empty()) ret.count.push_back(count[0]);
+        if (!stride.empty()) ret.stride.push_back(stride[0]);
+        return ret;
+    }
+
+    /**
+     * @brief Fills in the missing entries for an array with the given dimensions
+     *
+     * @param dims  The dimensions of the array
+     * @return      A selection with exactly dims.size() entries in offset, count and stride
+     *
+     * @throws std::runtime_error if the selection exceeds the array
+     */
+    ArraySelection resolve(const std::vector<size_t>& dims) const
+    {
+        if (offset.size() > dims.size() || count.size() > dims.size() || stride.size() > dims.size())
+        {
+            throw std::runtime_error("[ArraySelection]: Selection has more dimensions than the array.");
+        }
+
+        ArraySelection ret;
+        for (size_t d = 0; d < dims.size(); d++)
+        {
+            size_t o = d < offset.size() ? offset[d] : 0;
+            size_t s = d < stride.size() ? stride[d] : 1;
+            if (s == 0)
+            {
+                throw std::runtime_error("[ArraySelection]: Stride must not be zero.");
+            }
+
+            size_t c;
+            if (d < count.size())
+            {
+                c = count[d];
+                if (c > 0 && (o >= dims[d] || (c - 1) > (dims[d] - 1 - o) / s))
+                {
+                    throw std::runtime_error("[ArraySelection]: Selection exceeds array bounds.");
+                }
+            }
+            else
+            {
+                c = o < dims[d] ? (dims[d] - o + s - 1) / s : 0;
+            }
+
+            ret.offset.push_back(o);
+            ret.count.push_back(c);
+            ret.stride.push_back(s);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Returns true if the selection covers the complete array with the given dimensions
+     */
+    bool selectsAll(const std::vector<size_t>& dims) const
+    {
+        ArraySelection sel = resolve(dims);
+        for (size_t d = 0; d < dims.size(); d++)
+        {
+            if (sel.offset[d] != 0 || sel.count[d] != dims[d] || (sel.count[d] > 1 && sel.stride[d] != 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Copies the selected part of an array that is completely in memory.
+ *
+ * @param data          The array in row-major order
+ * @param dims          The dimensions of 'data'
+ * @param selection     The part to copy
+ * @param selectedDims  Will be set to the dimensions of the returned array
+ * @return              The selected elements in row-major order. Shares 'data' if
+ *                      the selection covers the whole array.
+ */
+template<typename T>
+boost::shared_array<T> selectArray(
+    const boost::shared_array<T>& data,
+    const std::vector<size_t>& dims,
+    const ArraySelection& selection,
+    std::vector<size_t>& selectedDims)
+{
+    ArraySelection sel = selection.resolve(dims);
+    selectedDims = sel.count;
+
+    if (dims.empty() || selection.selectsAll(dims))
+    {
+        return data;
+    }
+
+    size_t total = 1;
+    for (size_t c : sel.count)
+    {
+        total *= c;
+    }
+
+    boost::shared_array<T> ret(new T[total]);
+    if (total == 0)
+    {
+        return ret;
+    }
+
+    // Distance between two consecutive entries of each dimension in 'data'
+    size_t last = dims.size() - 1;
+    std::vector<size_t> pitch(dims.size(), 1);
+    for (size_t d = last; d-- > 0; )
+    {
+        pitch[d] = pitch[d + 1] * dims[d + 1];
+    }
+
+    // Copy one run of the last dimension at a time
+    std::vector<size_t> index(dims.size(), 0);
+    T* out = ret.get();
+    while (true)
+    {
+        size_t src = sel.offset[last];
+        for (size_t d = 0; d < last; d++)
+        {
+            src += (sel.offset[d] + index[d] * sel.stride[d]) * pitch[d];
+        }
+        for (size_t i = 0; i < sel.count[last]; i++)
+        {
+            *out++ = data[src + i * sel.stride[last]];
+        }
+
+        bool done = true;
+        for (size_t d = last; d-- > 0; )
+        {
+            if (++index[d] < sel.count[d])
+            {
+                done = false;
+                break;
+            }
+            index[d] = 0;
+        }
+        if (done)
+        {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Visitor that applies an ArraySelection to the rows of a channel
+ */
+struct ChannelRowSelector : public boost::static_visitor<PointBuffer::val_type>
+{
+    ChannelRowSelector(const ArraySelection& rows) : m_rows(rows.firstDimension()) {}
+
+    template<typename T>
+    PointBuffer::val_type operator()(const Channel<T>& channel) const
+    {
+        std::vector<size_t> dims;
+        boost::shared_array<T> data = selectArray(
+            channel.dataPtr(), {channel.numElements(), channel.width()}, m_rows, dims);
+        return Channel<T>(dims[0], dims[1], data);
+    }
+
+    ArraySelection m_rows;
+};
+
+/**
+ * @brief Copies the selected rows of all channels of a PointBuffer.
+ *
+ * Only the first dimension of 'rows' is used, so every channel keeps its width.
+ */
+inline PointBufferPtr selectRows(const PointBuffer& buffer, const ArraySelection& rows)
+{
+    ChannelRowSelector selector(rows);
+
+    PointBufferPtr ret(new PointBuffer);
+    for (const auto& elem : buffer)
+    {
+        ret->insert({elem.first, boost::apply_visitor(selector, elem.second)});
+    }
+    return ret;
+}
+
+} // namespace lvr2
+
+#endif
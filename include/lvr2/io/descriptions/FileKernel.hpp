@@ -13,6 +13,7 @@
 #include "lvr2/types/MatrixTypes.hpp"
 #include "lvr2/io/PointBuffer.hpp"
 #include "lvr2/io/MeshBuffer.hpp"
+#include "lvr2/io/descriptions/ArraySelection.hpp"
 
 namespace lvr2
 {
@@ -79,6 +80,54 @@ public:
         const std::string& constainer, 
         std::vector<size_t>& dims) const = 0;
 
+    /// The ...Selection() variants only read the selected part of an array.
+    /// Kernels that can't read partially fall back to loading everything
+    /// and copying the selection, so these are always correct, but only
+    /// kernels that override them save I/O and memory.
+
+    virtual ucharArr loadUCharArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t>& dims) const
+    {
+        std::vector<size_t> fullDims;
+        ucharArr data = loadUCharArray(group, container, fullDims);
+        return data ? selectArray(data, fullDims, selection, dims) : data;
+    }
+
+    virtual floatArr loadFloatArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t>& dims) const
+    {
+        std::vector<size_t> fullDims;
+        floatArr data = loadFloatArray(group, container, fullDims);
+        return data ? selectArray(data, fullDims, selection, dims) : data;
+    }
+
+    virtual doubleArr loadDoubleArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t>& dims) const
+    {
+        std::vector<size_t> fullDims;
+        doubleArr data = loadDoubleArray(group, container, fullDims);
+        return data ? selectArray(data, fullDims, selection, dims) : data;
+    }
+
+    /// Loads the selected rows of all channels, e.g. a block of points
+    virtual PointBufferPtr loadPointBufferSelection(
+        const std::string& group,
+        const std::string& container,
+        const ArraySelection& rows) const
+    {
+        PointBufferPtr buffer = loadPointBuffer(group, container);
+        return buffer ? selectRows(*buffer, rows) : buffer;
+    }
+
     virtual void saveFloatArray(
         const std::string& groupName, 
         const std::string& datasetName, 
@@ -14,8 +14,30 @@
 
 #include <type_traits>
 #include <tuple>
+#include <unordered_map>
 namespace lvr2
 {
+
+/**
+ * @brief Creation properties for datasets written by a HDF5Kernel
+ *
+ * Chunks always span all dimensions but the first one, so a block of
+ * rows (points, spectral bands, ...) can be read without decompressing
+ * unrelated data.
+ */
+struct HDF5DatasetConfig
+{
+    /// Number of rows per chunk. 0 disables chunking unless compression is
+    /// enabled, in which case chunks of about 1 MiB are used.
+    size_t chunkRows = 0;
+
+    /// Deflate level between 0 (no compression) and 9
+    unsigned int compression = 0;
+
+    /// Apply the shuffle filter before compressing
+    bool shuffle = false;
+};
+
 class HDF5Kernel : public FileKernel
 {
 public:
@@ -76,6 +98,29 @@ public:
         const std::string& container, 
         std::vector<size_t> &dims) const;
 
+    virtual ucharArr loadUCharArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t> &dims) const;
+
+    virtual floatArr loadFloatArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t> &dims) const;
+
+    virtual doubleArr loadDoubleArraySelection(
+        const std::string& group, 
+        const std::string& container, 
+        const ArraySelection& selection,
+        std::vector<size_t> &dims) const;
+
+    virtual PointBufferPtr loadPointBufferSelection(
+        const std::string& group,
+        const std::string& container,
+        const ArraySelection& rows) const;
+
     virtual void saveFloatArray(
         const std::string& groupName, 
         const std::string& datasetName, 
@@ -110,6 +155,21 @@ public:
         const std::string& datasetName, 
         std::vector<size_t>& dim) const;
 
+    /**
+     * @brief Reads only the selected hyperslab of a dataset
+     *
+     * @param groupName     The group containing the dataset
+     * @param datasetName   The dataset
+     * @param selection     The part of the dataset to read
+     * @param dim           Will be set to the dimensions of the returned array
+     */
+    template<typename T>
+    boost::shared_array<T> loadArray(
+        const std::string& groupName, 
+        const std::string& datasetName, 
+        const ArraySelection& selection,
+        std::vector<size_t>& dim) const;
+
     template<typename T> 
     void saveArray(
         const std::string& groupName, 
@@ -125,10 +185,16 @@ public:
         const boost::shared_array<T> data) const;
 
     template<typename T>
-    ChannelOptional<T> loadChannelOptional(HighFive::Group& g, const std::string& datasetName) const;
+    ChannelOptional<T> loadChannelOptional(
+        HighFive::Group& g, 
+        const std::string& datasetName, 
+        const ArraySelection& rows = ArraySelection()) const;
 
     template<typename T>
-    ChannelOptional<T> loadChannelOptional(const std::string& groupName, const std::string& datasetName) const;     
+    ChannelOptional<T> loadChannelOptional(
+        const std::string& groupName, 
+        const std::string& datasetName, 
+        const ArraySelection& rows = ArraySelection()) const;     
 
     // template<typename T>
     // ChannelOptional<T> load(
@@ -219,10 +285,16 @@ public:
     void save(HighFive::Group& group, std::string datasetName, const VariantChannel<Tp...>& vchannel) const;
     
     template<typename VariantChannelT>
-    boost::optional<VariantChannelT> load(std::string groupName, std::string datasetName) const;
+    boost::optional<VariantChannelT> load(
+        std::string groupName, 
+        std::string datasetName, 
+        const ArraySelection& rows = ArraySelection()) const;
     
     template<typename VariantChannelT>
-    boost::optional<VariantChannelT> load(HighFive::Group& group, std::string datasetName) const;
+    boost::optional<VariantChannelT> load(
+        HighFive::Group& group, 
+        std::string datasetName, 
+        const ArraySelection& rows = ArraySelection()) const;
     
     template<typename VariantChannelT>
     boost::optional<VariantChannelT> loadVariantChannel(std::string groupName, std::string datasetName) const;
@@ -230,7 +302,8 @@ public:
     template<typename VariantChannelT>
     boost::optional<VariantChannelT> loadDynamic(HighFive::DataType dtype,
         HighFive::Group& group,
-        std::string name) const;
+        std::string name,
+        const ArraySelection& rows = ArraySelection()) const;
 
     template<typename ...Tp>
     void saveDynamic(HighFive::Group& group,
@@ -243,9 +316,42 @@ public:
 
     void loadMetaData(const YAML::Node& node);
 
+    /**
+     * @brief Sets the creation properties of all datasets that have no
+     *        specific config, see setDatasetConfig(name, config)
+     */
+    void setDatasetConfig(const HDF5DatasetConfig& config);
+
+    /**
+     * @brief Sets the creation properties of all datasets with the given name,
+     *        e.g. "points", "colors" or "frames"
+     */
+    void setDatasetConfig(const std::string& datasetName, const HDF5DatasetConfig& config);
+
+    /**
+     * @brief Returns the creation properties used for datasets with the given name
+     */
+    const HDF5DatasetConfig& datasetConfig(const std::string& datasetName) const;
+
+    /**
+     * @brief Creates the chunking and filter properties of a new dataset
+     *
+     * @param datasetName   The name of the dataset, used to look up its HDF5DatasetConfig
+     * @param dims          The dimensions of the dataset
+     * @param elementSize   The size of a single element in bytes
+     */
+    HighFive::DataSetCreateProps createProperties(
+        const std::string& datasetName,
+        const std::vector<size_t>& dims,
+        size_t elementSize) const;
+
     std::shared_ptr<HighFive::File>  m_hdf5File;
 
     HDF5MetaDescriptionBase* m_metaDescription;
+
+    HDF5DatasetConfig m_defaultDatasetConfig;
+
+    std::unordered_map<std::string, HDF5DatasetConfig> m_datasetConfigs;
    
 };
 
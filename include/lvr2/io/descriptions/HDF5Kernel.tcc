@@ -4,14 +4,15 @@ namespace lvr2
 template<typename T>
 ChannelOptional<T> HDF5Kernel::loadChannelOptional(
     const std::string& groupName,
-    const std::string& datasetName) const  
+    const std::string& datasetName,
+    const ArraySelection& rows) const  
 {
     ChannelOptional<T> ret;
 
     if(hdf5util::exist(m_hdf5File, groupName))
     {
         HighFive::Group g = hdf5util::getGroup(m_hdf5File, groupName, false);
-        ret = loadChannelOptional<T>(g, datasetName);
+        ret = loadChannelOptional<T>(g, datasetName, rows);
     } 
 
     return ret;
@@ -20,7 +21,8 @@ ChannelOptional<T> HDF5Kernel::loadChannelOptional(
 template<typename T>
 ChannelOptional<T> HDF5Kernel::loadChannelOptional(
     HighFive::Group& g,
-    const std::string& datasetName) const
+    const std::string& datasetName,
+    const ArraySelection& rows) const
 {
     ChannelOptional<T> ret;
 
@@ -29,7 +31,8 @@ ChannelOptional<T> HDF5Kernel::loadChannelOptional(
         if (g.exist(datasetName))
         {
             HighFive::DataSet dataset = g.getDataSet(datasetName);
-            std::vector<size_t> dim = dataset.getSpace().getDimensions();
+            ArraySelection slab = rows.firstDimension().resolve(dataset.getSpace().getDimensions());
+            std::vector<size_t>& dim = slab.count;
 
             size_t elementCount = 1;
             for (auto e : dim)
@@ -37,8 +40,8 @@ ChannelOptional<T> HDF5Kernel::loadChannelOptional(
 
             if (elementCount)
             {
-                ret = Channel<T>(dim[0], dim[1]);
-                dataset.read(ret->dataPtr().get());
+                ret = Channel<T>(dim[0], dim.size() > 1 ? dim[1] : 1);
+                dataset.select(slab.offset, slab.count, slab.stride).read(ret->dataPtr().get());
             }
         }
     }
@@ -81,6 +84,16 @@ boost::shared_array<T> HDF5Kernel::loadArray(
     const std::string& groupName, 
     const std::string& datasetName, 
     std::vector<size_t>& dim) const
+{
+    return loadArray<T>(groupName, datasetName, ArraySelection(), dim);
+}
+
+template<typename T>
+boost::shared_array<T> HDF5Kernel::loadArray(
+    const std::string& groupName, 
+    const std::string& datasetName, 
+    const ArraySelection& selection,
+    std::vector<size_t>& dim) const
 {
     boost::shared_array<T> ret;
     HighFive::Group g = hdf5util::getGroup(m_hdf5File, groupName);
@@ -90,7 +103,8 @@ boost::shared_array<T> HDF5Kernel::loadArray(
         if (g.exist(datasetName))
         {
             HighFive::DataSet dataset = g.getDataSet(datasetName);
-            dim = dataset.getSpace().getDimensions();
+            ArraySelection slab = selection.resolve(dataset.getSpace().getDimensions());
+            dim = slab.count;
 
             size_t elementCount = 1;
             for (auto e : dim)
@@ -100,7 +114,8 @@ boost::shared_array<T> HDF5Kernel::loadArray(
             {
                 ret = boost::shared_array<T>(new T[elementCount]);
 
-                dataset.read(ret.get());
+                // Only the selected hyperslab is read (and decompressed) from the file
+                dataset.select(slab.offset, slab.count, slab.stride).read(ret.get());
             }
         }
     } 
@@ -135,27 +150,7 @@ void HDF5Kernel::saveArray(
     {
 
         HighFive::DataSpace dataSpace(dim);
-        HighFive::DataSetCreateProps properties;
-
-        // if(m_file_access->m_chunkSize)
-        // {
-        //     // We have to check explicitly if chunk size
-        //     // is < dimensionality to avoid errors from
-        //     // the HDF5 lib
-        //     for(size_t i = 0; i < chunkSizes.size(); i++)
-        //     {
-        //         if(chunkSizes[i] > dim[i])
-        //         {
-        //             chunkSizes[i] = dim[i];
-        //         }
-        //     }
-        //     properties.add(HighFive::Chunking(chunkSizes));
-        // }
-        // if(m_file_access->m_compress)
-        // {
-        //     //properties.add(HighFive::Shuffle());
-        //     properties.add(HighFive::Deflate(9));
-        // }
+        HighFive::DataSetCreateProps properties = createProperties(datasetName, dim, sizeof(T));
         
         std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<T>(
             g, datasetName, dataSpace, properties
@@ -210,18 +205,9 @@ bool HDF5Kernel::addChannel(const std::string group, const std::string name, con
 {
     if(m_hdf5File && m_hdf5File->isValid())
     {
-        HighFive::DataSpace dataSpace({channel.numElements(), channel.width()});
-        HighFive::DataSetCreateProps properties;
-
-        // if(m_file_access->m_chunkSize)
-        // {
-        //     properties.add(HighFive::Chunking({channel.numElements(), channel.width()}));
-        // }
-        // if(m_file_access->m_compress)
-        // {
-        //     //properties.add(HighFive::Shuffle());
-        //     properties.add(HighFive::Deflate(9));
-        // }
+        std::vector<size_t> dims = {channel.numElements(), channel.width()};
+        HighFive::DataSpace dataSpace(dims);
+        HighFive::DataSetCreateProps properties = createProperties(name, dims, sizeof(T));
 
         // TODO check group for vertex / face attribute and set flag in hdf5 channel
         HighFive::Group g = hdf5util::getGroup(m_hdf5File, "channels");
@@ -298,25 +284,8 @@ void HDF5Kernel::save(HighFive::Group &g,
         std::vector<size_t > dims = {channel.numElements(), channel.width()};
 
         HighFive::DataSpace dataSpace(dims);
-        HighFive::DataSetCreateProps properties;
-
-        // if(m_file_access->m_chunkSize)
-        // {
-        //     for(size_t i = 0; i < chunkSizes.size(); i++)
-        //     {
-        //         if(chunkSizes[i] > dims[i])
-        //         {
-        //             chunkSizes[i] = dims[i];
-        //         }
-        //     }
-        //     properties.add(HighFive::Chunking(chunkSizes));
-        // }
-        // if(m_file_access->m_compress)
-        // {
-        //     //properties.add(HighFive::Shuffle());
-        //     properties.add(HighFive::Deflate(9));
-        // }
-   
+        HighFive::DataSetCreateProps properties = createProperties(datasetName, dims, sizeof(T));
+
         std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<T>(
             g, datasetName, dataSpace, properties
         );
@@ -363,12 +332,13 @@ boost::optional<VariantChannelT> loadVChannel(
     HighFive::DataType dtype,
     const HDF5Kernel* channel_io,
     HighFive::Group& group,
-    std::string name)
+    std::string name,
+    const ArraySelection& rows)
 {
     boost::optional<VariantChannelT> ret;
     if(dtype == HighFive::AtomicType<typename VariantChannelT::template type_of_index<R> >())
     {
-        auto channel = channel_io->template loadChannelOptional<typename VariantChannelT::template type_of_index<R> >(group, name);
+        auto channel = channel_io->template loadChannelOptional<typename VariantChannelT::template type_of_index<R> >(group, name, rows);
         if(channel) {
             ret = *channel;
         }
@@ -384,13 +354,14 @@ boost::optional<VariantChannelT> loadVChannel(
     HighFive::DataType dtype,
     const HDF5Kernel* channel_io,
     HighFive::Group& group,
-    std::string name)  
+    std::string name,
+    const ArraySelection& rows)  
 {
     boost::optional<VariantChannelT> ret;
     if(dtype == HighFive::AtomicType<typename VariantChannelT::template type_of_index<R> >())
     {
         boost::optional<VariantChannelT> ret;
-        auto loaded_channel = channel_io->loadChannelOptional<typename VariantChannelT::template type_of_index<R> >(group, name);
+        auto loaded_channel = channel_io->loadChannelOptional<typename VariantChannelT::template type_of_index<R> >(group, name, rows);
         if(loaded_channel)
         {
             ret = *loaded_channel;
@@ -399,7 +370,7 @@ boost::optional<VariantChannelT> loadVChannel(
     } 
     else 
     {
-        return loadVChannel<VariantChannelT, R-1>(dtype, channel_io, group, name);
+        return loadVChannel<VariantChannelT, R-1>(dtype, channel_io, group, name, rows);
     }
 }
 
@@ -408,24 +379,26 @@ template<typename VariantChannelT>
 boost::optional<VariantChannelT> HDF5Kernel::loadDynamic(
     HighFive::DataType dtype,
     HighFive::Group& group,
-    std::string name) const
+    std::string name,
+    const ArraySelection& rows) const
 {
     return loadVChannel<VariantChannelT, VariantChannelT::num_types-1>(
-        dtype, this, group, name);
+        dtype, this, group, name, rows);
 }
 
 
 template<typename VariantChannelT>
 boost::optional<VariantChannelT> HDF5Kernel::load(
     std::string groupName,
-    std::string datasetName) const 
+    std::string datasetName,
+    const ArraySelection& rows) const 
 {
     boost::optional<VariantChannelT> ret;
 
     if(hdf5util::exist(m_hdf5File, groupName))
     {
         HighFive::Group g = hdf5util::getGroup(m_hdf5File, groupName, false);
-        ret = this->load<VariantChannelT>(g, datasetName);
+        ret = this->load<VariantChannelT>(g, datasetName, rows);
     } else {
         std::cout << "[VariantChannelIO] WARNING: Group " << groupName << " not found." << std::endl;
     }
@@ -437,7 +410,8 @@ boost::optional<VariantChannelT> HDF5Kernel::load(
 template<typename VariantChannelT>
 boost::optional<VariantChannelT> HDF5Kernel::load(
     HighFive::Group& group,
-    std::string datasetName) const
+    std::string datasetName,
+    const ArraySelection& rows) const
 {
     boost::optional<VariantChannelT> ret;
 
@@ -454,7 +428,7 @@ boost::optional<VariantChannelT> HDF5Kernel::load(
     if(dataset)
     {
         // name is dataset
-        ret = loadDynamic<VariantChannelT>(dataset->getDataType(), group, datasetName);
+        ret = loadDynamic<VariantChannelT>(dataset->getDataType(), group, datasetName, rows);
     }
 
     return ret;
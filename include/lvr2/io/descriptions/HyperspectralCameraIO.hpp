@@ -17,7 +17,15 @@ public:
   void saveHyperspectralCamera(const size_t& scanPosNo, const HyperspectralCameraPtr &buffer);
   void saveHyperspectralCamera(std::string &group, const HyperspectralCameraPtr &buffer);
 
-  HyperspectralCameraPtr loadHyperspectralCamera(const size_t& scanPosNo);
+  /**
+   * @brief Loads the hyperspectral camera of the given scan position
+   *
+   * @param scanPosNo   The scan position
+   * @param bands       Subset of spectral bands to load for every panorama. Only the
+   *                    first dimension is used, e.g. ArraySelection::rows(10, 20) for
+   *                    the bands 10 to 29. Loads all bands by default.
+   */
+  HyperspectralCameraPtr loadHyperspectralCamera(const size_t& scanPosNo, const ArraySelection& bands = ArraySelection());
   
 protected:
   bool isHyperspectralCamera(std::string &path);
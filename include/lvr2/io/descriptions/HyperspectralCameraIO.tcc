@@ -118,7 +118,9 @@ void HyperspectralCameraIO<Derived>::saveHyperspectralCamera(
 }
 
 template <typename Derived>
-HyperspectralCameraPtr HyperspectralCameraIO<Derived>::loadHyperspectralCamera(const size_t& scanPosNo)
+HyperspectralCameraPtr HyperspectralCameraIO<Derived>::loadHyperspectralCamera(
+    const size_t& scanPosNo, 
+    const ArraySelection& bands)
 {
     HyperspectralCameraPtr ret(new HyperspectralCamera);
     
@@ -339,13 +341,13 @@ HyperspectralCameraPtr HyperspectralCameraIO<Derived>::loadHyperspectralCamera(c
         std::vector<size_t> dim; // Uff, initialisierung???
         if(fd.dataSetName)
         {
-            data = m_arrayIO->loadUCharArray(positionGroup, *fd.dataSetName, dim);
+            data = m_arrayIO->loadUCharArray(positionGroup, *fd.dataSetName, bands.firstDimension(), dim);
         }
         
         std::vector<size_t> timeDim;
         if(td.dataSetName)
         {   
-            timestamps = m_arrayIO->loadDoubleArray(positionGroup, *td.dataSetName, timeDim);
+            timestamps = m_arrayIO->loadDoubleArray(positionGroup, *td.dataSetName, bands.firstDimension(), timeDim);
         }
 
         HyperspectralPanoramaPtr panoramaPtr(new HyperspectralPanorama);
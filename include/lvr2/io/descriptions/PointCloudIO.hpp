@@ -6,6 +6,7 @@
 #include <boost/optional.hpp>
 
 #include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/io/descriptions/ArraySelection.hpp"
 
 // Dependencies
 #include "ChannelIO.hpp"
@@ -47,6 +48,15 @@ class PointCloudIO
 public:
     void savePointCloud(const std::string& group, const std::string& name, const PointBufferPtr& buffer);
     PointBufferPtr loadPointCloud(const std::string& group, const std::string& container);
+
+    /**
+     * @brief Loads only the selected rows (points) of every channel.
+     *
+     * Allows to stream large point clouds in blocks, e.g.
+     * ArraySelection::rows(i * blockSize, blockSize) or every n-th
+     * point with ArraySelection::rows(0, numPoints / n, n).
+     */
+    PointBufferPtr loadPointCloud(const std::string& group, const std::string& container, const ArraySelection& rows);
     
 protected:
 
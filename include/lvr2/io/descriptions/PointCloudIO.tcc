@@ -16,6 +16,15 @@ PointBufferPtr PointCloudIO<FeatureBase>::loadPointCloud(const std::string& grou
     return m_featureBase->m_kernel->loadPointBuffer(group, name);
 }
 
+template<typename FeatureBase>
+PointBufferPtr PointCloudIO<FeatureBase>::loadPointCloud(
+    const std::string& group, 
+    const std::string& name, 
+    const ArraySelection& rows)
+{
+    return m_featureBase->m_kernel->loadPointBufferSelection(group, name, rows);
+}
+
 
 template<typename FeatureBase>
 bool PointCloudIO<FeatureBase>::isPointCloud(
@@ -54,6 +54,8 @@ class ChunkIO
     template <typename T>
     T loadChunk(std::string layer, int x, int y, int z);
 
+    bool chunkExists(std::string layer, int x, int y, int z);
+
   protected:
     Derived* m_file_access                 = static_cast<Derived*>(this);
     ArrayIO<Derived>* m_array_io           = static_cast<ArrayIO<Derived>*>(m_file_access);
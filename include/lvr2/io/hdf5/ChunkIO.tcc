@@ -134,6 +134,14 @@ T ChunkIO<Derived>::loadChunk(std::string layer, int x, int y, int z)
         ->load(m_chunkName + "/" + layer + "/" + chunkName);
 }
 
+template <typename Derived>
+bool ChunkIO<Derived>::chunkExists(std::string layer, int x, int y, int z)
+{
+    std::string chunkName = std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(z);
+
+    return hdf5util::exist(m_file_access->m_hdf5_file, m_chunkName + "/" + layer + "/" + chunkName);
+}
+
 } // namespace hdf5features
 
 } // namespace lvr2
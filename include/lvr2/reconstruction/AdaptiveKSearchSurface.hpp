@@ -296,6 +296,20 @@ private:
         const vector<size_t> &id
     );
 
+    /**
+     * @brief Estimates the normal of the query point from the given
+     *        k-neighborhood and flips it towards the nearest scan pose
+     *        (or the centroid if no poses are given).
+     */
+    Normal<typename BaseVecT::CoordType> estimateNormal(
+        const BaseVecT &queryPoint,
+        int k,
+        const vector<size_t> &id
+    );
+
+    /// Maximum number of neighbours requested by a single batched k-search
+    static constexpr size_t MAX_BATCH_NEIGHBOURS = 1 << 22;
+
 
 
 
@@ -44,6 +44,7 @@
 #include <set>
 #include <random>
 #include <algorithm>
+#include <numeric>
 
 #include "lvr2/util/Factories.hpp"
 #include "lvr2/io/Progress.hpp"
@@ -176,145 +177,181 @@ void AdaptiveKSearchSurface<BaseVecT>::calculateSurfaceNormals()
     string comment = timestamp.getElapsedTime() + "Estimating normals ";
     lvr2::ProgressBar progress(numPoints, comment);
 
-    #pragma omp parallel for schedule(dynamic, 12)
-    for(size_t i = 0; i < numPoints; i++) {
-        // We have to fit these vector to have the
-        // correct return values when performing the
-        // search on the stann kd tree. So we don't use
-        // the template parameter T for di
-        vector<size_t> id;
-        vector<float> di;
+    // The neighborhoods of all points are searched in batches. Points whose
+    // neighborhood has a degenerated bounding box are searched again with
+    // twice as many neighbors, at most five times.
+    vector<size_t> pending(numPoints);
+    std::iota(pending.begin(), pending.end(), 0);
 
-        int n = 0;
-        size_t k = k_0;
+    vector<BaseVecT> queries;
+    vector<size_t> ids;
+    vector<float> dists;
+    vector<char> retry;
 
-        while(n < 5)
+    size_t k = k_0;
+    for(int n = 1; n <= 5 && !pending.empty(); n++)
+    {
+        /**
+         *  @todo Maybe this should be done at the end of the loop
+         *        after the bounding box check
+         */
+        k = k * 2;
+
+        vector<size_t> nextPending;
+        size_t batchSize = std::max<size_t>(1, MAX_BATCH_NEIGHBOURS / k);
+
+        for(size_t start = 0; start < pending.size(); start += batchSize)
         {
-            n++;
-            /**
-             *  @todo Maybe this should be done at the end of the loop
-             *        after the bounding box check
-             */
-            k = k * 2;
-
-            //T* point = this->m_points[i];
-
-            id.clear();
-            di.clear();
-
-            this->m_searchTree->kSearch(pts[i], k, id, di);
-
-            float min_x = 1e15f;
-            float min_y = 1e15f;
-            float min_z = 1e15f;
-            float max_x = - min_x;
-            float max_y = - min_y;
-            float max_z = - min_z;
-
-            float dx, dy, dz;
-            dx = dy = dz = 0;
-
-            // Calculate the bounding box of found point set
-            /**
-             * @todo Use the bounding box object from the old model3d
-             *       library for bounding box calculation...
-             */
-            for(size_t j = 0; j < k; j++) {
-                min_x = std::min(min_x, pts[id[j]][0]);
-                min_y = std::min(min_y, pts[id[j]][1]);
-                min_z = std::min(min_z, pts[id[j]][2]);
-
-                max_x = std::max(max_x, pts[id[j]][0]);
-                max_y = std::max(max_y, pts[id[j]][1]);
-                max_z = std::max(max_z, pts[id[j]][2]);
-
-                dx = max_x - min_x;
-                dy = max_y - min_y;
-                dz = max_z - min_z;
-            }
+            size_t count = std::min(batchSize, pending.size() - start);
+
+            queries.resize(count);
+            ids.resize(count * k);
+            dists.resize(count * k);
+            retry.assign(count, 0);
 
-            if(boundingBoxOK(dx, dy, dz))
+            for(size_t j = 0; j < count; j++)
             {
-                break;
+                queries[j] = pts[pending[start + j]];
             }
-        }
 
-        // Create a query point for the current point
-        auto queryPoint = pts[i];
+            this->m_searchTree->kSearchMany(queries.data(), count, k, ids.data(), dists.data());
 
-        // Interpolate a plane based on the k-neighborhood
-        Plane<BaseVecT> p;
-        bool ransac_ok;
+            #pragma omp parallel
+            {
+                vector<size_t> id(k);
 
-        if(m_calcMethod == 1)
-        {
-            p = calcPlaneRANSAC(queryPoint, k, id, ransac_ok);
-            // Fallback if RANSAC failed
-            if(!ransac_ok)
+                #pragma omp for schedule(dynamic, 12)
+                for(size_t j = 0; j < count; j++)
+                {
+                    std::copy(ids.begin() + j * k, ids.begin() + (j + 1) * k, id.begin());
+
+                    float min_x = 1e15f;
+                    float min_y = 1e15f;
+                    float min_z = 1e15f;
+                    float max_x = - min_x;
+                    float max_y = - min_y;
+                    float max_z = - min_z;
+
+                    // Calculate the bounding box of found point set
+                    /**
+                     * @todo Use the bounding box object from the old model3d
+                     *       library for bounding box calculation...
+                     */
+                    for(size_t l = 0; l < k; l++) {
+                        min_x = std::min(min_x, pts[id[l]][0]);
+                        min_y = std::min(min_y, pts[id[l]][1]);
+                        min_z = std::min(min_z, pts[id[l]][2]);
+
+                        max_x = std::max(max_x, pts[id[l]][0]);
+                        max_y = std::max(max_y, pts[id[l]][1]);
+                        max_z = std::max(max_z, pts[id[l]][2]);
+                    }
+
+                    if(n < 5 && !boundingBoxOK(max_x - min_x, max_y - min_y, max_z - min_z))
+                    {
+                        retry[j] = 1;
+                        continue;
+                    }
+
+                    // Save result in normal array
+                    size_t i = pending[start + j];
+                    Normal<typename BaseVecT::CoordType> normal = estimateNormal(queries[j], k, id);
+                    normals[i*3 + 0] = normal.x;
+                    normals[i*3 + 1] = normal.y;
+                    normals[i*3 + 2] = normal.z;
+
+                    ++progress;
+                }
+            }
+
+            for(size_t j = 0; j < count; j++)
             {
-                // compare speed
-                p = calcPlane(queryPoint, k, id);
+                if(retry[j])
+                {
+                    nextPending.push_back(pending[start + j]);
+                }
             }
         }
-        else if(m_calcMethod == 2)
-        {
-            p = calcPlaneIterative(queryPoint, k, id);
-        }
-        else
+        pending.swap(nextPending);
+    }
+    cout << endl;
+
+    if(this->m_ki)
+    {
+        interpolateSurfaceNormals();
+    }
+}
+
+
+template<typename BaseVecT>
+Normal<typename BaseVecT::CoordType> AdaptiveKSearchSurface<BaseVecT>::estimateNormal(
+    const BaseVecT &queryPoint,
+    int k,
+    const vector<size_t> &id
+)
+{
+    // Interpolate a plane based on the k-neighborhood
+    Plane<BaseVecT> p;
+    bool ransac_ok;
+
+    if(m_calcMethod == 1)
+    {
+        p = calcPlaneRANSAC(queryPoint, k, id, ransac_ok);
+        // Fallback if RANSAC failed
+        if(!ransac_ok)
         {
+            // compare speed
             p = calcPlane(queryPoint, k, id);
         }
-        // Get the mean distance to the tangent plane
-        //mean_distance = meanDistance(p, id, k);
-        Normal<typename BaseVecT::CoordType> normal(0, 0, 1);
-        normal = p.normal;
+    }
+    else if(m_calcMethod == 2)
+    {
+        p = calcPlaneIterative(queryPoint, k, id);
+    }
+    else
+    {
+        p = calcPlane(queryPoint, k, id);
+    }
+    // Get the mean distance to the tangent plane
+    //mean_distance = meanDistance(p, id, k);
+    Normal<typename BaseVecT::CoordType> normal(0, 0, 1);
+    normal = p.normal;
 
-        // Flip normals towards the center of the scene or nearest scan pose
-        if(m_poseTree)
+    // Flip normals towards the center of the scene or nearest scan pose
+    if(m_poseTree)
+    {
+        const FloatChannel pts = *(this->m_pointBuffer->getFloatChannel("points"));
+        vector<size_t> nearestPoseIds;
+        m_poseTree->kSearch(queryPoint, 1, nearestPoseIds);
+        if(nearestPoseIds.size() == 1)
         {
-            vector<size_t> nearestPoseIds;
-            m_poseTree->kSearch(queryPoint, 1, nearestPoseIds);
-            if(nearestPoseIds.size() == 1)
-            {
-                BaseVecT nearest = pts[nearestPoseIds[0]];
-                Normal<typename BaseVecT::CoordType> dir(queryPoint - nearest);
-                if(normal.dot(dir) < 0)
-                {
-                    normal = -normal;
-                }
-            }
-            else
+            BaseVecT nearest = pts[nearestPoseIds[0]];
+            Normal<typename BaseVecT::CoordType> dir(queryPoint - nearest);
+            if(normal.dot(dir) < 0)
             {
-                cout << timestamp.getElapsedTime() << "Could not get nearest scan pose. Defaulting to centroid." << endl;
-                Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
-                if(normal.dot(dir) < 0)
-                {
-                    normal = -normal;
-                }
+                normal = -normal;
             }
         }
         else
         {
+            cout << timestamp.getElapsedTime() << "Could not get nearest scan pose. Defaulting to centroid." << endl;
             Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
             if(normal.dot(dir) < 0)
             {
                 normal = -normal;
             }
         }
-
-        // Save result in normal array
-        normals[i*3 + 0] = normal.x;
-        normals[i*3 + 1] = normal.y;
-        normals[i*3 + 2] = normal.z;
-
-        ++progress;
     }
-    cout << endl;
-
-    if(this->m_ki)
+    else
     {
-        interpolateSurfaceNormals();
+        Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
+        if(normal.dot(dir) < 0)
+        {
+            normal = -normal;
+        }
     }
+
+    return normal;
 }
 
 
@@ -334,38 +371,59 @@ void AdaptiveKSearchSurface<BaseVecT>::interpolateSurfaceNormals()
     string comment = timestamp.getElapsedTime() + "Interpolating normals ";
     lvr2::ProgressBar progress(numPoints, comment);
 
-    // Interpolate normals
-    #pragma omp parallel for schedule(dynamic, 12)
-    for( int i = 0; i < (int)numPoints; i++)
+    // Interpolate normals. The neighborhoods are searched in batches.
+    const int ki = this->m_ki;
+    const size_t batchSize = std::max<size_t>(1, MAX_BATCH_NEIGHBOURS / ki);
+
+    vector<BaseVecT> queries;
+    vector<size_t> ids;
+    vector<float> dists;
+
+    for(size_t start = 0; start < numPoints; start += batchSize)
     {
-        vector<size_t> id;
-        vector<float> di;
+        size_t count = std::min(batchSize, numPoints - start);
 
-        this->m_searchTree->kSearch(pts[i], this->m_ki, id, di);
+        queries.resize(count);
+        ids.resize(count * ki);
+        dists.resize(count * ki);
 
-        BaseVecT mean = normals[i];
-        for(int j = 0; j < this->m_ki; j++)
+        for(size_t j = 0; j < count; j++)
         {
-            mean += normals[id[j]];
+            queries[j] = pts[start + j];
         }
-        auto mean_normal = mean.normalized();
-        tmp[i] = mean_normal;
 
-        ///todo Try to remove this code. Should improve the results at all.
-        for(int j = 0; j < this->m_ki; j++)
+        this->m_searchTree->kSearchMany(queries.data(), count, ki, ids.data(), dists.data());
+
+        #pragma omp parallel for schedule(dynamic, 12)
+        for(size_t j = 0; j < count; j++)
         {
-            Normal<typename BaseVecT::CoordType> n = normals[id[j]];
+            size_t i = start + j;
+            const size_t* id = ids.data() + j * ki;
+
+            BaseVecT mean = normals[i];
+            for(int l = 0; l < ki; l++)
+            {
+                mean += normals[id[l]];
+            }
+            auto mean_normal = mean.normalized();
+            tmp[i] = mean_normal;
 
-            // Only override existing normals if the interpolated
-            // normals is significantly different from the initial
-            // estimation. This helps to avoid a too smooth normal
-            // field
-            if(fabs(n.dot(mean_normal)) > 0.2 )
+            ///todo Try to remove this code. Should improve the results at all.
+            for(int l = 0; l < ki; l++)
             {
-                normals[id[j]] = mean_normal;
+                Normal<typename BaseVecT::CoordType> n = normals[id[l]];
+
+                // Only override existing normals if the interpolated
+                // normals is significantly different from the initial
+                // estimation. This helps to avoid a too smooth normal
+                // field
+                if(fabs(n.dot(mean_normal)) > 0.2 )
+                {
+                    normals[id[l]] = mean_normal;
+                }
             }
+            ++progress;
         }
-        ++progress;
     }
     cout << endl;
     cout << timestamp.getElapsedTime() << "Copying normals..." << endl;
@@ -37,13 +37,18 @@
 
 #include "lvr2/geometry/BoundingBox.hpp"
 #include "lvr2/io/DataStruct.hpp"
+#include "lvr2/io/ScanProjectPointStream.hpp"
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #ifndef __APPLE__
 #include <omp.h>
@@ -72,22 +77,62 @@ class BigGrid
 {
   public:
     /**
-     * Constructor:
+     * Constructor: Reads every input file once, stages the scaled points in
+     * temporary files and sorts them into the grid cells in parallel.
      * @param cloudPath path to PointCloud in ASCII xyz Format // Todo: Add other file formats
      * @param voxelsize
+     * @param bufferSize number of points that are read from the files at once
+     * @param directory directory that holds the files of the grid. It is
+     *                  created if it does not exist.
      */
-    BigGrid(std::vector<std::string> cloudPath, float voxelsize, float scale = 0, size_t bufferSize = 1024);
+    BigGrid(std::vector<std::string> cloudPath,
+            float voxelsize,
+            float scale = 0,
+            size_t bufferSize = 1 << 20,
+            std::string directory = ".");
 
     /**
      * Constructor: specific case for incremental reconstruction/chunking. also compatible with simple reconstruction
+     * The first scan of every position is read twice through a
+     * ScanProjectPointStream, once for the bounding boxes and once to stage
+     * the points in a temporary file, so scans do not need to be in memory.
      * @param voxelsize specified voxelsize
      * @param project ScanProject, which contain one or more Scans
      * @param scale scale value of for current scans
+     * @param directory directory that holds the files of the grid. It is
+     *                  created if it does not exist.
      */
-    BigGrid(float voxelsize,ScanProjectEditMarkPtr project, float scale = 0);
+    BigGrid(float voxelsize, ScanProjectEditMarkPtr project, float scale = 0, std::string directory = ".");
 
+    /**
+     * Constructor: Reopens a grid written by \ref serialize. Only the header
+     * and the cell table are read, the channel files are mapped on demand.
+     * Headers of older versions (without channel list) are still accepted.
+     * @param path the grid directory or the header file within it. The
+     *             channel files are expected next to the header, so the
+     *             directory can be moved as a whole.
+     * @throws std::runtime_error if the header cannot be opened, is
+     *         truncated, has an unsupported version or the point file is
+     *         missing.
+     */
     BigGrid(std::string path);
 
+    /**
+     * Adds the points of all changed scans of the given project to the grid.
+     * If they lie within the bounding box of the grid, the cell layout is
+     * only extended by the cells that receive points. Every channel file is
+     * still rewritten, but the stored points of all other cells are copied
+     * as whole blocks. Otherwise the grid is rebuilt from its own files,
+     * which are staged on disk together with the new points. The partial
+     * bounding box is set to the added scans.
+     * If the grid stores normals or colors, the added scans have to provide
+     * them as well.
+     * @param project ScanProject, scans marked as changed are added
+     * @throws std::runtime_error if an added scan lacks normals or colors the
+     *         grid stores. The grid is not changed in this case.
+     */
+    void append(ScanProjectEditMarkPtr project);
+
     /**
      * @return Number of voxels
      */
@@ -118,7 +163,11 @@ class BigGrid
     lvr2::floatArr points(int i, int j, int k, size_t& numPoints);
 
     /**
-     *  Points that are within bounding box defined by a min and max point
+     *  Points that are within bounding box defined by a min and max point.
+     *  Only the cells overlapping the box are visited. If these cells are
+     *  stored consecutively in the memory mapped file, the returned array is
+     *  a copy-on-write view into the file, otherwise the contiguous runs of
+     *  cells are copied.
      * @param minx
      * @param miny
      * @param minz
@@ -137,7 +186,8 @@ class BigGrid
     lvr2::ucharArr colors(
         float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
     /**
-     * return numbers of points in a specific area (defined by the params) of the grid
+     * return numbers of points in a specific area (defined by the params) of the grid.
+     * The area is clamped to the grid like in \ref points, so both return the same number of points.
      * @param minx
      * @param miny
      * @param minz
@@ -148,7 +198,36 @@ class BigGrid
      */
     size_t getSizeofBox(float minx, float miny, float minz, float maxx, float maxy, float maxz);
 
-    void serialize(std::string path = "serinfo.ls");
+    /**
+     * Writes the header of the grid (bounding boxes, voxel size, channel list
+     * and cell table) to the grid directory. Together with the channel files,
+     * the directory can be reopened with BigGrid(std::string).
+     * @param name file name of the header within the grid directory
+     */
+    void serialize(std::string name = "serinfo.ls");
+
+    /**
+     * @return directory that holds the files of the grid
+     */
+    const std::string& getDirectory() const { return m_directory; }
+
+    /**
+     * @return voxel size of the grid cells
+     */
+    float getVoxelSize() const { return m_voxelSize; }
+
+    /**
+     * @return scale that was applied to the input points
+     */
+    float getScale() const { return m_scale; }
+
+    /**
+     * Bounding boxes of the scan positions whose points were added by the
+     * scan project constructor or the last call of \ref append, indexed like
+     * the positions of the project. Boxes of positions that were not added
+     * are invalid.
+     */
+    const std::vector<BoundingBox<BaseVecT>>& getAddedPositionBoxes() const { return m_addedPositionBoxes; }
 
     lvr2::floatArr getPointCloud(size_t& numPoints);
 
@@ -191,9 +270,159 @@ class BigGrid
   private:
     inline int calcIndex(float f) { return f < 0 ? f - .5 : f + .5; }
 
+    /// Occupied cell in the Morton ordered cell index
+    struct MortonCell
+    {
+        uint64_t code;
+        size_t offset;
+        size_t size;
+    };
+
+    /// Start of headers with channel list, older headers start with m_maxIndexSquare
+    static constexpr char HEADER_MAGIC[] = "LVR2BGRD";
+    static constexpr size_t HEADER_MAGIC_SIZE = 8;
+    static constexpr uint32_t HEADER_VERSION = 1;
+
+    /// Largest cell index per axis that can be encoded in a Morton code
+    static constexpr size_t MORTON_MAX_INDEX = (1 << 21) - 1;
+
+    /**
+     * Interleaves the lower 21 bits of the given cell indices to a Morton
+     * (Z-order) code. Bit 3n holds bit n of i, bit 3n + 1 of j and bit 3n + 2 of k.
+     */
+    static inline uint64_t mortonCode(size_t i, size_t j, size_t k)
+    {
+        return spreadBits(i) | (spreadBits(j) << 1) | (spreadBits(k) << 2);
+    }
+
+    static inline uint64_t spreadBits(uint64_t v)
+    {
+        v &= MORTON_MAX_INDEX;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8) & 0x100f00f00f00f00full;
+        v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+
+    /**
+     * Returns the smallest Morton code greater than code that lies within
+     * the box spanned by zmin and zmax (BIGMIN, Tropf and Herzog 1981).
+     */
+    static uint64_t nextMortonCode(uint64_t code, uint64_t zmin, uint64_t zmax);
+
+    /**
+     * Rebuilds the Morton ordered index of all occupied cells.
+     */
+    void buildCellIndex();
+
+    /**
+     * Returns the ranges [first, last) of points in the memory mapped files
+     * that belong to the cells within the given box. The box is clamped to
+     * the bounding box of the grid. Adjacent cells are merged into a single
+     * range.
+     */
+    std::vector<std::pair<size_t, size_t>> cellRanges(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz);
+
+    /**
+     * Returns the given ranges of 3-tuples of the memory mapped file at path.
+     */
+    template <typename T>
+    boost::shared_array<T> readRanges(const std::string& path,
+                                      const std::vector<std::pair<size_t, size_t>>& ranges,
+                                      size_t numPoints);
+
     bool exists(int i, int j, int k);
     void insert(float x, float y, float z);
 
+    /**
+     * @return path of the file with the given name in the grid directory
+     */
+    std::string filePath(const std::string& name) const;
+
+    /// Staging file, closed without error check when it goes out of scope
+    using StageFile = std::unique_ptr<FILE, int (*)(FILE*)>;
+
+    /**
+     * Creates the file with the given name in the grid directory for writing.
+     * @throws std::runtime_error if the file cannot be created
+     */
+    StageFile openStage(const std::string& name);
+
+    /**
+     * Writes count elements of the given size to the staging file.
+     * @throws std::runtime_error if not all elements were written
+     */
+    void writeStage(StageFile& stage, const void* data, size_t size, size_t count, const std::string& name);
+
+    /**
+     * Closes the staging file.
+     * @throws std::runtime_error if buffered data could not be written
+     */
+    void closeStage(StageFile& stage, const std::string& name);
+
+    /**
+     * Scales the points of all blocks of the given stream and writes them
+     * in order to the file with the given name in the grid directory.
+     * @param progress called with every block after its points are scaled
+     * @param normalName if not empty, the normals are written to this file
+     * @param colorName if not empty, the colors are written to this file
+     * @return number of written points
+     * @throws std::runtime_error if a block has no normals or colors although
+     *         they are requested
+     */
+    template <typename ProgressFunc>
+    size_t stagePoints(ScanProjectPointStream& stream,
+                       const std::string& name,
+                       ProgressFunc progress,
+                       const std::string& normalName = "",
+                       const std::string& colorName = "");
+
+    /**
+     * Adds the given points (and the optional attributes) to the grid, see
+     * \ref append. Attributes the grid does not store are ignored.
+     * @return bounding box of the added points
+     * @throws std::runtime_error if the grid stores normals or colors and
+     *         they are not given. The grid is not changed in this case.
+     */
+    BoundingBox<BaseVecT> appendPoints(const float* points,
+                                       const float* normals,
+                                       const unsigned char* colors,
+                                       size_t numPoints);
+
+    /**
+     * Adds the 7 neighbor cells (see HGCreateTable) of the given cells to
+     * the grid if they do not exist yet.
+     */
+    void addNeighborCells(const std::vector<CellInfo>& cells);
+
+    /**
+     * Assigns the file offsets of all cells in Morton order and rebuilds
+     * the cell index.
+     */
+    void layoutCells();
+
+    /**
+     * Aligns the bounding box to the voxel size and calculates the
+     * maximum indices of the grid.
+     * @throws std::runtime_error if an axis has more cells than the Morton
+     *         codes can encode. The grid is not changed in this case.
+     */
+    void calcIndices();
+
+    /**
+     * Builds the cell histogram from per-thread partial histograms and
+     * writes the points (and the optional attributes) sorted by cell to
+     * the memory mapped files. The cells are stored in Morton order, within
+     * a cell, the input order is kept.
+     * @param points m_numPoints scaled points in input order
+     * @param normals normals of the points or nullptr
+     * @param colors colors of the points or nullptr
+     */
+    void sortIntoCells(const float* points, const float* normals, const unsigned char* colors);
+
     size_t m_maxIndexSquare;
     size_t m_maxIndex;
     size_t m_maxIndexX;
@@ -221,7 +450,17 @@ class BigGrid
 
     std::vector<shared_ptr<Scan>> m_scans;
 
+    /// Directory that holds the header and the channel files
+    std::string m_directory;
+
+    /// See getAddedPositionBoxes()
+    std::vector<BoundingBox<BaseVecT>> m_addedPositionBoxes;
+
     std::unordered_map<size_t, CellInfo> m_gridNumPoints;
+
+    /// Occupied cells sorted by their Morton code
+    std::vector<MortonCell> m_cellIndex;
+
     float m_scale;
 };
 
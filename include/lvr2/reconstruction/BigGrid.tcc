@@ -32,6 +32,7 @@
  *      Author: Isaak Mitschke
  */
 
+#include "lvr2/config/lvropenmp.hpp"
 #include "lvr2/io/hdf5/HDF5FeatureBase.hpp"
 #include "lvr2/io/LineReader.hpp"
 #include "lvr2/io/Progress.hpp"
@@ -43,11 +44,17 @@
 #include "lvr2/io/hdf5/VariantChannelIO.hpp"
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/optional/optional_io.hpp>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 using namespace std;
 
@@ -58,11 +65,16 @@ template <typename BaseVecT>
 BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
                            float voxelsize,
                            float scale,
-                           size_t bufferSize)
+                           size_t bufferSize,
+                           std::string directory)
     : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
       m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false),
-      m_pointBufferSize(1024)
+      m_pointBufferSize(bufferSize), m_directory(directory)
 {
+    if (!boost::filesystem::exists(m_directory))
+    {
+        boost::filesystem::create_directories(m_directory);
+    }
 
     boost::filesystem::path selectedFile(cloudPath[0]);
     string extension = selectedFile.extension().string();
@@ -71,472 +83,357 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
 #endif
     m_voxelSize = voxelsize;
 
-    // First, parse whole file to get BoundingBox and amount of points
-    float ix, iy, iz;
-    std::cout << lvr2::timestamp << "Computing Bounding Box..." << std::endl;
-    m_numPoints = 0;
-    size_t rsize = 0;
+    // Parse all files once. The scaled points are staged in input order
+    // while the bounding box is computed. The layout of the first file
+    // determines which attributes are stored.
+    std::cout << lvr2::timestamp << "Reading points and computing Bounding Box..." << std::endl;
     LineReader lineReader(cloudPath);
-    size_t lasti = 0;
+    fileType type = lineReader.getFileType(0);
+    m_has_normal = (type == XYZN || type == XYZNRGB);
+    m_has_color = (type == XYZRGB || type == XYZNRGB);
+
+    StageFile pointStage = openStage("points_raw.mmf");
+    StageFile normalStage = m_has_normal ? openStage("normals_raw.mmf") : StageFile(nullptr, fclose);
+    StageFile colorStage = m_has_color ? openStage("colors_raw.mmf") : StageFile(nullptr, fclose);
+
+    std::vector<float> points;
+    std::vector<float> normals;
+    std::vector<unsigned char> colors;
+    size_t rsize = 0;
+    m_numPoints = 0;
     while (lineReader.ok())
     {
-        if (lineReader.getFileType() == XYZNRGB)
+        boost::shared_ptr<void> chunk = lineReader.getNextPoints(rsize, m_pointBufferSize);
+        if (rsize <= 0)
         {
-            boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
+            if (!lineReader.ok())
             {
                 break;
             }
-            for (int i = 0; i < rsize; i++)
-            {
-                m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                        a.get()[i].point.y * m_scale,
-                                        a.get()[i].point.z * m_scale));
-                m_numPoints++;
-            }
+            continue;
         }
-        else if (lineReader.getFileType() == XYZN)
+
+        // Record layout of the current file (see LineReader.hpp)
+        fileType chunkType = lineReader.getFileType();
+        size_t recordSize = sizeof(xyz);
+        size_t normalOffset = 0;
+        size_t colorOffset = 0;
+        if (chunkType == XYZN || chunkType == XYZNRGB)
         {
-            boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            for (int i = 0; i < rsize; i++)
-            {
-                m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                        a.get()[i].point.y * m_scale,
-                                        a.get()[i].point.z * m_scale));
-                m_numPoints++;
-            }
+            normalOffset = recordSize;
+            recordSize += sizeof(coord<float>);
         }
-        else if (lineReader.getFileType() == XYZ)
+        if (chunkType == XYZRGB || chunkType == XYZNRGB)
         {
-            boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            for (size_t i = 0; i < rsize; i++)
-            {
-                m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                        a.get()[i].point.y * m_scale,
-                                        a.get()[i].point.z * m_scale));
-                m_numPoints++;
-                lasti = i;
-            }
+            colorOffset = recordSize;
+            recordSize += sizeof(color<unsigned char>);
         }
-        else if (lineReader.getFileType() == XYZRGB)
+
+        points.resize(rsize * 3);
+        normals.assign(m_has_normal ? rsize * 3 : 0, 0.0f);
+        colors.assign(m_has_color ? rsize * 3 : 0, 0);
+
+        const char* records = static_cast<const char*>(chunk.get());
+        for (size_t i = 0; i < rsize; i++)
         {
-            boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
+            const char* record = records + i * recordSize;
+            coord<float> point;
+            memcpy(&point, record, sizeof(point));
+            points[i * 3] = point.x * m_scale;
+            points[i * 3 + 1] = point.y * m_scale;
+            points[i * 3 + 2] = point.z * m_scale;
+            m_bb.expand(BaseVecT(points[i * 3], points[i * 3 + 1], points[i * 3 + 2]));
+
+            if (m_has_normal && normalOffset)
             {
-                break;
+                memcpy(&normals[i * 3], record + normalOffset, sizeof(coord<float>));
             }
-            for (size_t i = 0; i < rsize; i++)
+            if (m_has_color && colorOffset)
             {
-                m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                        a.get()[i].point.y * m_scale,
-                                        a.get()[i].point.z * m_scale));
-                m_numPoints++;
-                lasti = i;
+                memcpy(&colors[i * 3], record + colorOffset, sizeof(color<unsigned char>));
             }
         }
-        else
+
+        writeStage(pointStage, points.data(), sizeof(float), points.size(), "points_raw.mmf");
+        if (normalStage)
+        {
+            writeStage(normalStage, normals.data(), sizeof(float), normals.size(), "normals_raw.mmf");
+        }
+        if (colorStage)
         {
-            exit(-1);
+            writeStage(colorStage, colors.data(), sizeof(unsigned char), colors.size(), "colors_raw.mmf");
         }
+        m_numPoints += rsize;
     }
 
-    // Make box side lenghts be divisible by voxel size
-    float longestSide = m_bb.getLongestSide();
+    closeStage(pointStage, "points_raw.mmf");
+    if (normalStage)
+    {
+        closeStage(normalStage, "normals_raw.mmf");
+    }
+    if (colorStage)
+    {
+        closeStage(colorStage, "colors_raw.mmf");
+    }
+
+    calcIndices();
+    std::cout << "BG: " << m_maxIndexSquare << "|" << m_maxIndexX << "|" << m_maxIndexY << "|"
+                << m_maxIndexZ << std::endl;
+
+    // Sort the staged points into the grid cells
+    std::cout << lvr2::timestamp << "Building grid..." << std::endl;
+    {
+        boost::iostreams::mapped_file_source pointSource(filePath("points_raw.mmf"));
+        boost::iostreams::mapped_file_source normalSource;
+        boost::iostreams::mapped_file_source colorSource;
+        if (m_has_normal)
+        {
+            normalSource.open(filePath("normals_raw.mmf"));
+        }
+        if (m_has_color)
+        {
+            colorSource.open(filePath("colors_raw.mmf"));
+        }
+        sortIntoCells((const float*)pointSource.data(),
+                      m_has_normal ? (const float*)normalSource.data() : nullptr,
+                      m_has_color ? (const unsigned char*)colorSource.data() : nullptr);
+    }
+
+    boost::filesystem::remove(filePath("points_raw.mmf"));
+    boost::filesystem::remove(filePath("normals_raw.mmf"));
+    boost::filesystem::remove(filePath("colors_raw.mmf"));
+}
 
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::calcIndices()
+{
+    // Make box side lenghts be divisible by voxel size
+    float voxelsize = m_voxelSize;
     BaseVecT center = m_bb.getCentroid();
-    size_t xsize2 = calcIndex(m_bb.getXSize() / m_voxelSize);
     float xsize = ceil(m_bb.getXSize() / voxelsize) * voxelsize;
     float ysize = ceil(m_bb.getYSize() / voxelsize) * voxelsize;
     float zsize = ceil(m_bb.getZSize() / voxelsize) * voxelsize;
-    m_bb.expand(BaseVecT(center.x + xsize / 2, center.y + ysize / 2, center.z + zsize / 2));
-    m_bb.expand(BaseVecT(center.x - xsize / 2, center.y - ysize / 2, center.z - zsize / 2));
-    longestSide = ceil(longestSide / voxelsize) * voxelsize;
 
     // calc max indices
+    size_t maxIndexX = (size_t)(xsize / voxelsize) + 1;
+    size_t maxIndexY = (size_t)(ysize / voxelsize) + 2;
+    size_t maxIndexZ = (size_t)(zsize / voxelsize) + 3;
+
+    // The cells are ordered by Morton codes of their indices. The empty
+    // neighbor cells at index -1 wrap to MORTON_MAX_INDEX, so all other
+    // indices have to stay below it. The grid is not changed otherwise.
+    if (maxIndexX > MORTON_MAX_INDEX || maxIndexY > MORTON_MAX_INDEX || maxIndexZ > MORTON_MAX_INDEX)
+    {
+        throw std::runtime_error("BigGrid: The grid has " + std::to_string(maxIndexX) + " x " +
+                                 std::to_string(maxIndexY) + " x " + std::to_string(maxIndexZ) +
+                                 " cells, at most " + std::to_string(MORTON_MAX_INDEX) +
+                                 " cells per axis are supported. Use a larger voxel size.");
+    }
+
+    m_bb.expand(BaseVecT(center.x + xsize / 2, center.y + ysize / 2, center.z + zsize / 2));
+    m_bb.expand(BaseVecT(center.x - xsize / 2, center.y - ysize / 2, center.z - zsize / 2));
 
     // m_maxIndex = (size_t)(longestSide/voxelsize);
-    m_maxIndexX = (size_t)(xsize / voxelsize);
-    m_maxIndexY = (size_t)(ysize / voxelsize);
-    m_maxIndexZ = (size_t)(zsize / voxelsize);
-    m_maxIndex = std::max(m_maxIndexX, std::max(m_maxIndexY, m_maxIndexZ)) + 5 * voxelsize;
-    m_maxIndexX += 1;
-    m_maxIndexY += 2;
-    m_maxIndexZ += 3;
+    m_maxIndexX = maxIndexX;
+    m_maxIndexY = maxIndexY;
+    m_maxIndexZ = maxIndexZ;
+    m_maxIndex = std::max(m_maxIndexX - 1, std::max(m_maxIndexY - 2, m_maxIndexZ - 3)) + 5 * voxelsize;
     m_maxIndexSquare = m_maxIndex * m_maxIndex;
-    std::cout << "BG: " << m_maxIndexSquare << "|" << m_maxIndexX << "|" << m_maxIndexY << "|"
-                << m_maxIndexZ << std::endl;
-
-    string comment = lvr2::timestamp.getElapsedTime() + "Building grid... ";
-    lvr2::ProgressBar progress(this->m_numPoints, comment);
+}
 
-    lineReader.rewind();
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::sortIntoCells(const float* points,
+                                      const float* normals,
+                                      const unsigned char* colors)
+{
+    const int numThreads = OpenMPConfig::getNumThreads();
+    const float voxelsize = m_voxelSize;
+    const BaseVecT min = m_bb.getMin();
 
-    size_t idx, idy, idz;
-    while (lineReader.ok())
+    auto cellIndex = [&](const float* p, size_t& idx, size_t& idy, size_t& idz)
     {
-        if (lineReader.getFileType() == XYZNRGB)
-        {
-            boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            int dx, dy, dz;
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                int e;
-                this->m_extrude ? e = 8 : e = 1;
-                for (int j = 0; j < e; j++)
-                {
-                    dx = HGCreateTable[j][0];
-                    dy = HGCreateTable[j][1];
-                    dz = HGCreateTable[j][2];
-                    size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                    if (j == 0)
-                        m_gridNumPoints[h].size++;
-                    else
-                    {
-                        auto it = m_gridNumPoints.find(h);
-                        if (it == m_gridNumPoints.end())
-                        {
-                            m_gridNumPoints[h].size = 0;
-                        }
-                    }
-                }
-            }
-        }
-        else if (lineReader.getFileType() == XYZN)
-        {
-            boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            int dx, dy, dz;
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-
-                int e;
-                this->m_extrude ? e = 8 : e = 1;
-                for (int j = 0; j < e; j++)
-                {
-                    dx = HGCreateTable[j][0];
-                    dy = HGCreateTable[j][1];
-                    dz = HGCreateTable[j][2];
-                    size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                    if (j == 0)
-                        m_gridNumPoints[h].size++;
-                    else
-                    {
-                        auto it = m_gridNumPoints.find(h);
-                        if (it == m_gridNumPoints.end())
-                        {
-                            m_gridNumPoints[h].size = 0;
-                        }
-                    }
-                }
-            }
-        }
-        else if (lineReader.getFileType() == XYZ)
+        idx = calcIndex((p[0] - min[0]) / voxelsize);
+        idy = calcIndex((p[1] - min[1]) / voxelsize);
+        idz = calcIndex((p[2] - min[2]) / voxelsize);
+        return hashValue(idx, idy, idz);
+    };
+
+    // Every thread counts the points of a contiguous range per cell
+    std::vector<std::unordered_map<size_t, CellInfo>> localCells(numThreads);
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < numThreads; t++)
+    {
+        std::unordered_map<size_t, CellInfo>& cells = localCells[t];
+        size_t end = m_numPoints * (t + 1) / numThreads;
+        for (size_t i = m_numPoints * t / numThreads; i < end; i++)
         {
-            boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            int dx, dy, dz;
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                int e;
-                this->m_extrude ? e = 8 : e = 1;
-                for (int j = 0; j < e; j++)
-                {
-                    dx = HGCreateTable[j][0];
-                    dy = HGCreateTable[j][1];
-                    dz = HGCreateTable[j][2];
-                    size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                    if (j == 0)
-                        m_gridNumPoints[h].size++;
-                    else
-                    {
-                        auto it = m_gridNumPoints.find(h);
-                        if (it == m_gridNumPoints.end())
-                        {
-                            m_gridNumPoints[h].size = 0;
-                        }
-                    }
-                }
-            }
+            size_t idx, idy, idz;
+            CellInfo& cell = cells[cellIndex(points + i * 3, idx, idy, idz)];
+            cell.size++;
+            cell.ix = idx;
+            cell.iy = idy;
+            cell.iz = idz;
         }
-        else if (lineReader.getFileType() == XYZRGB)
+    }
+
+    // Merge the partial histograms
+    for (int t = 0; t < numThreads; t++)
+    {
+        for (auto& local : localCells[t])
         {
-            boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            int dx, dy, dz;
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                int e;
-                this->m_extrude ? e = 8 : e = 1;
-                for (int j = 0; j < e; j++)
-                {
-                    dx = HGCreateTable[j][0];
-                    dy = HGCreateTable[j][1];
-                    dz = HGCreateTable[j][2];
-                    size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                    if (j == 0)
-                        m_gridNumPoints[h].size++;
-                    else
-                    {
-                        auto it = m_gridNumPoints.find(h);
-                        if (it == m_gridNumPoints.end())
-                        {
-                            m_gridNumPoints[h].size = 0;
-                        }
-                    }
-                }
-            }
+            CellInfo& cell = m_gridNumPoints[local.first];
+            cell.size += local.second.size;
+            cell.ix = local.second.ix;
+            cell.iy = local.second.iy;
+            cell.iz = local.second.iz;
         }
-        else
+    }
+
+    // Add the empty neighbor cells of all occupied cells
+    if (m_extrude)
+    {
+        std::vector<CellInfo> occupied;
+        occupied.reserve(m_gridNumPoints.size());
+        for (auto& cell : m_gridNumPoints)
         {
-            exit(-1);
+            occupied.push_back(cell.second);
         }
-        progress += rsize;
+        addNeighborCells(occupied);
     }
 
-    size_t num_cells = 0;
-    size_t offset = 0;
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
+    layoutCells();
+
+    // Reserve a slice of each cell for every thread. Threads are processed
+    // in range order, so the points keep their input order within a cell.
+    for (int t = 0; t < numThreads; t++)
     {
-        it->second.offset = offset;
-        offset += it->second.size;
-        it->second.dist_offset = num_cells++;
+        for (auto& local : localCells[t])
+        {
+            CellInfo& cell = m_gridNumPoints[local.first];
+            local.second.offset = cell.offset + cell.inserted;
+            cell.inserted += local.second.size;
+        }
     }
 
-    lineReader.rewind();
-
     boost::iostreams::mapped_file_params mmfparam;
-    mmfparam.path = "points.mmf";
+    mmfparam.path = filePath("points.mmf");
     mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
 
     boost::iostreams::mapped_file_params mmfparam_normal;
-    mmfparam_normal.path = "normals.mmf";
+    mmfparam_normal.path = filePath("normals.mmf");
     mmfparam_normal.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
 
     boost::iostreams::mapped_file_params mmfparam_color;
-    mmfparam_color.path = "colors.mmf";
+    mmfparam_color.path = filePath("colors.mmf");
     mmfparam_color.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
 
     m_PointFile.open(mmfparam);
-    float* mmfdata_normal;
-    unsigned char* mmfdata_color;
-    if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZN)
+    float* mmfdata = (float*)m_PointFile.data();
+    float* mmfdata_normal = nullptr;
+    unsigned char* mmfdata_color = nullptr;
+    if (normals)
     {
         m_NomralFile.open(mmfparam_normal);
         mmfdata_normal = (float*)m_NomralFile.data();
-        m_has_normal = true;
     }
-    if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZRGB)
+    if (colors)
     {
         m_ColorFile.open(mmfparam_color);
         mmfdata_color = (unsigned char*)m_ColorFile.data();
-        m_has_color = true;
     }
-    float* mmfdata = (float*)m_PointFile.data();
 
-    while (lineReader.ok())
+    // Scatter the points into their cells
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < numThreads; t++)
     {
-        if (lineReader.getFileType() == XYZNRGB)
-        {
-            boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                size_t h = hashValue(idx, idy, idz);
-                size_t ins = (m_gridNumPoints[h].inserted);
-                m_gridNumPoints[h].ix = idx;
-                m_gridNumPoints[h].iy = idy;
-                m_gridNumPoints[h].iz = idz;
-                m_gridNumPoints[h].inserted++;
-                size_t index = m_gridNumPoints[h].offset + ins;
-                mmfdata[index * 3] = ix;
-                mmfdata[index * 3 + 1] = iy;
-                mmfdata[index * 3 + 2] = iz;
-                mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
-
-                mmfdata_color[index * 3] = a.get()[i].color.r;
-                mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
-            }
-        }
-        else if (lineReader.getFileType() == XYZN)
-        {
-            boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                size_t h = hashValue(idx, idy, idz);
-                size_t ins = (m_gridNumPoints[h].inserted);
-                m_gridNumPoints[h].ix = idx;
-                m_gridNumPoints[h].iy = idy;
-                m_gridNumPoints[h].iz = idz;
-                m_gridNumPoints[h].inserted++;
-                size_t index = m_gridNumPoints[h].offset + ins;
-                mmfdata[index * 3] = ix;
-                mmfdata[index * 3 + 1] = iy;
-                mmfdata[index * 3 + 2] = iz;
-                mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
-            }
-        }
-        else if (lineReader.getFileType() == XYZ)
-        {
-            boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
-            {
-                break;
-            }
-            for (int i = 0; i < rsize; i++)
-            {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                size_t h = hashValue(idx, idy, idz);
-                size_t ins = (m_gridNumPoints[h].inserted);
-                m_gridNumPoints[h].ix = idx;
-                m_gridNumPoints[h].iy = idy;
-                m_gridNumPoints[h].iz = idz;
-                m_gridNumPoints[h].inserted++;
-                size_t index = m_gridNumPoints[h].offset + ins;
-                mmfdata[index * 3] = ix;
-                mmfdata[index * 3 + 1] = iy;
-                mmfdata[index * 3 + 2] = iz;
-            }
-        }
-        else if (lineReader.getFileType() == XYZRGB)
+        std::unordered_map<size_t, CellInfo>& cells = localCells[t];
+        size_t end = m_numPoints * (t + 1) / numThreads;
+        for (size_t i = m_numPoints * t / numThreads; i < end; i++)
         {
-            boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                lineReader.getNextPoints(rsize, m_pointBufferSize));
-            if (rsize <= 0 && !lineReader.ok())
+            size_t idx, idy, idz;
+            size_t index = cells[cellIndex(points + i * 3, idx, idy, idz)].offset++;
+            std::copy(points + i * 3, points + i * 3 + 3, mmfdata + index * 3);
+            if (normals)
             {
-                break;
+                std::copy(normals + i * 3, normals + i * 3 + 3, mmfdata_normal + index * 3);
             }
-            for (int i = 0; i < rsize; i++)
+            if (colors)
             {
-                ix = a.get()[i].point.x * m_scale;
-                iy = a.get()[i].point.y * m_scale;
-                iz = a.get()[i].point.z * m_scale;
-                size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                size_t h = hashValue(idx, idy, idz);
-                size_t ins = (m_gridNumPoints[h].inserted);
-                m_gridNumPoints[h].ix = idx;
-                m_gridNumPoints[h].iy = idy;
-                m_gridNumPoints[h].iz = idz;
-                m_gridNumPoints[h].inserted++;
-                size_t index = m_gridNumPoints[h].offset + ins;
-                mmfdata[index * 3] = ix;
-                mmfdata[index * 3 + 1] = iy;
-                mmfdata[index * 3 + 2] = iz;
-                mmfdata_color[index * 3] = a.get()[i].color.r;
-                mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
+                std::copy(colors + i * 3, colors + i * 3 + 3, mmfdata_color + index * 3);
             }
         }
     }
 
-    //    for(auto it = m_gridNumPoints.begin(); it!= m_gridNumPoints.end() ; it++)
-    //    {
-    //        std::cout << "h : " << it->first << std::endl;
-    //    }
     m_PointFile.close();
     m_NomralFile.close();
-    mmfparam.path = "distances.mmf";
+    m_ColorFile.close();
+    mmfparam.path = filePath("distances.mmf");
     mmfparam.new_file_size = sizeof(float) * size() * 8;
 
     m_PointFile.open(mmfparam);
     m_PointFile.close();
 }
 
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::addNeighborCells(const std::vector<CellInfo>& cells)
+{
+    for (const CellInfo& cell : cells)
+    {
+        for (int j = 1; j < 8; j++)
+        {
+            size_t ix = cell.ix + HGCreateTable[j][0];
+            size_t iy = cell.iy + HGCreateTable[j][1];
+            size_t iz = cell.iz + HGCreateTable[j][2];
+            auto inserted = m_gridNumPoints.emplace(hashValue(ix, iy, iz), CellInfo());
+            if (inserted.second)
+            {
+                inserted.first->second.ix = ix;
+                inserted.first->second.iy = iy;
+                inserted.first->second.iz = iz;
+            }
+        }
+    }
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::layoutCells()
+{
+    // Lay out the cells in Morton order, so that the cells of a box query
+    // map to few contiguous ranges of the memory mapped files
+    std::vector<std::pair<uint64_t, size_t>> order;
+    order.reserve(m_gridNumPoints.size());
+    for (auto& cell : m_gridNumPoints)
+    {
+        order.emplace_back(mortonCode(cell.second.ix, cell.second.iy, cell.second.iz), cell.first);
+    }
+    std::sort(order.begin(), order.end());
+
+    size_t num_cells = 0;
+    size_t offset = 0;
+    for (auto& entry : order)
+    {
+        CellInfo& cell = m_gridNumPoints[entry.second];
+        cell.offset = offset;
+        offset += cell.size;
+        cell.dist_offset = num_cells++;
+    }
+    buildCellIndex();
+}
+
 
 template <typename BaseVecT>
-BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, float scale)
+BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, float scale, std::string directory)
         : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
-          m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false)
+          m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false),
+          m_pointBufferSize(1 << 20), m_directory(directory)
 {
+    if (!boost::filesystem::exists(m_directory))
+    {
+        boost::filesystem::create_directories(m_directory);
+    }
     /// 
 #ifdef LVR2_USE_OPEN_MP
     omp_init_lock(&m_lock);
@@ -550,213 +447,98 @@ BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, floa
     }
     else
     {
-        float ix, iy, iz;
-
         string comment = lvr2::timestamp.getElapsedTime() + "Building grid... ";
-        lvr2::ProgressBar progress(project->changed.size() * 3, comment);
+        lvr2::ProgressBar progress(project->changed.size() * 2, comment);
+        size_t ticks = 0;
+        auto advanceTo = [&](size_t n)
+        {
+            for (; ticks < n; ticks++)
+            {
+                if(!timestamp.isQuiet())
+                    ++progress;
+            }
+        };
+
         // bounding box of all scans in .h5
-        std::vector<BoundingBox<BaseVecT>> scan_boxes;
+        std::vector<BoundingBox<BaseVecT>> scan_boxes(project->changed.size());
 
         //iterate through ALL points to calculate transformed boundingboxes of scans
-        for (int i = 0; i < project->changed.size(); i++)
         {
-            ScanPositionPtr pos = project->project->positions.at(i); // moegl. Weise project->project ?
-            assert(pos->scans.size() > 0);
-            size_t numPoints = pos->scans[0]->points->numPoints();
-            BoundingBox<BaseVecT> box;
-
-            boost::shared_array<float> points = pos->scans[0]->points->getPointArray();
-            Transformd finalPose_n = pos->scans[0]->registration;
-
-            Transformd finalPose = finalPose_n;
-
-            for (int k = 0; k < numPoints; k++)
+            std::vector<bool> positions(project->changed.size(), true);
+            ScanProjectPointStream stream(project->project, m_pointBufferSize, positions, true);
+            while (ScanProjectPointStream::BlockPtr block = stream.next())
             {
-                Eigen::Vector4d point(
-                    points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                Eigen::Vector4d transPoint = finalPose * point;
+                advanceTo(block->position);
+                const float* points = block->points.get();
+                BoundingBox<BaseVecT>& box = scan_boxes[block->position];
 
-                BaseVecT temp(transPoint[0], transPoint[1], transPoint[2]);
-                m_bb.expand(temp);
-                box.expand(temp);
+                #pragma omp parallel
+                {
+                    BoundingBox<BaseVecT> threadBox;
+                    #pragma omp for nowait
+                    for (long k = 0; k < (long)block->numPoints; k++)
+                    {
+                        threadBox.expand(BaseVecT(points[k * 3], points[k * 3 + 1], points[k * 3 + 2]));
+                    }
+                    #pragma omp critical
+                    {
+                        box.expand(threadBox);
+                    }
+                }
             }
+        }
+        advanceTo(project->changed.size());
+
+        for (int i = 0; i < project->changed.size(); i++)
+        {
+            m_bb.expand(scan_boxes[i]);
             // filter the new scans to calculate new reconstruction area
             if(project->changed.at(i))
             {
-                m_partialbb.expand(box);
+                m_partialbb.expand(scan_boxes[i]);
             }
-            scan_boxes.push_back(box);
-
-            if(!timestamp.isQuiet())
-                ++progress;
         }
 
+        calcIndices();
 
-        // Make box side lenghts divisible by voxel size
-        float longestSide = m_bb.getLongestSide();
-
-        BaseVecT center = m_bb.getCentroid();
-        size_t xsize2 = calcIndex(m_bb.getXSize() / m_voxelSize);
-        float xsize = ceil(m_bb.getXSize() / voxelsize) * voxelsize;
-        float ysize = ceil(m_bb.getYSize() / voxelsize) * voxelsize;
-        float zsize = ceil(m_bb.getZSize() / voxelsize) * voxelsize;
-        m_bb.expand(BaseVecT(center.x + xsize / 2, center.y + ysize / 2, center.z + zsize / 2));
-        m_bb.expand(BaseVecT(center.x - xsize / 2, center.y - ysize / 2, center.z - zsize / 2));
-        longestSide = ceil(longestSide / voxelsize) * voxelsize;
-
-        // calculate max indices
-
-        // m_maxIndex = (size_t)(longestSide/voxelsize);
-        m_maxIndexX = (size_t)(xsize / voxelsize);
-        m_maxIndexY = (size_t)(ysize / voxelsize);
-        m_maxIndexZ = (size_t)(zsize / voxelsize);
-        m_maxIndex = std::max(m_maxIndexX, std::max(m_maxIndexY, m_maxIndexZ)) + 5 * voxelsize;
-        m_maxIndexX += 1;
-        m_maxIndexY += 2;
-        m_maxIndexZ += 3;
-        m_maxIndexSquare = m_maxIndex * m_maxIndex;
-
-        size_t idx, idy, idz;
-
+        // Stream the points of all considered scans once more and stage
+        // them in input order
+        std::vector<bool> included(project->changed.size(), true);
+        m_addedPositionBoxes.assign(project->changed.size(), BoundingBox<BaseVecT>());
         for (int i = 0; i < project->changed.size(); i++)
         {
             if ((!project->changed.at(i)) && m_partialbb.isValid() && !m_partialbb.overlap(scan_boxes.at(i)))
             {
                 cout << "Scan No. " << i << " ignored!" << endl;
+                included[i] = false;
             }
             else
             {
-
-                ScanPositionPtr pos = project->project->positions.at(i);
-                size_t numPoints = pos->scans[0]->points->numPoints();
-                boost::shared_array<float> points = pos->scans[0]->points->getPointArray();
-                m_numPoints += numPoints;
-                Transformd finalPose_n = pos->scans[0]->registration;
-                Transformd finalPose = finalPose_n;
-                int dx, dy, dz;
-                for (int k = 0; k < numPoints; k++)
-                {
-                    Eigen::Vector4d point(
-                            points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                    Eigen::Vector4d transPoint = finalPose * point;
-                    BaseVecT temp(transPoint[0], transPoint[1], transPoint[2]);
-                    // m_bb.expand(temp);
-                    ix = transPoint[0] * m_scale;
-                    iy = transPoint[1] * m_scale;
-                    iz = transPoint[2] * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-
-                            }
-                        }
-                    }
-                }
+                m_addedPositionBoxes[i] = scan_boxes[i];
             }
-            if(!timestamp.isQuiet())
-                ++progress;
         }
 
-
-        size_t num_cells = 0;
-        size_t offset = 0;
-        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
         {
-            it->second.offset = offset;
-            offset += it->second.size;
-            it->second.dist_offset = num_cells++;
+            ScanProjectPointStream stream(project->project, m_pointBufferSize, included, true);
+            m_numPoints = stagePoints(stream, "points_raw.mmf", [&](const ScanProjectPointStream::Block& block)
+            {
+                advanceTo(project->changed.size() + block.position);
+            });
         }
+        advanceTo(project->changed.size() * 2);
 
-        boost::iostreams::mapped_file_params mmfparam;
-
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_normal;
-        mmfparam_normal.path = "normals.mmf";
-        mmfparam_normal.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_color;
-        mmfparam_color.path = "colors.mmf";
-        mmfparam_color.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
-
-        m_PointFile.open(mmfparam);
-
-        float* mmfdata = (float*)m_PointFile.data();
-
-
+        if(!timestamp.isQuiet())
+            cout << endl;
 
-        for (int i = 0; i < project->changed.size(); i++)
         {
-            if ((project->changed.at(i) != true) && m_partialbb.isValid() && !m_partialbb.overlap(scan_boxes.at(i)))
+            boost::iostreams::mapped_file_source pointSource;
+            if (m_numPoints)
             {
-                cout << "Scan No. " << i << " ignored!" << endl;
+                pointSource.open(filePath("points_raw.mmf"));
             }
-            else{
-                ScanPositionPtr pos = project->project->positions.at(i);
-                size_t numPoints = pos->scans[0]->points->numPoints();
-
-
-                boost::shared_array<float> points = pos->scans[0]->points->getPointArray();
-                Transformd finalPose_n = pos->scans[0]->registration;
-                Transformd finalPose = finalPose_n;
-                for (int k = 0; k < numPoints; k++) {
-                    Eigen::Vector4d point(
-                            points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                    Eigen::Vector4d transPoint = finalPose * point;
-
-                    ix = transPoint[0] * m_scale;
-                    iy = transPoint[1] * m_scale;
-                    iz = transPoint[2] * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                }
-            }
-            if(!timestamp.isQuiet())
-                ++progress;
+            sortIntoCells((const float*)pointSource.data(), nullptr, nullptr);
         }
-
-        if(!timestamp.isQuiet())
-            cout << endl;
-        
-        m_PointFile.close();
-        m_NomralFile.close();
-        mmfparam.path = "distances.mmf";
-        mmfparam.new_file_size = sizeof(float) * size() * 8;
-
-        m_PointFile.open(mmfparam);
-        m_PointFile.close();
-
+        boost::filesystem::remove(filePath("points_raw.mmf"));
     }
 }
 
@@ -770,8 +552,51 @@ BigGrid<BaseVecT>::~BigGrid()
 
 template <typename BaseVecT>
 BigGrid<BaseVecT>::BigGrid(std::string path)
+    : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
+      m_numPoints(0), m_pointBufferSize(1 << 20), m_extrude(true), m_has_normal(false),
+      m_has_color(false), m_scale(1)
 {
-    ifstream ifs(path, ios::binary);
+#ifdef LVR2_USE_OPEN_MP
+    omp_init_lock(&m_lock);
+#endif
+    boost::filesystem::path headerPath(path);
+    if (boost::filesystem::is_directory(headerPath))
+    {
+        headerPath /= "serinfo.ls";
+    }
+    m_directory = headerPath.parent_path().empty() ? "." : headerPath.parent_path().string();
+
+    ifstream ifs(headerPath.string(), ios::binary);
+    if (!ifs.good())
+    {
+        throw std::runtime_error("BigGrid: Unable to open " + headerPath.string());
+    }
+    boost::system::error_code sizeError;
+    uintmax_t headerSize = boost::filesystem::file_size(headerPath, sizeError);
+    auto remaining = [&]() -> uintmax_t
+    {
+        std::streamoff pos = ifs.tellg();
+        return (sizeError || pos < 0 || uintmax_t(pos) > headerSize) ? 0 : headerSize - pos;
+    };
+
+    char magic[HEADER_MAGIC_SIZE];
+    uint32_t version = 0;
+    ifs.read(magic, HEADER_MAGIC_SIZE);
+    if (ifs.good() && std::equal(magic, magic + HEADER_MAGIC_SIZE, HEADER_MAGIC))
+    {
+        ifs.read((char*)&version, sizeof(version));
+    }
+    else
+    {
+        ifs.clear();
+        ifs.seekg(0);
+    }
+    if (version > HEADER_VERSION)
+    {
+        throw std::runtime_error("BigGrid: " + headerPath.string() + " has header version " +
+                                 std::to_string(version) + ", only versions up to " +
+                                 std::to_string(HEADER_VERSION) + " are supported");
+    }
 
     ifs.read((char*)&m_maxIndexSquare, sizeof(m_maxIndexSquare));
     ifs.read((char*)&m_maxIndex, sizeof(m_maxIndex));
@@ -792,54 +617,123 @@ BigGrid<BaseVecT>::BigGrid(std::string path)
     ifs.read((char*)&n1, sizeof(float));
     ifs.read((char*)&n2, sizeof(float));
     ifs.read((char*)&n3, sizeof(float));
+    if (!ifs)
+    {
+        throw std::runtime_error("BigGrid: Unable to read the header of " + headerPath.string());
+    }
+    if (m_maxIndexX > MORTON_MAX_INDEX || m_maxIndexY > MORTON_MAX_INDEX || m_maxIndexZ > MORTON_MAX_INDEX)
+    {
+        throw std::runtime_error("BigGrid: The cell counts in " + headerPath.string() + " are out of range");
+    }
     m_bb.expand(BaseVecT(mx, my, mz));
     m_bb.expand(BaseVecT(n1, n2, n3));
 
-    size_t gridSize;
-    ifs.read((char*)&gridSize, sizeof(gridSize));
-
-    std::cout << "LOADING OLD GRID: " << std::endl;
-    std::cout << "m_maxIndexSquare: \t\t\t" << m_maxIndexSquare << std::endl;
-    std::cout << "m_maxIndex: \t\t\t" << m_maxIndex << std::endl;
-    std::cout << "m_maxIndexX: \t\t\t" << m_maxIndexX << std::endl;
-    std::cout << "m_maxIndexY: \t\t\t" << m_maxIndexY << std::endl;
-    std::cout << "m_maxIndexZ: \t\t\t" << m_maxIndexZ << std::endl;
-    std::cout << "m_numPoints: \t\t\t" << m_numPoints << std::endl;
-    std::cout << "m_pointBufferSize: \t\t\t" << m_pointBufferSize << std::endl;
-    std::cout << "m_voxelSize: \t\t\t" << m_voxelSize << std::endl;
-    std::cout << "m_extrude: \t\t\t" << m_extrude << std::endl;
-    std::cout << "m_has_normal: \t\t\t" << m_has_normal << std::endl;
-    std::cout << "m_scale: \t\t\t" << m_scale << std::endl;
-    std::cout << "m_bb: \t\t\t" << m_bb << std::endl;
-    std::cout << "gridSize: \t\t\t" << gridSize << std::endl;
-
-    for (size_t i = 0; i < gridSize; i++)
+    if (version >= 1)
     {
-        CellInfo c;
-        size_t hash;
-        ifs.read((char*)&hash, sizeof(size_t));
-        ifs.read((char*)&c.size, sizeof(size_t));
-        ifs.read((char*)&c.offset, sizeof(size_t));
-        ifs.read((char*)&c.inserted, sizeof(size_t));
-        ifs.read((char*)&c.dist_offset, sizeof(size_t));
-        ifs.read((char*)&c.ix, sizeof(size_t));
-        ifs.read((char*)&c.iy, sizeof(size_t));
-        ifs.read((char*)&c.iz, sizeof(size_t));
-        m_gridNumPoints[hash] = c;
-    }
-}
+        bool hasPartial;
+        ifs.read((char*)&hasPartial, sizeof(hasPartial));
+        ifs.read((char*)&mx, sizeof(float));
+        ifs.read((char*)&my, sizeof(float));
+        ifs.read((char*)&mz, sizeof(float));
+        ifs.read((char*)&n1, sizeof(float));
+        ifs.read((char*)&n2, sizeof(float));
+        ifs.read((char*)&n3, sizeof(float));
+        if (hasPartial)
+        {
+            m_partialbb.expand(BaseVecT(mx, my, mz));
+            m_partialbb.expand(BaseVecT(n1, n2, n3));
+        }
+
+        // Channel list: name, components per point and bytes per component.
+        // The data of a channel is stored in <name>.mmf next to the header.
+        m_has_normal = false;
+        m_has_color = false;
+        uint32_t numChannels = 0;
+        ifs.read((char*)&numChannels, sizeof(numChannels));
+        for (uint32_t i = 0; i < numChannels && ifs.good(); i++)
+        {
+            uint32_t nameLength = 0, width, elementSize;
+            ifs.read((char*)&nameLength, sizeof(nameLength));
+            if (!ifs || nameLength > remaining())
+            {
+                break;
+            }
+            std::string name(nameLength, ' ');
+            ifs.read(&name[0], nameLength);
+            ifs.read((char*)&width, sizeof(width));
+            ifs.read((char*)&elementSize, sizeof(elementSize));
+            if (!ifs)
+            {
+                break;
+            }
+
+            boost::system::error_code ec;
+            uintmax_t fileSize = boost::filesystem::file_size(filePath(name + ".mmf"), ec);
+            if (ec || fileSize < m_numPoints * width * elementSize)
+            {
+                if (name == "points")
+                {
+                    throw std::runtime_error("BigGrid: Point file " + filePath(name + ".mmf") +
+                                             " is missing or too small");
+                }
+                std::cerr << lvr2::timestamp << "BigGrid: Channel file " << filePath(name + ".mmf")
+                          << " is missing or too small." << std::endl;
+                continue;
+            }
+            if (name == "normals")
+            {
+                m_has_normal = true;
+            }
+            else if (name == "colors")
+            {
+                m_has_color = true;
+            }
+        }
+    }
+
+    // Each cell record holds the hash and seven fields of the cell info
+    const size_t cellRecordSize = 8 * sizeof(size_t);
+    size_t gridSize = 0;
+    ifs.read((char*)&gridSize, sizeof(gridSize));
+    if (!ifs || gridSize > remaining() / cellRecordSize)
+    {
+        throw std::runtime_error("BigGrid: Unable to read the cell table of " + headerPath.string());
+    }
+
+    std::cout << lvr2::timestamp << "Loading grid " << headerPath.string() << ": " << gridSize
+              << " cells, " << m_numPoints << " points, bounding box " << m_bb << std::endl;
+
+    m_gridNumPoints.reserve(gridSize);
+    for (size_t i = 0; i < gridSize; i++)
+    {
+        CellInfo c;
+        size_t hash;
+        ifs.read((char*)&hash, sizeof(size_t));
+        ifs.read((char*)&c.size, sizeof(size_t));
+        ifs.read((char*)&c.offset, sizeof(size_t));
+        ifs.read((char*)&c.inserted, sizeof(size_t));
+        ifs.read((char*)&c.dist_offset, sizeof(size_t));
+        ifs.read((char*)&c.ix, sizeof(size_t));
+        ifs.read((char*)&c.iy, sizeof(size_t));
+        ifs.read((char*)&c.iz, sizeof(size_t));
+        if (!ifs)
+        {
+            throw std::runtime_error("BigGrid: Unable to read cell " + std::to_string(i) + " of " +
+                                     std::to_string(gridSize) + " from " + headerPath.string());
+        }
+        m_gridNumPoints[hash] = c;
+    }
+    buildCellIndex();
+}
 
 template <typename BaseVecT>
-void BigGrid<BaseVecT>::serialize(std::string path)
+void BigGrid<BaseVecT>::serialize(std::string name)
 {
-    ofstream ofs(path, ios::binary);
-    //    size_t data_size =      sizeof(m_maxIndexSquare) + sizeof(m_maxIndex) +
-    //    sizeof(m_maxIndexX) + sizeof(m_maxIndexY) +
-    //                            sizeof(m_maxIndexZ) + sizeof(m_numPoints) +
-    //                            sizeof(m_pointBufferSize) + sizeof(m_voxelSize) +
-    //                            sizeof(m_extrude) + sizeof(m_has_normal) + sizeof(m_has_color) +
-    //                            sizeof(m_scale) + (m_gridNumPoints.size() * (sizeof(size_t)*7)) +
-    //                            (m_gridNumPoints.size() *(sizeof(size_t)));
+    ofstream ofs(filePath(name), ios::binary);
+
+    uint32_t version = HEADER_VERSION;
+    ofs.write(HEADER_MAGIC, HEADER_MAGIC_SIZE);
+    ofs.write((char*)&version, sizeof(version));
 
     ofs.write((char*)&m_maxIndexSquare, sizeof(m_maxIndexSquare));
     ofs.write((char*)&m_maxIndex, sizeof(m_maxIndex));
@@ -860,6 +754,37 @@ void BigGrid<BaseVecT>::serialize(std::string path)
     ofs.write((char*)&m_bb.getMax()[0], sizeof(float));
     ofs.write((char*)&m_bb.getMax()[1], sizeof(float));
     ofs.write((char*)&m_bb.getMax()[2], sizeof(float));
+
+    bool hasPartial = m_partialbb.isValid();
+    ofs.write((char*)&hasPartial, sizeof(hasPartial));
+    ofs.write((char*)&m_partialbb.getMin()[0], sizeof(float));
+    ofs.write((char*)&m_partialbb.getMin()[1], sizeof(float));
+    ofs.write((char*)&m_partialbb.getMin()[2], sizeof(float));
+    ofs.write((char*)&m_partialbb.getMax()[0], sizeof(float));
+    ofs.write((char*)&m_partialbb.getMax()[1], sizeof(float));
+    ofs.write((char*)&m_partialbb.getMax()[2], sizeof(float));
+
+    std::vector<std::pair<std::string, uint32_t>> channels = {{"points", sizeof(float)}};
+    if (m_has_normal)
+    {
+        channels.push_back({"normals", sizeof(float)});
+    }
+    if (m_has_color)
+    {
+        channels.push_back({"colors", sizeof(unsigned char)});
+    }
+    uint32_t numChannels = channels.size();
+    ofs.write((char*)&numChannels, sizeof(numChannels));
+    for (auto& channel : channels)
+    {
+        uint32_t nameLength = channel.first.size();
+        uint32_t width = 3;
+        ofs.write((char*)&nameLength, sizeof(nameLength));
+        ofs.write(channel.first.data(), nameLength);
+        ofs.write((char*)&width, sizeof(width));
+        ofs.write((char*)&channel.second, sizeof(channel.second));
+    }
+
     size_t gridSize = m_gridNumPoints.size();
     ofs.write((char*)&gridSize, sizeof(gridSize));
     for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
@@ -876,6 +801,414 @@ void BigGrid<BaseVecT>::serialize(std::string path)
     ofs.close();
 }
 
+template <typename BaseVecT>
+std::string BigGrid<BaseVecT>::filePath(const std::string& name) const
+{
+    return (boost::filesystem::path(m_directory) / name).string();
+}
+
+template <typename BaseVecT>
+typename BigGrid<BaseVecT>::StageFile BigGrid<BaseVecT>::openStage(const std::string& name)
+{
+    StageFile stage(fopen(filePath(name).c_str(), "wb"), fclose);
+    if (!stage)
+    {
+        throw std::runtime_error("BigGrid: Unable to create " + filePath(name));
+    }
+    return stage;
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::writeStage(
+    StageFile& stage, const void* data, size_t size, size_t count, const std::string& name)
+{
+    if (fwrite(data, size, count, stage.get()) != count)
+    {
+        throw std::runtime_error("BigGrid: Unable to write " + filePath(name));
+    }
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::closeStage(StageFile& stage, const std::string& name)
+{
+    if (fclose(stage.release()) != 0)
+    {
+        throw std::runtime_error("BigGrid: Unable to write " + filePath(name));
+    }
+}
+
+template <typename BaseVecT>
+template <typename ProgressFunc>
+size_t BigGrid<BaseVecT>::stagePoints(ScanProjectPointStream& stream,
+                                      const std::string& name,
+                                      ProgressFunc progress,
+                                      const std::string& normalName,
+                                      const std::string& colorName)
+{
+    StageFile stage = openStage(name);
+    StageFile normalStage = normalName.empty() ? StageFile(nullptr, fclose) : openStage(normalName);
+    StageFile colorStage = colorName.empty() ? StageFile(nullptr, fclose) : openStage(colorName);
+
+    size_t numPoints = 0;
+    while (ScanProjectPointStream::BlockPtr block = stream.next())
+    {
+        if ((normalStage && !block->normals) || (colorStage && !block->colors))
+        {
+            throw std::runtime_error("BigGrid: Scan " + std::to_string(block->scan) + " of position " +
+                                     std::to_string(block->position) +
+                                     " has no " + (block->normals ? "colors" : "normals") +
+                                     ", but the grid stores them.");
+        }
+
+        float* points = block->points.get();
+        #pragma omp parallel for
+        for (long k = 0; k < (long)block->numPoints * 3; k++)
+        {
+            points[k] *= m_scale;
+        }
+        progress(*block);
+
+        writeStage(stage, points, sizeof(float), block->numPoints * 3, name);
+        if (normalStage)
+        {
+            writeStage(normalStage, block->normals.get(), sizeof(float), block->numPoints * 3, normalName);
+        }
+        if (colorStage)
+        {
+            writeStage(colorStage, block->colors.get(), sizeof(unsigned char), block->numPoints * 3, colorName);
+        }
+        numPoints += block->numPoints;
+    }
+
+    closeStage(stage, name);
+    if (normalStage)
+    {
+        closeStage(normalStage, normalName);
+    }
+    if (colorStage)
+    {
+        closeStage(colorStage, colorName);
+    }
+    return numPoints;
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::append(ScanProjectEditMarkPtr project)
+{
+    // Normals and colors are only staged if the grid stores them
+    std::string normalName = m_has_normal ? "normals_append.mmf" : "";
+    std::string colorName = m_has_color ? "colors_append.mmf" : "";
+    auto removeStages = [&]()
+    {
+        boost::filesystem::remove(filePath("points_append.mmf"));
+        boost::filesystem::remove(filePath("normals_append.mmf"));
+        boost::filesystem::remove(filePath("colors_append.mmf"));
+    };
+
+    // Bounding box of every added position
+    auto addBox = [&](const ScanProjectPointStream::Block& block)
+    {
+        const float* points = block.points.get();
+        BoundingBox<BaseVecT>& box = m_addedPositionBoxes[block.position];
+        #pragma omp parallel
+        {
+            BoundingBox<BaseVecT> threadBox;
+            #pragma omp for nowait
+            for (long k = 0; k < (long)block.numPoints; k++)
+            {
+                threadBox.expand(BaseVecT(points[k * 3], points[k * 3 + 1], points[k * 3 + 2]));
+            }
+            #pragma omp critical
+            {
+                box.expand(threadBox);
+            }
+        }
+    };
+    m_addedPositionBoxes.assign(project->project->positions.size(), BoundingBox<BaseVecT>());
+
+    size_t numPoints;
+    try
+    {
+        ScanProjectPointStream stream(project->project, m_pointBufferSize, project->changed, true);
+        numPoints = stagePoints(stream, "points_append.mmf", addBox, normalName, colorName);
+    }
+    catch (...)
+    {
+        removeStages();
+        throw;
+    }
+
+    std::cout << lvr2::timestamp << "Adding " << numPoints << " points to grid..." << std::endl;
+    {
+        boost::iostreams::mapped_file_source pointSource;
+        boost::iostreams::mapped_file_source normalSource;
+        boost::iostreams::mapped_file_source colorSource;
+        if (numPoints)
+        {
+            pointSource.open(filePath("points_append.mmf"));
+            if (m_has_normal)
+            {
+                normalSource.open(filePath(normalName));
+            }
+            if (m_has_color)
+            {
+                colorSource.open(filePath(colorName));
+            }
+        }
+        m_partialbb = appendPoints((const float*)pointSource.data(),
+                                   (const float*)normalSource.data(),
+                                   (const unsigned char*)colorSource.data(),
+                                   numPoints);
+    }
+    removeStages();
+}
+
+template <typename BaseVecT>
+BoundingBox<BaseVecT> BigGrid<BaseVecT>::appendPoints(const float* points,
+                                                      const float* normals,
+                                                      const unsigned char* colors,
+                                                      size_t numPoints)
+{
+    BoundingBox<BaseVecT> box;
+    #pragma omp parallel
+    {
+        BoundingBox<BaseVecT> threadBox;
+        #pragma omp for nowait
+        for (long i = 0; i < (long)numPoints; i++)
+        {
+            threadBox.expand(BaseVecT(points[i * 3], points[i * 3 + 1], points[i * 3 + 2]));
+        }
+        #pragma omp critical
+        {
+            box.expand(threadBox);
+        }
+    }
+    if (numPoints == 0)
+    {
+        return box;
+    }
+    if ((m_has_normal && !normals) || (m_has_color && !colors))
+    {
+        throw std::runtime_error(std::string("BigGrid: The grid stores ") +
+                                 (m_has_normal && !normals ? "normals" : "colors") +
+                                 ", but the added points have none.");
+    }
+
+    size_t oldNumPoints = m_numPoints;
+
+    bool inside = true;
+    for (int a = 0; a < 3; a++)
+    {
+        inside &= box.getMin()[a] >= m_bb.getMin()[a] && box.getMax()[a] <= m_bb.getMax()[a];
+    }
+    if (!oldNumPoints || !inside)
+    {
+        // The grid origin moves, so all cell indices change. Rebuild the
+        // grid from the stored points instead of the original input. The
+        // stored and the new values are staged on disk like the input of
+        // the constructors.
+        auto removeStages = [&]()
+        {
+            boost::filesystem::remove(filePath("points_raw.mmf"));
+            boost::filesystem::remove(filePath("normals_raw.mmf"));
+            boost::filesystem::remove(filePath("colors_raw.mmf"));
+        };
+        auto stage = [&](const std::string& name, const std::string& rawName, auto* values)
+        {
+            using T = typename std::remove_const<typename std::remove_pointer<decltype(values)>::type>::type;
+            StageFile rawStage = openStage(rawName);
+            if (oldNumPoints)
+            {
+                boost::iostreams::mapped_file_source mmfs(filePath(name));
+                writeStage(rawStage, mmfs.data(), sizeof(T), oldNumPoints * 3, rawName);
+            }
+            writeStage(rawStage, values, sizeof(T), numPoints * 3, rawName);
+            closeStage(rawStage, rawName);
+        };
+
+        try
+        {
+            stage("points.mmf", "points_raw.mmf", points);
+            if (m_has_normal)
+            {
+                stage("normals.mmf", "normals_raw.mmf", normals);
+            }
+            if (m_has_color)
+            {
+                stage("colors.mmf", "colors_raw.mmf", colors);
+            }
+        }
+        catch (...)
+        {
+            removeStages();
+            throw;
+        }
+
+        BoundingBox<BaseVecT> oldBB = m_bb;
+        m_bb.expand(box);
+        try
+        {
+            calcIndices();
+        }
+        catch (...)
+        {
+            m_bb = oldBB;
+            removeStages();
+            throw;
+        }
+        m_numPoints += numPoints;
+        m_gridNumPoints.clear();
+        {
+            boost::iostreams::mapped_file_source pointSource(filePath("points_raw.mmf"));
+            boost::iostreams::mapped_file_source normalSource;
+            boost::iostreams::mapped_file_source colorSource;
+            if (m_has_normal)
+            {
+                normalSource.open(filePath("normals_raw.mmf"));
+            }
+            if (m_has_color)
+            {
+                colorSource.open(filePath("colors_raw.mmf"));
+            }
+            sortIntoCells((const float*)pointSource.data(),
+                          m_has_normal ? (const float*)normalSource.data() : nullptr,
+                          m_has_color ? (const unsigned char*)colorSource.data() : nullptr);
+        }
+        removeStages();
+        return box;
+    }
+
+    m_numPoints += numPoints;
+
+    // Remember where the stored points of the occupied cells are
+    struct Run
+    {
+        size_t hash;
+        size_t oldOffset;
+        size_t size;
+        size_t newOffset;
+    };
+    std::vector<Run> runs;
+    runs.reserve(m_cellIndex.size());
+    for (auto& cell : m_gridNumPoints)
+    {
+        if (cell.second.size)
+        {
+            runs.push_back({cell.first, cell.second.offset, cell.second.size, 0});
+        }
+    }
+
+    // Count the new points per cell
+    const BaseVecT min = m_bb.getMin();
+    std::vector<size_t> pointCells(numPoints);
+    std::unordered_map<size_t, size_t> added;
+    std::vector<CellInfo> newlyOccupied;
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        size_t idx = calcIndex((points[i * 3] - min[0]) / m_voxelSize);
+        size_t idy = calcIndex((points[i * 3 + 1] - min[1]) / m_voxelSize);
+        size_t idz = calcIndex((points[i * 3 + 2] - min[2]) / m_voxelSize);
+        size_t h = hashValue(idx, idy, idz);
+        pointCells[i] = h;
+        added[h]++;
+
+        CellInfo& cell = m_gridNumPoints[h];
+        if (cell.size == 0)
+        {
+            cell.ix = idx;
+            cell.iy = idy;
+            cell.iz = idz;
+            newlyOccupied.push_back(cell);
+        }
+        cell.size++;
+    }
+    if (m_extrude)
+    {
+        addNeighborCells(newlyOccupied);
+    }
+    layoutCells();
+
+    // Write position of the new points within their cell
+    for (auto& cell : added)
+    {
+        const CellInfo& info = m_gridNumPoints[cell.first];
+        cell.second = info.offset + info.size - cell.second;
+    }
+
+    // Unchanged cells keep their Morton order, so the stored points are
+    // moved in few large blocks
+    for (Run& run : runs)
+    {
+        run.newOffset = m_gridNumPoints[run.hash].offset;
+    }
+    std::sort(runs.begin(), runs.end(),
+              [](const Run& a, const Run& b) { return a.oldOffset < b.oldOffset; });
+    std::vector<Run> blocks;
+    for (const Run& run : runs)
+    {
+        if (!blocks.empty() && blocks.back().oldOffset + blocks.back().size == run.oldOffset &&
+            blocks.back().newOffset + blocks.back().size == run.newOffset)
+        {
+            blocks.back().size += run.size;
+        }
+        else
+        {
+            blocks.push_back(run);
+        }
+    }
+
+    auto update = [&](const std::string& name, auto* values)
+    {
+        using T = typename std::remove_const<typename std::remove_pointer<decltype(values)>::type>::type;
+        std::string tmpName = filePath(name + ".tmp");
+        {
+            boost::iostreams::mapped_file_params mmfparam;
+            mmfparam.path = tmpName;
+            mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
+            mmfparam.new_file_size = sizeof(T) * m_numPoints * 3;
+            boost::iostreams::mapped_file target(mmfparam);
+            boost::iostreams::mapped_file_source source(filePath(name));
+            const T* in = (const T*)source.data();
+            T* out = (T*)target.data();
+
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (long b = 0; b < (long)blocks.size(); b++)
+            {
+                std::copy(in + blocks[b].oldOffset * 3,
+                          in + (blocks[b].oldOffset + blocks[b].size) * 3,
+                          out + blocks[b].newOffset * 3);
+            }
+
+            std::unordered_map<size_t, size_t> cursor = added;
+            for (size_t i = 0; i < numPoints; i++)
+            {
+                size_t index = cursor[pointCells[i]]++;
+                std::copy(values + i * 3, values + i * 3 + 3, out + index * 3);
+            }
+        }
+        boost::filesystem::rename(tmpName, filePath(name));
+    };
+
+    update("points.mmf", points);
+    if (m_has_normal)
+    {
+        update("normals.mmf", normals);
+    }
+    if (m_has_color)
+    {
+        update("colors.mmf", colors);
+    }
+
+    boost::iostreams::mapped_file_params mmfparam;
+    mmfparam.path = filePath("distances.mmf");
+    mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
+    mmfparam.new_file_size = sizeof(float) * size() * 8;
+    m_PointFile.open(mmfparam);
+    m_PointFile.close();
+
+    return box;
+}
+
 template <typename BaseVecT>
 size_t BigGrid<BaseVecT>::size()
 {
@@ -911,27 +1244,72 @@ lvr2::floatArr BigGrid<BaseVecT>::points(int i, int j, int k, size_t& numPoints)
     auto it = m_gridNumPoints.find(h);
     if (it != m_gridNumPoints.end())
     {
-        size_t cellSize = m_gridNumPoints[h].size;
-
-        points = lvr2::floatArr(new float[3 * cellSize]);
-        boost::iostreams::mapped_file_params mmfparam;
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-
-        m_PointFile.open(mmfparam);
-        float* mmfdata = (float*)m_PointFile.data();
+        numPoints = it->second.size;
+        std::vector<std::pair<size_t, size_t>> ranges;
+        if (numPoints)
+        {
+            ranges.emplace_back(it->second.offset, it->second.offset + numPoints);
+        }
+        points = readRanges<float>(filePath("points.mmf"), ranges, numPoints);
+    }
+    return points;
+}
 
-        memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
+template <typename BaseVecT>
+uint64_t BigGrid<BaseVecT>::nextMortonCode(uint64_t code, uint64_t zmin, uint64_t zmax)
+{
+    uint64_t bigmin = 0;
+    for (int bit = 62; bit >= 0; bit--)
+    {
+        uint64_t mask = uint64_t(1) << bit;
+        // Lower bits of the same dimension
+        uint64_t lower = (0x1249249249249249ull << (bit % 3)) & (mask - 1);
+        bool c = code & mask;
+        bool lo = zmin & mask;
+        bool hi = zmax & mask;
+        if (!c && !lo && hi)
+        {
+            bigmin = (zmin | mask) & ~lower;
+            zmax = (zmax & ~mask) | lower;
+        }
+        else if (!c && lo && hi)
+        {
+            return zmin;
+        }
+        else if (c && !lo && !hi)
+        {
+            return bigmin;
+        }
+        else if (c && !lo && hi)
+        {
+            zmin = (zmin | mask) & ~lower;
+        }
+    }
+    return bigmin;
+}
 
-        numPoints = pointSize();
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::buildCellIndex()
+{
+    m_cellIndex.clear();
+    for (auto& cell : m_gridNumPoints)
+    {
+        if (cell.second.size)
+        {
+            m_cellIndex.push_back({mortonCode(cell.second.ix, cell.second.iy, cell.second.iz),
+                                   cell.second.offset,
+                                   cell.second.size});
+        }
     }
-    return points;
+    std::sort(m_cellIndex.begin(), m_cellIndex.end(),
+              [](const MortonCell& a, const MortonCell& b) { return a.code < b.code; });
 }
 
 template <typename BaseVecT>
-lvr2::floatArr BigGrid<BaseVecT>::points(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+std::vector<std::pair<size_t, size_t>> BigGrid<BaseVecT>::cellRanges(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz)
 {
+    // Clamp the box to the grid, so all queries agree on the selected cells
     minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
     miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
     minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
@@ -946,135 +1324,148 @@ lvr2::floatArr BigGrid<BaseVecT>::points(
     size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
     size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
 
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
-
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (idxmin > idxmax || idymin > idymax || idzmin > idzmax ||
+        idxmin > MORTON_MAX_INDEX || idymin > MORTON_MAX_INDEX || idzmin > MORTON_MAX_INDEX)
+    {
+        return ranges;
+    }
 
-    lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
+    uint64_t zmin = mortonCode(idxmin, idymin, idzmin);
+    uint64_t zmax = mortonCode(std::min(idxmax, MORTON_MAX_INDEX),
+                               std::min(idymax, MORTON_MAX_INDEX),
+                               std::min(idzmax, MORTON_MAX_INDEX));
 
-    boost::iostreams::mapped_file_source mmfs("points.mmf");
-    float* mmfdata = (float*)mmfs.data();
+    // A code lies within the box iff each of its dimensions does
+    auto inside = [zmin, zmax](uint64_t code)
+    {
+        for (int d = 0; d < 3; d++)
+        {
+            uint64_t mask = 0x1249249249249249ull << d;
+            if ((code & mask) < (zmin & mask) || (code & mask) > (zmax & mask))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto lowerBound = [this](typename std::vector<MortonCell>::iterator first, uint64_t code)
+    {
+        return std::lower_bound(first, m_cellIndex.end(), code,
+                                [](const MortonCell& c, uint64_t v) { return c.code < v; });
+    };
 
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    auto it = lowerBound(m_cellIndex.begin(), zmin);
+    while (it != m_cellIndex.end() && it->code <= zmax)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
+        if (inside(it->code))
         {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
+            if (!ranges.empty() && ranges.back().second == it->offset)
             {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
+                ranges.back().second += it->size;
             }
+            else
+            {
+                ranges.emplace_back(it->offset, it->offset + it->size);
+            }
+            ++it;
+        }
+        else
+        {
+            // Skip the part of the curve that leaves the box
+            uint64_t next = nextMortonCode(it->code, zmin, zmax);
+            if (next <= it->code)
+            {
+                break;
+            }
+            it = lowerBound(it, next);
         }
     }
-    return points;
+    return ranges;
+}
+
+template <typename BaseVecT>
+template <typename T>
+boost::shared_array<T> BigGrid<BaseVecT>::readRanges(
+    const std::string& path, const std::vector<std::pair<size_t, size_t>>& ranges, size_t numPoints)
+{
+    if (ranges.size() == 1)
+    {
+        // Private mapping, so writes to the returned array do not reach the file
+        auto file = std::make_shared<boost::iostreams::mapped_file>();
+        boost::iostreams::mapped_file_params mmfparam(path);
+        mmfparam.flags = boost::iostreams::mapped_file::priv;
+        file->open(mmfparam);
+        T* data = (T*)file->data() + ranges[0].first * 3;
+        return boost::shared_array<T>(data, [file](T*) {});
+    }
+
+    boost::shared_array<T> arr(new T[numPoints * 3]);
+    if (ranges.empty())
+    {
+        return arr;
+    }
+    boost::iostreams::mapped_file_source mmfs(path);
+    const T* mmfdata = (const T*)mmfs.data();
+    T* out = arr.get();
+    for (auto& range : ranges)
+    {
+        out = std::copy(mmfdata + range.first * 3, mmfdata + range.second * 3, out);
+    }
+    return arr;
+}
+
+template <typename BaseVecT>
+lvr2::floatArr BigGrid<BaseVecT>::points(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+{
+    auto ranges = cellRanges(minx, miny, minz, maxx, maxy, maxz);
+    numPoints = 0;
+    for (auto& range : ranges)
+    {
+        numPoints += range.second - range.first;
+    }
+    return readRanges<float>(filePath("points.mmf"), ranges, numPoints);
 }
 
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::normals(
     float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
 {
-    std::ifstream ifs("normals.mmf");
-    if (!ifs.good())
+    std::ifstream ifs(filePath("normals.mmf"));
+    if (!m_has_normal || !ifs.good())
     {
         numPoints = 0;
         lvr2::floatArr arr;
         return arr;
     }
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
-
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
-
-    lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
-
-    boost::iostreams::mapped_file_source mmfs("normals.mmf");
-    float* mmfdata = (float*)mmfs.data();
-
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    auto ranges = cellRanges(minx, miny, minz, maxx, maxy, maxz);
+    numPoints = 0;
+    for (auto& range : ranges)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        numPoints += range.second - range.first;
     }
-
-    return points;
+    return readRanges<float>(filePath("normals.mmf"), ranges, numPoints);
 }
 
 template <typename BaseVecT>
 lvr2::ucharArr BigGrid<BaseVecT>::colors(
     float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
 {
-    std::ifstream ifs("colors.mmf");
-    if (!ifs.good())
+    std::ifstream ifs(filePath("colors.mmf"));
+    if (!m_has_color || !ifs.good())
     {
         numPoints = 0;
         lvr2::ucharArr arr;
         return arr;
     }
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
-
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
-
-    lvr2::ucharArr points(new unsigned char[numPoints * 3]);
-    size_t p_index = 0;
-
-    boost::iostreams::mapped_file_source mmfs("colors.mmf");
-    unsigned char* mmfdata = (unsigned char*)mmfs.data();
-
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    auto ranges = cellRanges(minx, miny, minz, maxx, maxy, maxz);
+    numPoints = 0;
+    for (auto& range : ranges)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        numPoints += range.second - range.first;
     }
-
-    return points;
+    return readRanges<unsigned char>(filePath("colors.mmf"), ranges, numPoints);
 }
 
 template <typename BaseVecT>
@@ -1093,62 +1484,24 @@ void BigGrid<BaseVecT>::insert(float x, float y, float z)
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::getPointCloud(size_t& numPoints)
 {
-    lvr2::floatArr points(new float[3 * pointSize()]);
-    boost::iostreams::mapped_file_params mmfparam;
-    mmfparam.path = "points.mmf";
-    mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-
-    m_PointFile.open(mmfparam);
-    float* mmfdata = (float*)m_PointFile.data();
-    memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
-
     numPoints = pointSize();
-    return points;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (numPoints)
+    {
+        ranges.emplace_back(0, numPoints);
+    }
+    return readRanges<float>(filePath("points.mmf"), ranges, numPoints);
 }
 
-    template <typename BaseVecT>
+template <typename BaseVecT>
 size_t BigGrid<BaseVecT>::getSizeofBox(
     float minx, float miny, float minz, float maxx, float maxy, float maxz)
 {
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
     size_t numPoints = 0;
-
-    // Overhead of saving indices needed to speedup size lookup
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    for (auto& range : cellRanges(minx, miny, minz, maxx, maxy, maxz))
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            numPoints += it->second.size;
-        }
+        numPoints += range.second - range.first;
     }
-
-    //    #pragma omp parallel for schedule(dynamic,1) collapse(3)
-    //    for(size_t i = idxmin ; i<=idxmax ; i++)
-    //    {
-    //        for(size_t j = idymin ; j<=idymax ; j++)
-    //        {
-    //            for(size_t k = idzmin ; k<=idzmax ; k++)
-    //            {
-    //
-    //                size_t h = hashValue(i,j,k);
-    //                auto it = m_gridNumPoints.find(h);
-    //                if(it != m_gridNumPoints.end())
-    //                {
-    //                    omp_set_lock(&m_lock);
-    //                    numPoints+=it->second.size;
-    //                    omp_unset_lock(&m_lock);
-    //                }
-    //
-    //            }
-    //        }
-    //    }
     return numPoints;
 }
 
@@ -73,6 +73,18 @@ public:
         float comparePrecision
     );
 
+    /**
+     * @brief Returns the Marching Cubes table index for the current corner
+     *        configuration or -1 if one of the corners is invalid. Unlike
+     *        \ref FastBox, extruded boxes generate a surface, too.
+     */
+    virtual int getSurfaceIndex(vector<QueryPoint<BaseVecT>>& query_points);
+
+    /**
+     * @brief Remembers the given face for \ref optimizePlanarFaces
+     */
+    virtual void addSurfaceFace(FaceHandle face);
+
     void optimizePlanarFaces(BaseMesh<BaseVecT>& mesh, size_t kc);
 
     // the point set surface
@@ -52,6 +52,26 @@ BilinearFastBox<BaseVecT>::BilinearFastBox(BaseVecT center)
     //cout << m_surface << endl;
 }
 
+template<typename BaseVecT>
+int BilinearFastBox<BaseVecT>::getSurfaceIndex(vector<QueryPoint<BaseVecT>>& qp)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        if (qp[this->m_vertices[i]].m_invalid)
+        {
+            return -1;
+        }
+    }
+
+    return this->getIndex(qp);
+}
+
+template<typename BaseVecT>
+void BilinearFastBox<BaseVecT>::addSurfaceFace(FaceHandle face)
+{
+    m_faces.push_back(face);
+}
+
 template<typename BaseVecT>
 void BilinearFastBox<BaseVecT>::getSurface(
         BaseMesh<BaseVecT>& mesh,
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellMap.hpp
+ */
+
+#ifndef _LVR2_RECONSTRUCTION_CELLMAP_H_
+#define _LVR2_RECONSTRUCTION_CELLMAP_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace lvr2
+{
+
+/**
+ * @brief Cell storage of a HashGrid.
+ *
+ * Maps the hash values of grid cells to boxes. The boxes are constructed
+ * in large blocks of contiguous memory that are owned by the map, so
+ * creating a cell does not need a heap allocation of its own and cells
+ * created one after another are neighbors in memory. The hash values are
+ * kept in an open addressing table with linear probing.
+ *
+ * Iterating the map visits the cells in insertion order. The iterators
+ * point to `pair<size_t, BoxT*>` entries, i.e., they can be used like
+ * iterators of an `unordered_map<size_t, BoxT*>`. Box addresses stay
+ * valid until the map is cleared or destroyed.
+ */
+template<typename BoxT>
+class CellMap
+{
+public:
+    typedef std::pair<size_t, BoxT*> value_type;
+    typedef typename vector<value_type>::iterator iterator;
+
+    CellMap();
+
+    ~CellMap();
+
+    CellMap(const CellMap&) = delete;
+    CellMap& operator=(const CellMap&) = delete;
+
+    /// Returns the number of cells in the map
+    size_t size() const { return m_entries.size(); }
+
+    bool empty() const { return m_entries.empty(); }
+
+    iterator begin() { return m_entries.begin(); }
+
+    iterator end() { return m_entries.end(); }
+
+    /**
+     * @brief   Returns an iterator to the cell with the given hash value
+     *          or end() if no such cell exists.
+     *
+     * Concurrent calls are safe as long as the map is not modified.
+     */
+    iterator find(size_t hash);
+
+    /**
+     * @brief   Constructs a new box in the storage of this map. The box is
+     *          owned by the map but not reachable through find() or
+     *          iteration until it is inserted.
+     */
+    template<typename... Args>
+    BoxT* newBox(Args&&... args);
+
+    /**
+     * @brief   Constructs \ref n boxes in a single block of memory.
+     *
+     * The boxes are constructed in parallel, box i from the constructor
+     * argument args(i).
+     *
+     * @return  A pointer to the first of the n consecutive boxes.
+     */
+    template<typename ArgFunc>
+    BoxT* newBoxes(size_t n, ArgFunc args);
+
+    /**
+     * @brief   Inserts a box constructed by newBox() or newBoxes() under
+     *          the given hash value. If the hash is already taken, the old
+     *          entry points to the new box afterwards, its position in the
+     *          iteration order is kept.
+     */
+    void insert(size_t hash, BoxT* box);
+
+    /// Reserves index space for the given number of cells
+    void reserve(size_t n);
+
+    /// Destroys all boxes and empties the map
+    void clear();
+
+private:
+
+    /// Entry of the open addressing table
+    struct Slot
+    {
+        size_t hash;
+        size_t entry;
+    };
+
+    /// Block of boxes, constructed in sequence
+    struct Block
+    {
+        BoxT*  boxes;
+        size_t capacity;
+        size_t used;
+    };
+
+    /// Marks a free slot
+    static constexpr size_t EMPTY_SLOT = static_cast<size_t>(-1);
+
+    /// Number of boxes in a block allocated by newBox()
+    static constexpr size_t BLOCK_SIZE = 4096;
+
+    /// Returns the table position where probing for the given hash starts
+    inline size_t home(size_t hash) const
+    {
+        // Fibonacci hashing spreads the linear grid hashes over the table
+        return (hash * 11400714819323198485ull) >> m_shift;
+    }
+
+    /// Resizes the table to 2^bits slots and re-inserts all entries
+    void rehash(int bits);
+
+    BoxT* allocate(size_t n);
+
+    /// The cells in insertion order
+    vector<value_type>  m_entries;
+
+    /// Open addressing table with a power of two size
+    vector<Slot>        m_slots;
+
+    /// Shift to map a 64 bit value onto the table size
+    int                 m_shift;
+
+    /// Memory blocks that hold the boxes
+    vector<Block>       m_blocks;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/CellMap.tcc"
+
+#endif /* _LVR2_RECONSTRUCTION_CELLMAP_H_ */
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellMap.tcc
+ */
+
+#include <new>
+
+namespace lvr2
+{
+
+template<typename BoxT>
+CellMap<BoxT>::CellMap()
+{
+    rehash(4);
+}
+
+template<typename BoxT>
+CellMap<BoxT>::~CellMap()
+{
+    clear();
+}
+
+template<typename BoxT>
+typename CellMap<BoxT>::iterator CellMap<BoxT>::find(size_t hash)
+{
+    size_t mask = m_slots.size() - 1;
+    for (size_t pos = home(hash); m_slots[pos].entry != EMPTY_SLOT; pos = (pos + 1) & mask)
+    {
+        if (m_slots[pos].hash == hash)
+        {
+            return m_entries.begin() + m_slots[pos].entry;
+        }
+    }
+    return m_entries.end();
+}
+
+template<typename BoxT>
+template<typename... Args>
+BoxT* CellMap<BoxT>::newBox(Args&&... args)
+{
+    if (m_blocks.empty() || m_blocks.back().used == m_blocks.back().capacity)
+    {
+        m_blocks.push_back({allocate(BLOCK_SIZE), BLOCK_SIZE, 0});
+    }
+
+    Block& block = m_blocks.back();
+    BoxT* box = new (block.boxes + block.used) BoxT(std::forward<Args>(args)...);
+    block.used++;
+    return box;
+}
+
+template<typename BoxT>
+template<typename ArgFunc>
+BoxT* CellMap<BoxT>::newBoxes(size_t n, ArgFunc args)
+{
+    if (n == 0)
+    {
+        return nullptr;
+    }
+
+    Block block = {allocate(n), n, n};
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)n; i++)
+    {
+        new (block.boxes + i) BoxT(args(i));
+    }
+    m_blocks.push_back(block);
+    return block.boxes;
+}
+
+template<typename BoxT>
+void CellMap<BoxT>::insert(size_t hash, BoxT* box)
+{
+    if (2 * (m_entries.size() + 1) > m_slots.size())
+    {
+        rehash(64 - m_shift + 1);
+    }
+
+    size_t mask = m_slots.size() - 1;
+    size_t pos = home(hash);
+    for (; m_slots[pos].entry != EMPTY_SLOT; pos = (pos + 1) & mask)
+    {
+        if (m_slots[pos].hash == hash)
+        {
+            m_entries[m_slots[pos].entry].second = box;
+            return;
+        }
+    }
+    m_slots[pos] = {hash, m_entries.size()};
+    m_entries.push_back(value_type(hash, box));
+}
+
+template<typename BoxT>
+void CellMap<BoxT>::reserve(size_t n)
+{
+    int bits = 64 - m_shift;
+    while ((size_t(1) << bits) < 2 * n)
+    {
+        bits++;
+    }
+    if (bits > 64 - m_shift)
+    {
+        rehash(bits);
+    }
+    m_entries.reserve(n);
+}
+
+template<typename BoxT>
+void CellMap<BoxT>::clear()
+{
+    for (Block& block : m_blocks)
+    {
+        for (size_t i = 0; i < block.used; i++)
+        {
+            block.boxes[i].~BoxT();
+        }
+        ::operator delete(block.boxes);
+    }
+    m_blocks.clear();
+    m_entries.clear();
+    rehash(4);
+}
+
+template<typename BoxT>
+void CellMap<BoxT>::rehash(int bits)
+{
+    m_shift = 64 - bits;
+    m_slots.assign(size_t(1) << bits, {0, EMPTY_SLOT});
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        size_t pos = home(m_entries[i].first);
+        while (m_slots[pos].entry != EMPTY_SLOT)
+        {
+            pos = (pos + 1) & mask;
+        }
+        m_slots[pos] = {m_entries[i].first, i};
+    }
+}
+
+template<typename BoxT>
+BoxT* CellMap<BoxT>::allocate(size_t n)
+{
+    return static_cast<BoxT*>(::operator new(n * sizeof(BoxT)));
+}
+
+} // namespace lvr2
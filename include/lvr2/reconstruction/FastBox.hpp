@@ -110,6 +110,32 @@ public:
 
     inline BaseVecT getCenter() { return m_center; }
 
+    /**
+     * @brief Returns the Marching Cubes table index for the current corner
+     *        configuration or -1 if the box does not generate a surface,
+     *        i.e., if it is extruded or one of its corners is invalid.
+     *
+     * @param query_points  A vector containing the query points of the
+     *                      reconstruction grid
+     */
+    virtual int getSurfaceIndex(vector<QueryPoint<BaseVecT>>& query_points);
+
+    /**
+     * @brief Calculates the interpolated surface intersections on the
+     *        twelve box edges.
+     *
+     * @param query_points  A vector containing the query points of the
+     *                      reconstruction grid
+     * @param positions     The twelve interpolated intersections
+     */
+    void getIntersections(vector<QueryPoint<BaseVecT>>& query_points, BaseVecT* positions);
+
+    /**
+     * @brief Called for each face that the parallel surface extraction
+     *        of \ref FastReconstruction generates for this box.
+     */
+    virtual void addSurfaceFace(FaceHandle face) {}
+
 
     /**
      * @brief Performs a local reconstruction according to the standard
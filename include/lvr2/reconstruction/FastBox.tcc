@@ -194,6 +194,36 @@ void FastBox<BaseVecT>::getIntersections(BaseVecT* corners,
 }
 
 
+template<typename BaseVecT>
+void FastBox<BaseVecT>::getIntersections(vector<QueryPoint<BaseVecT>>& qp, BaseVecT* positions)
+{
+    BaseVecT corners[8];
+    float distances[8];
+
+    getCorners(corners, qp);
+    getDistances(distances, qp);
+    getIntersections(corners, distances, positions);
+}
+
+template<typename BaseVecT>
+int FastBox<BaseVecT>::getSurfaceIndex(vector<QueryPoint<BaseVecT>>& qp)
+{
+    if (this->m_extruded)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (qp[m_vertices[i]].m_invalid)
+        {
+            return -1;
+        }
+    }
+
+    return getIndex(qp);
+}
+
 template<typename BaseVecT>
 void FastBox<BaseVecT>::getSurface(
     BaseMesh<BaseVecT>& mesh,
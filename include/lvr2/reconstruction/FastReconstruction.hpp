@@ -50,6 +50,7 @@
 
 #include <unordered_map>
 #include <memory>
+#include <type_traits>
 
 using std::shared_ptr;
 using std::unordered_map;
@@ -117,6 +118,18 @@ public:
 
 private:
 
+    /**
+     * @brief Generates the Marching Cubes surface of all cells in parallel.
+     *
+     * Shared edge intersections are assigned to the first cell in grid
+     * order that uses them, so vertices and faces are added to the mesh
+     * in exactly the same order as by the serial cell loop. Only used for
+     * \ref FastBox and \ref BilinearFastBox.
+     *
+     * @param mesh
+     */
+    void getSurfaceParallel(BaseMesh<BaseVecT>& mesh);
+
     shared_ptr<HashGrid<BaseVecT, BoxT>> m_grid;
 };
 
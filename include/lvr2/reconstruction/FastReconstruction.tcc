@@ -32,8 +32,12 @@
  *      Author: Thomas Wiemann
  */
 #include "lvr2/geometry/BaseMesh.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/config/lvropenmp.hpp"
+
+#include <limits>
 
 namespace lvr2
 {
@@ -47,26 +51,38 @@ FastReconstruction<BaseVecT, BoxT>::FastReconstruction(shared_ptr<HashGrid<BaseV
 template<typename BaseVecT, typename BoxT>
 void FastReconstruction<BaseVecT, BoxT>::getMesh(BaseMesh<BaseVecT> &mesh)
 {
-    // Status message for mesh generation
-    string comment = timestamp.getElapsedTime() + "Creating mesh ";
-    ProgressBar progress(m_grid->getNumberOfCells(), comment);
+    typename HashGrid<BaseVecT, BoxT>::box_map_it it;
 
-    // Some pointers
-    BoxT* b;
-    unsigned int global_index = mesh.numVertices();
+    // Other box types generate their surfaces differently
+    bool plainMC = std::is_same<BoxT, FastBox<BaseVecT>>::value
+                || std::is_same<BoxT, BilinearFastBox<BaseVecT>>::value;
 
-    // Iterate through cells and calculate local approximations
-    typename HashGrid<BaseVecT, BoxT>::box_map_it it;
-    for(it = m_grid->firstCell(); it != m_grid->lastCell(); it++)
+    if(plainMC && OpenMPConfig::getNumThreads() > 1)
     {
-        b = it->second;
-        b->getSurface(mesh, m_grid->getQueryPoints(), global_index);
-        if(!timestamp.isQuiet())
-            ++progress;
+        getSurfaceParallel(mesh);
     }
+    else
+    {
+        // Status message for mesh generation
+        string comment = timestamp.getElapsedTime() + "Creating mesh ";
+        ProgressBar progress(m_grid->getNumberOfCells(), comment);
 
-    if(!timestamp.isQuiet())
-        cout << endl;
+        // Some pointers
+        BoxT* b;
+        unsigned int global_index = mesh.numVertices();
+
+        // Iterate through cells and calculate local approximations
+        for(it = m_grid->firstCell(); it != m_grid->lastCell(); it++)
+        {
+            b = it->second;
+            b->getSurface(mesh, m_grid->getQueryPoints(), global_index);
+            if(!timestamp.isQuiet())
+                ++progress;
+        }
+
+        if(!timestamp.isQuiet())
+            cout << endl;
+    }
 
     BoxTraits<BoxT> traits;
 
@@ -177,6 +193,242 @@ void FastReconstruction<BaseVecT, BoxT>::getMesh(BaseMesh<BaseVecT> &mesh)
 
 }
 
+template<typename BaseVecT, typename BoxT>
+void FastReconstruction<BaseVecT, BoxT>::getSurfaceParallel(BaseMesh<BaseVecT>& mesh)
+{
+    // Status message for mesh generation
+    string comment = timestamp.getElapsedTime() + "Creating mesh ";
+    ProgressBar progress(m_grid->getNumberOfCells(), comment);
+
+    auto& cells = m_grid->getCells();
+    vector<QueryPoint<BaseVecT>>& qp = m_grid->getQueryPoints();
+    auto firstCell = m_grid->firstCell();
+    long numCells = cells.size();
+
+    // For every MC configuration: the used edges in order of their first
+    // appearance in the triangles, i.e., the order in which the serial
+    // implementation creates the vertices of a box
+    int edgeOrder[256][12];
+    int numEdges[256];
+    int edgeMask[256];
+    int numTriangles[256];
+    for(int index = 0; index < 256; index++)
+    {
+        numEdges[index] = 0;
+        edgeMask[index] = 0;
+        int a = 0;
+        for(; MCTable[index][a] != -1; a++)
+        {
+            int edge = MCTable[index][a];
+            if(!(edgeMask[index] & (1 << edge)))
+            {
+                edgeMask[index] |= 1 << edge;
+                edgeOrder[index][numEdges[index]++] = edge;
+            }
+        }
+        numTriangles[index] = a / 3;
+    }
+
+    // Hash offsets of the 27 neighbors of a cell
+    size_t neighborHashes[27];
+    for(int n = 0; n < 27; n++)
+    {
+        neighborHashes[n] = m_grid->hashValue(n / 9 - 1, n / 3 % 3 - 1, n % 3 - 1);
+    }
+
+    vector<short> mcIndex(numCells);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(long r = 0; r < numCells; r++)
+    {
+        int index = firstCell[r].second->getSurfaceIndex(qp);
+        mcIndex[r] = (index < 0 || numEdges[index] == 0) ? -1 : index;
+        if(!timestamp.isQuiet())
+            ++progress;
+    }
+
+    if(!timestamp.isQuiet())
+        cout << endl;
+
+    // Enumerate the cells that generate triangles
+    const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+    vector<unsigned int> surfaceIndex(numCells, NONE);
+    vector<long> surfaceCells;
+    for(long r = 0; r < numCells; r++)
+    {
+        if(mcIndex[r] >= 0)
+        {
+            surfaceIndex[r] = surfaceCells.size();
+            surfaceCells.push_back(r);
+        }
+    }
+    long numSurfaceCells = surfaceCells.size();
+
+    // An edge intersection is shared by up to four cells. Its vertex is
+    // created by the first of them (in grid order) that uses the edge.
+    auto findOwner = [&](long s, int edge, long& owner, int& ownerEdge)
+    {
+        owner = s;
+        ownerEdge = edge;
+        for(int i = 0; i < 3; i++)
+        {
+            auto it = cells.find(firstCell[surfaceCells[s]].first + neighborHashes[neighbor_table[edge][i]]);
+            if(it == cells.end())
+            {
+                continue;
+            }
+
+            unsigned int n = surfaceIndex[it - firstCell];
+            int neighborEdge = neighbor_vertex_table[edge][i];
+            if(n != NONE && n < owner && (edgeMask[mcIndex[surfaceCells[n]]] & (1 << neighborEdge)))
+            {
+                owner = n;
+                ownerEdge = neighborEdge;
+            }
+        }
+    };
+
+    vector<unsigned int> firstVertex(numSurfaceCells + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        int index = mcIndex[surfaceCells[s]];
+        for(int e = 0; e < numEdges[index]; e++)
+        {
+            long owner;
+            int ownerEdge;
+            findOwner(s, edgeOrder[index][e], owner, ownerEdge);
+            firstVertex[s + 1] += owner == s;
+        }
+    }
+
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        firstVertex[s + 1] += firstVertex[s];
+    }
+
+    // Number the vertices owned by each cell and interpolate their positions
+    vector<unsigned int> vertexIds(12 * numSurfaceCells, NONE);
+    vector<BaseVecT> positions(firstVertex[numSurfaceCells]);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        BoxT* box = firstCell[surfaceCells[s]].second;
+        int index = mcIndex[surfaceCells[s]];
+        unsigned int current = firstVertex[s];
+
+        BaseVecT vertex_positions[12];
+        box->getIntersections(qp, vertex_positions);
+
+        for(int e = 0; e < numEdges[index]; e++)
+        {
+            int edge = edgeOrder[index][e];
+            long owner;
+            int ownerEdge;
+            findOwner(s, edge, owner, ownerEdge);
+            if(owner == s)
+            {
+                positions[current] = vertex_positions[edge];
+                vertexIds[12 * s + edge] = current++;
+            }
+        }
+    }
+
+    // Shared intersections reuse the vertex of their owner
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        int index = mcIndex[surfaceCells[s]];
+        for(int e = 0; e < numEdges[index]; e++)
+        {
+            int edge = edgeOrder[index][e];
+            long owner;
+            int ownerEdge;
+            findOwner(s, edge, owner, ownerEdge);
+            if(owner != s)
+            {
+                vertexIds[12 * s + edge] = vertexIds[12 * owner + ownerEdge];
+            }
+        }
+    }
+
+    // Build the mesh in grid order
+    vector<VertexHandle> handles;
+    handles.reserve(positions.size());
+    for(auto& p : positions)
+    {
+        handles.push_back(mesh.addVertex(p));
+    }
+    vector<BaseVecT>().swap(positions);
+
+    // Collect the triangles of all cells in grid order
+    vector<size_t> firstFace(numSurfaceCells + 1, 0);
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        firstFace[s + 1] = firstFace[s] + numTriangles[mcIndex[surfaceCells[s]]];
+    }
+    size_t numFaces = firstFace[numSurfaceCells];
+
+    vector<unsigned int> faceIndices(3 * numFaces);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        BoxT* box = firstCell[surfaceCells[s]].second;
+        int index = mcIndex[surfaceCells[s]];
+        for(int e = 0; e < numEdges[index]; e++)
+        {
+            int edge = edgeOrder[index][e];
+            box->m_intersections[edge] = handles[vertexIds[12 * s + edge]];
+        }
+
+        unsigned int* face = faceIndices.data() + 3 * firstFace[s];
+        for(int a = 0; MCTable[index][a] != -1; a++)
+        {
+            face[a] = handles[vertexIds[12 * s + MCTable[index][a]]].idx();
+        }
+    }
+    vector<unsigned int>().swap(vertexIds);
+
+    // A half-edge mesh without faces is built from the index buffer in one
+    // pass. The i-th face then has the handle FaceHandle(i). Other meshes and
+    // non-manifold surfaces get the faces one by one, like the serial
+    // implementation.
+    bool bulk = false;
+    if(mesh.numFaces() == 0)
+    {
+        if(auto hem = dynamic_cast<HalfEdgeMesh<BaseVecT>*>(&mesh))
+        {
+            bulk = hem->addFacesFromIndices(faceIndices.data(), numFaces);
+        }
+        else if(auto hem = dynamic_cast<HalfEdgeMesh<BaseVecT, BitmapStableVector>*>(&mesh))
+        {
+            bulk = hem->addFacesFromIndices(faceIndices.data(), numFaces);
+        }
+    }
+
+    vector<FaceHandle> faces;
+    if(!bulk)
+    {
+        faces.reserve(numFaces);
+        for(size_t f = 0; f < numFaces; f++)
+        {
+            faces.push_back(mesh.addFace(
+                VertexHandle(faceIndices[3 * f]),
+                VertexHandle(faceIndices[3 * f + 1]),
+                VertexHandle(faceIndices[3 * f + 2])
+            ));
+        }
+    }
+
+    for(long s = 0; s < numSurfaceCells; s++)
+    {
+        BoxT* box = firstCell[surfaceCells[s]].second;
+        for(size_t f = firstFace[s]; f < firstFace[s + 1]; f++)
+        {
+            box->addSurfaceFace(bulk ? FaceHandle(f) : faces[f]);
+        }
+    }
+}
+
 template<typename BaseVecT, typename BoxT>
 void FastReconstruction<BaseVecT, BoxT>::getMesh(
     BaseMesh<BaseVecT>& mesh,
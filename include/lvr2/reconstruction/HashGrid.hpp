@@ -35,6 +35,7 @@
 #ifndef _LVR2_RECONSTRUCTION_HASHGRID_H_
 #define _LVR2_RECONSTRUCTION_HASHGRID_H_
 
+#include <array>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -42,6 +43,7 @@
 #include "QueryPoint.hpp"
 
 #include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/reconstruction/CellMap.hpp"
 #include "lvr2/reconstruction/QueryPoint.hpp"
 
 using std::string;
@@ -98,12 +100,12 @@ public:
     BoundingBox<BaseVecT> qp_bb;
 
     /// Typedef to alias box map
-    typedef unordered_map<size_t, BoxT*> box_map;
+    typedef CellMap<BoxT> box_map;
 
     typedef unordered_map<size_t, size_t> qp_map;
 
     /// Typedef to alias iterators for box maps
-    typedef typename unordered_map<size_t, BoxT*>::iterator  box_map_it;
+    typedef typename box_map::iterator  box_map_it;
 
     /// Typedef to alias iterators to query points
     typedef typename vector<QueryPoint<BaseVecT>>::iterator query_point_it;
@@ -178,6 +180,21 @@ public:
      */
     virtual void addLatticePoint(int i, int j, int k, float distance = 0.0);
 
+    /**
+     * @brief   Adds the lattice points for all given cells at once.
+     *
+     * The resulting grid (cells, neighbor links, query point numbering
+     * and iteration order of the cell map) is identical to calling
+     * \ref addLatticePoint for each entry in the given order. On an
+     * empty grid, cell creation, neighbor linking and query point
+     * deduplication are distributed over all OpenMP threads.
+     *
+     * @param indices   Discrete {i, j, k} positions within the grid.
+     *                  Duplicate entries are allowed.
+     * @param distance  Initial distance value of the new query points.
+     */
+    void addLatticePoints(const vector<std::array<int, 3>>& indices, float distance = 0.0);
+
     /**
      * @brief   Saves a representation of the grid to the given file
      *
@@ -221,7 +238,7 @@ public:
 
     vector<QueryPoint<BaseVecT>>& getQueryPoints() { return m_queryPoints; }
 
-    box_map getCells() { return m_cells; }
+    box_map& getCells() { return m_cells; }
 
     /***
      * @brief   Destructor
@@ -283,6 +300,23 @@ protected:
         return f < 0 ? f - .5 : f + .5;
     }
 
+    /**
+     * @brief   Allocates a new box for the cell with the given index and
+     *          marks it as duplicate if it lies close to the bounding box.
+     */
+    BoxT* createBox(int i, int j, int k);
+
+    /**
+     * @brief   Returns the center of the cell with the given index
+     */
+    BaseVecT cellCenter(int i, int j, int k);
+
+    /**
+     * @brief   Marks the given box as duplicate if it lies close to the
+     *          bounding box.
+     */
+    void checkDuplicate(BoxT* box);
+
     /// Map to handle the boxes in the grid
     box_map         m_cells;
 
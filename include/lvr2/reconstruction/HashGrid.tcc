@@ -32,6 +32,7 @@
  *      Author: Thomas Wiemann
  */
 
+#include "lvr2/config/lvropenmp.hpp"
 #include "lvr2/geometry/BaseMesh.hpp"
 #include "lvr2/io/ChunkIO.hpp"
 #include "lvr2/io/Progress.hpp"
@@ -142,14 +143,14 @@ HashGrid<BaseVecT, BoxT>::HashGrid(string file)
         // cout << "i: " << k << endl;
         ifs >> h >> cell[0] >> cell[1] >> cell[2] >> cell[3] >> cell[4] >> cell[5] >> cell[6] >>
             cell[7] >> cell_center.x >> cell_center.y >> cell_center.z >> fusion;
-        BoxT* box = new BoxT(cell_center);
+        BoxT* box = m_cells.newBox(cell_center);
         box->m_extruded = fusion;
         for (int j = 0; j < 8; j++)
         {
             box->setVertex(j, cell[j]);
         }
 
-        m_cells[h] = box;
+        m_cells.insert(h, box);
     }
     cout << timestamp << "Reading cells.." << endl;
     typename HashGrid<BaseVecT, BoxT>::box_map_it it;
@@ -237,7 +238,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
             auto cell_it = this->m_cells.find(hash);
             if (cell_it == this->m_cells.end() && !extruded)
             {
-                BoxT* box = new BoxT(box_center);
+                BoxT* box = m_cells.newBox(box_center);
                 for (int i = 0; i < 8; i++)
                 {
                     current_index = this->findQueryPoint(i, idx, idy, idz);
@@ -282,7 +283,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
                     }
                 }
 
-                this->m_cells[hash] = box;
+                this->m_cells.insert(hash, box);
             }
         }
         fclose(pFile);
@@ -340,7 +341,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
             auto cell_it = this->m_cells.find(hash);
             if (cell_it == this->m_cells.end() && !extruded)
             {
-                BoxT* box = new BoxT(box_center);
+                BoxT* box = m_cells.newBox(box_center);
                 for (int i = 0; i < 8; i++)
                 {
                     current_index = this->findQueryPoint(i, idx, idy, idz);
@@ -385,7 +386,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
                     }
                 }
 
-                this->m_cells[hash] = box;
+                this->m_cells.insert(hash, box);
             }
         }
         fclose(pFile);
@@ -447,7 +448,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<PointBufferPtr> chunks,
                 auto cell_it = this->m_cells.find(hash);
                 if (cell_it == this->m_cells.end() && !extruded.get()[cellCount])
                 {
-                    BoxT* box = new BoxT(BaseVecT(centers[cellCount * 3 + 0], centers[cellCount * 3 + 1], centers[cellCount * 3 + 2]));
+                    BoxT* box = m_cells.newBox(BaseVecT(centers[cellCount * 3 + 0], centers[cellCount * 3 + 1], centers[cellCount * 3 + 2]));
                     for (int i = 0; i < 8; i++)
                     {
                         current_index = this->findQueryPoint(i, idx, idy, idz);
@@ -492,7 +493,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<PointBufferPtr> chunks,
                         }
                     }
 
-                    this->m_cells[hash] = box;
+                    this->m_cells.insert(hash, box);
                 }
             }
         }
@@ -529,10 +530,6 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x,
     // created query point will get
     unsigned int current_index = 0;
 
-    // Get min and max vertex of the point clouds bounding box
-    auto v_min = this->m_boundingBox.getMin();
-    auto v_max = this->m_boundingBox.getMax();
-
     int limit = this->m_extrude ? 1 : 0;
     for (int dx = -limit; dx <= limit; dx++)
     {
@@ -545,39 +542,9 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x,
                 it = this->m_cells.find(hash_value);
                 if (it == this->m_cells.end())
                 {
-                    // Calculate box center
-                    BaseVecT box_center((index_x + dx) * this->m_voxelsize + v_min.x,
-                                        (index_y + dy) * this->m_voxelsize + v_min.y,
-                                        (index_z + dz) * this->m_voxelsize + v_min.z);
-
-                    // WHY? this makes the results more worse than lvr1
-                    // if((
-                    //         box_center[0] <= m_boundingBox.getMin().x ||
-                    //         box_center[1] <= m_boundingBox.getMin().y ||
-                    //         box_center[2] <= m_boundingBox.getMin().z ||
-                    //         box_center[0] >= m_boundingBox.getMax().x + m_voxelsize ||
-                    //         box_center[1] >= m_boundingBox.getMax().y + m_voxelsize ||
-                    //         box_center[2] >= m_boundingBox.getMax().z + m_voxelsize
-                    // ))
-                    // {
-                    //     continue;
-                    // }
-
                     // Create new box
-                    BoxT* box = new BoxT(box_center);
-
-                    if (box_center[0] <= m_boundingBox.getMin().x + m_voxelsize * 5 ||
-                        box_center[1] <= m_boundingBox.getMin().y + m_voxelsize * 5 ||
-                        box_center[2] <= m_boundingBox.getMin().z + m_voxelsize * 5)
-                    {
-                        box->m_duplicate = true;
-                    }
-                    else if (box_center[0] >= m_boundingBox.getMax().x - m_voxelsize * 5 ||
-                             box_center[1] >= m_boundingBox.getMax().y - m_voxelsize * 5 ||
-                             box_center[2] >= m_boundingBox.getMax().z - m_voxelsize * 5)
-                    {
-                        box->m_duplicate = true;
-                    }
+                    BoxT* box = createBox(index_x + dx, index_y + dy, index_z + dz);
+                    BaseVecT box_center = box->getCenter();
 
                     // Setup the box itself
                     for (int k = 0; k < 8; k++)
@@ -635,7 +602,7 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x,
                         }
                     }
 
-                    this->m_cells[hash_value] = box;
+                    this->m_cells.insert(hash_value, box);
                 }
             }
         }
@@ -643,26 +610,327 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x,
 }
 
 template <typename BaseVecT, typename BoxT>
-void HashGrid<BaseVecT, BoxT>::setCoordinateScaling(float x, float y, float z)
+BoxT* HashGrid<BaseVecT, BoxT>::createBox(int i, int j, int k)
 {
-    m_coordinateScales.x = x;
-    m_coordinateScales.y = y;
-    m_coordinateScales.z = z;
+    BoxT* box = m_cells.newBox(cellCenter(i, j, k));
+    checkDuplicate(box);
+    return box;
 }
 
 template <typename BaseVecT, typename BoxT>
-HashGrid<BaseVecT, BoxT>::~HashGrid()
+BaseVecT HashGrid<BaseVecT, BoxT>::cellCenter(int i, int j, int k)
+{
+    auto v_min = this->m_boundingBox.getMin();
+    return BaseVecT(i * this->m_voxelsize + v_min.x,
+                    j * this->m_voxelsize + v_min.y,
+                    k * this->m_voxelsize + v_min.z);
+}
+
+template <typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::checkDuplicate(BoxT* box)
 {
-    box_map_it iter;
-    for (iter = m_cells.begin(); iter != m_cells.end(); iter++)
+    BaseVecT box_center = box->getCenter();
+
+    // WHY? this makes the results more worse than lvr1
+    // if((
+    //         box_center[0] <= m_boundingBox.getMin().x ||
+    //         box_center[1] <= m_boundingBox.getMin().y ||
+    //         box_center[2] <= m_boundingBox.getMin().z ||
+    //         box_center[0] >= m_boundingBox.getMax().x + m_voxelsize ||
+    //         box_center[1] >= m_boundingBox.getMax().y + m_voxelsize ||
+    //         box_center[2] >= m_boundingBox.getMax().z + m_voxelsize
+    // ))
+    // {
+    //     continue;
+    // }
+
+    if (box_center[0] <= m_boundingBox.getMin().x + m_voxelsize * 5 ||
+        box_center[1] <= m_boundingBox.getMin().y + m_voxelsize * 5 ||
+        box_center[2] <= m_boundingBox.getMin().z + m_voxelsize * 5)
+    {
+        box->m_duplicate = true;
+    }
+    else if (box_center[0] >= m_boundingBox.getMax().x - m_voxelsize * 5 ||
+             box_center[1] >= m_boundingBox.getMax().y - m_voxelsize * 5 ||
+             box_center[2] >= m_boundingBox.getMax().z - m_voxelsize * 5)
+    {
+        box->m_duplicate = true;
+    }
+}
+
+template <typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::addLatticePoints(const vector<std::array<int, 3>>& indices,
+                                                float distance)
+{
+    // The bulk path reproduces the serial numbering only if no cells
+    // and query points exist yet
+    int numChunks = OpenMPConfig::getNumThreads();
+    if (numChunks < 2 || !m_cells.empty() || !m_queryPoints.empty())
+    {
+        for (const auto& index : indices)
+        {
+            addLatticePoint(index[0], index[1], index[2], distance);
+        }
+        return;
+    }
+
+    float vsh = 0.5 * this->m_voxelsize;
+    size_t numIndices = indices.size();
+
+    // Cell offsets in the same order as visited by addLatticePoint(). The
+    // hash function is linear, so the hash of a neighbor cell is the hash
+    // of the cell plus the hash of the offset.
+    int limit = this->m_extrude ? 1 : 0;
+    vector<std::array<int, 3>> offsets;
+    vector<size_t> offsetHashes;
+    for (int dx = -limit; dx <= limit; dx++)
+    {
+        for (int dy = -limit; dy <= limit; dy++)
+        {
+            for (int dz = -limit; dz <= limit; dz++)
+            {
+                offsets.push_back({dx, dy, dz});
+                offsetHashes.push_back(this->hashValue(dx, dy, dz));
+            }
+        }
+    }
+    size_t numOffsets = offsets.size();
+
+    vector<size_t> seedHashes(numIndices);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)numIndices; i++)
+    {
+        seedHashes[i] = this->hashValue(indices[i][0], indices[i][1], indices[i][2]);
+    }
+
+    // Position of the first occurrence of each distinct input cell. The
+    // map is split into shards by hash value, every shard is filled by a
+    // single thread in input order.
+    vector<unordered_map<size_t, size_t>> firstSeeds(numChunks);
+    #pragma omp parallel for schedule(static, 1)
+    for (int s = 0; s < numChunks; s++)
+    {
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            if (seedHashes[i] % numChunks == (size_t)s)
+            {
+                firstSeeds[s].emplace(seedHashes[i], i);
+            }
+        }
+    }
+
+    auto firstSeed = [&](size_t hash) {
+        auto& shard = firstSeeds[hash % numChunks];
+        auto it = shard.find(hash);
+        return it != shard.end() ? it->second : numIndices;
+    };
+
+    // The serial path creates a cell when visiting the first (input, offset)
+    // pair that hits it. A pair is the creator of its cell if no other pair
+    // hitting the same cell comes before it. Chunks are contiguous input
+    // ranges, so their concatenation is already in creation order.
+    struct NewCell
+    {
+        size_t hash;
+        std::array<int, 3> index;
+    };
+    vector<vector<NewCell>> chunkCells(numChunks);
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < numChunks; t++)
+    {
+        size_t begin = numIndices * t / numChunks;
+        size_t end = numIndices * (t + 1) / numChunks;
+        for (size_t i = begin; i < end; i++)
+        {
+            if (firstSeed(seedHashes[i]) != i)
+            {
+                continue;
+            }
+            for (size_t o = 0; o < numOffsets; o++)
+            {
+                size_t hash = seedHashes[i] + offsetHashes[o];
+                size_t order = i * numOffsets + o;
+                bool creator = true;
+                for (size_t p = 0; p < numOffsets && creator; p++)
+                {
+                    size_t pos = firstSeed(hash - offsetHashes[p]);
+                    creator = pos == numIndices || pos * numOffsets + p >= order;
+                }
+                if (creator)
+                {
+                    chunkCells[t].push_back({hash, {indices[i][0] + offsets[o][0],
+                                                    indices[i][1] + offsets[o][1],
+                                                    indices[i][2] + offsets[o][2]}});
+                }
+            }
+        }
+    }
+    firstSeeds.clear();
+    seedHashes.clear();
+
+    vector<NewCell> cells;
+    for (auto& c : chunkCells)
+    {
+        cells.insert(cells.end(), c.begin(), c.end());
+        vector<NewCell>().swap(c);
+    }
+    long numCells = cells.size();
+
+    BoxT* boxes = m_cells.newBoxes(numCells, [&](size_t r) {
+        return cellCenter(cells[r].index[0], cells[r].index[1], cells[r].index[2]);
+    });
+
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < numCells; r++)
+    {
+        checkDuplicate(boxes + r);
+    }
+
+    // The cell map is iterated in insertion order, so the boxes have to
+    // be inserted in creation order
+    m_cells.reserve(numCells);
+    for (long r = 0; r < numCells; r++)
+    {
+        m_cells.insert(cells[r].hash, boxes + r);
+    }
+
+    // Link all adjacent cells. Every box sets its own pointers, the own
+    // cell (index 13) is never linked.
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < numCells; r++)
+    {
+        int neighbor_index = 0;
+        for (int a = -1; a < 2; a++)
+        {
+            for (int b = -1; b < 2; b++)
+            {
+                for (int c = -1; c < 2; c++)
+                {
+                    if (neighbor_index != 13)
+                    {
+                        auto neighbor_it = m_cells.find(this->hashValue(cells[r].index[0] + a,
+                                                                        cells[r].index[1] + b,
+                                                                        cells[r].index[2] + c));
+                        if (neighbor_it != m_cells.end())
+                        {
+                            boxes[r].setNeighbor(neighbor_index, neighbor_it->second);
+                        }
+                    }
+                    neighbor_index++;
+                }
+            }
+        }
+    }
+
+    // A shared corner gets its query point from the earliest created box
+    // touching it. The creation rank is kept in the first corner of each
+    // box until the final indices are written.
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < numCells; r++)
+    {
+        boxes[r].setVertex(0, r);
+    }
+
+    vector<unsigned int> ownerBox(8 * numCells);
+    vector<unsigned char> ownerCorner(8 * numCells);
+    vector<unsigned char> numOwned(numCells);
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < numCells; r++)
     {
-        if (iter->second != NULL)
+        for (int k = 0; k < 8; k++)
         {
-            delete (iter->second);
-            iter->second = NULL;
+            unsigned int owner = r;
+            int corner = k;
+            for (int i = 0; i < 7; i++)
+            {
+                const int* shared = shared_vertex_table[k] + 4 * i;
+                auto neighbor = boxes[r].getNeighbor(
+                    (shared[0] + 1) * 9 + (shared[1] + 1) * 3 + (shared[2] + 1));
+                if (neighbor && neighbor->getVertex(0) < owner)
+                {
+                    owner = neighbor->getVertex(0);
+                    corner = shared[3];
+                }
+            }
+            ownerBox[8 * r + k] = owner;
+            ownerCorner[8 * r + k] = corner;
+            numOwned[r] += owner == r;
         }
     }
 
+    // Prefix sum over the number of new query points per box
+    vector<unsigned int> firstIndex(numCells);
+    vector<size_t> chunkSums(numChunks + 1, 0);
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < numChunks; t++)
+    {
+        for (long r = numCells * t / numChunks; r < numCells * (t + 1) / numChunks; r++)
+        {
+            chunkSums[t + 1] += numOwned[r];
+        }
+    }
+    for (int t = 0; t < numChunks; t++)
+    {
+        chunkSums[t + 1] += chunkSums[t];
+    }
+
+    m_queryPoints.resize(chunkSums[numChunks]);
+    vector<unsigned int> cornerIndices(8 * numCells);
+    vector<BoundingBox<BaseVecT>> chunkBoxes(numChunks);
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < numChunks; t++)
+    {
+        unsigned int current_index = chunkSums[t];
+        for (long r = numCells * t / numChunks; r < numCells * (t + 1) / numChunks; r++)
+        {
+            BaseVecT box_center = boxes[r].getCenter();
+            for (int k = 0; k < 8; k++)
+            {
+                if (ownerBox[8 * r + k] == r)
+                {
+                    BaseVecT position(box_center.x + box_creation_table[k][0] * vsh,
+                                      box_center.y + box_creation_table[k][1] * vsh,
+                                      box_center.z + box_creation_table[k][2] * vsh);
+
+                    chunkBoxes[t].expand(position);
+                    m_queryPoints[current_index] = QueryPoint<BaseVecT>(position, distance);
+                    cornerIndices[8 * r + k] = current_index;
+                    current_index++;
+                }
+            }
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < numCells; r++)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            boxes[r].setVertex(k, cornerIndices[8 * ownerBox[8 * r + k] + ownerCorner[8 * r + k]]);
+        }
+    }
+
+    for (int t = 0; t < numChunks; t++)
+    {
+        if (chunkSums[t + 1] > chunkSums[t])
+        {
+            qp_bb.expand(chunkBoxes[t]);
+        }
+    }
+    m_globalIndex = m_queryPoints.size();
+}
+
+template <typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::setCoordinateScaling(float x, float y, float z)
+{
+    m_coordinateScales.x = x;
+    m_coordinateScales.y = y;
+    m_coordinateScales.z = z;
+}
+
+template <typename BaseVecT, typename BoxT>
+HashGrid<BaseVecT, BoxT>::~HashGrid()
+{
     m_cells.clear();
 }
 
@@ -741,7 +1009,7 @@ void HashGrid<BaseVecT, BoxT>::saveGrid(string filename)
         }
 
         // Write box definitions
-        typename unordered_map<size_t, BoxT*>::iterator it;
+        box_map_it it;
         BoxT* box;
         for (it = m_cells.begin(); it != m_cells.end(); it++)
         {
@@ -847,7 +1115,7 @@ void HashGrid<BaseVecT, BoxT>::serialize(string file)
         }
 
         // Write box definitions
-        typename unordered_map<size_t, BoxT*>::iterator it;
+        box_map_it it;
         BoxT* box;
         for (it = m_cells.begin(); it != m_cells.end(); it++)
         {
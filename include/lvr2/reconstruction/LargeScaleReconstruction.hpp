@@ -33,6 +33,10 @@
 #include "lvr2/reconstruction/FastBox.hpp"
 #include "lvr2/algorithm/ChunkManager.hpp"
 #include "lvr2/geometry/HalfEdgeMesh.hpp"
+#include "lvr2/reconstruction/BigGrid.hpp"
+
+#include <map>
+#include <string>
 
 
 namespace lvr2
@@ -116,6 +120,16 @@ namespace lvr2
         // Threshold for fusing line segments while tesselating.
         float lineFusionThreshold = 0.01;
 
+        // Number of partitions that are reconstructed at once (0 = one per 4 threads).
+        uint parallelPartitions = 0;
+
+        // Estimated memory in MB that partitions reconstructed at once may use (0 = unlimited).
+        size_t partitionMemoryBudget = 8192;
+
+        // Directory of the BigGrid. An existing grid in it is reused and only scan positions
+        // that it does not contain yet are added. If empty, a temporary directory is used per run.
+        std::string gridDirectory = "";
+
         vector<float> getFlipPoint() const
         {
             std::vector<float> dest = flipPoint;
@@ -149,7 +163,9 @@ namespace lvr2
                 uint nodeSize, int partMethod,int ki, int kd, int kn, bool useRansac, std::vector<float> flipPoint,
                 bool extrude, int removeDanglingArtifacts, int cleanContours, int fillHoles, bool optimizePlanes,
                 float getNormalThreshold, int planeIterations, int minPlaneSize, int smallRegionThreshold,
-                bool retesselate, float lineFusionThreshold, bool bigMesh, bool debugChunks, bool useGPU);
+                bool retesselate, float lineFusionThreshold, bool bigMesh, bool debugChunks, bool useGPU,
+                uint parallelPartitions = 0, size_t partitionMemoryBudget = 8192,
+                std::string gridDirectory = "");
 
         /**
          * Constructor with parameters in a struct
@@ -192,6 +208,34 @@ namespace lvr2
 
     private:
 
+        /**
+         * Builds or reopens the BigGrid of the given project.
+         *
+         * Without a grid directory, the grid is built in a new directory that is
+         * removed when the returned grid is released. Otherwise an existing grid in
+         * the directory is reopened if it was built with the same voxel size and
+         * scale, and the scan positions it does not contain yet are appended.
+         * Positions are identified by their index within the project. The indices
+         * and bounding boxes of the stored positions are kept in positions.ls next
+         * to the grid header.
+         *
+         * @param project ScanProject containing Scans
+         * @param partialBB set to the bounding box of the changed scan positions
+         * @return the grid
+         */
+        std::shared_ptr<BigGrid<BaseVecT>> openGrid(ScanProjectEditMarkPtr project, BoundingBox<BaseVecT>& partialBB);
+
+        /**
+         * Reads the stored scan positions of a grid, see \ref openGrid.
+         * @return false if the file does not exist or cannot be parsed
+         */
+        bool readGridPositions(const std::string& path, std::map<size_t, BoundingBox<BaseVecT>>& positions);
+
+        /**
+         * Writes the stored scan positions of a grid, see \ref openGrid.
+         */
+        void writeGridPositions(const std::string& path, const std::map<size_t, BoundingBox<BaseVecT>>& positions);
+
         /**
          * This method adds the tsdf-values of one chunk to the ChunkManager-Layer
          *
@@ -288,6 +332,19 @@ namespace lvr2
         // Threshold for fusing line segments while tesselating. Default: 0.01
         float m_lineFusionThreshold;
 
+        // Number of partitions that are reconstructed at once (0 = one per 4 threads). Default: 0
+        uint m_parallelPartitions;
+
+        // Estimated memory in MB that partitions reconstructed at once may use (0 = unlimited). Default: 8192
+        size_t m_partitionMemoryBudget;
+
+        // Directory of the BigGrid, a temporary directory per run if empty. Default: ""
+        std::string m_gridDirectory;
+
+        // Rough estimate of the memory needed per point of a partition (points,
+        // normals, search tree and tsdf grid)
+        static constexpr size_t PARTITION_BYTES_PER_POINT = 512;
+
 
     };
 } // namespace lvr2
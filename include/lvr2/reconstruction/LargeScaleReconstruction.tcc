@@ -26,6 +26,11 @@
  */
 
 #include <iostream>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
 #include "lvr2/types/ScanTypes.hpp"
 #include "lvr2/io/hdf5/HDF5FeatureBase.hpp"
 #include "lvr2/io/hdf5/ChannelIO.hpp"
@@ -39,6 +44,7 @@
 #include "lvr2/reconstruction/PointsetGrid.hpp"
 #include "lvr2/reconstruction/FastBox.hpp"
 #include "lvr2/reconstruction/FastReconstruction.hpp"
+#include "lvr2/reconstruction/PartitionScheduler.hpp"
 #include "lvr2/registration/OctreeReduction.hpp"
 
 #include "lvr2/algorithm/CleanupAlgorithms.hpp"
@@ -78,7 +84,8 @@ namespace lvr2
     : m_voxelSizes(std::vector<float>{0.1}), m_bgVoxelSize(1), m_scale(1),m_nodeSize(1000000), m_partMethod(1),
     m_ki(20), m_kd(25), m_kn(20), m_useRansac(false), m_flipPoint(std::vector<float>{10000000, 10000000, 10000000}), m_extrude(false), m_removeDanglingArtifacts(0), m_cleanContours(0),
     m_fillHoles(0), m_optimizePlanes(false), m_planeNormalThreshold(0.85), m_planeIterations(3), m_minPlaneSize(7), m_smallRegionThreshold(0),
-    m_retesselate(false), m_lineFusionThreshold(0.01)
+    m_retesselate(false), m_lineFusionThreshold(0.01), m_parallelPartitions(0), m_partitionMemoryBudget(8192),
+    m_gridDirectory("")
     {
         std::cout << "Reconstruction Instance generated..." << std::endl;
     }
@@ -93,7 +100,9 @@ namespace lvr2
                                                                  float planeNormalThreshold, int planeIterations,
                                                                  int minPlaneSize, int smallRegionThreshold,
                                                                  bool retesselate, float lineFusionThreshold,
-                                                                 bool bigMesh, bool debugChunks, bool useGPU)
+                                                                 bool bigMesh, bool debugChunks, bool useGPU,
+                                                                 uint parallelPartitions, size_t partitionMemoryBudget,
+                                                                 std::string gridDirectory)
             : m_voxelSizes(voxelSizes), m_bgVoxelSize(bgVoxelSize),
               m_scale(scale),m_nodeSize(nodeSize),
               m_partMethod(partMethod), m_ki(ki), m_kd(kd), m_kn(kn), m_useRansac(useRansac),
@@ -101,7 +110,9 @@ namespace lvr2
               m_cleanContours(cleanContours), m_fillHoles(fillHoles), m_optimizePlanes(optimizePlanes),
               m_planeNormalThreshold(planeNormalThreshold), m_planeIterations(planeIterations),
               m_minPlaneSize(minPlaneSize), m_smallRegionThreshold(smallRegionThreshold),
-              m_retesselate(retesselate), m_lineFusionThreshold(lineFusionThreshold),m_bigMesh(bigMesh), m_debugChunks(debugChunks), m_useGPU(useGPU)
+              m_retesselate(retesselate), m_lineFusionThreshold(lineFusionThreshold),m_bigMesh(bigMesh), m_debugChunks(debugChunks), m_useGPU(useGPU),
+              m_parallelPartitions(parallelPartitions), m_partitionMemoryBudget(partitionMemoryBudget),
+              m_gridDirectory(gridDirectory)
     {
         std::cout << "Reconstruction Instance generated..." << std::endl;
     }
@@ -115,10 +126,169 @@ namespace lvr2
               options.cleanContours, options.fillHoles, options.optimizePlanes,
               options.planeNormalThreshold, options.planeIterations,
               options.minPlaneSize, options.smallRegionThreshold,
-              options.retesselate, options.lineFusionThreshold, options.bigMesh, options.debugChunks, options.useGPU)
+              options.retesselate, options.lineFusionThreshold, options.bigMesh, options.debugChunks, options.useGPU,
+              options.parallelPartitions, options.partitionMemoryBudget, options.gridDirectory)
     {
     }
 
+    template <typename BaseVecT>
+    std::shared_ptr<BigGrid<BaseVecT>> LargeScaleReconstruction<BaseVecT>::openGrid(ScanProjectEditMarkPtr project,
+                                                                                    BoundingBox<BaseVecT>& partialBB)
+    {
+        namespace fs = boost::filesystem;
+
+        // Without a grid directory, the grid is only kept for this run
+        if (m_gridDirectory.empty())
+        {
+            fs::path directory = fs::unique_path("bigGrid-%%%%-%%%%-%%%%");
+            cout << lvr2::timestamp << "Building BigGrid in " << directory.string() << endl;
+            auto removeGrid = [directory](BigGrid<BaseVecT>* grid)
+            {
+                delete grid;
+                boost::system::error_code ec;
+                fs::remove_all(directory, ec);
+            };
+
+            std::shared_ptr<BigGrid<BaseVecT>> grid;
+            try
+            {
+                grid = std::shared_ptr<BigGrid<BaseVecT>>(
+                    new BigGrid<BaseVecT>(m_bgVoxelSize, project, m_scale, directory.string()), removeGrid);
+            }
+            catch (...)
+            {
+                boost::system::error_code ec;
+                fs::remove_all(directory, ec);
+                throw;
+            }
+            partialBB = grid->getpartialBB();
+            return grid;
+        }
+
+        fs::path directory(m_gridDirectory);
+        std::string header = (directory / "serinfo.ls").string();
+        std::string record = (directory / "positions.ls").string();
+
+        std::shared_ptr<BigGrid<BaseVecT>> grid;
+        std::map<size_t, BoundingBox<BaseVecT>> stored;
+        if (fs::exists(header) && readGridPositions(record, stored))
+        {
+            try
+            {
+                grid = std::make_shared<BigGrid<BaseVecT>>(directory.string());
+            }
+            catch (std::exception& e)
+            {
+                cout << lvr2::timestamp << e.what() << endl;
+                cout << lvr2::timestamp << "BigGrid in " << directory.string()
+                     << " cannot be reused and is rebuilt" << endl;
+                stored.clear();
+            }
+            if (grid && (grid->getVoxelSize() != m_bgVoxelSize || grid->getScale() != m_scale))
+            {
+                cout << lvr2::timestamp << "BigGrid in " << directory.string()
+                     << " was built with a different voxel size or scale and is rebuilt" << endl;
+                grid.reset();
+                stored.clear();
+            }
+        }
+        else if (fs::exists(header))
+        {
+            cout << lvr2::timestamp << "BigGrid in " << directory.string()
+                 << " has no list of stored scan positions and is rebuilt" << endl;
+        }
+
+        // The list is restored once the grid is complete again, so an
+        // interrupted run leads to a rebuild instead of a corrupt grid
+        fs::remove(record);
+
+        if (grid)
+        {
+            ScanProjectEditMarkPtr missing(new ScanProjectEditMark);
+            missing->project = project->project;
+            size_t numMissing = 0;
+            for (size_t i = 0; i < project->project->positions.size(); i++)
+            {
+                missing->changed.push_back(stored.find(i) == stored.end());
+                numMissing += missing->changed.back();
+            }
+
+            cout << lvr2::timestamp << "Reusing BigGrid in " << directory.string() << ", adding "
+                 << numMissing << " scan positions" << endl;
+            if (numMissing)
+            {
+                grid->append(missing);
+            }
+        }
+        else
+        {
+            cout << lvr2::timestamp << "Building BigGrid in " << directory.string() << endl;
+            grid = std::make_shared<BigGrid<BaseVecT>>(m_bgVoxelSize, project, m_scale, directory.string());
+        }
+
+        const std::vector<BoundingBox<BaseVecT>>& added = grid->getAddedPositionBoxes();
+        for (size_t i = 0; i < added.size(); i++)
+        {
+            if (added[i].isValid())
+            {
+                stored[i] = added[i];
+            }
+        }
+
+        grid->serialize();
+        writeGridPositions(record, stored);
+
+        partialBB = BoundingBox<BaseVecT>();
+        for (size_t i = 0; i < project->changed.size(); i++)
+        {
+            auto it = stored.find(i);
+            if (project->changed[i] && it != stored.end())
+            {
+                partialBB.expand(it->second);
+            }
+        }
+        return grid;
+    }
+
+    template <typename BaseVecT>
+    bool LargeScaleReconstruction<BaseVecT>::readGridPositions(const std::string& path,
+                                                               std::map<size_t, BoundingBox<BaseVecT>>& positions)
+    {
+        // One line per position: index min.x min.y min.z max.x max.y max.z
+        std::ifstream in(path);
+        if (!in.good())
+        {
+            return false;
+        }
+
+        size_t index;
+        float minX, minY, minZ, maxX, maxY, maxZ;
+        while (in >> index >> minX >> minY >> minZ >> maxX >> maxY >> maxZ)
+        {
+            positions[index] = BoundingBox<BaseVecT>(BaseVecT(minX, minY, minZ), BaseVecT(maxX, maxY, maxZ));
+        }
+        return in.eof();
+    }
+
+    template <typename BaseVecT>
+    void LargeScaleReconstruction<BaseVecT>::writeGridPositions(const std::string& path,
+                                                                const std::map<size_t, BoundingBox<BaseVecT>>& positions)
+    {
+        std::ofstream out(path);
+        out.precision(std::numeric_limits<float>::max_digits10);
+        for (auto& position : positions)
+        {
+            const BaseVecT& min = position.second.getMin();
+            const BaseVecT& max = position.second.getMax();
+            out << position.first << " " << min.x << " " << min.y << " " << min.z << " "
+                << max.x << " " << max.y << " " << max.z << endl;
+        }
+        if (!out.good())
+        {
+            throw std::runtime_error("LargeScaleReconstruction: Unable to write " + path);
+        }
+    }
+
 
     template<typename BaseVecT>
     int LargeScaleReconstruction<BaseVecT>::mpiAndReconstruct(ScanProjectEditMarkPtr project){
@@ -130,7 +300,9 @@ namespace lvr2
         }
 
         cout << lvr2::timestamp << "Starting BigGrid" << endl;
-        BigGrid<BaseVecT> bg( m_bgVoxelSize ,project, m_scale);
+        BoundingBox<BaseVecT> partbb;
+        std::shared_ptr<BigGrid<BaseVecT>> grid = openGrid(project, partbb);
+        BigGrid<BaseVecT>& bg = *grid;
         cout << lvr2::timestamp << "BigGrid finished " << endl;
 
         BoundingBox<BaseVecT> bb = bg.getBB();
@@ -376,7 +548,9 @@ namespace lvr2
         }
 
         cout << lvr2::timestamp << "Starting BigGrid" << endl;
-        BigGrid<BaseVecT> bg( m_bgVoxelSize ,project, m_scale);
+        BoundingBox<BaseVecT> partbb;
+        std::shared_ptr<BigGrid<BaseVecT>> grid = openGrid(project, partbb);
+        BigGrid<BaseVecT>& bg = *grid;
         cout << lvr2::timestamp << "BigGrid finished " << endl;
 
         BoundingBox<BaseVecT> bb = bg.getBB();
@@ -388,11 +562,10 @@ namespace lvr2
 
 
 
-        BoundingBox<BaseVecT> partbb = bg.getpartialBB();
         cout << lvr2::timestamp << "generating VGrid" << endl;
 
         VirtualGrid<BaseVecT> vGrid(
-                    bg.getpartialBB(), m_chunkSize, m_bgVoxelSize);
+                    partbb, m_chunkSize, m_bgVoxelSize);
         vGrid.calculateBoxes();
         partitionBoxes = vGrid.getBoxes();
         BaseVecT addMin = BaseVecT(std::floor(partbb.getMin().x / m_chunkSize) * m_chunkSize, std::floor(partbb.getMin().y / m_chunkSize) * m_chunkSize, std::floor(partbb.getMin().z / m_chunkSize) * m_chunkSize);
@@ -431,43 +604,49 @@ namespace lvr2
             string layerName = "tsdf_values_" + std::to_string(m_voxelSizes[h]);
             //create chunks
 
+            using PartitionGrid = lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>;
+            float overlap = m_voxelSizes[h] * 3;
+
+            // Estimated memory of each partition
+            std::vector<size_t> costs(partitionBoxes->size());
             for (int i = 0; i < partitionBoxes->size(); i++)
             {
-                string name_id;
-                name_id =
-                        std::to_string(
-                                    (int)floor(partitionBoxes->at(i).getCentroid().x / m_chunkSize)) +
-                                    "_" +std::to_string(
-                                    (int)floor(partitionBoxes->at(i).getCentroid().y / m_chunkSize)) +
-                            "_" + std::to_string((int)floor(partitionBoxes->at(i).getCentroid().z / m_chunkSize));
-
+                BaseVecT min = partitionBoxes->at(i).getMin();
+                BaseVecT max = partitionBoxes->at(i).getMax();
+                size_t numPoints = bg.getSizeofBox(min.x - overlap, min.y - overlap, min.z - overlap,
+                                                   max.x + overlap, max.y + overlap, max.z + overlap);
+                costs[i] = numPoints * PARTITION_BYTES_PER_POINT;
+            }
 
+            // Computes the tsdf values of a partition, nullptr if it has too few points
+            auto reconstructPartition = [&](size_t i, int numThreads) -> std::shared_ptr<PartitionGrid>
+            {
                 size_t numPoints;
 
-                floatArr points = bg.points(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMin().y - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMin().z - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().x + m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().y + m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().z + m_voxelSizes[h] *3,
+                floatArr points = bg.points(partitionBoxes->at(i).getMin().x - overlap,
+                                            partitionBoxes->at(i).getMin().y - overlap,
+                                            partitionBoxes->at(i).getMin().z - overlap,
+                                            partitionBoxes->at(i).getMax().x + overlap,
+                                            partitionBoxes->at(i).getMax().y + overlap,
+                                            partitionBoxes->at(i).getMax().z + overlap,
                                             numPoints);
 
                 // remove chunks with less than 50 points
                 if (numPoints <= 50)
                 {
-                    partitionBoxesSkipped++;
-                    continue;
+                    return nullptr;
                 }
 
-                BaseVecT gridbb_min(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] *3,
-                                    partitionBoxes->at(i).getMin().y - m_voxelSizes[h] *3,
-                                    partitionBoxes->at(i).getMin().z - m_voxelSizes[h] *3);
-                BaseVecT gridbb_max(partitionBoxes->at(i).getMax().x + m_voxelSizes[h] *3,
-                                    partitionBoxes->at(i).getMax().y + m_voxelSizes[h] *3,
-                                    partitionBoxes->at(i).getMax().z + m_voxelSizes[h] *3);
+                BaseVecT gridbb_min(partitionBoxes->at(i).getMin().x - overlap,
+                                    partitionBoxes->at(i).getMin().y - overlap,
+                                    partitionBoxes->at(i).getMin().z - overlap);
+                BaseVecT gridbb_max(partitionBoxes->at(i).getMax().x + overlap,
+                                    partitionBoxes->at(i).getMax().y + overlap,
+                                    partitionBoxes->at(i).getMax().z + overlap);
                 BoundingBox<BaseVecT> gridbb(gridbb_min, gridbb_max);
 
-                cout << "\n" <<  lvr2::timestamp <<"grid: " << i << "/" << partitionBoxes->size() - 1 << endl;
+                cout << "\n" <<  lvr2::timestamp <<"grid: " << i << "/" << partitionBoxes->size() - 1
+                     << " (" << numThreads << " threads)" << endl;
 
                 lvr2::PointBufferPtr p_loader(new lvr2::PointBuffer);
                 p_loader->setPointArray(points, numPoints);
@@ -475,12 +654,12 @@ namespace lvr2
                 if (bg.hasNormals())
                 {
                     size_t numNormals;
-                    lvr2::floatArr normals = bg.normals(partitionBoxes->at(i).getMin().x -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMin().y -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMin().z -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().x +m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().y +m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().z +m_voxelSizes[h] *3,
+                    lvr2::floatArr normals = bg.normals(partitionBoxes->at(i).getMin().x - overlap,
+                                                        partitionBoxes->at(i).getMin().y - overlap,
+                                                        partitionBoxes->at(i).getMin().z - overlap,
+                                                        partitionBoxes->at(i).getMax().x + overlap,
+                                                        partitionBoxes->at(i).getMax().y + overlap,
+                                                        partitionBoxes->at(i).getMax().z + overlap,
                                                         numNormals);
 
                     p_loader->setNormalArray(normals, numNormals);
@@ -540,17 +719,33 @@ namespace lvr2
                     }
                 }
 
-
-
-                auto ps_grid = std::make_shared<lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>>(
+                // All partitions of a layer share the voxel size, so setting
+                // the static FastBox voxel size concurrently is harmless
+                auto ps_grid = std::make_shared<PartitionGrid>(
                         m_voxelSizes[h], surface, gridbb, true, m_extrude);
 
                 ps_grid->setBB(gridbb);
                 ps_grid->calcIndices();
                 ps_grid->calcDistanceValues();
+                return ps_grid;
+            };
 
+            // Adds the partitions to the chunk manager in their original order
+            auto commitPartition = [&](size_t i, std::shared_ptr<PartitionGrid>& ps_grid)
+            {
+                if (!ps_grid)
+                {
+                    partitionBoxesSkipped++;
+                    return;
+                }
 
-
+                string name_id;
+                name_id =
+                        std::to_string(
+                                    (int)floor(partitionBoxes->at(i).getCentroid().x / m_chunkSize)) +
+                                    "_" +std::to_string(
+                                    (int)floor(partitionBoxes->at(i).getCentroid().y / m_chunkSize)) +
+                            "_" + std::to_string((int)floor(partitionBoxes->at(i).getCentroid().z / m_chunkSize));
 
                 unsigned long timeStart = lvr2::timestamp.getCurrentTimeInMs();
                 int x = (int)floor(partitionBoxes->at(i).getCentroid().x / m_chunkSize);
@@ -584,8 +779,12 @@ namespace lvr2
                         ModelFactory::saveModel(m, name_id + ".ply");
                     }
                 }
+            };
 
-            }
+            // The GPU normal estimation can only serve one partition at a time
+            PartitionScheduler<std::shared_ptr<PartitionGrid>> scheduler(
+                    m_useGPU ? 1 : m_parallelPartitions, m_partitionMemoryBudget << 20);
+            scheduler.run(costs, reconstructPartition, commitPartition);
             std::cout << lvr2::timestamp << "Skipped PartitionBoxes: " << partitionBoxesSkipped << std::endl;
 
             cout << "ChunkManagerIO Time: " <<(double) (timeSum / 1000.0) << " s" << endl;
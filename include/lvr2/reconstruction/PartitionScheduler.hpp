@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PartitionScheduler.hpp
+ */
+
+#ifndef _LVR2_RECONSTRUCTION_PARTITIONSCHEDULER_H_
+#define _LVR2_RECONSTRUCTION_PARTITIONSCHEDULER_H_
+
+#include <boost/thread.hpp>
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Processes independent partitions of a reconstruction concurrently
+ *        on a single node.
+ *
+ * Partitions are started largest-first to avoid a long tail. The OpenMP
+ * threads are split between the partitions that run at the same time, so
+ * the partitions started last get more threads each. A partition is only
+ * started while the estimated memory of all started, uncommitted partitions
+ * stays within a budget. The budget is not a hard limit: if nothing else is
+ * running, the next partition in index order is started even if it does not
+ * fit, so a single oversized partition exceeds the budget. The results are
+ * committed on the calling thread in index order, so the output is identical
+ * to processing the partitions one after another.
+ */
+template<typename ResultT>
+class PartitionScheduler
+{
+public:
+
+    /// Computes the result of a partition with the given number of OpenMP threads
+    using ComputeFunc = std::function<ResultT(size_t index, int numThreads)>;
+
+    /// Consumes the result of a partition
+    using CommitFunc = std::function<void(size_t index, ResultT& result)>;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param maxPartitions Maximum number of partitions that are processed at
+     *                      once. 0 selects one partition per 4 OpenMP threads.
+     * @param memoryBudget  Budget for the estimated memory (in bytes) of all
+     *                      started partitions whose results are not committed
+     *                      yet. 0 disables the limit. A partition that
+     *                      exceeds the budget is still processed once no
+     *                      other partition is running, so the budget may be
+     *                      exceeded by that partition.
+     */
+    PartitionScheduler(size_t maxPartitions = 0, size_t memoryBudget = 0);
+
+    /**
+     * @brief Processes all partitions.
+     *
+     * @param costs     Estimated memory of each partition in bytes. Also used
+     *                  as work estimate for the processing order.
+     * @param compute   Called concurrently from worker threads. The OpenMP
+     *                  thread count of the calling thread is already set.
+     * @param commit    Called on the calling thread in index order.
+     */
+    void run(const std::vector<size_t>& costs, ComputeFunc compute, CommitFunc commit);
+
+private:
+
+    /**
+     * @brief Picks the next partition to start. Has to be called with the
+     *        lock held.
+     *
+     * @return The index of the partition or -1 if none can be started now.
+     */
+    long nextPartition();
+
+    /**
+     * @brief Computes partitions until all are started.
+     */
+    void work();
+
+    size_t m_maxPartitions;
+    size_t m_memoryBudget;
+
+    // Total number of OpenMP threads
+    int m_numThreads;
+
+    size_t m_numWorkers;
+
+    const std::vector<size_t>* m_costs;
+    ComputeFunc m_compute;
+
+    // Partition indices sorted by decreasing cost
+    std::vector<size_t> m_order;
+
+    std::vector<bool> m_started;
+    std::vector<bool> m_finished;
+    std::vector<std::unique_ptr<ResultT>> m_results;
+
+    // Number of partitions in m_order that have been started
+    size_t m_numStarted;
+
+    // Number of partitions that are computed right now
+    size_t m_numActive;
+
+    // Number of committed partitions, they are committed in index order
+    size_t m_numCommitted;
+
+    // Estimated memory of all started, uncommitted partitions
+    size_t m_memoryInUse;
+
+    // First exception thrown by a worker
+    std::exception_ptr m_error;
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_condition;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/PartitionScheduler.tcc"
+
+#endif /* _LVR2_RECONSTRUCTION_PARTITIONSCHEDULER_H_ */
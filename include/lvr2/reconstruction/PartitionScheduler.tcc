@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PartitionScheduler.tcc
+ */
+
+#include "lvr2/config/lvropenmp.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace lvr2
+{
+
+template<typename ResultT>
+PartitionScheduler<ResultT>::PartitionScheduler(size_t maxPartitions, size_t memoryBudget)
+    : m_maxPartitions(maxPartitions), m_memoryBudget(memoryBudget), m_numThreads(1),
+      m_numWorkers(1), m_costs(nullptr), m_numStarted(0), m_numActive(0), m_numCommitted(0), m_memoryInUse(0)
+{
+}
+
+template<typename ResultT>
+void PartitionScheduler<ResultT>::run(const std::vector<size_t>& costs, ComputeFunc compute, CommitFunc commit)
+{
+    size_t numPartitions = costs.size();
+    m_costs = &costs;
+    m_compute = compute;
+    m_numThreads = std::max(1, OpenMPConfig::getNumThreads());
+
+    m_order.resize(numPartitions);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::stable_sort(m_order.begin(), m_order.end(),
+                     [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    m_started.assign(numPartitions, false);
+    m_finished.assign(numPartitions, false);
+    m_results.clear();
+    m_results.resize(numPartitions);
+    m_numStarted = 0;
+    m_numActive = 0;
+    m_numCommitted = 0;
+    m_memoryInUse = 0;
+    m_error = nullptr;
+
+    m_numWorkers = m_maxPartitions ? m_maxPartitions : std::max(1, m_numThreads / 4);
+    m_numWorkers = std::max<size_t>(1, std::min(m_numWorkers, numPartitions));
+
+    boost::thread_group workers;
+    for (size_t i = 0; i < m_numWorkers; i++)
+    {
+        workers.create_thread(boost::bind(&PartitionScheduler<ResultT>::work, this));
+    }
+
+    for (size_t i = 0; i < numPartitions; i++)
+    {
+        std::unique_ptr<ResultT> result;
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            while (!m_finished[i] && !m_error)
+            {
+                m_condition.wait(lock);
+            }
+            if (m_error)
+            {
+                break;
+            }
+            result = std::move(m_results[i]);
+        }
+
+        // The workers use this scheduler until they are joined, so an error
+        // while committing stops them like a failed partition does
+        try
+        {
+            commit(i, *result);
+        }
+        catch (...)
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+            break;
+        }
+        result.reset();
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_memoryInUse -= costs[i];
+        m_numCommitted++;
+        m_condition.notify_all();
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        if (m_error)
+        {
+            // Let the workers run out without starting new partitions
+            m_numStarted = numPartitions;
+            std::fill(m_started.begin(), m_started.end(), true);
+            m_condition.notify_all();
+        }
+    }
+    workers.join_all();
+
+    if (m_error)
+    {
+        std::rethrow_exception(m_error);
+    }
+}
+
+template<typename ResultT>
+long PartitionScheduler<ResultT>::nextPartition()
+{
+    // Largest remaining partition that fits into the budget
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        size_t index = m_order[i];
+        if (!m_started[index] &&
+            (!m_memoryBudget || m_memoryInUse + (*m_costs)[index] <= m_memoryBudget))
+        {
+            return index;
+        }
+    }
+
+    // Nothing fits. If all partitions before the first unstarted one are
+    // committed, the memory is held by results that wait for it. Start it
+    // regardless of the budget, so that these results can be committed.
+    if (m_numActive == 0 && m_numCommitted < m_started.size() && !m_started[m_numCommitted])
+    {
+        return m_numCommitted;
+    }
+    return -1;
+}
+
+template<typename ResultT>
+void PartitionScheduler<ResultT>::work()
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while (m_numStarted < m_order.size())
+    {
+        long index = nextPartition();
+        if (index < 0)
+        {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        m_started[index] = true;
+        m_numStarted++;
+        m_numActive++;
+        m_memoryInUse += (*m_costs)[index];
+
+        // Share the threads between the partitions that can still run at the
+        // same time, so the last partitions get more threads each
+        size_t concurrent = std::min(m_numWorkers, m_numActive + m_order.size() - m_numStarted);
+        int numThreads = std::max<int>(1, m_numThreads / (int)concurrent);
+        lock.unlock();
+
+        std::unique_ptr<ResultT> result;
+        try
+        {
+            OpenMPConfig::setNumThreads(numThreads);
+            result.reset(new ResultT(m_compute(index, numThreads)));
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+            m_numActive--;
+            m_condition.notify_all();
+            return;
+        }
+
+        lock.lock();
+        m_results[index] = std::move(result);
+        m_finished[index] = true;
+        m_numActive--;
+        m_condition.notify_all();
+    }
+}
+
+} // namespace lvr2
@@ -32,6 +32,10 @@
  *      Author: twiemann
  */
 
+#include "lvr2/config/lvropenmp.hpp"
+
+#include <unordered_set>
+
 namespace lvr2
 {
 
@@ -56,13 +60,38 @@ PointsetGrid<BaseVecT, BoxT>::PointsetGrid(
 
     FloatChannel pts = *(m_surface->pointBuffer()->getFloatChannel("points"));
 
-    // Iterator over all points, calc lattice indices and add lattice points to the grid
-    for(size_t i = 0; i < numPoint; i++)
+    // Calc the lattice indices of all points in parallel. Points that hit an
+    // already visited cell do not change the grid, so every chunk only keeps
+    // the first point of each cell. The chunks are contiguous, hence their
+    // concatenation visits the cells in the same order as a serial loop.
+    int numChunks = OpenMPConfig::getNumThreads();
+    vector<vector<std::array<int, 3>>> chunkIndices(numChunks);
+
+    #pragma omp parallel for schedule(static, 1)
+    for(int t = 0; t < numChunks; t++)
     {
-        BaseVecT pt = pts[i];
-        auto index = (pt - v_min) / this->m_voxelsize;
-        this->addLatticePoint(calcIndex(index.x), calcIndex(index.y), calcIndex(index.z));
+        std::unordered_set<size_t> visited;
+        for(size_t i = numPoint * t / numChunks; i < numPoint * (t + 1) / numChunks; i++)
+        {
+            BaseVecT pt = pts[i];
+            auto index = (pt - v_min) / this->m_voxelsize;
+            std::array<int, 3> cell = {calcIndex(index.x), calcIndex(index.y), calcIndex(index.z)};
+            if(visited.insert(this->hashValue(cell[0], cell[1], cell[2])).second)
+            {
+                chunkIndices[t].push_back(cell);
+            }
+        }
     }
+
+    vector<std::array<int, 3>> indices;
+    for(auto& chunk : chunkIndices)
+    {
+        indices.insert(indices.end(), chunk.begin(), chunk.end());
+        vector<std::array<int, 3>>().swap(chunk);
+    }
+
+    // Add lattice points to the grid
+    this->addLatticePoints(indices);
 }
 
 
@@ -96,6 +96,30 @@ public:
         std::vector<size_t>& indices
     ) const;
 
+    /**
+     * @brief Performs a k-next-neighbor search for many query points at
+     *        once. The queries are distributed over all OpenMP threads.
+     *
+     * The neighbours of query point `i` are stored at the positions
+     * `i * k` to `i * k + k - 1` of the given arrays. The data set has to
+     * contain at least `k` points.
+     *
+     * @param query       Array of `n` query points.
+     * @param n           The number of query points.
+     * @param k           The number of neighbours that should be searched.
+     * @param indices     Preallocated array of `n * k` indices for the
+     *                    neighbours within the dataset.
+     * @param distances   Preallocated array of `n * k` distances for the
+     *                    neighbours that are found.
+     */
+    virtual void kSearchMany(
+        const BaseVecT* query,
+        size_t n,
+        int k,
+        size_t* indices,
+        CoordT* distances
+    ) const;
+
     // /**
     //  * @brief Set the number of neighbours used to estimate and interpolate normals.
     //  */
@@ -35,6 +35,7 @@
 
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -53,6 +54,34 @@ int SearchTree<BaseVecT>::kSearch(
     return this->kSearch(qp, neighbours, indices, distances);
 }
 
+template<typename BaseVecT>
+void SearchTree<BaseVecT>::kSearchMany(
+    const BaseVecT* query,
+    size_t n,
+    int k,
+    size_t* indices,
+    CoordT* distances
+) const
+{
+    #pragma omp parallel
+    {
+        // Reuse the result buffers for all queries of this thread
+        std::vector<size_t> id;
+        std::vector<CoordT> di;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < n; i++)
+        {
+            id.clear();
+            di.clear();
+            this->kSearch(query[i], k, id, di);
+
+            std::copy(id.begin(), id.begin() + std::min<size_t>(id.size(), k), indices + i * k);
+            std::copy(di.begin(), di.begin() + std::min<size_t>(di.size(), k), distances + i * k);
+        }
+    }
+}
+
 // template<typename BaseVecT>
 // void SearchTree<BaseVecT>::setKi(int ki)
 // {
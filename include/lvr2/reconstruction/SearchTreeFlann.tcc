@@ -37,10 +37,7 @@
 #include "lvr2/io/Timestamp.hpp"
 
 #include "lvr2/util/Panic.hpp"
-
-#ifndef __APPLE__
-#include <omp.h>
-#endif
+#include "lvr2/config/lvropenmp.hpp"
 
 using std::make_unique;
 
@@ -105,16 +102,21 @@ void SearchTreeFlann<BaseVecT>::radiusSearch(
 template<typename BaseVecT>
 void SearchTreeFlann<BaseVecT>::kSearchMany(
     const BaseVecT* query,
-    int n,
+    size_t n,
     int k,
     size_t* indices,
     CoordT* distances
 ) const
 {
+    if (n == 0)
+    {
+        return;
+    }
+
     CoordT* queries = new CoordT[n * 3];
     flann::Matrix<CoordT> queries_mat(queries, n, 3);
-    flann::Matrix<size_t> indices_mat(indices, n, 1);
-    flann::Matrix<CoordT> distances_mat(distances, n, 1);
+    flann::Matrix<size_t> indices_mat(indices, n, k);
+    flann::Matrix<CoordT> distances_mat(distances, n, k);
 
     #pragma omp parallel for
     for (size_t i = 0; i < n; i++)
@@ -124,13 +126,10 @@ void SearchTreeFlann<BaseVecT>::kSearchMany(
         queries_mat[i][2] = query[i].z;
     }
 
+    // FLANN distributes the queries over the given number of threads
     flann::SearchParams params;
-    #ifndef __APPLE__
-    params.cores = omp_get_max_threads();
-    #else
-    params.cores = 4;
-    #endif
-    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, 1, params);
+    params.cores = OpenMPConfig::getNumThreads();
+    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, k, params);
 
     delete[] queries;
 }
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * DynamicVertexGrid.hpp
+ */
+
+#ifndef LAS_VEGAS_DYNAMICVERTEXGRID_HPP
+#define LAS_VEGAS_DYNAMICVERTEXGRID_HPP
+
+#include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/geometry/Handles.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Nearest vertex index for meshes whose vertices move, appear and disappear.
+ *
+ * Vertices are hashed into a uniform grid. Inserting, removing and moving a vertex is O(1).
+ * A nearest neighbor query searches the cells around the query point in growing shells, so it
+ * only touches the neighborhood of the result. The cell size is halved whenever the cells get
+ * too crowded as the mesh grows.
+ */
+template <typename BaseVecT>
+class DynamicVertexGrid
+{
+  public:
+    /**
+     * @brief Creates an empty grid
+     *
+     * @param boundingBox   region the vertices are expected in, used for the initial cell size
+     */
+    explicit DynamicVertexGrid(const BoundingBox<BaseVecT>& boundingBox);
+
+    /**
+     * @brief Adds a vertex
+     */
+    void insert(VertexHandle vH, const BaseVecT& position);
+
+    /**
+     * @brief Removes a vertex, does nothing if the vertex is not in the grid
+     */
+    void remove(VertexHandle vH);
+
+    /**
+     * @brief Updates the position of a vertex
+     */
+    void update(VertexHandle vH, const BaseVecT& position);
+
+    /**
+     * @brief Returns true if the vertex is in the grid
+     */
+    bool contains(VertexHandle vH) const;
+
+    /**
+     * @brief Returns the vertex closest to the given point, none if the grid is empty
+     */
+    OptionalVertexHandle findNearest(const BaseVecT& point) const;
+
+    /**
+     * @brief Number of vertices in the grid
+     */
+    size_t size() const { return m_size; }
+
+  private:
+    struct Entry
+    {
+        Index vH;
+        BaseVecT position;
+    };
+
+    struct Slot
+    {
+        uint64_t cell;
+        size_t index;
+        bool valid = false;
+    };
+
+    /// Maximum average number of vertices per occupied cell before the cells are split
+    static constexpr size_t MAX_CELL_OCCUPANCY = 8;
+
+    /// Bits per axis in a cell key
+    static constexpr int KEY_BITS = 21;
+
+    uint64_t cellKey(const BaseVecT& position) const;
+
+    uint64_t cellKey(int64_t i, int64_t j, int64_t k) const;
+
+    void cellIndex(const BaseVecT& position, int64_t& i, int64_t& j, int64_t& k) const;
+
+    void add(Index vH, const BaseVecT& position, uint64_t key);
+
+    /// Searches all vertices in the given cell
+    void searchCell(uint64_t key, const BaseVecT& point, Index& best, float& bestDistance) const;
+
+    /// Halves the cell size until the cells are small enough for the current number of vertices
+    void refine();
+
+    /// Grid cells with the vertices they contain
+    std::unordered_map<uint64_t, std::vector<Entry>> m_cells;
+
+    /// Location of each vertex in m_cells, indexed by vertex handle
+    std::vector<Slot> m_slots;
+
+    /// Origin of the cell indices
+    BaseVecT m_origin;
+
+    /// Edge length of a cell
+    float m_cellSize;
+
+    /// Number of vertices in the grid
+    size_t m_size;
+
+    /// Number of vertices at which the cell occupancy is checked next
+    size_t m_refineAt;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/gs2/DynamicVertexGrid.tcc"
+
+#endif // LAS_VEGAS_DYNAMICVERTEXGRID_HPP
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * DynamicVertexGrid.tcc
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lvr2
+{
+
+template <typename BaseVecT>
+DynamicVertexGrid<BaseVecT>::DynamicVertexGrid(const BoundingBox<BaseVecT>& boundingBox)
+    : m_origin(boundingBox.getCentroid()), m_size(0), m_refineAt(0)
+{
+    float longestSide = std::max({boundingBox.getXSize(), boundingBox.getYSize(), boundingBox.getZSize()});
+    m_cellSize = longestSide > 0 ? longestSide / 4 : 1.0f;
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::cellIndex(const BaseVecT& position, int64_t& i, int64_t& j, int64_t& k) const
+{
+    // cell indices are shifted to be positive and clamped to the key range
+    const int64_t center = int64_t(1) << (KEY_BITS - 1);
+    const int64_t maxIndex = (int64_t(1) << KEY_BITS) - 1;
+    auto index = [&](float coord, float origin)
+    {
+        int64_t idx = static_cast<int64_t>(std::floor((coord - origin) / m_cellSize)) + center;
+        return std::min(std::max(idx, int64_t(0)), maxIndex);
+    };
+    i = index(position.x, m_origin.x);
+    j = index(position.y, m_origin.y);
+    k = index(position.z, m_origin.z);
+}
+
+template <typename BaseVecT>
+uint64_t DynamicVertexGrid<BaseVecT>::cellKey(int64_t i, int64_t j, int64_t k) const
+{
+    return (static_cast<uint64_t>(i) << (2 * KEY_BITS)) | (static_cast<uint64_t>(j) << KEY_BITS) | static_cast<uint64_t>(k);
+}
+
+template <typename BaseVecT>
+uint64_t DynamicVertexGrid<BaseVecT>::cellKey(const BaseVecT& position) const
+{
+    int64_t i, j, k;
+    cellIndex(position, i, j, k);
+    return cellKey(i, j, k);
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::add(Index vH, const BaseVecT& position, uint64_t key)
+{
+    std::vector<Entry>& cell = m_cells[key];
+    cell.push_back({vH, position});
+
+    Slot& slot = m_slots[vH];
+    slot.cell = key;
+    slot.index = cell.size() - 1;
+    slot.valid = true;
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::insert(VertexHandle vH, const BaseVecT& position)
+{
+    if (contains(vH))
+    {
+        update(vH, position);
+        return;
+    }
+
+    if (vH.idx() >= m_slots.size())
+    {
+        m_slots.resize(std::max<size_t>(vH.idx() + 1, m_slots.size() * 2));
+    }
+
+    add(vH.idx(), position, cellKey(position));
+    m_size++;
+
+    if (m_size >= m_refineAt && m_size > MAX_CELL_OCCUPANCY * m_cells.size())
+    {
+        refine();
+    }
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::remove(VertexHandle vH)
+{
+    if (!contains(vH))
+    {
+        return;
+    }
+
+    Slot& slot = m_slots[vH.idx()];
+    auto cellIt = m_cells.find(slot.cell);
+    std::vector<Entry>& cell = cellIt->second;
+
+    // move the last entry of the cell into the gap
+    if (slot.index != cell.size() - 1)
+    {
+        cell[slot.index] = cell.back();
+        m_slots[cell[slot.index].vH].index = slot.index;
+    }
+    cell.pop_back();
+    if (cell.empty())
+    {
+        m_cells.erase(cellIt);
+    }
+
+    slot.valid = false;
+    m_size--;
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::update(VertexHandle vH, const BaseVecT& position)
+{
+    if (!contains(vH))
+    {
+        insert(vH, position);
+        return;
+    }
+
+    const Slot& slot = m_slots[vH.idx()];
+    uint64_t key = cellKey(position);
+    if (key == slot.cell)
+    {
+        m_cells[key][slot.index].position = position;
+    }
+    else
+    {
+        remove(vH);
+        add(vH.idx(), position, key);
+        m_size++;
+    }
+}
+
+template <typename BaseVecT>
+bool DynamicVertexGrid<BaseVecT>::contains(VertexHandle vH) const
+{
+    return vH.idx() < m_slots.size() && m_slots[vH.idx()].valid;
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::searchCell(uint64_t key, const BaseVecT& point, Index& best, float& bestDistance) const
+{
+    auto cellIt = m_cells.find(key);
+    if (cellIt == m_cells.end())
+    {
+        return;
+    }
+
+    for (const Entry& entry : cellIt->second)
+    {
+        float distance = (point - entry.position).length2();
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = entry.vH;
+        }
+    }
+}
+
+template <typename BaseVecT>
+OptionalVertexHandle DynamicVertexGrid<BaseVecT>::findNearest(const BaseVecT& point) const
+{
+    if (m_size == 0)
+    {
+        return OptionalVertexHandle();
+    }
+
+    int64_t ci, cj, ck;
+    cellIndex(point, ci, cj, ck);
+
+    const int64_t maxIndex = (int64_t(1) << KEY_BITS) - 1;
+    auto inRange = [maxIndex](int64_t idx) { return idx >= 0 && idx <= maxIndex; };
+
+    Index best = 0;
+    float bestDistance = std::numeric_limits<float>::infinity();
+
+    for (int64_t r = 0; ; r++)
+    {
+        // once the search cube covers more cells than are occupied, scanning them all is cheaper
+        const int64_t width = 2 * r + 1;
+        if (static_cast<size_t>(width * width * width) > m_cells.size())
+        {
+            for (const auto& cell : m_cells)
+            {
+                searchCell(cell.first, point, best, bestDistance);
+            }
+            break;
+        }
+
+        // visit all cells with Chebyshev distance r to the cell of the query point
+        for (int64_t di = -r; di <= r; di++)
+        {
+            for (int64_t dj = -r; dj <= r; dj++)
+            {
+                const bool onShell = std::abs(di) == r || std::abs(dj) == r;
+                const int64_t step = onShell ? 1 : std::max<int64_t>(2 * r, 1);
+                for (int64_t dk = -r; dk <= r; dk += step)
+                {
+                    if (inRange(ci + di) && inRange(cj + dj) && inRange(ck + dk))
+                    {
+                        searchCell(cellKey(ci + di, cj + dj, ck + dk), point, best, bestDistance);
+                    }
+                }
+            }
+        }
+
+        // vertices in cells further out are at least r cells away from the query point
+        const float shellDistance = r * m_cellSize;
+        if (bestDistance <= shellDistance * shellDistance)
+        {
+            break;
+        }
+    }
+
+    return OptionalVertexHandle(VertexHandle(best));
+}
+
+template <typename BaseVecT>
+void DynamicVertexGrid<BaseVecT>::refine()
+{
+    while (m_size > MAX_CELL_OCCUPANCY * m_cells.size())
+    {
+        std::vector<Entry> entries;
+        entries.reserve(m_size);
+        for (const auto& cell : m_cells)
+        {
+            entries.insert(entries.end(), cell.second.begin(), cell.second.end());
+        }
+
+        const size_t numCells = m_cells.size();
+        m_cellSize /= 2;
+        m_cells.clear();
+        for (const Entry& entry : entries)
+        {
+            add(entry.vH, entry.position, cellKey(entry.position));
+        }
+
+        // many vertices at the same position, smaller cells do not help
+        if (m_cells.size() == numCells)
+        {
+            m_refineAt = 2 * m_size;
+            return;
+        }
+    }
+}
+
+} // namespace lvr2
@@ -9,7 +9,7 @@
 #include "lvr2/config/BaseOption.hpp"
 #include "lvr2/geometry/HalfEdgeMesh.hpp"
 #include "lvr2/reconstruction/PointsetSurface.hpp"
-#include "lvr2/reconstruction/gs2/DynamicKDTree.hpp"
+#include "lvr2/reconstruction/gs2/DynamicVertexGrid.hpp"
 #include "lvr2/reconstruction/gs2/TumbleTree.hpp"
 
 namespace lvr2
@@ -58,6 +58,8 @@ class GrowingCellStructure
 
     bool isInterior() const { return m_interior; }
 
+    bool isUseVertexGrid() const { return m_useVertexGrid; }
+
     void setRuntime(int m_runtime) { GrowingCellStructure::m_runtime = m_runtime; }
 
     void setBasicSteps(int m_basicSteps) { GrowingCellStructure::m_basicSteps = m_basicSteps; }
@@ -104,6 +106,11 @@ class GrowingCellStructure
 
     void setNumBalances(int m_balances) { GrowingCellStructure::m_balances = m_balances; }
 
+    void setUseVertexGrid(bool m_useVertexGrid)
+    {
+        GrowingCellStructure::m_useVertexGrid = m_useVertexGrid;
+    }
+
   private:
     PointsetSurfacePtr<BaseVecT>* m_surface; // helper-surface
     HalfEdgeMesh<BaseVecT>* m_mesh;
@@ -123,7 +130,8 @@ class GrowingCellStructure
 
     // "GCS" related members
     TumbleTree* tumble_tree;
-    DynamicKDTree<BaseVecT>* kd_tree;
+    DynamicVertexGrid<BaseVecT>* vertex_grid; // index for the winner search, kept in sync with the mesh
+    bool m_useVertexGrid = true; // false: search the winner by a linear scan over all vertices
     std::vector<Cell*> cellArr; // TODO: OUTSOURCE IT INTO THE TUMBLETREE CLASS, NEW PARAMETER FOR
                                 // THE TUMBLE TREE CONSTRUCTOR
                                 // CONTAINING THE MAXMIMUM SIZE OF THE MESH
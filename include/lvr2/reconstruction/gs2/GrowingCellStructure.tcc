@@ -27,7 +27,7 @@ namespace lvr2 {
         m_surface = &surface;
         m_mesh = 0;
         tumble_tree = new TumbleTree(); //create tumble tree
-        kd_tree = new DynamicKDTree<BaseVecT>(3); // create 3-dimensional kd-tree for distance evaluation
+        vertex_grid = NULL;
     }
 
     /**
@@ -49,12 +49,19 @@ namespace lvr2 {
 
         //initTestMesh(); //init a mesh used for vertex split and edge split testing
 
+        //create the index for the winner search
+        vertex_grid = new DynamicVertexGrid<BaseVecT>(m_surface->get()->getBoundingBox());
+
         //get initial tetrahedron mesh
         getInitialMesh();
 
-        //progress bar
-        size_t runtime_length = (size_t)((((size_t)m_runtime*(size_t)m_numSplits)
-                                          *(((size_t)m_numSplits*(size_t)m_runtime)+1)/(size_t)2) * (size_t)m_basicSteps);
+        //progress bar, the linear winner search advances it once per visited vertex
+        size_t runtime_length = (size_t)m_runtime * (size_t)m_numSplits * (size_t)m_basicSteps;
+        if(!m_useVertexGrid)
+        {
+            runtime_length = (size_t)((((size_t)m_runtime*(size_t)m_numSplits)
+                                       *(((size_t)m_numSplits*(size_t)m_runtime)+1)/(size_t)2) * (size_t)m_basicSteps);
+        }
         PacmanProgressBar progress_bar(runtime_length);
 
         //algorithm
@@ -109,7 +116,7 @@ namespace lvr2 {
         cout << "Max depth of tt: " << (m_balances != 0 ? max_depth : tumble_tree->maxDepth()) << endl;
         cout << "Not Deleted in TT: " << tumble_tree->notDeleted << endl;
         cout << "Tumble Tree size: " << tumble_tree->size() << endl;
-        cout << "KD-Tree size: " << kd_tree->size() << endl;
+        cout << "Vertex grid size: " << vertex_grid->size() << endl;
         cout << "Cell array size: " << cellVecSize() << endl;
         cout << "Not found counter: " << notFoundCounter << endl;
         cout << endl;
@@ -120,6 +127,8 @@ namespace lvr2 {
         cout << "Valances >= 10: " << numVertexValences(10) << endl;
         cout << "Valances >= 15: " << numVertexValences(15) << endl;
         delete tumble_tree;
+        delete vertex_grid;
+        vertex_grid = NULL;
     }
 
 
@@ -141,15 +150,12 @@ namespace lvr2 {
         //cout << "basic step" << endl;
         if(!m_useGSS) //if only gcs is used (gcs basic step)
         {
-            VertexHandle winnerH = this->getClosestPointInMesh(random_point, progress_bar); //TODO: better runtime efficency(kd-tree)
-            /*Index winnerIndex = kd_tree->findNearest(random_point);
-            VertexHandle winnerH(winnerIndex);*/
+            VertexHandle winnerH = this->getClosestPointInMesh(random_point, progress_bar);
 
             //smooth the winning vertex
             BaseVecT &winner = m_mesh->getVertexPosition(winnerH);
-            //kd_tree->deleteNode(winner);
             winner += (random_point - winner) * getLearningRate();
-            //kd_tree->insert(winner, winnerH);
+            vertex_grid->update(winnerH, winner);
 
             //smooth the winning vertices' neighbors (laplacian smoothing)
 
@@ -160,12 +166,11 @@ namespace lvr2 {
             for(auto v : neighborsOfWinner)
             {
                 BaseVecT& nb = m_mesh->getVertexPosition(v);
-                //kd_tree->deleteNode(nb);
 
                 nb += (random_point - winner) * getNeighborLearningRate();
                 if(m_mesh->numVertices() > 100) performLaplacianSmoothing(v, random_point, getNeighborLearningRate());
 
-                //kd_tree->insert(nb, v);
+                vertex_grid->update(v, nb);
             }
 
 
@@ -240,8 +245,7 @@ namespace lvr2 {
             cellArr[newVH.idx()] = tumble_tree->insert(actual_sc / 2, newVH);
 
 
-            /*BaseVecT kdInsert = m_mesh->getVertexPosition(newVH);
-            kd_tree->insert(kdInsert, newVH);*/
+            vertex_grid->insert(newVH, m_mesh->getVertexPosition(newVH));
 
         }
         else //GSS TODO: INCLUDE GSS ADDITIONS
@@ -342,11 +346,11 @@ namespace lvr2 {
 
                     if(eToSixVal && m_mesh->isCollapsable(eToSixVal.unwrap()))
                     {
-                        //TODO: use collapse result to remove the (vertex) from the tumble tree and the kd tree
-                        //otherwise this wont work
                         EdgeCollapseResult result = m_mesh->collapseEdge(eToSixVal.unwrap());
                         tumble_tree->remove(cellArr[result.removedPoint.idx()], result.removedPoint);
                         cellArr[result.removedPoint.idx()] = NULL;
+                        vertex_grid->remove(result.removedPoint);
+                        vertex_grid->update(result.midPoint, m_mesh->getVertexPosition(result.midPoint));
                         std::cout << "Collapsed an Edge!" << endl;
                     }
                 }
@@ -391,7 +395,7 @@ namespace lvr2 {
 
     /**
      * Gets the closest point to the given point using the euclidean distance
-     * runtime: O(n) //TODO: make it better. kd-tree? KD-TREE IMPLEMENTATION IN GS2 NOT GOOD.
+     * runtime: O(1) on average using the vertex grid, O(n) with the linear scan
      *
      * @tparam BaseVecT
      * @tparam NormalT
@@ -402,6 +406,12 @@ namespace lvr2 {
     template <typename BaseVecT, typename NormalT>
     VertexHandle GrowingCellStructure<BaseVecT, NormalT>::getClosestPointInMesh(BaseVecT point, PacmanProgressBar& progress_bar)
     {
+        if(m_useVertexGrid)
+        {
+            ++progress_bar;
+            return vertex_grid->findNearest(point).unwrap();
+        }
+
         //search the closest point of the mesh
         auto vertices = m_mesh->vertices();
 
@@ -599,10 +609,10 @@ namespace lvr2 {
             cellArr[vH3.idx()] = tumble_tree->insert(1, vH3);
             cellArr[vH4.idx()] = tumble_tree->insert(1, vH4);
 
-            kd_tree->insert(top, vH1);
-            kd_tree->insert(left, vH2);
-            kd_tree->insert(right, vH3);
-            kd_tree->insert(back, vH4);
+            vertex_grid->insert(vH1, top);
+            vertex_grid->insert(vH2, left);
+            vertex_grid->insert(vH3, right);
+            vertex_grid->insert(vH4, back);
         }
     }
 
@@ -747,10 +757,29 @@ namespace lvr2 {
         cout << "Aggressive Cutout..." << endl;
         auto faces = m_mesh->getFacesOfVertex(vH);
         tumble_tree->remove(cellArr[vH.idx()], vH);
+
+        vector<VertexHandle> affected;
+        for(auto face : faces)
+        {
+            for(auto vertex : m_mesh->getVerticesOfFace(face))
+            {
+                affected.push_back(vertex);
+            }
+        }
+
         for(auto face : faces)
         {
             m_mesh->removeFace(face);
         }
+
+        //vertices without faces are removed from the mesh
+        for(auto vertex : affected)
+        {
+            if(!m_mesh->containsVertex(vertex))
+            {
+                vertex_grid->remove(vertex);
+            }
+        }
     }
 
     /**
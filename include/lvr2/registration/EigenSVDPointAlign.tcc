@@ -53,7 +53,8 @@ T EigenSVDPointAlign<T, PointT>::alignPoints(
     // Fill H matrix
     Mat3 H = Matrix3d::Zero();
 
-    for (size_t i = 0; i < scan->numPoints(); i++)
+    const std::vector<Vector3d>& points = scan->points();
+    for (size_t i = 0; i < points.size(); i++)
     {
         if (neighbors[i] == nullptr)
         {
@@ -61,7 +62,7 @@ T EigenSVDPointAlign<T, PointT>::alignPoints(
         }
 
         Vec3 m = neighbors[i]->template cast<T>() - centroid_m;
-        Vec3 d = scan->point(i).template cast<T>() - centroid_d;
+        Vec3 d = points[i].template cast<T>() - centroid_d;
 
         error += (m - d).squaredNorm();
         pairs++;
@@ -40,6 +40,7 @@
 
 #include <memory>
 #include <limits>
+#include <vector>
 #include <boost/shared_array.hpp>
 
 namespace lvr2
@@ -59,11 +60,38 @@ public:
     /**
      * @brief Creates a new KDTree from the given Scan.
      *
+     * @param scan          The Scan to use the global Points of
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     */
+    static std::shared_ptr<KDTree> create(SLAMScanPtr scan, int maxLeafSize = 20);
+
+    /**
+     * @brief Creates a new KDTree from the given Points.
+     *
      * @param points        The Point Cloud
      * @param n             The number of points in 'points'
      * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
      */
-    static std::shared_ptr<KDTree> create(SLAMScanPtr scan, int maxLeafSize = 20);
+    static std::shared_ptr<KDTree> create(const Vector3d* points, size_t n, int maxLeafSize = 20);
+
+    /**
+     * @brief Adds more Points to the Tree without rebuilding it from scratch.
+     *
+     * The Tree is kept as a list of independent sub-trees whose sizes at least halve from one
+     * to the next. New Points form a new sub-tree that is merged with all trailing sub-trees
+     * that are not larger than itself, so every Point is only rebuilt O(log n) times.
+     *
+     * Invalidates all Neighbors returned so far.
+     *
+     * @param points        The Points to add
+     * @param n             The number of points in 'points'
+     */
+    void extend(const Vector3d* points, size_t n);
+
+    /**
+     * @brief Returns the number of Points in the Tree
+     */
+    size_t numPoints() const;
 
     /**
      * @brief Finds the nearest neighbor of 'point' that is within 'maxDistance' (defaults to infinity).
@@ -86,13 +114,15 @@ public:
     {
         neighbor = nullptr;
         distance = maxDistance;
-        nnInternal(point.template cast<PointT>(), neighbor, distance);
+        Point p = point.template cast<PointT>();
+        for (const Block& block : blocks)
+        {
+            nnInternal(block, 0, p, neighbor, distance);
+        }
 
         return neighbor != nullptr;
     }
 
-    virtual ~KDTree() = default;
-
     /**
      * @brief Finds the nearest neighbors of all points in a Scan using a pre-generated KDTree
      *
@@ -125,11 +155,48 @@ protected:
     KDTree() = default;
     KDTree(const KDTree&&) = delete;
 
-    virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const = 0;
+    /**
+     * @brief A Node of the Tree.
+     *
+     * Inner Nodes store the split plane and the index of their "lesser" child. The
+     * "greater" child is always stored directly behind it. Leaves store a range of
+     * 'points', so the points of every Leaf are contiguous in memory.
+     */
+    struct Node
+    {
+        /// The split value of an inner Node
+        float split;
+        /// The split axis of an inner Node or -1 for Leaves
+        int axis;
+        /// The index of the "lesser" child or the index of the first point of a Leaf
+        unsigned int first;
+        /// The number of points in a Leaf
+        unsigned int count;
+    };
+
+    /**
+     * @brief An independent sub-tree, see extend()
+     */
+    struct Block
+    {
+        /// All Nodes in breadth-first order. The root is nodes[0].
+        std::vector<Node> nodes;
+
+        boost::shared_array<Point> points;
+        size_t numPoints;
+    };
+
+    /**
+     * @brief Builds the Nodes of a Block over 'points', reordering them in the process
+     */
+    static void buildBlock(Block& block, int maxLeafSize);
+
+    void nnInternal(const Block& block, unsigned int node, const Point& point, Neighbor& neighbor, double& maxDist) const;
 
-    friend class KDNode;
+    /// The sub-trees, ordered by decreasing size
+    std::vector<Block> blocks;
 
-    boost::shared_array<Point> points;
+    int maxLeafSize;
 };
 
 using KDTreePtr = std::shared_ptr<KDTree>;
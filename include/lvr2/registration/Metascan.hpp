@@ -35,6 +35,7 @@
 #define METASCAN_HPP_
 
 #include "SLAMScanWrapper.hpp"
+#include "KDTree.hpp"
 
 namespace lvr2
 {
@@ -43,6 +44,9 @@ namespace lvr2
  * @brief Represents several Scans as part of a single Scan
  * 
  * Note that most methods of Scan don't make sense on a Metascan, like reductions or Pose getters.
+ *
+ * The global Points of all Scans are kept in one contiguous buffer that is appended to when a
+ * Scan is added. Only the parts of Scans that were transformed since the last access are recomputed.
  */
 class Metascan : public SLAMScanWrapper
 {
@@ -53,11 +57,41 @@ public:
 
     virtual void transform(const Transformd& transform, bool writeFrame = true, FrameUse use = FrameUse::UPDATED) override;
     virtual Vector3d point(size_t index) const override;
+    virtual const std::vector<Vector3d>& points() const override;
 
     void addScan(SLAMScanPtr scan);
 
+    /**
+     * @brief Returns a KDTree over points() that is kept alive between calls.
+     *
+     * Scans added since the last call are inserted with KDTree::extend(). The Tree is only
+     * rebuilt if one of the contained Scans was transformed in the meantime.
+     *
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     * @return KDTreePtr the Tree
+     */
+    KDTreePtr searchTree(int maxLeafSize);
+
 protected:
+    /**
+     * @brief Brings m_globalPoints up to date. Expects m_globalMutex to be locked.
+     *
+     * @return bool true if the Points of an already contained Scan changed
+     */
+    bool updatePoints() const;
+
     std::vector<SLAMScanPtr> m_scans;
+
+    /// m_offsets[i] is the index of the first Point of m_scans[i]. Has m_scans.size() + 1 entries
+    std::vector<size_t>      m_offsets;
+
+    /// The Pose of every Scan when its part of m_globalPoints was computed
+    mutable std::vector<Transformd> m_scanPoses;
+
+    KDTreePtr                m_searchTree;
+    int                      m_treeLeafSize;
+    /// The number of Scans contained in m_searchTree
+    size_t                   m_treeScans;
 };
 
 } /* namespace lvr2 */
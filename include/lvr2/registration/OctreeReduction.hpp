@@ -63,17 +63,26 @@ private:
     template<typename T>
     size_t splitPoints(T* points, const size_t& n, const int axis, const double& splitValue);
 
-    template<typename T>
-    void createOctree(lvr2::PointBufferPtr& points, size_t s, size_t n, bool* flagged, const lvr2::Vector3<T>& min, const lvr2::Vector3<T>& max, const int& level);
-
-    template<typename T>
-    size_t splitPoints(lvr2::PointBufferPtr& points, size_t s, size_t n, const int axis, const double& splitValue);
-
-    template<typename T>
-    void swapAllChannelsOfType(lvr2::PointBufferPtr& points, const size_t& l, const size_t& r);
-
-    template<typename T>
-    void swapInChannel(lvr2::Channel<T>& ch, const size_t& l, const size_t& r);
+    /**
+     * @brief Flags all points of a channel that are not kept, without reordering them.
+     *
+     * Every point gets the key of its octree voxel (see voxelKey) in parallel. Sorting an
+     * index permutation by these keys groups the points of each voxel, and voxels with more
+     * than m_minPointsPerVoxel points only keep the point closest to their center.
+     */
+    void reducePoints(const lvr2::Channel<float>& points, const Vector3f& min, const Vector3f& max);
+
+    /**
+     * @brief Returns the key of the octree voxel that contains the given point.
+     *
+     * The box from min to max is split at its center along x, y and z in turn, until it
+     * is not larger than the voxel size along the next split axis. Every split appends one
+     * bit to the key, behind a leading 1, so points share a key if and only if they lie in
+     * the same voxel. At most 63 splits are done.
+     *
+     * @param center    Set to the center of the voxel
+     */
+    uint64_t voxelKey(const Vector3f& point, Vector3f min, Vector3f max, Vector3f& center) const;
 
     double  m_voxelSize;
     size_t  m_minPointsPerVoxel;
@@ -37,6 +37,7 @@
 #include "lvr2/types/ScanTypes.hpp"
 
 #include <Eigen/Dense>
+#include <mutex>
 #include <vector>
 
 namespace lvr2
@@ -141,6 +142,17 @@ public:
      */
     virtual Vector3d point(size_t index) const;
 
+    /**
+     * @brief Returns all Points in global Coordinates as one contiguous array
+     *
+     * points()[i] is equal to point(i). The array is cached and only recomputed when the
+     * Pose or the Points changed since the last call, so hot loops should use this instead
+     * of calling point(i) for every Point.
+     *
+     * @return const std::vector<Vector3d>& the Points in global Coordinates
+     */
+    virtual const std::vector<Vector3d>& points() const;
+
     /**
      * @brief Returns the Point at the specified index in local Coordinates
      * 
@@ -216,6 +228,17 @@ protected:
     Transformd            m_deltaPose;
 
     std::vector<std::pair<Transformd, FrameUse>> m_frames;
+
+    /**
+     * @brief Transforms 'n' local Points into global Coordinates using 'pose'
+     */
+    static void transformPoints(const Vector3f* in, size_t n, const Transformd& pose, Vector3d* out);
+
+    /// Cache for points(). Only valid if m_globalPose equals pose() and m_globalValid is set
+    mutable std::vector<Vector3d> m_globalPoints;
+    mutable Transformd            m_globalPose;
+    mutable bool                  m_globalValid;
+    mutable std::mutex            m_globalMutex;
 };
 
 using SLAMScanPtr = std::shared_ptr<SLAMScanWrapper>;
@@ -37,7 +37,7 @@
 namespace lvr2
 {
 ChunkHashGrid::ChunkHashGrid(std::string hdf5Path, size_t cacheSize, float chunkSize)
-    : m_cacheSize(cacheSize)
+    : m_cacheSize(cacheSize), m_cacheBytes(0), m_usedBytes(0), m_prefetchGeneration(0), m_stopPrefetch(false)
 {
     m_io.open(hdf5Path);
 
@@ -56,15 +56,32 @@ ChunkHashGrid::ChunkHashGrid(std::string hdf5Path,
                              size_t cacheSize,
                              BoundingBox<BaseVector<float>> boundingBox,
                              float chunkSize)
-    : m_cacheSize(cacheSize)
+    : m_cacheSize(cacheSize), m_cacheBytes(0), m_usedBytes(0), m_prefetchGeneration(0), m_stopPrefetch(false)
 {
     m_io.open(hdf5Path);
     setChunkSize(chunkSize);
     setBoundingBox(boundingBox);
 }
 
+ChunkHashGrid::~ChunkHashGrid()
+{
+    {
+        boost::mutex::scoped_lock lock(m_prefetchMutex);
+        m_stopPrefetch = true;
+        m_prefetchQueue.clear();
+    }
+    m_prefetchCondition.notify_all();
+
+    if (m_prefetchThread.joinable())
+    {
+        m_prefetchThread.join();
+    }
+}
+
 bool ChunkHashGrid::isChunkLoaded(std::string layer, std::size_t hashValue)
 {
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
     auto layerIt = m_hashGrid.find(layer);
     if (layerIt != m_hashGrid.end())
     {
@@ -79,51 +96,42 @@ bool ChunkHashGrid::isChunkLoaded(std::string layer, std::size_t hashValue)
 
 bool ChunkHashGrid::isChunkLoaded(std::string layer, int x, int y, int z)
 {
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
     return isChunkLoaded(layer, hashValue(x, y, z));
 }
 
-void ChunkHashGrid::rehashCache(const BaseVector<std::size_t>& oldChunkAmount,
-                                const BaseVector<std::size_t>& oldChunkIndexOffset)
+bool ChunkHashGrid::chunkExists(std::string layer, int x, int y, int z)
 {
-    std::unordered_map<std::string, std::unordered_map<std::size_t, val_type>> tmpCache;
-    for (std::pair<std::string, std::size_t>& elem : m_items)
+    if (isChunkLoaded(layer, x, y, z))
     {
-        // undo old hash function
-        int k = elem.second % oldChunkAmount.z - oldChunkIndexOffset.z;
-        int j = (elem.second / oldChunkAmount.z) % oldChunkAmount.y - oldChunkIndexOffset.y;
-        int i = elem.second / (oldChunkAmount.y * oldChunkAmount.z) - oldChunkIndexOffset.x;
-
-        val_type chunk;
+        return true;
+    }
 
-        auto layerIt = tmpCache.find(elem.first);
-        if (layerIt != tmpCache.end())
-        {
-            auto chunkIt = tmpCache[elem.first].find(elem.second);
-            if (chunkIt != tmpCache[elem.first].end())
-            {
-                chunk = tmpCache[elem.first][elem.second];
-            }
-            else
-            {
-                chunk = m_hashGrid[elem.first][elem.second];
-            }
-        }
-        else
-        {
-            chunk = m_hashGrid[elem.first][elem.second];
-        }
+    boost::mutex::scoped_lock ioLock(m_ioMutex);
+    return m_io.chunkExists(layer, x, y, z);
+}
 
-        std::size_t newHash = hashValue(i, j, k);
+void ChunkHashGrid::setCacheMemory(size_t bytes)
+{
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+    m_cacheBytes = bytes;
+    evictChunks();
+}
 
-        auto chunkIt = m_hashGrid[elem.first].find(newHash);
-        if (chunkIt != m_hashGrid[elem.first].end())
-        {
-            tmpCache[elem.first][newHash] = m_hashGrid[elem.first][newHash];
-        }
-        m_hashGrid[elem.first][newHash] = chunk;
-        m_hashGrid[elem.first].erase(elem.second);
+size_t ChunkHashGrid::getCacheMemoryUsage()
+{
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+    return m_usedBytes;
+}
 
-        elem.second = newHash;
+void ChunkHashGrid::rehashCache()
+{
+    // the cache entries keep their chunk coordinates, so the index can simply be rebuilt
+    m_hashGrid.clear();
+    for (auto it = m_items.begin(); it != m_items.end(); ++it)
+    {
+        it->hash = hashValue(it->x, it->y, it->z);
+        m_hashGrid[it->layer][it->hash] = it;
     }
 }
 
@@ -132,6 +140,8 @@ void ChunkHashGrid::expandBoundingBox(const val_type& data)
     FloatChannelOptional geometryChannel = boost::apply_visitor(ChunkGeomtryChannelVisitor(), data);
     if (geometryChannel)
     {
+        boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
         BoundingBox<BaseVector<float>> boundingBox = m_boundingBox;
         for (unsigned int i = 0; i < geometryChannel.get().numElements(); i++)
         {
@@ -144,33 +154,124 @@ void ChunkHashGrid::expandBoundingBox(const val_type& data)
 
 void ChunkHashGrid::loadChunk(std::string layer, int x, int y, int z, const val_type& data)
 {
-    std::size_t chunkHash = hashValue(x, y, z);
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
 
-    if (isChunkLoaded(layer, chunkHash))
+    auto& layerGrid = m_hashGrid[layer];
+    auto chunkIt = layerGrid.find(hashValue(x, y, z));
+    if (chunkIt != layerGrid.end())
+    {
+        // chunk exists for layer in grid, replace its data and move it to the front
+        size_t bytes = boost::apply_visitor(ChunkMemoryVisitor(), data);
+        entry_list::iterator entry = chunkIt->second;
+        m_usedBytes = m_usedBytes - entry->bytes + bytes;
+        entry->data = data;
+        entry->bytes = bytes;
+        m_items.splice(m_items.begin(), m_items, entry);
+        evictChunks();
+    }
+    else
     {
-        // chunk exists for layer in grid
-        // remove chunk from cache to put the chunk to front of lru cache later
-        m_items.remove({layer, chunkHash});
+        // add new chunk to cache
+        insertChunk(layer, x, y, z, data, m_items.begin());
     }
+}
 
-    // add new chunk to cache
-    m_items.push_front({layer, chunkHash});
+void ChunkHashGrid::insertChunk(const std::string& layer, int x, int y, int z,
+                                const val_type& data, entry_list::iterator position)
+{
+    std::size_t chunkHash = hashValue(x, y, z);
+    size_t bytes = boost::apply_visitor(ChunkMemoryVisitor(), data);
+
+    m_hashGrid[layer][chunkHash] = m_items.insert(position, {layer, x, y, z, chunkHash, data, bytes});
+    m_usedBytes += bytes;
+
+    evictChunks();
+}
 
-    // check if cache is full
-    if (m_items.size() > m_cacheSize)
+void ChunkHashGrid::evictChunks()
+{
+    while (m_items.size() > 1
+           && (m_items.size() > m_cacheSize || (m_cacheBytes && m_usedBytes > m_cacheBytes)))
     {
         // remove chunk from grid keep the grid for the current layer even if it holds no elements
-        m_hashGrid[m_items.back().first].erase(m_items.back().second);
+        const CacheEntry& entry = m_items.back();
+        m_hashGrid[entry.layer].erase(entry.hash);
+        m_usedBytes -= entry.bytes;
 
         // remove erased element from cache
         m_items.pop_back();
     }
+}
+
+void ChunkHashGrid::setPrefetchQueue(std::deque<boost::function<bool()>> requests)
+{
+    {
+        boost::recursive_mutex::scoped_lock cacheLock(m_cacheMutex);
+        m_lastPrefetched = boost::none;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(m_prefetchMutex);
+        m_prefetchQueue = std::move(requests);
+        m_prefetchGeneration++;
+
+        if (!m_prefetchThread.joinable())
+        {
+            m_prefetchThread = boost::thread(&ChunkHashGrid::prefetchWorker, this);
+        }
+    }
+    m_prefetchCondition.notify_one();
+}
+
+void ChunkHashGrid::prefetchWorker()
+{
+    while (true)
+    {
+        boost::function<bool()> request;
+        size_t generation;
+        {
+            boost::mutex::scoped_lock lock(m_prefetchMutex);
+            while (m_prefetchQueue.empty() && !m_stopPrefetch)
+            {
+                m_prefetchCondition.wait(lock);
+            }
 
-    m_hashGrid[layer][chunkHash] = data;
+            if (m_stopPrefetch)
+            {
+                return;
+            }
+
+            request    = m_prefetchQueue.front();
+            generation = m_prefetchGeneration;
+            m_prefetchQueue.pop_front();
+        }
+
+        bool proceed = true;
+        try
+        {
+            proceed = request();
+        }
+        catch (...)
+        {
+            // a chunk that cannot be prefetched is reported when it is requested with getChunk
+        }
+
+        if (!proceed)
+        {
+            // drop the rest of this request, but keep requests that arrived in the meantime
+            boost::mutex::scoped_lock lock(m_prefetchMutex);
+            if (generation == m_prefetchGeneration)
+            {
+                m_prefetchQueue.clear();
+            }
+        }
+    }
 }
 
 void ChunkHashGrid::setBoundingBox(const BoundingBox<BaseVector<float>> boundingBox)
 {
+    boost::recursive_mutex::scoped_lock lock(m_cacheMutex);
+
     if (m_boundingBox.getMin() == boundingBox.getMin()
         && m_boundingBox.getMax() == boundingBox.getMax())
     {
@@ -178,7 +279,10 @@ void ChunkHashGrid::setBoundingBox(const BoundingBox<BaseVector<float>> bounding
     }
 
     m_boundingBox = boundingBox;
-    m_io.saveBoundingBox(m_boundingBox);
+    {
+        boost::mutex::scoped_lock ioLock(m_ioMutex);
+        m_io.saveBoundingBox(m_boundingBox);
+    }
 
     BaseVector<std::size_t> chunkIndexOffset;
     chunkIndexOffset.x
@@ -204,13 +308,10 @@ void ChunkHashGrid::setChunkAmountAndOffset(const BaseVector<std::size_t>& chunk
 {
     if (m_chunkAmount != chunkAmount || m_chunkIndexOffset != chunkIndexOffset)
     {
-        BaseVector<std::size_t> oldChunkAmount      = m_chunkAmount;
-        BaseVector<std::size_t> oldChunkIndexOffset = m_chunkIndexOffset;
-
         m_chunkAmount      = chunkAmount;
         m_chunkIndexOffset = chunkIndexOffset;
 
-        rehashCache(oldChunkAmount, oldChunkIndexOffset);
+        rehashCache();
     }
 }
 
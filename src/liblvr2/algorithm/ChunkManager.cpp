@@ -36,28 +36,284 @@
 
 #include "lvr2/algorithm/ChunkManager.hpp"
 
+#include "lvr2/algorithm/NormalAlgorithms.hpp"
+#include "lvr2/algorithm/ReductionAlgorithms.hpp"
+#include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/util/Panic.hpp"
 
 #include <algorithm>
+#include <array>
 #include <boost/filesystem.hpp>
 #include <cmath>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace
 {
-template <typename T>
-struct VectorCapsule
+/// Position of a vertex on a chunk border, used to find the same vertex in neighboring chunks
+using SeamVertex = std::array<float, 3>;
+
+struct SeamVertexHash
 {
-  private:
-    std::shared_ptr<std::vector<T>> arr_;
+    std::size_t operator()(const SeamVertex& v) const
+    {
+        std::size_t seed = 0;
+        for (float coord : v)
+        {
+            // adding 0 maps -0.0 to 0.0, so positions that compare equal also hash equal
+            seed ^= std::hash<float>()(coord + 0.0f) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+using ChunkMesh = lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>;
 
-  public:
-    explicit VectorCapsule(std::vector<T>&& arr)
-        : arr_(std::make_shared<std::vector<T>>(std::move(arr)))
+/**
+ * @brief builds a half-edge mesh of a mesh buffer
+ *
+ * The vertex handles are equal to the vertex indices of the buffer. Faces that can not be
+ * inserted (non-manifold input) are left out.
+ *
+ * @param buffer mesh buffer to convert
+ * @param faceIndices set to the index in the buffer of every face handle
+ */
+std::unique_ptr<ChunkMesh> buildChunkMesh(const lvr2::MeshBufferPtr& buffer,
+                                          std::vector<std::size_t>& faceIndices)
+{
+    std::unique_ptr<ChunkMesh> mesh(new ChunkMesh(buffer));
+    if (mesh->numFaces() == buffer->numFaces())
     {
+        faceIndices.resize(buffer->numFaces());
+        for (std::size_t i = 0; i < faceIndices.size(); i++)
+        {
+            faceIndices[i] = i;
+        }
+        return mesh;
     }
-    ~VectorCapsule() = default;
-    void operator()(void*) {}
+
+    // some faces were left out, insert them again one by one to know which
+    lvr2::floatArr vertices = buffer->getVertices();
+    lvr2::indexArray indices = buffer->getFaceIndices();
+    mesh.reset(new ChunkMesh());
+    for (std::size_t i = 0; i < buffer->numVertices(); i++)
+    {
+        mesh->addVertex(
+            lvr2::BaseVector<float>(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]));
+    }
+
+    faceIndices.clear();
+    for (std::size_t i = 0; i < buffer->numFaces(); i++)
+    {
+        try
+        {
+            lvr2::FaceHandle fH = mesh->addFace(lvr2::VertexHandle(indices[i * 3]),
+                                                lvr2::VertexHandle(indices[i * 3 + 1]),
+                                                lvr2::VertexHandle(indices[i * 3 + 2]));
+            if (fH.idx() >= faceIndices.size())
+            {
+                faceIndices.resize(fH.idx() + 1);
+            }
+            faceIndices[fH.idx()] = i;
+        }
+        catch (lvr2::PanicException exception)
+        {
+        }
+    }
+    return mesh;
+}
+
+/**
+ * @brief visitor that copies the given elements of a channel
+ */
+struct ChannelGatherer : public boost::static_visitor<lvr2::MultiChannelMap::val_type>
+{
+    explicit ChannelGatherer(const std::vector<std::size_t>& indices) : m_indices(indices) {}
+
+    template <typename T>
+    lvr2::MultiChannelMap::val_type operator()(const lvr2::Channel<T>& channel) const
+    {
+        const std::size_t width = channel.width();
+        boost::shared_array<T> data(new T[m_indices.size() * width]);
+        for (std::size_t i = 0; i < m_indices.size(); i++)
+        {
+            std::copy(channel.dataPtr().get() + m_indices[i] * width,
+                      channel.dataPtr().get() + (m_indices[i] + 1) * width,
+                      data.get() + i * width);
+        }
+        return lvr2::Channel<T>(m_indices.size(), width, data);
+    }
+
+    const std::vector<std::size_t>& m_indices;
 };
+
+/**
+ * @brief builds a chunk from a part of a reduced mesh
+ *
+ * Vertex and face channels of the source buffer are copied from the original elements, other
+ * channels are copied unchanged. Face normals and the vertex normals of vertices that are not
+ * fixed are recalculated, since the reduction moved them.
+ *
+ * @param source buffer the mesh was built from
+ * @param mesh the reduced mesh
+ * @param faceNormals normals of the faces of the reduced mesh
+ * @param faceIndices index in the source buffer of every face handle
+ * @param vertices vertices of the chunk, the border vertices first
+ * @param faces faces of the chunk
+ * @param fixed vertices that were not changed by the reduction
+ * @param numDuplicates number of border vertices
+ */
+lvr2::MeshBufferPtr buildChunk(const lvr2::MeshBufferPtr& source,
+                               const ChunkMesh& mesh,
+                               const lvr2::FaceMap<lvr2::Normal<float>>& faceNormals,
+                               const std::vector<std::size_t>& faceIndices,
+                               const std::vector<lvr2::VertexHandle>& vertices,
+                               const std::vector<lvr2::FaceHandle>& faces,
+                               const lvr2::VertexMap<bool>& fixed,
+                               unsigned int numDuplicates)
+{
+    std::vector<std::size_t> vertexSources(vertices.size());
+    std::vector<unsigned int> newIndices(mesh.nextVertexIndex());
+    lvr2::floatArr positions(new float[vertices.size() * 3]);
+    for (std::size_t i = 0; i < vertices.size(); i++)
+    {
+        vertexSources[i] = vertices[i].idx();
+        newIndices[vertices[i].idx()] = i;
+
+        const lvr2::BaseVector<float>& position = mesh.getVertexPosition(vertices[i]);
+        positions[i * 3] = position.x;
+        positions[i * 3 + 1] = position.y;
+        positions[i * 3 + 2] = position.z;
+    }
+
+    std::vector<std::size_t> faceSources(faces.size());
+    lvr2::indexArray indices(new unsigned int[faces.size() * 3]);
+    for (std::size_t i = 0; i < faces.size(); i++)
+    {
+        faceSources[i] = faceIndices[faces[i].idx()];
+
+        auto faceVertices = mesh.getVerticesOfFace(faces[i]);
+        for (std::size_t j = 0; j < 3; j++)
+        {
+            indices[i * 3 + j] = newIndices[faceVertices[j].idx()];
+        }
+    }
+
+    lvr2::MeshBufferPtr chunk(new lvr2::MeshBuffer);
+    for (const auto& elem : *source)
+    {
+        if (elem.first == "vertices" || elem.first == "face_indices"
+            || elem.first == "num_duplicates")
+        {
+            continue;
+        }
+
+        if (elem.second.numElements() == source->numVertices())
+        {
+            chunk->insert(
+                {elem.first, boost::apply_visitor(ChannelGatherer(vertexSources), elem.second)});
+        }
+        else if (elem.second.numElements() == source->numFaces())
+        {
+            chunk->insert(
+                {elem.first, boost::apply_visitor(ChannelGatherer(faceSources), elem.second)});
+        }
+        else
+        {
+            chunk->insert(elem);
+        }
+    }
+    chunk->setVertices(positions, vertices.size());
+    chunk->setFaceIndices(indices, faces.size());
+    chunk->addAtomic<unsigned int>(numDuplicates, "num_duplicates");
+
+    lvr2::FloatChannelOptional normals = chunk->getFloatChannel("face_normals");
+    if (normals && normals->width() == 3)
+    {
+        for (std::size_t i = 0; i < faces.size(); i++)
+        {
+            const lvr2::Normal<float>& normal = faceNormals[faces[i]];
+            normals->dataPtr()[i * 3] = normal.x;
+            normals->dataPtr()[i * 3 + 1] = normal.y;
+            normals->dataPtr()[i * 3 + 2] = normal.z;
+        }
+    }
+
+    normals = chunk->getFloatChannel("vertex_normals");
+    if (normals && normals->width() == 3)
+    {
+        for (std::size_t i = 0; i < vertices.size(); i++)
+        {
+            if (fixed[vertices[i]])
+            {
+                continue;
+            }
+            auto normal = lvr2::interpolatedVertexNormal(mesh, faceNormals, vertices[i]);
+            if (normal)
+            {
+                normals->dataPtr()[i * 3] = normal->x;
+                normals->dataPtr()[i * 3 + 1] = normal->y;
+                normals->dataPtr()[i * 3 + 2] = normal->z;
+            }
+        }
+    }
+
+    return chunk;
+}
+
+/**
+ * @brief reduces a chunk with locked border vertices
+ *
+ * @param chunk chunk to reduce
+ * @param reductionRatio share of the edges to collapse
+ * @param collapsed set to the number of collapsed edges
+ * @return reduced chunk, its border vertices are the same as in the original chunk
+ */
+lvr2::MeshBufferPtr reduceChunk(const lvr2::MeshBufferPtr& chunk,
+                                float reductionRatio,
+                                std::size_t& collapsed)
+{
+    auto duplicates = chunk->getAtomic<unsigned int>("num_duplicates");
+    const unsigned int numDuplicates = duplicates ? *duplicates : 0;
+
+    std::vector<std::size_t> faceIndices;
+    std::unique_ptr<ChunkMesh> mesh = buildChunkMesh(chunk, faceIndices);
+    auto faceNormals = lvr2::calcFaceNormals(*mesh);
+
+    lvr2::DenseVertexMap<bool> fixed(mesh->nextVertexIndex(), false);
+    for (unsigned int i = 0; i < numDuplicates; i++)
+    {
+        fixed[lvr2::VertexHandle(i)] = true;
+    }
+
+    // Each edge collapse removes two faces in the general case.
+    const auto count = static_cast<std::size_t>((mesh->numFaces() / 2) * reductionRatio);
+    collapsed = lvr2::quadricMeshReduction(*mesh, count, faceNormals, nullptr, &fixed);
+
+    // vertices are only removed, so the border vertices stay in front
+    std::vector<lvr2::VertexHandle> vertices;
+    vertices.reserve(mesh->numVertices());
+    for (std::size_t i = 0; i < chunk->numVertices(); i++)
+    {
+        if (mesh->containsVertex(lvr2::VertexHandle(i)))
+        {
+            vertices.push_back(lvr2::VertexHandle(i));
+        }
+    }
+
+    std::vector<lvr2::FaceHandle> faces;
+    faces.reserve(mesh->numFaces());
+    for (auto fH : mesh->faces())
+    {
+        faces.push_back(fH);
+    }
+
+    return buildChunk(chunk, *mesh, faceNormals, faceIndices, vertices, faces, fixed, numDuplicates);
+}
 } // namespace
 
 namespace lvr2
@@ -233,8 +489,8 @@ MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& ar
                 if (loadedChunk)
                 {
                     // TODO: remove saving tmp chunks later
-                    ModelFactory::saveModel(lvr2::ModelPtr(new lvr2::Model(*loadedChunk)),
-                                            "area/" + std::to_string(cellIndex) + ".ply");
+                    // ModelFactory::saveModel(lvr2::ModelPtr(new lvr2::Model(*loadedChunk)),
+                    //                         "area/" + std::to_string(cellIndex) + ".ply");
                     chunks.insert({cellIndex, *loadedChunk});
                 }
             }
@@ -242,116 +498,115 @@ MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& ar
     }
     std::cout << "Extracted " << chunks.size() << " Chunks" << std::endl;
 
-    std::vector<float> areaDuplicateVertices;
-    std::vector<std::unordered_map<std::size_t, std::size_t>> areaVertexIndices;
-    std::vector<float> areaUniqueVertices;
-    for (auto chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    // chunks without vertices do not contribute to the area mesh
+    std::vector<MeshBufferPtr> areaChunks;
+    areaChunks.reserve(chunks.size());
+    for (auto& chunk : chunks)
     {
-        MeshBufferPtr chunk        = chunkIt->second;
-        FloatChannel chunkVertices = *(chunk->getChannel<float>("vertices"));
-        std::size_t numDuplicates  = *chunk->getAtomic<unsigned int>("num_duplicates");
-        std::size_t numVertices    = chunk->numVertices();
-        std::unordered_map<std::size_t, std::size_t> chunkVertexIndices;
-
-        if (numVertices == 0)
+        if (chunk.second->numVertices() > 0)
         {
-            continue;
+            areaChunks.push_back(chunk.second);
         }
+    }
+    std::size_t numSeamVertices;
+    MeshBufferPtr areaMeshPtr = mergeChunks(areaChunks, numSeamVertices);
 
-        if ((chunkIt == chunks.begin() || areaDuplicateVertices.empty()) && numDuplicates > 0)
-        {
-            areaDuplicateVertices.insert(areaDuplicateVertices.end(),
-                                         chunkVertices.dataPtr().get(),
-                                         chunkVertices.dataPtr().get() + (numDuplicates * 3));
-        }
-
-        for (std::size_t i = 0; i < numDuplicates; ++i)
-        {
-            const size_t areaDuplicateVerticesSize = areaDuplicateVertices.size();
-
-            bool found = false;
-            for (std::size_t j = 0; j < areaDuplicateVerticesSize / 3; ++j)
-            {
-                if ((areaDuplicateVertices[j * 3] == chunkVertices[i][0])
-                    && (areaDuplicateVertices[j * 3 + 1] == chunkVertices[i][1])
-                    && (areaDuplicateVertices[j * 3 + 2] == chunkVertices[i][2]))
-                {
-                    found = true;
-                    chunkVertexIndices.insert({i, j});
-                    break;
-                }
-            }
-
-            if (!found)
-            {
-                areaDuplicateVertices.push_back(chunkVertices[i][0]);
-                areaDuplicateVertices.push_back(chunkVertices[i][1]);
-                areaDuplicateVertices.push_back(chunkVertices[i][2]);
+    std::cout << "Vertices: " << areaMeshPtr->numVertices()
+              << ", Faces: " << areaMeshPtr->numFaces() << std::endl;
 
-                chunkVertexIndices.insert({i, areaDuplicateVertices.size() / 3 - 1});
-            }
-        }
+    // ModelFactory::saveModel(ModelPtr(new Model(areaMeshPtr)), "test1.ply");
 
-        areaUniqueVertices.insert(areaUniqueVertices.end(),
-                                  chunkVertices.dataPtr().get() + (numDuplicates * 3),
-                                  (chunkVertices.dataPtr().get() + (numVertices * 3)));
+    return areaMeshPtr;
+}
 
-        areaVertexIndices.push_back(chunkVertexIndices);
+MeshBufferPtr ChunkManager::mergeChunks(const std::vector<MeshBufferPtr>& chunks,
+                                        std::size_t& numSeamVertices)
+{
+    const std::size_t numChunks = chunks.size();
+
+    // the first num_duplicates vertices of each chunk lie on its border and may also exist in
+    // neighboring chunks, the remaining ones are unique to the chunk
+    std::vector<std::size_t> numDuplicates(numChunks);
+    std::vector<std::size_t> uniqueOffsets(numChunks + 1, 0);
+    std::vector<std::size_t> faceOffsets(numChunks + 1, 0);
+    std::size_t totalDuplicates = 0;
+    for (std::size_t c = 0; c < numChunks; ++c)
+    {
+        numDuplicates[c] = *chunks[c]->getAtomic<unsigned int>("num_duplicates");
+        uniqueOffsets[c + 1] = uniqueOffsets[c] + chunks[c]->numVertices() - numDuplicates[c];
+        faceOffsets[c + 1] = faceOffsets[c] + chunks[c]->numFaces();
+        totalDuplicates += numDuplicates[c];
     }
 
-    std::vector<unsigned int> areaFaceIndices;
-    const std::size_t staticFaceIndexOffset = areaDuplicateVertices.size() / 3;
-    std::size_t dynFaceIndexOffset          = 0;
-    auto areaVertexIndicesIt                = areaVertexIndices.begin();
-    for (auto chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    // stitch the border vertices: equal positions get the same index in the area mesh, indices
+    // are assigned in order of first occurrence
+    std::vector<float> areaDuplicateVertices;
+    std::vector<std::vector<std::size_t>> areaVertexIndices(numChunks);
+    std::unordered_map<SeamVertex, std::size_t, SeamVertexHash> seamVertexIndices;
+    seamVertexIndices.reserve(totalDuplicates);
+    areaDuplicateVertices.reserve(totalDuplicates * 3);
+    for (std::size_t c = 0; c < numChunks; ++c)
     {
-        MeshBufferPtr chunk         = chunkIt->second;
-        indexArray chunkFaceIndices = chunk->getFaceIndices();
-        std::size_t numDuplicates   = *chunk->getAtomic<unsigned int>("num_duplicates");
-        std::size_t numVertices     = chunk->numVertices();
-        std::size_t numFaces        = chunk->numFaces();
-        std::size_t faceIndexOffset = staticFaceIndexOffset - numDuplicates + dynFaceIndexOffset;
+        floatArr chunkVertices = chunks[c]->getVertices();
+        areaVertexIndices[c].resize(numDuplicates[c]);
 
-        for (std::size_t i = 0; i < numFaces * 3; ++i)
+        for (std::size_t i = 0; i < numDuplicates[c]; ++i)
         {
-            std::size_t oldIndex = chunkFaceIndices[i];
-            auto it              = (*areaVertexIndicesIt).find(oldIndex);
-            if (it != (*areaVertexIndicesIt).end())
-            {
-                areaFaceIndices.push_back(it->second);
-            }
-            else
+            const SeamVertex position
+                = {chunkVertices[i * 3], chunkVertices[i * 3 + 1], chunkVertices[i * 3 + 2]};
+            auto inserted = seamVertexIndices.emplace(position, seamVertexIndices.size());
+            if (inserted.second)
             {
-                areaFaceIndices.push_back(oldIndex + faceIndexOffset);
+                areaDuplicateVertices.insert(
+                    areaDuplicateVertices.end(), position.begin(), position.end());
             }
+            areaVertexIndices[c][i] = inserted.first->second;
         }
-        dynFaceIndexOffset += (numVertices - numDuplicates);
-        ++areaVertexIndicesIt;
     }
 
+    const std::size_t staticFaceIndexOffset = seamVertexIndices.size();
+    std::size_t areaVertexNum = staticFaceIndexOffset + uniqueOffsets[numChunks];
+    std::size_t faceIndexNum  = faceOffsets[numChunks];
+
     std::cout << "combine vertices" << std::endl;
-    std::cout << "Duplicates: " << areaDuplicateVertices.size() / 3 << std::endl;
-    std::cout << "Unique: " << areaUniqueVertices.size() / 3 << std::endl;
-    areaDuplicateVertices.insert(
-        areaDuplicateVertices.end(), areaUniqueVertices.begin(), areaUniqueVertices.end());
+    std::cout << "Duplicates: " << staticFaceIndexOffset << std::endl;
+    std::cout << "Unique: " << uniqueOffsets[numChunks] << std::endl;
 
-    std::size_t areaVertexNum = areaDuplicateVertices.size() / 3;
-    float* tmpVertices        = areaDuplicateVertices.data();
-    floatArr vertexArr
-        = floatArr(tmpVertices, VectorCapsule<float>(std::move(areaDuplicateVertices)));
+    floatArr vertexArr(new float[areaVertexNum * 3]);
+    indexArray faceIndexArr(new unsigned int[faceIndexNum * 3]);
+    std::copy(areaDuplicateVertices.begin(), areaDuplicateVertices.end(), vertexArr.get());
 
-    std::size_t faceIndexNum = areaFaceIndices.size() / 3;
-    auto* tmpFaceIndices     = areaFaceIndices.data();
-    indexArray faceIndexArr
-        = indexArray(tmpFaceIndices, VectorCapsule<unsigned int>(std::move(areaFaceIndices)));
+    // every chunk writes its unique vertices and faces to its own range of the area mesh
+    #pragma omp parallel for schedule(dynamic)
+    for (std::size_t c = 0; c < numChunks; ++c)
+    {
+        MeshBufferPtr chunk            = chunks[c];
+        floatArr chunkVertices         = chunk->getVertices();
+        indexArray chunkFaceIndices    = chunk->getFaceIndices();
+        const std::size_t numVertices  = chunk->numVertices();
+        const std::vector<std::size_t>& duplicateIndices = areaVertexIndices[c];
+        const std::size_t faceIndexOffset
+            = staticFaceIndexOffset + uniqueOffsets[c] - numDuplicates[c];
+
+        std::copy(chunkVertices.get() + numDuplicates[c] * 3,
+                  chunkVertices.get() + numVertices * 3,
+                  vertexArr.get() + (staticFaceIndexOffset + uniqueOffsets[c]) * 3);
+
+        unsigned int* areaFaceIndices = faceIndexArr.get() + faceOffsets[c] * 3;
+        for (std::size_t i = 0; i < chunk->numFaces() * 3; ++i)
+        {
+            std::size_t oldIndex = chunkFaceIndices[i];
+            areaFaceIndices[i] = oldIndex < numDuplicates[c] ? duplicateIndices[oldIndex]
+                                                              : oldIndex + faceIndexOffset;
+        }
+    }
 
     MeshBufferPtr areaMeshPtr(new MeshBuffer);
     areaMeshPtr->setVertices(vertexArr, areaVertexNum);
     areaMeshPtr->setFaceIndices(faceIndexArr, faceIndexNum);
 
-    for (auto chunkIt = chunks.begin(); chunkIt != chunks.end(); ++chunkIt)
+    for (const MeshBufferPtr& chunk : chunks)
     {
-        MeshBufferPtr chunk = chunkIt->second;
         for (auto elem : *chunk)
         {
             if (elem.first != "vertices" && elem.first != "face_indices"
@@ -398,11 +653,7 @@ MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& ar
         }
     }
 
-    std::cout << "Vertices: " << areaMeshPtr->numVertices()
-              << ", Faces: " << areaMeshPtr->numFaces() << std::endl;
-
-    ModelFactory::saveModel(ModelPtr(new Model(areaMeshPtr)), "test1.ply");
-
+    numSeamVertices = staticFaceIndexOffset;
     return areaMeshPtr;
 }
 
@@ -776,4 +1027,352 @@ void ChunkManager::loadAllChunks(std::string layer)
     std::cout << "loaded " << numLoaded << " chunks from hdf5-file." << std::endl;
 }
 
+std::size_t ChunkManager::reduceChunks(float reductionRatio,
+                                       std::string targetLayer,
+                                       std::string layer,
+                                       bool reduceSeams)
+{
+    std::vector<BaseVector<int>> chunkCoordinates;
+    for (int i = getChunkMinChunkIndex().x; i < getChunkMaxChunkIndex().x; i++)
+    {
+        for (int j = getChunkMinChunkIndex().y; j < getChunkMaxChunkIndex().y; j++)
+        {
+            for (int k = getChunkMinChunkIndex().z; k < getChunkMaxChunkIndex().z; k++)
+            {
+                chunkCoordinates.push_back(BaseVector<int>(i, j, k));
+            }
+        }
+    }
+
+    std::cout << timestamp << "Reducing the chunks of layer '" << layer << "'" << std::endl;
+
+    // every chunk is loaded, reduced and stored on its own. Exceptions can't leave the parallel
+    // loop, the first one is rethrown afterwards.
+    std::size_t collapsed = 0;
+    std::size_t numUnreduced = 0;
+    std::exception_ptr error;
+    #pragma omp parallel for schedule(dynamic) reduction(+ : collapsed, numUnreduced)
+    for (std::size_t c = 0; c < chunkCoordinates.size(); c++)
+    {
+        const BaseVector<int>& coord = chunkCoordinates[c];
+        try
+        {
+            boost::optional<MeshBufferPtr> chunk = getStoredChunk(layer, coord);
+            if (!chunk)
+            {
+                continue;
+            }
+
+            // chunks without faces and chunks that can't be reduced are copied unchanged
+            MeshBufferPtr reduced = *chunk;
+            if ((*chunk)->numFaces() > 0)
+            {
+                std::size_t chunkCollapsed = 0;
+                try
+                {
+                    reduced = reduceChunk(*chunk, reductionRatio, chunkCollapsed);
+                    collapsed += chunkCollapsed;
+                }
+                catch (PanicException& exception)
+                {
+                    numUnreduced++;
+                }
+            }
+            setChunk<MeshBufferPtr>(targetLayer, coord.x, coord.y, coord.z, reduced);
+        }
+        catch (...)
+        {
+            #pragma omp critical
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (numUnreduced > 0)
+    {
+        std::cout << timestamp << "Warning: " << numUnreduced
+                  << " chunks could not be reduced and were copied unchanged" << std::endl;
+    }
+
+    if (reduceSeams)
+    {
+        std::cout << timestamp << "Reducing the seams of layer '" << targetLayer << "'"
+                  << std::endl;
+
+        // the blocks of a round are disjoint, the second round shifts them by one chunk
+        for (int shift = 0; shift < 2; shift++)
+        {
+            std::vector<BaseVector<int>> blocks;
+            for (int i = getChunkMinChunkIndex().x - shift; i < getChunkMaxChunkIndex().x; i += 2)
+            {
+                for (int j = getChunkMinChunkIndex().y - shift; j < getChunkMaxChunkIndex().y;
+                     j += 2)
+                {
+                    for (int k = getChunkMinChunkIndex().z - shift;
+                         k < getChunkMaxChunkIndex().z;
+                         k += 2)
+                    {
+                        blocks.push_back(BaseVector<int>(i, j, k));
+                    }
+                }
+            }
+
+            #pragma omp parallel for schedule(dynamic) reduction(+ : collapsed)
+            for (std::size_t b = 0; b < blocks.size(); b++)
+            {
+                try
+                {
+                    collapsed += reduceSeamBlock(blocks[b], reductionRatio, targetLayer);
+                }
+                catch (...)
+                {
+                    #pragma omp critical
+                    {
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    std::cout << timestamp << "Collapsed " << collapsed << " edges" << std::endl;
+
+    return collapsed;
+}
+
+boost::optional<MeshBufferPtr> ChunkManager::getStoredChunk(const std::string& layer,
+                                                            const BaseVector<int>& coord)
+{
+    boost::optional<MeshBufferPtr> chunk
+        = getChunk<MeshBufferPtr>(layer, coord.x, coord.y, coord.z);
+    if (!chunk && chunkExists(layer, coord.x, coord.y, coord.z))
+    {
+        throw std::runtime_error("ChunkManager: Unable to load chunk " + std::to_string(coord.x)
+                                 + "_" + std::to_string(coord.y) + "_" + std::to_string(coord.z)
+                                 + " of layer '" + layer + "'");
+    }
+    return chunk;
+}
+
+std::size_t ChunkManager::reduceSeamBlock(const BaseVector<int>& first,
+                                          float reductionRatio,
+                                          const std::string& layer)
+{
+    auto inGrid = [&](const BaseVector<int>& coord) {
+        return coord.x >= getChunkMinChunkIndex().x && coord.x < getChunkMaxChunkIndex().x
+               && coord.y >= getChunkMinChunkIndex().y && coord.y < getChunkMaxChunkIndex().y
+               && coord.z >= getChunkMinChunkIndex().z && coord.z < getChunkMaxChunkIndex().z;
+    };
+
+    std::vector<BaseVector<int>> blockCoordinates;
+    std::vector<MeshBufferPtr> blockChunks;
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            for (int k = 0; k < 2; k++)
+            {
+                BaseVector<int> coord(first.x + i, first.y + j, first.z + k);
+                if (!inGrid(coord))
+                {
+                    continue;
+                }
+                boost::optional<MeshBufferPtr> chunk = getStoredChunk(layer, coord);
+                if (chunk && (*chunk)->numFaces() > 0)
+                {
+                    blockCoordinates.push_back(coord);
+                    blockChunks.push_back(*chunk);
+                }
+            }
+        }
+    }
+
+    if (blockChunks.size() < 2)
+    {
+        return 0;
+    }
+
+    std::size_t numSeamVertices;
+    MeshBufferPtr merged = mergeChunks(blockChunks, numSeamVertices);
+    floatArr mergedVertices = merged->getVertices();
+
+    std::unordered_map<SeamVertex, std::size_t, SeamVertexHash> seamVertices;
+    seamVertices.reserve(numSeamVertices);
+    for (std::size_t i = 0; i < numSeamVertices; i++)
+    {
+        seamVertices.emplace(SeamVertex{mergedVertices[i * 3],
+                                        mergedVertices[i * 3 + 1],
+                                        mergedVertices[i * 3 + 2]},
+                             i);
+    }
+
+    // find the border vertices that are shared with chunks around the block
+    std::vector<bool> outerVertex(numSeamVertices, false);
+    for (int i = -1; i < 3; i++)
+    {
+        for (int j = -1; j < 3; j++)
+        {
+            for (int k = -1; k < 3; k++)
+            {
+                BaseVector<int> coord(first.x + i, first.y + j, first.z + k);
+                if ((i == 0 || i == 1) && (j == 0 || j == 1) && (k == 0 || k == 1))
+                {
+                    continue;
+                }
+                if (!inGrid(coord))
+                {
+                    continue;
+                }
+
+                boost::optional<MeshBufferPtr> chunk = getStoredChunk(layer, coord);
+                if (!chunk || (*chunk)->numVertices() == 0)
+                {
+                    continue;
+                }
+
+                floatArr vertices = (*chunk)->getVertices();
+                auto numDuplicates = (*chunk)->getAtomic<unsigned int>("num_duplicates");
+                for (unsigned int v = 0; numDuplicates && v < *numDuplicates; v++)
+                {
+                    auto it = seamVertices.find(
+                        SeamVertex{vertices[v * 3], vertices[v * 3 + 1], vertices[v * 3 + 2]});
+                    if (it != seamVertices.end())
+                    {
+                        outerVertex[it->second] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<std::size_t> faceIndices;
+    std::unique_ptr<ChunkMesh> mesh = buildChunkMesh(merged, faceIndices);
+    auto faceNormals = calcFaceNormals(*mesh);
+
+    // only the seams inside the block and their neighbors may change
+    DenseVertexMap<bool> fixed(mesh->nextVertexIndex(), true);
+    std::vector<VertexHandle> neighbors;
+    std::size_t numFree = 0;
+    for (std::size_t i = 0; i < numSeamVertices; i++)
+    {
+        if (outerVertex[i])
+        {
+            continue;
+        }
+
+        neighbors.clear();
+        mesh->getNeighboursOfVertex(VertexHandle(i), neighbors);
+        neighbors.push_back(VertexHandle(i));
+        for (VertexHandle vH : neighbors)
+        {
+            if (fixed[vH] && !(vH.idx() < numSeamVertices && outerVertex[vH.idx()]))
+            {
+                fixed[vH] = false;
+                numFree++;
+            }
+        }
+    }
+
+    // Each edge collapse removes one vertex.
+    const auto count = static_cast<std::size_t>(numFree * reductionRatio);
+    std::size_t collapsed = quadricMeshReduction(*mesh, count, faceNormals, nullptr, &fixed);
+
+    // every face stays in the chunk it came from
+    std::vector<std::size_t> faceOffsets(blockChunks.size() + 1, 0);
+    for (std::size_t c = 0; c < blockChunks.size(); c++)
+    {
+        faceOffsets[c + 1] = faceOffsets[c] + blockChunks[c]->numFaces();
+    }
+    std::vector<std::vector<FaceHandle>> chunkFaces(blockChunks.size());
+    for (auto fH : mesh->faces())
+    {
+        std::size_t c = std::upper_bound(faceOffsets.begin(), faceOffsets.end(),
+                                         faceIndices[fH.idx()])
+                        - faceOffsets.begin() - 1;
+        chunkFaces[c].push_back(fH);
+    }
+
+    // count the chunks of the block using each vertex
+    std::vector<int> lastChunk(mesh->nextVertexIndex(), -1);
+    std::vector<unsigned char> numChunks(mesh->nextVertexIndex(), 0);
+    for (std::size_t c = 0; c < blockChunks.size(); c++)
+    {
+        for (FaceHandle fH : chunkFaces[c])
+        {
+            for (VertexHandle vH : mesh->getVerticesOfFace(fH))
+            {
+                if (lastChunk[vH.idx()] != static_cast<int>(c))
+                {
+                    lastChunk[vH.idx()] = c;
+                    numChunks[vH.idx()]++;
+                }
+            }
+        }
+    }
+
+    std::fill(lastChunk.begin(), lastChunk.end(), -1);
+    for (std::size_t c = 0; c < blockChunks.size(); c++)
+    {
+        // vertices that are used by other chunks are stored first
+        std::vector<VertexHandle> duplicates;
+        std::vector<VertexHandle> unique;
+        for (FaceHandle fH : chunkFaces[c])
+        {
+            for (VertexHandle vH : mesh->getVerticesOfFace(fH))
+            {
+                if (lastChunk[vH.idx()] == static_cast<int>(c))
+                {
+                    continue;
+                }
+                lastChunk[vH.idx()] = c;
+
+                if (numChunks[vH.idx()] > 1
+                    || (vH.idx() < numSeamVertices && outerVertex[vH.idx()]))
+                {
+                    duplicates.push_back(vH);
+                }
+                else
+                {
+                    unique.push_back(vH);
+                }
+            }
+        }
+
+        const unsigned int numDuplicates = duplicates.size();
+        duplicates.insert(duplicates.end(), unique.begin(), unique.end());
+
+        const BaseVector<int>& coord = blockCoordinates[c];
+        setChunk<MeshBufferPtr>(layer,
+                                coord.x,
+                                coord.y,
+                                coord.z,
+                                buildChunk(merged,
+                                           *mesh,
+                                           faceNormals,
+                                           faceIndices,
+                                           duplicates,
+                                           chunkFaces[c],
+                                           fixed,
+                                           numDuplicates));
+    }
+
+    return collapsed;
+}
+
 } /* namespace lvr2 */
@@ -32,6 +32,7 @@ namespace lvr2
 BVHRaycaster::BVHRaycaster(const MeshBufferPtr mesh)
 :RaycasterBase(mesh)
 ,m_bvh(mesh)
+,m_packetTraversal(true)
 {
     
 }
@@ -89,6 +90,21 @@ void BVHRaycaster::castRays(
 
     size_t num_rays = directions.size();
 
+    if(packetTraversal())
+    {
+        cast_rays_packets(origin_f,
+            false,
+            direction_f,
+            num_rays,
+            clBVHindicesOrTriLists,
+            clBVHlimits,
+            clTriangleIntersectionData,
+            clTriIdxList,
+            result,
+            result_hits);
+        return;
+    }
+
     cast_rays_one_multi(origin_f, 
         direction_f, 
         num_rays,
@@ -123,6 +139,21 @@ void BVHRaycaster::castRays(
 
     size_t num_rays = directions.size();
 
+    if(packetTraversal())
+    {
+        cast_rays_packets(origin_f,
+            true,
+            direction_f,
+            num_rays,
+            clBVHindicesOrTriLists,
+            clBVHlimits,
+            clTriangleIntersectionData,
+            clTriIdxList,
+            result,
+            result_hits);
+        return;
+    }
+
     cast_rays_multi_multi(origin_f, 
         direction_f, 
         num_rays,
@@ -186,6 +217,122 @@ bool BVHRaycaster::rayIntersectsBox(
 }
 
 
+bool BVHRaycaster::packetIntersectsBox(
+    const RayPacket& packet,
+    const float* boxPtr)
+{
+    const float minX = boxPtr[0], maxX = boxPtr[1];
+    const float minY = boxPtr[2], maxY = boxPtr[3];
+    const float minZ = boxPtr[4], maxZ = boxPtr[5];
+
+    int any = 0;
+
+    #pragma omp simd reduction(|:any)
+    for(int i = 0; i < BVH_PACKET_SIZE; i++)
+    {
+        // slab test, the near plane depends on the sign of the direction
+        float t0x = ((packet.invx[i] < 0 ? maxX : minX) - packet.ox[i]) * packet.invx[i];
+        float t1x = ((packet.invx[i] < 0 ? minX : maxX) - packet.ox[i]) * packet.invx[i];
+        float t0y = ((packet.invy[i] < 0 ? maxY : minY) - packet.oy[i]) * packet.invy[i];
+        float t1y = ((packet.invy[i] < 0 ? minY : maxY) - packet.oy[i]) * packet.invy[i];
+        float t0z = ((packet.invz[i] < 0 ? maxZ : minZ) - packet.oz[i]) * packet.invz[i];
+        float t1z = ((packet.invz[i] < 0 ? minZ : maxZ) - packet.oz[i]) * packet.invz[i];
+
+        float tmin = std::max(t0x, std::max(t0y, t0z));
+        float tmax = std::min(t1x, std::min(t1y, t1z));
+
+        // the box has to be visited if it lies in front of the origin
+        // and is not farther away than the closest hit so far
+        float tnear = std::max(tmin, 0.0f);
+        any |= (tmin <= tmax) & (tmax >= 0.0f) & (tnear * tnear <= packet.bestDist[i]);
+    }
+
+    return any;
+}
+
+void BVHRaycaster::intersectPacketBVH(
+    RayPacket& packet,
+    const unsigned int* clBVHindicesOrTriLists,
+    const float* clBVHlimits,
+    const float* clTriangleIntersectionData,
+    const unsigned int* clTriIdxList
+)
+{
+    int tid_scale = 4;
+    int bvh_limits_scale = 2;
+    const float eps = EPSILON;
+
+    unsigned int stack[BVH_STACK_SIZE];
+
+    int stackId = 0;
+    stack[stackId++] = 0;
+
+    while (stackId)
+    {
+        unsigned int boxId = stack[--stackId];
+
+        // skip the subtree if no ray of the packet can hit something closer in it
+        if (!packetIntersectsBox(packet, &clBVHlimits[bvh_limits_scale * 3 * boxId]))
+        {
+            continue;
+        }
+
+        if (!(clBVHindicesOrTriLists[4 * boxId + 0] & 0x80000000)) // inner node
+        {
+            if (stackId + 2 > BVH_STACK_SIZE)
+            {
+                printf("BVH stack size exceeded!\n");
+                return;
+            }
+            stack[stackId++] = clBVHindicesOrTriLists[4 * boxId + 1];
+            stack[stackId++] = clBVHindicesOrTriLists[4 * boxId + 2];
+        }
+        else // leaf node
+        {
+            unsigned int first = clBVHindicesOrTriLists[4 * boxId + 3];
+            unsigned int count = clBVHindicesOrTriLists[4 * boxId + 0] & 0x7fffffff;
+
+            for (unsigned int t = first; t < first + count; t++)
+            {
+                const float* tri = clTriangleIntersectionData + tid_scale * 4 * clTriIdxList[t];
+                const float* normal = tri;
+                const float* ee1 = tri + tid_scale;
+                const float* ee2 = tri + tid_scale * 2;
+                const float* ee3 = tri + tid_scale * 3;
+
+                // same tests as in intersectTrianglesBVH for all rays at once
+                #pragma omp simd
+                for (int i = 0; i < BVH_PACKET_SIZE; i++)
+                {
+                    float k = normal[0] * packet.dx[i] + normal[1] * packet.dy[i] + normal[2] * packet.dz[i];
+                    float s = (normal[3] - (normal[0] * packet.ox[i] + normal[1] * packet.oy[i] + normal[2] * packet.oz[i])) / k;
+
+                    float hx = packet.dx[i] * s + packet.ox[i];
+                    float hy = packet.dy[i] * s + packet.oy[i];
+                    float hz = packet.dz[i] * s + packet.oz[i];
+
+                    float kt1 = ee1[0] * hx + ee1[1] * hy + ee1[2] * hz - ee1[3];
+                    float kt2 = ee2[0] * hx + ee2[1] * hy + ee2[2] * hz - ee2[3];
+                    float kt3 = ee3[0] * hx + ee3[1] * hy + ee3[2] * hz - ee3[3];
+
+                    float ddx = packet.ox[i] - hx;
+                    float ddy = packet.oy[i] - hy;
+                    float ddz = packet.oz[i] - hz;
+                    float dist = ddx * ddx + ddy * ddy + ddz * ddz;
+
+                    bool hit = (k != 0.0f) & (s > eps) & (kt1 >= 0.0f) & (kt2 >= 0.0f) & (kt3 >= 0.0f)
+                        & (dist < packet.bestDist[i]);
+
+                    packet.bestDist[i] = hit ? dist : packet.bestDist[i];
+                    packet.hitx[i] = hit ? hx : packet.hitx[i];
+                    packet.hity[i] = hit ? hy : packet.hity[i];
+                    packet.hitz[i] = hit ? hz : packet.hitz[i];
+                }
+            }
+        }
+    }
+}
+
 typename BVHRaycaster::TriangleIntersectionResult BVHRaycaster::intersectTrianglesBVH(
     const unsigned int* clBVHindicesOrTriLists,
     Vector3f origin,
@@ -476,4 +623,68 @@ void BVHRaycaster::cast_rays_multi_multi(
 
 }
 
-} // namespace lvr2
\ No newline at end of file
+void BVHRaycaster::cast_rays_packets(
+        const float* ray_origin,
+        bool multi_origin,
+        const float* rays,
+        size_t num_rays,
+        const unsigned int* clBVHindicesOrTriLists,
+        const float* clBVHlimits,
+        const float* clTriangleIntersectionData,
+        const unsigned int* clTriIdxList,
+        float* result,
+        uint8_t* result_hits
+    )
+{
+    long num_packets = (num_rays + BVH_PACKET_SIZE - 1) / BVH_PACKET_SIZE;
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(long p = 0; p < num_packets; p++)
+    {
+        size_t first = p * BVH_PACKET_SIZE;
+        RayPacket packet;
+
+        for(int i = 0; i < BVH_PACKET_SIZE; i++)
+        {
+            // fill up the last packet with copies of the last ray
+            size_t id = std::min(first + i, num_rays - 1);
+            const float* o = multi_origin ? ray_origin + id * 3 : ray_origin;
+
+            Vector3f ray_d(rays[id*3], rays[id*3+1], rays[id*3+2]);
+            ray_d.normalize();
+
+            packet.ox[i] = o[0];
+            packet.oy[i] = o[1];
+            packet.oz[i] = o[2];
+            packet.dx[i] = ray_d.x();
+            packet.dy[i] = ray_d.y();
+            packet.dz[i] = ray_d.z();
+            packet.invx[i] = 1.0f / ray_d.x();
+            packet.invy[i] = 1.0f / ray_d.y();
+            packet.invz[i] = 1.0f / ray_d.z();
+            packet.bestDist[i] = std::numeric_limits<float>::max();
+            packet.hitx[i] = 0;
+            packet.hity[i] = 0;
+            packet.hitz[i] = 0;
+        }
+
+        intersectPacketBVH(
+            packet,
+            clBVHindicesOrTriLists,
+            clBVHlimits,
+            clTriangleIntersectionData,
+            clTriIdxList
+        );
+
+        for(int i = 0; i < BVH_PACKET_SIZE && first + i < num_rays; i++)
+        {
+            size_t id = first + i;
+            result[id*3] = packet.hitx[i];
+            result[id*3+1] = packet.hity[i];
+            result[id*3+2] = packet.hitz[i];
+            result_hits[id] = packet.bestDist[i] < std::numeric_limits<float>::max();
+        }
+    }
+}
+
+} // namespace lvr2
@@ -34,11 +34,32 @@
 
 #include <fstream>
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <algorithm>
+#include <limits>
+#include <vector>
+
+// Floating point std::from_chars needs GCC >= 11. Older standard libraries
+// use strtof_l with the C locale instead.
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if !(defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L)
+#define LVR2_ASCII_USE_STRTOF_L
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#endif
 
 using std::ifstream;
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "lvr2/io/AsciiIO.hpp"
 #include "lvr2/io/Progress.hpp"
@@ -48,6 +69,132 @@ namespace lvr2
 {
 
 
+namespace
+{
+
+/// Size of the ranges of the data section that are parsed by a single thread
+constexpr size_t ASCII_CHUNK_SIZE = 1 << 24;
+
+/// Column targets of the parsed attributes
+enum AsciiTarget { TARGET_X, TARGET_Y, TARGET_Z, TARGET_R, TARGET_G, TARGET_B, TARGET_I, TARGET_NONE };
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/// Returns the first character after the line that contains \ref p
+inline const char* nextLine(const char* p, const char* end)
+{
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    return eol ? eol + 1 : end;
+}
+
+/// Returns true if the line [p, end) contains other characters than blanks
+inline bool hasEntries(const char* p, const char* end)
+{
+    while (p < end && *p != '\n')
+    {
+        if (!isBlank(*p))
+        {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
+/// Maximum length of a number that is parsed with strtof_l
+constexpr size_t ASCII_MAX_NUMBER_LENGTH = 64;
+
+/**
+ * @brief Parses the token [first, last) as an unsigned integer.
+ *
+ * @return false if the token contains other characters than digits or
+ *         the value does not fit into an unsigned int
+ */
+inline bool parseToken(const char* first, const char* last, unsigned int& value)
+{
+    if (first == last)
+    {
+        return false;
+    }
+    unsigned long long v = 0;
+    for (; first < last; first++)
+    {
+        if (*first < '0' || *first > '9')
+        {
+            return false;
+        }
+        v = v * 10 + (*first - '0');
+        if (v > std::numeric_limits<unsigned int>::max())
+        {
+            return false;
+        }
+    }
+    value = static_cast<unsigned int>(v);
+    return true;
+}
+
+/**
+ * @brief Parses the token [first, last) as a float without locale
+ *        dependency.
+ *
+ * @return false if the token is not a number or out of range
+ */
+inline bool parseToken(const char* first, const char* last, float& value)
+{
+#ifdef LVR2_ASCII_USE_STRTOF_L
+    // The token is not null terminated and may end at the end of the
+    // mapped file, so it is copied
+    size_t length = last - first;
+    if (length == 0 || length >= ASCII_MAX_NUMBER_LENGTH)
+    {
+        return false;
+    }
+    char buffer[ASCII_MAX_NUMBER_LENGTH];
+    memcpy(buffer, first, length);
+    buffer[length] = '\0';
+
+    // Hexadecimal floats are not accepted by from_chars either
+    if (memchr(buffer, 'x', length) || memchr(buffer, 'X', length))
+    {
+        return false;
+    }
+
+    static const locale_t cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    char* end;
+    errno = 0;
+    value = strtof_l(buffer, &end, cLocale);
+    return end == buffer + length && errno != ERANGE;
+#else
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+#endif
+}
+
+/**
+ * @brief Parses a number without locale dependency. A leading '+' sign is
+ *        accepted.
+ *
+ * @return false if the token [first, last) is not a valid number
+ */
+template<typename T>
+inline bool parseNumber(const char* first, const char* last, T& value)
+{
+    if (first < last && *first == '+')
+    {
+        first++;
+        if (first < last && *first == '-')
+        {
+            return false;
+        }
+    }
+    return parseToken(first, last, value);
+}
+
+} // namespace
+
 ModelPtr AsciiIO::read(
         string filename,
         const int &xPos, const int& yPos, const int& zPos,
@@ -62,46 +209,51 @@ ModelPtr AsciiIO::read(
         cout << "»" << extension << "« is not a valid file extension." << endl;
         return ModelPtr();
     }
-    // Count lines in file to estimate the number of present points
-    size_t lines_in_file = countLines(filename);
 
-    if ( lines_in_file < 2 )
+    // Map the file into memory. Empty files can not be mapped.
+    boost::iostreams::mapped_file_source file;
+    try
     {
-        cout << timestamp << "AsciiIO: Too few lines in file (has to be > 2)." << endl;
+        if (boost::filesystem::file_size(selectedFile) > 0)
+        {
+            file.open(filename);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        cout << timestamp << "AsciiIO: Unable to map »" << filename << "«: " << e.what() << endl;
         return ModelPtr();
     }
 
-    // Open file
-    ifstream in;
-    in.open(filename.c_str());
+    const char* begin = file.is_open() ? file.data() : nullptr;
+    const char* end   = begin + (file.is_open() ? file.size() : 0);
 
-    // Read first two lines, ignore the first one
-    char buffer[2048];
-    in.getline(buffer, 2048);
-    in.getline(buffer, 2048);
-
-    // Get number of entries in test line and analize
-    int num_columns  = AsciiIO::getEntriesInLine(filename);
-
-    // Reopen file and read data
-    in.close();
-    in.open(filename.c_str());
-
-    // Again skip first line
-    in.getline(buffer, 2048);
-
-    // Buffer related variables
-    size_t numPoints = 0;
-
-    floatArr points;
-    ucharArr pointColors;
-    floatArr pointIntensities;
+    // Skip the first line (as it may contain meta data in some formats)
+    const char* data = begin ? nextLine(begin, end) : end;
+    if ( data == end )
+    {
+        cout << timestamp << "AsciiIO: Too few lines in file (has to be > 2)." << endl;
+        return ModelPtr();
+    }
 
-    // Alloc memory for points
-    numPoints = lines_in_file - 1;
-    points = floatArr( new float[ numPoints * 3 ] );
-    ModelPtr model(new Model);
-    model->m_pointCloud = PointBufferPtr( new PointBuffer);
+    // Get number of entries in the first data line
+    int num_columns = 0;
+    for (const char* p = data; p < end && *p != '\n'; )
+    {
+        while (p < end && isBlank(*p))
+        {
+            p++;
+        }
+        if (p == end || *p == '\n')
+        {
+            break;
+        }
+        num_columns++;
+        while (p < end && !isBlank(*p) && *p != '\n')
+        {
+            p++;
+        }
+    }
 
     // (Some) sanity checks for given paramters
     if(rPos > num_columns || gPos > num_columns || bPos > num_columns || iPos > num_columns)
@@ -115,7 +267,63 @@ ModelPtr AsciiIO::read(
     bool has_color = (rPos > -1 && gPos > -1 && bPos > -1);
     bool has_intensity = (iPos > -1);
 
-    // Alloc buffer memory for additional attributes
+    // Map columns to the attribute they contain
+    int columns[] = { xPos, yPos, zPos, rPos, gPos, bPos, iPos };
+    int last_column = 0;
+    for (int t = TARGET_X; t < TARGET_NONE; t++)
+    {
+        if ((t < TARGET_R || (t < TARGET_I && has_color) || (t == TARGET_I && has_intensity)) && columns[t] > -1)
+        {
+            last_column = std::max(last_column, columns[t]);
+        }
+    }
+    std::vector<int> targets(last_column + 1, TARGET_NONE);
+    for (int t = TARGET_NONE - 1; t >= TARGET_X; t--)
+    {
+        if ((t < TARGET_R || (t < TARGET_I && has_color) || (t == TARGET_I && has_intensity)) && columns[t] > -1)
+        {
+            targets[columns[t]] = t;
+        }
+    }
+
+    // Split the data section into ranges that start at line boundaries
+    std::vector<const char*> chunks(1, data);
+    while (chunks.back() < end)
+    {
+        const char* next = chunks.back() + ASCII_CHUNK_SIZE;
+        chunks.push_back(next < end ? nextLine(next, end) : end);
+    }
+    const long num_chunks = chunks.size() - 1;
+
+    // Count the points within each range to get their output offsets
+    std::vector<size_t> offsets(num_chunks + 1, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (long c = 0; c < num_chunks; c++)
+    {
+        size_t n = 0;
+        for (const char* p = chunks[c]; p < chunks[c + 1]; p = nextLine(p, chunks[c + 1]))
+        {
+            n += hasEntries(p, chunks[c + 1]);
+        }
+        offsets[c + 1] = n;
+    }
+    for (long c = 0; c < num_chunks; c++)
+    {
+        offsets[c + 1] += offsets[c];
+    }
+
+    size_t numPoints = offsets.back();
+    if ( numPoints == 0 )
+    {
+        cout << timestamp << "AsciiIO: Too few lines in file (has to be > 2)." << endl;
+        return ModelPtr();
+    }
+
+    // Alloc memory for points and additional attributes
+    floatArr points( new float[ numPoints * 3 ] );
+    ucharArr pointColors;
+    floatArr pointIntensities;
+
     if ( has_color )
     {
         pointColors = ucharArr( new uint8_t[ numPoints * 3 ] );
@@ -126,97 +334,146 @@ ModelPtr AsciiIO::read(
         pointIntensities = floatArr( new float[ numPoints ] );
     }
 
-    // Read data form file
-    size_t c = 0;
-    while (in.good() && c < numPoints)
+    // Parse all ranges in parallel. Lines with missing entries or entries
+    // that are no numbers are skipped.
+    size_t incomplete = 0;
+    size_t malformed = 0;
+    std::vector<size_t> parsed(num_chunks, 0);
+    #pragma omp parallel for schedule(dynamic) reduction(+:incomplete, malformed)
+    for (long c = 0; c < num_chunks; c++)
     {
-        float x, y, z, intensity, dummy;
-        unsigned int r, g, b;
-
-        for(int i = 0; i < num_columns; i++)
+        size_t index = offsets[c];
+        const char* chunk_end = chunks[c + 1];
+        for (const char* line = chunks[c]; line < chunk_end; line = nextLine(line, chunk_end))
         {
-            if(i == xPos)
-            {
-                in >> x;
-            }
-            else if(i == yPos)
-            {
-                in >> y;
-            }
-            else if(i == zPos)
+            if (!hasEntries(line, chunk_end))
             {
-                in >> z;
+                continue;
             }
-            else if(i == rPos)
+
+            float values[TARGET_NONE] = { 0.0f };
+            unsigned int color[3] = { 0, 0, 0 };
+            const char* p = line;
+            int column = 0;
+            bool valid = true;
+            for (; column <= last_column; column++)
             {
-                in >> r;
+                while (p < chunk_end && isBlank(*p))
+                {
+                    p++;
+                }
+                if (p == chunk_end || *p == '\n')
+                {
+                    break;
+                }
+                const char* token = p;
+                while (p < chunk_end && !isBlank(*p) && *p != '\n')
+                {
+                    p++;
+                }
+
+                int target = targets[column];
+                if (target >= TARGET_R && target <= TARGET_B)
+                {
+                    valid &= parseNumber(token, p, color[target - TARGET_R]);
+                }
+                else if (target != TARGET_NONE)
+                {
+                    valid &= parseNumber(token, p, values[target]);
+                }
             }
-            else if(i == gPos)
+            if (column <= last_column)
             {
-                in >> g;
+                incomplete++;
+                continue;
             }
-            else if(i == bPos)
+            if (!valid)
             {
-                in >> b;
+                malformed++;
+                continue;
             }
-            else if(i == iPos)
+
+            points[ index * 3     ] = values[TARGET_X];
+            points[ index * 3 + 1 ] = values[TARGET_Y];
+            points[ index * 3 + 2 ] = values[TARGET_Z];
+
+            if(has_color)
             {
-                in >> intensity;
+                pointColors[ index * 3     ] = (unsigned char) color[0];
+                pointColors[ index * 3 + 1 ] = (unsigned char) color[1];
+                pointColors[ index * 3 + 2 ] = (unsigned char) color[2];
             }
-            else
+
+            if (has_intensity)
             {
-                in >> dummy;
+                pointIntensities[index] = values[TARGET_I];
             }
-
+            index++;
         }
+        parsed[c] = index - offsets[c];
+    }
 
-        // Read according to determined format
-        if(has_color)
-        {
-            pointColors[ c * 3     ] = (unsigned char) r;
-            pointColors[ c * 3 + 1 ] = (unsigned char) g;
-            pointColors[ c * 3 + 2 ] = (unsigned char) b;
+    // Sanity check
+    if(incomplete)
+    {
+        cout << timestamp << "Warning: " << incomplete << " of " << numPoints
+             << " lines contain less than " << last_column + 1 << " entries and were skipped." << endl;
+    }
+    if(malformed)
+    {
+        cout << timestamp << "Warning: " << malformed << " of " << numPoints
+             << " lines contain invalid numbers and were skipped." << endl;
+    }
 
+    // Close the gaps left by skipped lines
+    if (incomplete || malformed)
+    {
+        size_t index = 0;
+        for (long c = 0; c < num_chunks; c++)
+        {
+            if (index != offsets[c])
+            {
+                std::copy(points.get() + offsets[c] * 3,
+                          points.get() + (offsets[c] + parsed[c]) * 3,
+                          points.get() + index * 3);
+                if (has_color)
+                {
+                    std::copy(pointColors.get() + offsets[c] * 3,
+                              pointColors.get() + (offsets[c] + parsed[c]) * 3,
+                              pointColors.get() + index * 3);
+                }
+                if (has_intensity)
+                {
+                    std::copy(pointIntensities.get() + offsets[c],
+                              pointIntensities.get() + offsets[c] + parsed[c],
+                              pointIntensities.get() + index);
+                }
+            }
+            index += parsed[c];
         }
+        numPoints = index;
 
-        if (has_intensity)
+        if ( numPoints == 0 )
         {
-            pointIntensities[c] = intensity;
-
+            cout << timestamp << "AsciiIO: No valid points in file." << endl;
+            return ModelPtr();
         }
-
-        points[ c * 3     ] = x;
-        points[ c * 3 + 1 ] = y;
-        points[ c * 3 + 2 ] = z;
-        c++;
-    }
-
-    // Sanity check
-    if(c != numPoints)
-    {
-        cout << timestamp << "Warning: Point count / line count mismatch: "
-             << numPoints << " / " << c << endl;
     }
 
     // Assign buffers
-    size_t numColors = 0;
-    size_t numIntensities = 0;
+    ModelPtr model(new Model);
+    model->m_pointCloud = PointBufferPtr( new PointBuffer);
 
     if(has_color)
     {
-        numColors = numPoints;
-        model->m_pointCloud->setColorArray(pointColors, numColors);
-
+        model->m_pointCloud->setColorArray(pointColors, numPoints);
     }
 
     if(has_intensity)
     {
-        numIntensities = numPoints;
-        model->m_pointCloud->addFloatChannel(pointIntensities, "intensities", numIntensities, 1);
-
+        model->m_pointCloud->addFloatChannel(pointIntensities, "intensities", numPoints, 1);
     }
 
-
     model->m_pointCloud->setPointArray(points, numPoints);
 
     this->m_model = model;
@@ -235,30 +492,13 @@ ModelPtr AsciiIO::read(string filename)
         cout << "»" << extension << "« is not a valid file extension." << endl;
         return ModelPtr();
     }
-    // Count lines in file to estimate the number of present points
-    int lines_in_file = countLines(filename);
-
-    if ( lines_in_file < 2 )
-    {
-        cout << timestamp << "AsciiIO: Too few lines in file (has to be > 2)." << endl;
-        return ModelPtr();
-    }
-    // Open the given file. Skip the first line (as it may
-    // contain meta data in some formats). Then try to guess
-    // the additional data using some heuristics that apply for
-    // most data formats: If 4 values per point are, given
-    // the 4th value usually is a reflectence information.
-    // Six entries suggest RGB information, seven entries
-    // intensity and RGB.
-
-    // Open file
-    ifstream in;
-    in.open(filename.c_str());
-
-    // Read first to lines, ignore the first one
-    char buffer[2048];
-    in.getline(buffer, 2048);
-    in.getline(buffer, 2048);
+    // Skip the first line (as it may contain meta data in some
+    // formats). Then try to guess the additional data using some
+    // heuristics that apply for most data formats: If 4 values
+    // per point are, given the 4th value usually is a reflectence
+    // information. Six entries suggest RGB information, seven
+    // entries intensity and RGB. Too short files are rejected
+    // by the parser.
 
     // Get number of entries in test line and analize
     int num_attributes  = AsciiIO::getEntriesInLine(filename) - 3;
@@ -385,18 +625,24 @@ void AsciiIO::save( std::string filename )
 
 size_t AsciiIO::countLines(string filename)
 {
-    // Open file for reading
-    ifstream in(filename.c_str());
-
-    // Count lines in file
+    // Count line breaks in the mapped file. Like reading the file
+    // line by line until it fails, this counts the (possibly empty)
+    // remainder after the last line break as an additional line.
     size_t c = 0;
-    char line[2048];
-    while(in.good())
+    try
     {
-        in.getline(line, 1024);
-        c++;
+        c = 1;
+        if (boost::filesystem::file_size(filename) > 0)
+        {
+            boost::iostreams::mapped_file_source file(filename);
+            c += std::count(file.data(), file.data() + file.size(), '\n');
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // Unreadable files contain no lines
+        c = 0;
     }
-    in.close();
     return c;
 }
 
@@ -42,7 +42,9 @@
 #include "lvr2/io/PLYIO.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 #include <ctime>
 #include <sstream>
 #include <fstream>
@@ -53,6 +55,544 @@
 namespace lvr2
 {
 
+namespace
+{
+
+/// Number of records that are staged at once when reading or writing blocks
+constexpr size_t PLY_BLOCK_RECORDS = 1 << 16;
+
+/// Type names as written by RPly, indexed by e_ply_type
+const char* const PLY_TYPE_NAMES[] = {
+    "int8", "uint8", "int16", "uint16",
+    "int32", "uint32", "float32", "float64",
+    "char", "uchar", "short", "ushort",
+    "int", "uint", "float", "double"
+};
+
+/**
+ * @brief A scalar property of a PLY element that is mapped to a channel.
+ */
+struct PlyField
+{
+    /// Property name
+    const char* name;
+
+    /// Property type in the file
+    e_ply_type  type;
+
+    /// Byte offset of the property within one record
+    size_t      offset;
+
+    /// Size of the property in bytes
+    size_t      size;
+
+    /// First entry of the channel
+    char*       channel;
+
+    /// Bytes between two consecutive entries of the channel
+    size_t      stride;
+};
+
+/**
+ * @brief An element of a binary PLY file. It either consists of scalar
+ *        properties only or of a single list of three indices per face.
+ */
+struct PlyBlock
+{
+    /// Element name
+    const char*             name;
+
+    /// Number of records
+    size_t                  count;
+
+    /// Size of a record in bytes
+    size_t                  recordSize;
+
+    /// Scalar properties that are mapped to channels
+    std::vector<PlyField>   fields;
+
+    /// True if the element is a list of triangle indices
+    bool                    isFaceList;
+
+    /// Size of the list length of a face record
+    size_t                  lengthSize;
+
+    /// Face index channel, null if faces are skipped
+    unsigned int*           faces;
+};
+
+/**
+ * @brief Channels of a vertex or point element. Unused channels are null.
+ */
+struct PlyChannels
+{
+    float*      xyz;
+    uint8_t*    colors;
+    float*      confidences;
+    float*      intensities;
+    float*      normals;
+    short*      panoramaCoords;
+};
+
+bool hostIsLittleEndian()
+{
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+size_t plyTypeSize(e_ply_type type)
+{
+    switch (type)
+    {
+    case PLY_INT8:    case PLY_UINT8:   case PLY_CHAR:  case PLY_UCHAR:
+        return 1;
+    case PLY_INT16:   case PLY_UINT16:  case PLY_SHORT: case PLY_USHORT:
+        return 2;
+    case PLY_INT32:   case PLY_UIN32:  case PLY_INT:   case PLY_UINT:
+    case PLY_FLOAT32: case PLY_FLOAT:
+        return 4;
+    case PLY_FLOAT64: case PLY_DOUBLE:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+bool isPlyFloat(e_ply_type type)
+{
+    return type == PLY_FLOAT || type == PLY_FLOAT32;
+}
+
+bool isPlyUChar(e_ply_type type)
+{
+    return type == PLY_UCHAR || type == PLY_UINT8;
+}
+
+bool isPlyShort(e_ply_type type)
+{
+    return type == PLY_SHORT || type == PLY_INT16;
+}
+
+bool isPlyIndex(e_ply_type type)
+{
+    return type == PLY_INT || type == PLY_UINT || type == PLY_INT32 || type == PLY_UIN32;
+}
+
+void addField(PlyBlock& block, const char* name, e_ply_type type, void* channel, size_t stride)
+{
+    size_t size = plyTypeSize(type);
+    block.fields.push_back({ name, type, block.recordSize, size, static_cast<char*>(channel), stride });
+    block.recordSize += size;
+}
+
+PlyBlock scalarBlock(const char* name, size_t count)
+{
+    return PlyBlock{ name, count, 0, {}, false, 0, nullptr };
+}
+
+PlyBlock faceBlock(const char* name, size_t count, size_t lengthSize, unsigned int* faces)
+{
+    return PlyBlock{ name, count, lengthSize + 3 * sizeof(unsigned int), {}, true, lengthSize, faces };
+}
+
+/**
+ * @brief Maps the scalar properties of a vertex or point element onto the
+ *        given channels. Properties without a channel are skipped.
+ *
+ * @return  False if a requested channel is missing in the element or if
+ *          its type does not match the channel type.
+ */
+bool layoutChannels(p_ply_element elem, const PlyChannels& channels, PlyBlock& block)
+{
+    size_t expected = 3
+        + (channels.colors         ? 3 : 0)
+        + (channels.confidences    ? 1 : 0)
+        + (channels.intensities    ? 1 : 0)
+        + (channels.normals        ? 3 : 0)
+        + (channels.panoramaCoords ? 2 : 0);
+
+    const char* const xyzNames[]    = { "x", "y", "z" };
+    const char* const colorNames[]  = { "red", "green", "blue" };
+    const char* const normalNames[] = { "nx", "ny", "nz" };
+
+    p_ply_property prop = NULL;
+    while ( ( prop = ply_get_next_property( elem, prop ) ) )
+    {
+        const char* name;
+        e_ply_type type;
+        ply_get_property_info( prop, &name, &type, NULL, NULL );
+        if ( type == PLY_LIST )
+        {
+            return false;
+        }
+
+        void* channel = nullptr;
+        size_t stride = 0;
+        bool matches = true;
+        for ( int c = 0; c < 3; c++ )
+        {
+            if ( !strcmp( name, xyzNames[c] ) && channels.xyz )
+            {
+                channel = channels.xyz + c;
+                stride = 3 * sizeof(float);
+                matches = isPlyFloat(type);
+            }
+            else if ( !strcmp( name, colorNames[c] ) && channels.colors )
+            {
+                channel = channels.colors + c;
+                stride = 3;
+                matches = isPlyUChar(type);
+            }
+            else if ( !strcmp( name, normalNames[c] ) && channels.normals )
+            {
+                channel = channels.normals + c;
+                stride = 3 * sizeof(float);
+                matches = isPlyFloat(type);
+            }
+        }
+        if ( !strcmp( name, "confidence" ) && channels.confidences )
+        {
+            channel = channels.confidences;
+            stride = sizeof(float);
+            matches = isPlyFloat(type);
+        }
+        else if ( !strcmp( name, "intensity" ) && channels.intensities )
+        {
+            channel = channels.intensities;
+            stride = sizeof(float);
+            matches = isPlyFloat(type);
+        }
+        else if ( ( !strcmp( name, "x_coords" ) || !strcmp( name, "y_coords" ) ) && channels.panoramaCoords )
+        {
+            channel = channels.panoramaCoords + ( name[0] == 'x' ? 0 : 1 );
+            stride = 2 * sizeof(short);
+            matches = isPlyShort(type);
+        }
+
+        if ( !matches )
+        {
+            return false;
+        }
+        if ( channel )
+        {
+            addField( block, name, type, channel, stride );
+        }
+        else
+        {
+            block.recordSize += plyTypeSize(type);
+        }
+    }
+    return block.fields.size() == expected;
+}
+
+/**
+ * @brief Builds the block layout of a PLY file whose header was read by RPly.
+ *
+ * @return  False if the file contains elements that can not be read
+ *          block-wise.
+ */
+bool layoutBlocks(
+    p_ply ply,
+    const PlyChannels& vertexChannels,
+    const PlyChannels& pointChannels,
+    unsigned int* faces,
+    std::vector<PlyBlock>& blocks)
+{
+    p_ply_element elem = NULL;
+    while ( ( elem = ply_get_next_element( ply, elem ) ) )
+    {
+        const char* name;
+        long int n;
+        ply_get_element_info( elem, &name, &n );
+
+        p_ply_property prop = ply_get_next_property( elem, NULL );
+        const char* propName = "";
+        e_ply_type type = PLY_LIST, lengthType = PLY_UCHAR, valueType = PLY_INT;
+        if ( prop )
+        {
+            ply_get_property_info( prop, &propName, &type, &lengthType, &valueType );
+        }
+
+        if ( prop && type == PLY_LIST )
+        {
+            // Lists of three 32 bit indices are the only lists we support
+            if ( ply_get_next_property( elem, prop ) || !isPlyIndex(valueType) )
+            {
+                return false;
+            }
+            size_t lengthSize = plyTypeSize(lengthType);
+            if ( lengthSize == 0 || lengthSize > sizeof(uint32_t) || lengthType == PLY_FLOAT32 || lengthType == PLY_FLOAT )
+            {
+                return false;
+            }
+            bool isFace = !strcmp( name, "face" )
+                && ( !strcmp( propName, "vertex_indices" ) || !strcmp( propName, "vertex_index" ) );
+            blocks.push_back( faceBlock( name, n, lengthSize, isFace ? faces : nullptr ) );
+            continue;
+        }
+
+        PlyChannels none = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+        const PlyChannels& channels = !strcmp( name, "vertex" ) ? vertexChannels
+                                    : !strcmp( name, "point" )  ? pointChannels : none;
+        blocks.push_back( scalarBlock( name, n ) );
+        if ( !layoutChannels( elem, channels, blocks.back() ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the given blocks from a binary little endian PLY file.
+ *
+ * @return  False if the file is not binary little endian or if a face is
+ *          not a triangle. The channels may be partially filled then.
+ */
+bool readBlocks(const std::string& filename, const std::vector<PlyBlock>& blocks)
+{
+    std::unique_ptr<FILE, int(*)(FILE*)> in( fopen( filename.c_str(), "rb" ), fclose );
+    if ( !in )
+    {
+        return false;
+    }
+
+    // Skip the header. RPly reads it buffered, so the data offset is unknown.
+    std::string line;
+    bool binaryLittleEndian = false;
+    int c;
+    while ( ( c = fgetc( in.get() ) ) != EOF )
+    {
+        if ( c != '\n' )
+        {
+            line.push_back( c );
+            continue;
+        }
+        if ( !line.empty() && line.back() == '\r' )
+        {
+            line.pop_back();
+        }
+        if ( line.compare( 0, 7, "format " ) == 0 )
+        {
+            binaryLittleEndian = line.compare( 7, 20, "binary_little_endian" ) == 0;
+        }
+        if ( line == "end_header" )
+        {
+            break;
+        }
+        line.clear();
+    }
+    if ( c == EOF || !binaryLittleEndian )
+    {
+        return false;
+    }
+
+    std::vector<char> staging;
+    for ( size_t b = 0; b < blocks.size(); b++ )
+    {
+        const PlyBlock& block = blocks[b];
+
+        // Nothing left to read from the remaining blocks
+        if ( block.fields.empty() && !block.faces && b + 1 == blocks.size() )
+        {
+            break;
+        }
+
+        // Coordinates only: The file layout equals the channel layout
+        if ( block.fields.size() == 3 && block.recordSize == 3 * sizeof(float)
+            && block.fields[0].offset == 0 && block.fields[1].offset == sizeof(float)
+            && block.fields[0].channel + sizeof(float) == block.fields[1].channel
+            && block.fields[1].channel + sizeof(float) == block.fields[2].channel
+            && block.fields[0].stride == block.recordSize )
+        {
+            if ( fread( block.fields[0].channel, block.recordSize, block.count, in.get() ) != block.count )
+            {
+                return false;
+            }
+            continue;
+        }
+
+        staging.resize( PLY_BLOCK_RECORDS * block.recordSize );
+        for ( size_t first = 0; first < block.count; first += PLY_BLOCK_RECORDS )
+        {
+            size_t n = std::min( PLY_BLOCK_RECORDS, block.count - first );
+            if ( fread( staging.data(), block.recordSize, n, in.get() ) != n )
+            {
+                return false;
+            }
+
+            for ( size_t i = 0; i < n; i++ )
+            {
+                const char* record = staging.data() + i * block.recordSize;
+                if ( block.isFaceList )
+                {
+                    uint32_t length = 0;
+                    std::memcpy( &length, record, block.lengthSize );
+                    if ( length != 3 )
+                    {
+                        return false;
+                    }
+                    if ( block.faces )
+                    {
+                        std::memcpy( block.faces + 3 * ( first + i ), record + block.lengthSize, 3 * sizeof(unsigned int) );
+                    }
+                    continue;
+                }
+                for ( const PlyField& field : block.fields )
+                {
+                    std::memcpy( field.channel + ( first + i ) * field.stride, record + field.offset, field.size );
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the given blocks as binary little endian PLY file. The
+ *        header equals the one written by RPly.
+ */
+bool writeBlocks(const std::string& filename, const std::vector<PlyBlock>& blocks)
+{
+    std::unique_ptr<FILE, int(*)(FILE*)> out( fopen( filename.c_str(), "wb" ), fclose );
+    if ( !out )
+    {
+        std::cerr << timestamp << "Could not create »" << filename << "«" << std::endl;
+        return false;
+    }
+
+    std::ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\n";
+    for ( const PlyBlock& block : blocks )
+    {
+        header << "element " << block.name << " " << block.count << "\n";
+        if ( block.isFaceList )
+        {
+            header << "property list uchar int vertex_indices\n";
+        }
+        for ( const PlyField& field : block.fields )
+        {
+            header << "property " << PLY_TYPE_NAMES[field.type] << " " << field.name << "\n";
+        }
+    }
+    header << "end_header\n";
+
+    const std::string headerString = header.str();
+    if ( fwrite( headerString.data(), 1, headerString.size(), out.get() ) != headerString.size() )
+    {
+        std::cerr << timestamp << "Could not write header." << std::endl;
+        return false;
+    }
+
+    std::vector<char> staging;
+    for ( const PlyBlock& block : blocks )
+    {
+        staging.resize( PLY_BLOCK_RECORDS * block.recordSize );
+        for ( size_t first = 0; first < block.count; first += PLY_BLOCK_RECORDS )
+        {
+            size_t n = std::min( PLY_BLOCK_RECORDS, block.count - first );
+            for ( size_t i = 0; i < n; i++ )
+            {
+                char* record = staging.data() + i * block.recordSize;
+                if ( block.isFaceList )
+                {
+                    record[0] = 3;
+                    std::memcpy( record + 1, block.faces + 3 * ( first + i ), 3 * sizeof(unsigned int) );
+                    continue;
+                }
+                for ( const PlyField& field : block.fields )
+                {
+                    std::memcpy( record + field.offset, field.channel + ( first + i ) * field.stride, field.size );
+                }
+            }
+            if ( fwrite( staging.data(), block.recordSize, n, out.get() ) != n )
+            {
+                std::cerr << timestamp << "Could not write »" << filename << "«." << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if ( fclose( out.release() ) != 0 )
+    {
+        std::cerr << timestamp << "Could not close file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the given blocks value by value using RPly. Used on big
+ *        endian hosts.
+ */
+bool writeBlocksRply(const std::string& filename, const std::vector<PlyBlock>& blocks)
+{
+    p_ply oply = ply_create( filename.c_str(), PLY_LITTLE_ENDIAN, NULL, 0, NULL );
+    if ( !oply )
+    {
+        std::cerr << timestamp << "Could not create »" << filename << "«" << std::endl;
+        return false;
+    }
+
+    for ( const PlyBlock& block : blocks )
+    {
+        ply_add_element( oply, block.name, block.count );
+        if ( block.isFaceList )
+        {
+            ply_add_list_property( oply, "vertex_indices", PLY_UCHAR, PLY_INT );
+        }
+        for ( const PlyField& field : block.fields )
+        {
+            ply_add_scalar_property( oply, field.name, field.type );
+        }
+    }
+
+    if ( !ply_write_header( oply ) )
+    {
+        std::cerr << timestamp << "Could not write header." << std::endl;
+        ply_close( oply );
+        return false;
+    }
+
+    for ( const PlyBlock& block : blocks )
+    {
+        for ( size_t i = 0; i < block.count; i++ )
+        {
+            if ( block.isFaceList )
+            {
+                ply_write( oply, 3.0 ); /* Indices per face. */
+                ply_write( oply, (double) block.faces[ i * 3     ] );
+                ply_write( oply, (double) block.faces[ i * 3 + 1 ] );
+                ply_write( oply, (double) block.faces[ i * 3 + 2 ] );
+                continue;
+            }
+            for ( const PlyField& field : block.fields )
+            {
+                const char* value = field.channel + i * field.stride;
+                if ( isPlyUChar( field.type ) )
+                {
+                    ply_write( oply, *reinterpret_cast<const uint8_t*>( value ) );
+                }
+                else
+                {
+                    ply_write( oply, *reinterpret_cast<const float*>( value ) );
+                }
+            }
+        }
+    }
+
+    if ( !ply_close( oply ) )
+    {
+        std::cerr << timestamp << "Could not close file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
 
 void PLYIO::save( string filename )
 {
@@ -62,9 +602,6 @@ void PLYIO::save( string filename )
         return;
     }
 
-    /* Handle options. */
-    e_ply_storage_mode mode( PLY_LITTLE_ENDIAN );
-
     // Local buffer shortcuts
     floatArr m_vertices;
     floatArr m_vertexConfidence;
@@ -128,45 +665,26 @@ void PLYIO::save( string filename )
     }
 
 
-    p_ply oply = ply_create( filename.c_str(), mode, NULL, 0, NULL );
-    if ( !oply )
-    {
-        std::cerr << timestamp << "Could not create »" << filename << "«" << std::endl;
-        return;
-    }
-
     /* Check if we have vertex information. */
     if ( !( m_vertices || m_points ) )
     {
         std::cout << timestamp << "Neither vertices nor points to write." << std::endl;
-        if ( !ply_close( oply ) )
-        {
-            std::cerr << timestamp << "Could not close file." << std::endl;
-        }
         return;
     }
 
-    /* First: Write Header information according to data. */
-
-    bool vertex_color      = false;
-    bool vertex_intensity  = false;
-    bool vertex_confidence = false;
-    bool vertex_normal     = false;
-    bool point_color       = false;
-    bool point_intensity   = false;
-    bool point_confidence  = false;
-    bool point_normal      = false;
-
+    /* First: Describe the elements according to data. */
+    std::vector<PlyBlock> blocks;
 
     /* Add vertex element. */
     if ( m_vertices )
     {
-        ply_add_element( oply, "vertex", m_numVertices );
+        blocks.push_back( scalarBlock( "vertex", m_numVertices ) );
+        PlyBlock& vertexBlock = blocks.back();
 
         /* Add vertex properties: x, y, z, (r, g, b) */
-        ply_add_scalar_property( oply, "x", PLY_FLOAT );
-        ply_add_scalar_property( oply, "y", PLY_FLOAT );
-        ply_add_scalar_property( oply, "z", PLY_FLOAT );
+        addField( vertexBlock, "x", PLY_FLOAT, m_vertices.get(),     3 * sizeof(float) );
+        addField( vertexBlock, "y", PLY_FLOAT, m_vertices.get() + 1, 3 * sizeof(float) );
+        addField( vertexBlock, "z", PLY_FLOAT, m_vertices.get() + 2, 3 * sizeof(float) );
 
         /* Add color information if there is any. */
         if ( m_vertexColors )
@@ -178,10 +696,9 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "red",   PLY_UCHAR );
-                ply_add_scalar_property( oply, "green", PLY_UCHAR );
-                ply_add_scalar_property( oply, "blue",  PLY_UCHAR );
-                vertex_color = true;
+                addField( vertexBlock, "red",   PLY_UCHAR, m_vertexColors.get(),     w_vertex_color );
+                addField( vertexBlock, "green", PLY_UCHAR, m_vertexColors.get() + 1, w_vertex_color );
+                addField( vertexBlock, "blue",  PLY_UCHAR, m_vertexColors.get() + 2, w_vertex_color );
             }
         }
 
@@ -196,8 +713,7 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "intensity",  PLY_FLOAT );
-                vertex_intensity = true;
+                addField( vertexBlock, "intensity", PLY_FLOAT, m_vertexIntensity.get(), sizeof(float) );
             }
         }
 
@@ -212,8 +728,7 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "confidence",  PLY_FLOAT );
-                vertex_confidence = true;
+                addField( vertexBlock, "confidence", PLY_FLOAT, m_vertexConfidence.get(), sizeof(float) );
             }
         }
 
@@ -227,30 +742,29 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "nx", PLY_FLOAT );
-                ply_add_scalar_property( oply, "ny", PLY_FLOAT );
-                ply_add_scalar_property( oply, "nz", PLY_FLOAT );
-                vertex_normal = true;
+                addField( vertexBlock, "nx", PLY_FLOAT, m_vertexNormals.get(),     3 * sizeof(float) );
+                addField( vertexBlock, "ny", PLY_FLOAT, m_vertexNormals.get() + 1, 3 * sizeof(float) );
+                addField( vertexBlock, "nz", PLY_FLOAT, m_vertexNormals.get() + 2, 3 * sizeof(float) );
             }
         }
 
         /* Add faces. */
         if ( m_faceIndices )
         {
-            ply_add_element( oply, "face", m_numFaces );
-            ply_add_list_property( oply, "vertex_indices", PLY_UCHAR, PLY_INT );
+            blocks.push_back( faceBlock( "face", m_numFaces, 1, m_faceIndices.get() ) );
         }
     }
 
     /* Add point element */
     if ( m_points )
     {
-        ply_add_element( oply, "point", m_numPoints );
+        blocks.push_back( scalarBlock( "point", m_numPoints ) );
+        PlyBlock& pointBlock = blocks.back();
 
         /* Add point properties: x, y, z, (r, g, b) */
-        ply_add_scalar_property( oply, "x", PLY_FLOAT );
-        ply_add_scalar_property( oply, "y", PLY_FLOAT );
-        ply_add_scalar_property( oply, "z", PLY_FLOAT );
+        addField( pointBlock, "x", PLY_FLOAT, m_points.get(),     3 * sizeof(float) );
+        addField( pointBlock, "y", PLY_FLOAT, m_points.get() + 1, 3 * sizeof(float) );
+        addField( pointBlock, "z", PLY_FLOAT, m_points.get() + 2, 3 * sizeof(float) );
 
         /* Add color information if there is any. */
         if ( m_pointColors )
@@ -262,10 +776,9 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "red",   PLY_UCHAR );
-                ply_add_scalar_property( oply, "green", PLY_UCHAR );
-                ply_add_scalar_property( oply, "blue",  PLY_UCHAR );
-                point_color = true;
+                addField( pointBlock, "red",   PLY_UCHAR, m_pointColors.get(),     w_point_color );
+                addField( pointBlock, "green", PLY_UCHAR, m_pointColors.get() + 1, w_point_color );
+                addField( pointBlock, "blue",  PLY_UCHAR, m_pointColors.get() + 2, w_point_color );
             }
         }
 
@@ -280,8 +793,7 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "intensity",  PLY_FLOAT );
-                point_intensity = true;
+                addField( pointBlock, "intensity", PLY_FLOAT, m_pointIntensities.get(), sizeof(float) );
             }
         }
 
@@ -296,8 +808,7 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "confidence",  PLY_FLOAT );
-                point_confidence = true;
+                addField( pointBlock, "confidence", PLY_FLOAT, m_pointConfidences.get(), sizeof(float) );
             }
         }
 
@@ -311,94 +822,23 @@ void PLYIO::save( string filename )
             }
             else
             {
-                ply_add_scalar_property( oply, "nx", PLY_FLOAT );
-                ply_add_scalar_property( oply, "ny", PLY_FLOAT );
-                ply_add_scalar_property( oply, "nz", PLY_FLOAT );
-                point_normal = true;
+                addField( pointBlock, "nx", PLY_FLOAT, m_pointNormals.get(),     3 * sizeof(float) );
+                addField( pointBlock, "ny", PLY_FLOAT, m_pointNormals.get() + 1, 3 * sizeof(float) );
+                addField( pointBlock, "nz", PLY_FLOAT, m_pointNormals.get() + 2, 3 * sizeof(float) );
             }
         }
     }
 
-    /* Write header to file. */
-    if ( !ply_write_header( oply ) )
+    /* Second: Write header and data. On little endian hosts the records are
+     * assembled block-wise, otherwise RPly converts every single value. */
+    if ( hostIsLittleEndian() )
     {
-        std::cerr << timestamp << "Could not write header." << std::endl;
-        return;
-    }
-
-    /* Second: Write data. */
-
-    for (size_t i = 0; i < m_numVertices; i++ )
-    {
-        ply_write( oply, (double) m_vertices[ i * 3     ] ); /* x */
-        ply_write( oply, (double) m_vertices[ i * 3 + 1 ] ); /* y */
-        ply_write( oply, (double) m_vertices[ i * 3 + 2 ] ); /* z */
-        if ( vertex_color )
-        {
-            ply_write( oply, m_vertexColors[ i * w_vertex_color     ] ); /* red */
-            ply_write( oply, m_vertexColors[ i * w_vertex_color + 1 ] ); /* green */
-            ply_write( oply, m_vertexColors[ i * w_vertex_color + 2 ] ); /* blue */
-        }
-        if ( vertex_intensity )
-        {
-            ply_write( oply, m_vertexIntensity[ i ] );
-        }
-        if ( vertex_confidence )
-        {
-            ply_write( oply, m_vertexConfidence[ i ] );
-        }
-        if ( vertex_normal )
-        {
-            ply_write( oply, (double) m_vertexNormals[ i * 3     ] ); /* nx */
-            ply_write( oply, (double) m_vertexNormals[ i * 3 + 1 ] ); /* ny */
-            ply_write( oply, (double) m_vertexNormals[ i * 3 + 2 ] ); /* nz */
-        }
-    }
-
-    /* Write faces (Only if we also have vertices). */
-    if ( m_vertices )
-    {
-        for ( size_t i = 0; i < m_numFaces; i++ )
-        {
-            ply_write( oply, 3.0 ); /* Indices per face. */
-            ply_write( oply, (double) m_faceIndices[ i * 3     ] );
-            ply_write( oply, (double) m_faceIndices[ i * 3 + 1 ] );
-            ply_write( oply, (double) m_faceIndices[ i * 3 + 2 ] );
-        }
+        writeBlocks( filename, blocks );
     }
-
-    for ( size_t i = 0; i < m_numPoints; i++ )
+    else
     {
-        ply_write( oply, (double) m_points[ i * 3     ] ); /* x */
-        ply_write( oply, (double) m_points[ i * 3 + 1 ] ); /* y */
-        ply_write( oply, (double) m_points[ i * 3 + 2 ] ); /* z */
-        if ( point_color )
-        {
-            ply_write( oply, m_pointColors[ i * w_point_color     ] ); /* red */
-            ply_write( oply, m_pointColors[ i * w_point_color + 1 ] ); /* green */
-            ply_write( oply, m_pointColors[ i * w_point_color + 2 ] ); /* blue */
-        }
-        if ( point_intensity )
-        {
-            ply_write( oply, m_pointIntensities[ i ] );
-        }
-        if ( point_confidence )
-        {
-            ply_write( oply, m_pointConfidences[ i ] );
-        }
-        if ( point_normal )
-        {
-            ply_write( oply, (double) m_pointNormals[ i * 3     ] ); /* nx */
-            ply_write( oply, (double) m_pointNormals[ i * 3 + 1 ] ); /* ny */
-            ply_write( oply, (double) m_pointNormals[ i * 3 + 2 ] ); /* nz */
-        }
-    }
-
-    if ( !ply_close( oply ) )
-    {
-       std::cerr << timestamp << "Could not close file." << std::endl;
+        writeBlocksRply( filename, blocks );
     }
-
 }
 
 
@@ -707,8 +1147,19 @@ ModelPtr PLYIO::read( string filename, bool readColor, bool readConfidence,
         ply_set_read_cb( ply, "point", "y_coords", readPanoramaCoordCB, &point_panorama_coords, 1 );
     }
 
+    /* Binary little endian files whose properties match our channels are
+     * read block-wise. Everything else is handled by the callbacks above. */
+    PlyChannels vertexChannels = { vertex, vertex_color, vertex_confidence,
+        vertex_intensity, vertex_normal, vertex_panorama_coords };
+    PlyChannels pointChannels = { point, point_color, point_confidence,
+        point_intensity, point_normal, point_panorama_coords };
+    std::vector<PlyBlock> blocks;
+    bool blocksRead = hostIsLittleEndian()
+        && layoutBlocks( ply, vertexChannels, pointChannels, face, blocks )
+        && readBlocks( filename, blocks );
+
     /* Read ply file. */
-    if ( !ply_read( ply ) )
+    if ( !blocksRead && !ply_read( ply ) )
     {
         std::cerr << timestamp << "Could not read »" << filename << "«."
             << std::endl;
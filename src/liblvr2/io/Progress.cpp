@@ -53,7 +53,7 @@ ProgressBar::ProgressBar(size_t max_val, string prefix)
 {
 	m_prefix = prefix;
 	m_maxVal = max_val;
-    m_currentVal = 0;
+	m_currentVal = 0;
 	m_percent = 0;
 
 	if(m_titleCallback)
@@ -82,52 +82,45 @@ void ProgressBar::setProgressTitleCallback(ProgressTitleCallbackPtr ptr)
 
 void ProgressBar::operator++()
 {
-    boost::mutex::scoped_lock lock(m_mutex);
+    *this += 1;
+}
 
-    m_currentVal++;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
-    if (difference < 1)
+void ProgressBar::operator+=(size_t n)
+{
+    // Lock free increment. Only the thread whose increment crosses
+    // a percent step generates output, all others return immediately.
+    size_t old = m_currentVal.fetch_add(n, std::memory_order_relaxed);
+    if (percentOf(old + n) > percentOf(old))
     {
-        return;
+        update();
     }
+}
 
-    while (difference >= 1)
+int ProgressBar::percentOf(size_t val) const
+{
+    if (m_maxVal == 0 || val >= m_maxVal)
     {
-        m_percent++;
-        difference--;
-        print_bar();
-
-        if(m_progressCallback)
-        {
-        	m_progressCallback(m_percent);
-        }
+        return 100;
     }
-
+    return (int)(val * 100 / m_maxVal);
 }
 
-void ProgressBar::operator+=(size_t n)
+void ProgressBar::update()
 {
     boost::mutex::scoped_lock lock(m_mutex);
 
-    m_currentVal+= n;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
-    if (difference < 1)
-    {
-        return;
-    }
-
-    while (difference >= 1)
+    // Catch up with all increments that happened in the meantime
+    int percent = percentOf(m_currentVal.load(std::memory_order_relaxed));
+    while (m_percent < percent)
     {
         m_percent++;
-        difference--;
         print_bar();
 
         if(m_progressCallback)
         {
-            m_progressCallback(m_percent);
+        	m_progressCallback(m_percent);
         }
     }
-
 }
 
 void ProgressBar::print_bar()
@@ -140,21 +133,27 @@ ProgressCounter::ProgressCounter(int stepVal, string prefix)
 	m_prefix = prefix;
 	m_stepVal = stepVal;
 	m_currentVal = 0;
+	m_printedVal = 0;
 }
 
 void ProgressCounter::operator++()
 {
-	boost::mutex::scoped_lock lock(m_mutex);
-	m_currentVal++;
-	if(m_currentVal % m_stepVal == 0)
+	size_t val = m_currentVal.fetch_add(1, std::memory_order_relaxed) + 1;
+	if(val % m_stepVal == 0)
 	{
-		print_progress();
+		boost::mutex::scoped_lock lock(m_mutex);
+		// Another thread may already have printed a larger value
+		if(val > m_printedVal)
+		{
+			m_printedVal = val;
+			print_progress(val);
+		}
 	}
 }
 
-void ProgressCounter::print_progress()
+void ProgressCounter::print_progress(size_t val)
 {
-	cout << "\r" << m_prefix << " " << m_currentVal << flush;
+	cout << "\r" << m_prefix << " " << val << flush;
 }
 
 PacmanProgressCallbackPtr PacmanProgressBar::m_progressCallback = 0;
@@ -166,7 +165,7 @@ PacmanProgressBar::PacmanProgressBar(size_t max_val, string prefix, size_t bar_l
 	,m_bar_length(bar_length)
 {
 	m_maxVal = max_val;
-    m_currentVal = 0;
+	m_currentVal = 0;
 	m_percent = 0;
 
 	if(m_titleCallback)
@@ -195,20 +194,30 @@ void PacmanProgressBar::setProgressTitleCallback(ProgressTitleCallbackPtr ptr)
 
 void PacmanProgressBar::operator++()
 {
-    boost::mutex::scoped_lock lock(m_mutex);
-
-    m_currentVal++;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
+    size_t old = m_currentVal.fetch_add(1, std::memory_order_relaxed);
+    if (percentOf(old + 1) > percentOf(old))
+    {
+        update();
+    }
+}
 
-	if (difference < 1)
+int PacmanProgressBar::percentOf(size_t val) const
+{
+    if (m_maxVal == 0 || val >= m_maxVal)
     {
-        return;
+        return 100;
     }
+    return (int)(val * 100 / m_maxVal);
+}
 
-    while (difference >= 1)
+void PacmanProgressBar::update()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    int percent = percentOf(m_currentVal.load(std::memory_order_relaxed));
+    while (m_percent < percent)
     {
         m_percent++;
-        difference--;
         print_bar();
 
         if(m_progressCallback)
@@ -216,7 +225,6 @@ void PacmanProgressBar::operator++()
         	m_progressCallback(m_percent);
         }
     }
-
 }
 
 void PacmanProgressBar::print_bar()
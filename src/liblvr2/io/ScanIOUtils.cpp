@@ -489,7 +489,8 @@ bool loadScan(
     Scan& scan,
     const std::string& positionDirectory,
     const std::string& scanSubDirectory,
-    const std::string& scanName)
+    const std::string& scanName,
+    bool loadPoints)
 {
 
     boost::filesystem::path scanDirectoryPath = root / positionDirectory / scanSubDirectory;
@@ -512,14 +513,25 @@ bool loadScan(
         YAML::Node meta = YAML::LoadFile(metaPath.string());
         scan = meta.as<Scan>();
 
-        // Load scan
+        // Remember where the points are, so they can be loaded later
         boost::filesystem::path scanFile = scanDataPath / (scanName + ".ply");
+        scan.scanRoot = scanDataPath;
+        scan.scanFile = scanName + ".ply";
+        scan.pointsLoaded = false;
+
+        if(!loadPoints)
+        {
+            return true;
+        }
+
+        // Load scan
         std::cout << timestamp << "Loading " << scanFile << std::endl;
         ModelPtr model = ModelFactory::readModel(scanFile.string());
 
-        if(model->m_pointCloud)
+        if(model && model->m_pointCloud)
         {
             scan.points = model->m_pointCloud;
+            scan.pointsLoaded = true;
         }
         else
         {
@@ -539,19 +551,21 @@ bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const std::string& positionDirectory,
-    const size_t& scanNumber)
+    const size_t& scanNumber,
+    bool loadPoints)
 {
     std::stringstream scanStr;
     scanStr << std::setfill('0') << std::setw(8) << scanNumber;
 
-    return loadScan(root, scan, positionDirectory, "scans", scanStr.str());
+    return loadScan(root, scan, positionDirectory, "scans", scanStr.str(), loadPoints);
 }
 
 bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const size_t& positionNumber,
-    const size_t& scanNumber)
+    const size_t& scanNumber,
+    bool loadPoints)
 {
     std::stringstream posStr;
     posStr << std::setfill('0') << std::setw(8) << positionNumber;
@@ -559,7 +573,7 @@ bool loadScan(
     std::stringstream scanStr;
     scanStr << std::setfill('0') << std::setw(8) << scanNumber;
 
-    return loadScan(root, scan, posStr.str(), "scans", scanStr.str());
+    return loadScan(root, scan, posStr.str(), "scans", scanStr.str(), loadPoints);
 }
 
 
@@ -951,7 +965,8 @@ void saveScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const std::string& positionDirectory)
+    const std::string& positionDirectory,
+    bool loadPoints)
 {
 
     boost::filesystem::path scanPosDir = root / positionDirectory;
@@ -991,7 +1006,7 @@ bool loadScanPosition(
                     std::string scanName = itScans->path().stem().string();
                     ScanPtr scan(new Scan);
 
-                    if(loadScan(root, *scan, positionDirectory, it->path().stem().string(), scanName))
+                    if(loadScan(root, *scan, positionDirectory, it->path().stem().string(), scanName, loadPoints))
                     {
                         scanPos.scans.push_back(scan);
                     }
@@ -1032,11 +1047,12 @@ bool loadScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const size_t& positionNumber)
+    const size_t& positionNumber,
+    bool loadPoints)
 {
     std::stringstream posStr;
     posStr << std::setfill('0') << std::setw(8) << positionNumber;
-    return loadScanPosition(root, scanPos, posStr.str());
+    return loadScanPosition(root, scanPos, posStr.str(), loadPoints);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -1082,7 +1098,8 @@ void saveScanProject(
 
 bool loadScanProject(
     const boost::filesystem::path& root,
-    ScanProject& scanProj)
+    ScanProject& scanProj,
+    bool loadPoints)
 {
     if(!boost::filesystem::exists(root))
     {
@@ -1113,7 +1130,7 @@ bool loadScanProject(
             std::cout << *it << '\n';
             ScanPositionPtr scanPos(new ScanPosition);
 
-            loadScanPosition(root, *scanPos, it->filename().string());
+            loadScanPosition(root, *scanPos, it->filename().string(), loadPoints);
             scanProj.positions.push_back(scanPos);
         }
 
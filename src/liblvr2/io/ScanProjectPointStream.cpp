@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lvr2/io/ScanProjectPointStream.hpp"
+#include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/Timestamp.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace lvr2
+{
+
+ScanProjectPointStream::ScanProjectPointStream(
+    ScanProjectPtr project,
+    size_t blockSize,
+    const std::vector<bool>& positions,
+    bool firstScanOnly)
+    : m_project(project),
+      m_blockSize(std::max<size_t>(blockSize, 1)),
+      m_positions(positions),
+      m_firstScanOnly(firstScanOnly),
+      m_numPoints(0),
+      m_finished(false),
+      m_stop(false)
+{
+    m_thread = boost::thread(&ScanProjectPointStream::readScans, this);
+}
+
+ScanProjectPointStream::~ScanProjectPointStream()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+ScanProjectPointStream::BlockPtr ScanProjectPointStream::next()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_queue.empty() && !m_finished)
+    {
+        m_condition.wait(lock);
+    }
+
+    if (m_queue.empty())
+    {
+        if (m_error)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return nullptr;
+    }
+
+    BlockPtr block = m_queue.front();
+    m_queue.pop_front();
+    m_numPoints += block->numPoints;
+    lock.unlock();
+    m_condition.notify_all();
+    return block;
+}
+
+bool ScanProjectPointStream::push(BlockPtr block)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_queue.size() >= m_maxQueued && !m_stop)
+    {
+        m_condition.wait(lock);
+    }
+
+    if (m_stop)
+    {
+        return false;
+    }
+
+    m_queue.push_back(block);
+    lock.unlock();
+    m_condition.notify_all();
+    return true;
+}
+
+void ScanProjectPointStream::readScans()
+{
+    try
+    {
+        for (size_t i = 0; i < m_project->positions.size(); i++)
+        {
+            if (!m_positions.empty() && (i >= m_positions.size() || !m_positions[i]))
+            {
+                continue;
+            }
+
+            ScanPositionPtr pos = m_project->positions[i];
+            size_t numScans = m_firstScanOnly ? std::min<size_t>(pos->scans.size(), 1) : pos->scans.size();
+            for (size_t j = 0; j < numScans; j++)
+            {
+                ScanPtr scan = pos->scans[j];
+
+                // Scans that are not in memory are only held while they are split into blocks
+                PointBufferPtr points = scan->points;
+                if (!points && !scan->scanFile.empty())
+                {
+                    boost::filesystem::path scanFile = scan->scanRoot / scan->scanFile;
+                    ModelPtr model = ModelFactory::readModel(scanFile.string());
+                    if (model && model->m_pointCloud)
+                    {
+                        points = model->m_pointCloud;
+                    }
+                }
+                if (!points)
+                {
+                    std::cout << timestamp << "Warning: Scan " << j << " of position "
+                              << i << " has no points." << std::endl;
+                    continue;
+                }
+
+                size_t numPoints = points->numPoints();
+                floatArr pointArray = points->getPointArray();
+                floatArr normalArray = points->getNormalArray();
+                size_t colorWidth = 0;
+                ucharArr colorArray = points->getColorArray(colorWidth);
+                if (colorWidth < 3)
+                {
+                    colorArray.reset();
+                }
+
+                Transformd pose = scan->registration;
+                Rotationd rotation = pose.block<3, 3>(0, 0);
+
+                for (size_t first = 0; first < numPoints; first += m_blockSize)
+                {
+                    size_t n = std::min(m_blockSize, numPoints - first);
+
+                    BlockPtr block(new Block);
+                    block->numPoints = n;
+                    block->position = i;
+                    block->scan = j;
+                    block->points = floatArr(new float[n * 3]);
+                    if (normalArray)
+                    {
+                        block->normals = floatArr(new float[n * 3]);
+                    }
+                    if (colorArray)
+                    {
+                        block->colors = ucharArr(new unsigned char[n * 3]);
+                    }
+
+                    #pragma omp parallel for
+                    for (long k = 0; k < (long)n; k++)
+                    {
+                        size_t src = first + k;
+                        Eigen::Vector4d point(
+                            pointArray[src * 3], pointArray[src * 3 + 1], pointArray[src * 3 + 2], 1);
+                        Eigen::Vector4d transPoint = pose * point;
+                        block->points[k * 3] = transPoint[0];
+                        block->points[k * 3 + 1] = transPoint[1];
+                        block->points[k * 3 + 2] = transPoint[2];
+
+                        if (normalArray)
+                        {
+                            Eigen::Vector3d normal(
+                                normalArray[src * 3], normalArray[src * 3 + 1], normalArray[src * 3 + 2]);
+                            Eigen::Vector3d transNormal = rotation * normal;
+                            block->normals[k * 3] = transNormal[0];
+                            block->normals[k * 3 + 1] = transNormal[1];
+                            block->normals[k * 3 + 2] = transNormal[2];
+                        }
+                        if (colorArray)
+                        {
+                            std::copy(colorArray.get() + src * colorWidth,
+                                      colorArray.get() + src * colorWidth + 3,
+                                      block->colors.get() + k * 3);
+                        }
+                    }
+
+                    if (!push(block))
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_error = std::current_exception();
+    }
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_finished = true;
+    }
+    m_condition.notify_all();
+}
+
+} // namespace lvr2
@@ -74,32 +74,14 @@ void HDF5Kernel::saveImage(
             // Couldnt write as H5Image, write as blob
 
             std::vector<size_t> dims = {static_cast<size_t>(img.rows), static_cast<size_t>(img.cols)};
-            std::vector<hsize_t> chunkSizes = {static_cast<hsize_t>(img.rows), static_cast<hsize_t>(img.cols)};
 
             if(img.channels() > 1)
             {
                 dims.push_back(img.channels());
-                chunkSizes.push_back(img.channels());
             }
 
             HighFive::DataSpace dataSpace(dims);
-            HighFive::DataSetCreateProps properties;
-
-            // if(m_hdf5File->m_chunkSize)
-            // {
-            //     for(size_t i = 0; i < chunkSizes.size(); i++)
-            //     {
-            //         if(chunkSizes[i] > dims[i])
-            //         {
-            //             chunkSizes[i] = dims[i];
-            //         }
-            //     }
-            //     properties.add(HighFive::Chunking(chunkSizes));
-            // }
-            // if(m_hdf5File->m_compress)
-            // {
-            //     properties.add(HighFive::Deflate(9));
-            // }
+            HighFive::DataSetCreateProps properties = createProperties(datasetName, dims, img.elemSize1());
 
             // Single Channel Type
             const int SCTYPE = img.type() % 8;
@@ -231,6 +213,14 @@ MeshBufferPtr HDF5Kernel::loadMeshBuffer(
 PointBufferPtr HDF5Kernel::loadPointBuffer(
     const std::string &group,
     const std::string &container) const
+{
+    return loadPointBufferSelection(group, container, ArraySelection());
+}
+
+PointBufferPtr HDF5Kernel::loadPointBufferSelection(
+    const std::string &group,
+    const std::string &container,
+    const ArraySelection &rows) const
 {
     HighFive::Group g = hdf5util::getGroup(m_hdf5File, group);
     PointBufferPtr ret;
@@ -258,7 +248,7 @@ PointBufferPtr HDF5Kernel::loadPointBuffer(
         {
             // name is dataset
             boost::optional<PointBuffer::val_type> opt_vchannel
-                 = this->template load<PointBuffer::val_type>(group, name);
+                 = this->template load<PointBuffer::val_type>(group, name, rows);
             
             if(opt_vchannel)
             {
@@ -360,6 +350,76 @@ void HDF5Kernel::loadMetaData(const YAML::Node& node)
     
 }
 
+void HDF5Kernel::setDatasetConfig(const HDF5DatasetConfig& config)
+{
+    m_defaultDatasetConfig = config;
+}
+
+void HDF5Kernel::setDatasetConfig(const std::string& datasetName, const HDF5DatasetConfig& config)
+{
+    m_datasetConfigs[datasetName] = config;
+}
+
+const HDF5DatasetConfig& HDF5Kernel::datasetConfig(const std::string& datasetName) const
+{
+    auto it = m_datasetConfigs.find(datasetName);
+    return it != m_datasetConfigs.end() ? it->second : m_defaultDatasetConfig;
+}
+
+HighFive::DataSetCreateProps HDF5Kernel::createProperties(
+    const std::string& datasetName,
+    const std::vector<size_t>& dims,
+    size_t elementSize) const
+{
+    HighFive::DataSetCreateProps properties;
+    const HDF5DatasetConfig& config = datasetConfig(datasetName);
+
+    size_t chunkRows = config.chunkRows;
+    if (chunkRows == 0 && config.compression == 0)
+    {
+        return properties;
+    }
+
+    // HDF5 can't chunk empty datasets
+    size_t rowSize = elementSize;
+    for (size_t i = 0; i < dims.size(); i++)
+    {
+        if (dims[i] == 0)
+        {
+            return properties;
+        }
+        if (i > 0)
+        {
+            rowSize *= dims[i];
+        }
+    }
+    if (dims.empty())
+    {
+        return properties;
+    }
+
+    if (chunkRows == 0)
+    {
+        chunkRows = std::max<size_t>(1, (1 << 20) / rowSize);
+    }
+
+    // The chunk size must not exceed the dataset
+    std::vector<hsize_t> chunkSizes(dims.begin(), dims.end());
+    chunkSizes[0] = std::min(chunkRows, dims[0]);
+    properties.add(HighFive::Chunking(chunkSizes));
+
+    if (config.compression > 0)
+    {
+        if (config.shuffle)
+        {
+            properties.add(HighFive::Shuffle());
+        }
+        properties.add(HighFive::Deflate(std::min(config.compression, 9u)));
+    }
+
+    return properties;
+}
+
 void HDF5Kernel::loadMetaYAML(
     const std::string &group,
     const std::string &container,
@@ -435,6 +495,33 @@ doubleArr HDF5Kernel::loadDoubleArray(
     return this->template loadArray<double>(group, container, dims);
 }
 
+ucharArr HDF5Kernel::loadUCharArraySelection(
+    const std::string &group,
+    const std::string &container,
+    const ArraySelection &selection,
+    std::vector<size_t> &dims) const
+{
+    return this->template loadArray<unsigned char>(group, container, selection, dims);
+}
+
+floatArr HDF5Kernel::loadFloatArraySelection(
+    const std::string &group,
+    const std::string &container,
+    const ArraySelection &selection,
+    std::vector<size_t> &dims) const
+{
+    return this->template loadArray<float>(group, container, selection, dims);
+}
+
+doubleArr HDF5Kernel::loadDoubleArraySelection(
+    const std::string &group,
+    const std::string &container,
+    const ArraySelection &selection,
+    std::vector<size_t> &dims) const
+{
+    return this->template loadArray<double>(group, container, selection, dims);
+}
+
 void HDF5Kernel::saveFloatArray(
     const std::string &groupName,
     const std::string &datasetName,
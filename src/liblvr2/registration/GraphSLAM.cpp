@@ -397,6 +397,8 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
 
     size_t pairs = KDTree::nearestNeighbors(tree, scan, results, m_options->slamMaxDistance);
 
+    const vector<Vector3d>& points = scan->points();
+
     Vector6d mz = Vector6d::Zero();
     Vector3d sum = Vector3d::Zero();
     double xy, yz, xz, ypz, xpz, xpy;
@@ -409,7 +411,7 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
             continue;
         }
 
-        Vector3d p = scan->point(i).cast<double>();
+        const Vector3d& p = points[i];
         Vector3d r = results[i]->cast<double>();
 
         Vector3d mid = (p + r) / 2.0;
@@ -462,7 +464,7 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
             continue;
         }
 
-        Vector3d p = scan->point(i).cast<double>();
+        const Vector3d& p = points[i];
         Vector3d r = results[i]->cast<double>();
 
         Vector3d mid = (p + r) / 2.0;
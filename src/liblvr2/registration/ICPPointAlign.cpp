@@ -33,6 +33,7 @@
  */
 #include "lvr2/registration/ICPPointAlign.hpp"
 #include "lvr2/registration/EigenSVDPointAlign.hpp"
+#include "lvr2/registration/Metascan.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
 #include <iomanip>
@@ -50,9 +51,8 @@ ICPPointAlign::ICPPointAlign(SLAMScanPtr model, SLAMScanPtr data) :
     m_maxDistanceMatch  = 25;
     m_maxIterations     = 50;
     m_epsilon           = 0.00001;
+    m_maxLeafSize       = 20;
     m_verbose           = false;
-
-    m_searchTree = KDTree::create(model, m_maxLeafSize);
 }
 
 Transformd ICPPointAlign::match()
@@ -73,6 +73,11 @@ Transformd ICPPointAlign::match()
     Transformd transform = Matrix4d::Identity();
     Transformd delta = Matrix4d::Identity();
 
+    // Built here instead of the constructor, so that setMaxLeafSize() is respected.
+    // A Metascan keeps its Tree and only extends it with newly added Scans
+    Metascan* metascan = dynamic_cast<Metascan*>(m_modelCloud.get());
+    m_searchTree = metascan ? metascan->searchTree(m_maxLeafSize) : KDTree::create(m_modelCloud, m_maxLeafSize);
+
     size_t numPoints = m_dataCloud->numPoints();
 
     KDTree::Neighbor* neighbors = new KDTree::Neighbor[numPoints];
@@ -34,63 +34,27 @@
 #include "lvr2/registration/KDTree.hpp"
 #include "lvr2/registration/AABB.hpp"
 
-namespace lvr2
-{
+#include <algorithm>
 
-class KDNode : public KDTree
+namespace lvr2
 {
-public:
-    KDNode(int axis, double split, KDTreePtr& lesser, KDTreePtr& greater)
-        : axis(axis), split(split), lesser(move(lesser)), greater(move(greater))
-    { }
-
-protected:
-    virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const override
-    {
-        double val = point(this->axis);
-        if (val < this->split)
-        {
-            this->lesser->nnInternal(point, neighbor, maxDist);
-            if (val + maxDist >= this->split)
-            {
-                this->greater->nnInternal(point, neighbor, maxDist);
-            }
-        }
-        else
-        {
-            this->greater->nnInternal(point, neighbor, maxDist);
-            if (val - maxDist <= this->split)
-            {
-                this->lesser->nnInternal(point, neighbor, maxDist);
-            }
-        }
-    }
 
-private:
-    int axis;
-    double split;
-    KDTreePtr lesser;
-    KDTreePtr greater;
-};
-
-class KDLeaf : public KDTree
+void KDTree::nnInternal(const Block& block, unsigned int nodeIndex, const Point& point, Neighbor& neighbor, double& maxDist) const
 {
-public:
-    KDLeaf(Point* points, int count)
-        : points(points), count(count)
-    { }
+    const Node& node = block.nodes[nodeIndex];
 
-protected:
-    virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const override
+    if (node.axis < 0)
     {
+        // Leaf: check all of its points
         double maxDistSq = maxDist * maxDist;
         bool changed = false;
-        for (int i = 0; i < this->count; i++)
+        Point* leafPoints = block.points.get() + node.first;
+        for (unsigned int i = 0; i < node.count; i++)
         {
-            double dist = (point - this->points[i]).squaredNorm();
+            double dist = (point - leafPoints[i]).squaredNorm();
             if (dist < maxDistSq)
             {
-                neighbor = &this->points[i];
+                neighbor = &leafPoints[i];
                 maxDistSq = dist;
                 changed = true;
             }
@@ -99,77 +63,174 @@ protected:
         {
             maxDist = sqrt(maxDistSq);
         }
+        return;
     }
 
-private:
-    Point* points;
-    int count;
-};
+    unsigned int lesser = node.first;
+    unsigned int greater = node.first + 1;
 
-KDTreePtr create_recursive(KDTree::Point* points, int n, int maxLeafSize)
-{
-    if (n <= maxLeafSize)
+    double val = point(node.axis);
+    if (val < node.split)
     {
-        return KDTreePtr(new KDLeaf(points, n));
+        nnInternal(block, lesser, point, neighbor, maxDist);
+        if (val + maxDist >= node.split)
+        {
+            nnInternal(block, greater, point, neighbor, maxDist);
+        }
     }
+    else
+    {
+        nnInternal(block, greater, point, neighbor, maxDist);
+        if (val - maxDist <= node.split)
+        {
+            nnInternal(block, lesser, point, neighbor, maxDist);
+        }
+    }
+}
 
-    AABB<float> boundingBox(points, n);
+KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
+{
+    const std::vector<Vector3d>& points = scan->points();
+    return create(points.data(), points.size(), maxLeafSize);
+}
 
-    int splitAxis = boundingBox.longestAxis();
-    double splitValue = boundingBox.avg()(splitAxis);
+KDTreePtr KDTree::create(const Vector3d* points, size_t n, int maxLeafSize)
+{
+    KDTreePtr ret(new KDTree());
+    ret->maxLeafSize = maxLeafSize;
+    ret->extend(points, n);
+    return ret;
+}
 
-    if (boundingBox.difference(splitAxis) == 0.0) // all points are exactly the same
+void KDTree::extend(const Vector3d* newPoints, size_t n)
+{
+    if (n == 0 && !blocks.empty())
     {
-        // this case is rare, but would lead to an infinite recursion loop if not handled,
-        // since all Points would end up in the "lesser" branch every time
-
-        // there is no need to check all of them later on, so just pretend like there is only one
-        return KDTreePtr(new KDLeaf(points, 1));
+        return;
     }
 
-    int l = splitPoints(points, n, splitAxis, splitValue);
-
-    KDTreePtr lesser, greater;
-
-    if (n > 8 * maxLeafSize) // stop the omp task subdivision early to avoid spamming tasks
+    // Merge all trailing Blocks that are not larger than the new one
+    size_t total = n;
+    size_t firstMerged = blocks.size();
+    while (firstMerged > 0 && blocks[firstMerged - 1].numPoints <= total)
     {
-        #pragma omp task shared(lesser)
-        lesser  = create_recursive(points    , l    , maxLeafSize);
+        firstMerged--;
+        total += blocks[firstMerged].numPoints;
+    }
 
-        #pragma omp task shared(greater)
-        greater = create_recursive(points + l, n - l, maxLeafSize);
+    Block block;
+    block.numPoints = total;
+    block.points = boost::shared_array<Point>(new Point[total]);
 
-        #pragma omp taskwait
+    size_t offset = 0;
+    for (size_t b = firstMerged; b < blocks.size(); b++)
+    {
+        std::copy_n(blocks[b].points.get(), blocks[b].numPoints, block.points.get() + offset);
+        offset += blocks[b].numPoints;
     }
-    else
+
+    Point* target = block.points.get() + offset;
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
     {
-        lesser  = create_recursive(points    , l    , maxLeafSize);
-        greater = create_recursive(points + l, n - l, maxLeafSize);
+        target[i] = newPoints[i].cast<PointT>();
     }
 
-    return KDTreePtr(new KDNode(splitAxis, splitValue, lesser, greater));
+    blocks.resize(firstMerged);
+    buildBlock(block, maxLeafSize);
+    blocks.push_back(std::move(block));
 }
 
-KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
+size_t KDTree::numPoints() const
 {
-    KDTreePtr ret;
+    size_t ret = 0;
+    for (const Block& block : blocks)
+    {
+        ret += block.numPoints;
+    }
+    return ret;
+}
 
-    size_t n = scan->numPoints();
-    auto points = boost::shared_array<Point>(new Point[n]);
+void KDTree::buildBlock(Block& block, int maxLeafSize)
+{
+    size_t n = block.numPoints;
+    Point* points = block.points.get();
 
-    #pragma omp parallel for schedule(static)
-    for (size_t i = 0; i < n; i++)
+    // A range of points that still has to be turned into a Node
+    struct Range
     {
-        points[i] = scan->point(i).cast<PointT>();
-    }
+        unsigned int node;
+        unsigned int first;
+        unsigned int count;
+    };
+
+    // Build the Tree level by level, so that all Nodes end up in breadth-first order
+    std::vector<Node>& nodes = block.nodes;
+    nodes.push_back(Node());
+    std::vector<Range> level = { Range{ 0, 0, (unsigned int)n } };
+    std::vector<unsigned int> lesserCount;
+
+    while (!level.empty())
+    {
+        lesserCount.assign(level.size(), 0);
 
-    #pragma omp parallel // allows "pragma omp task"
-    #pragma omp single // only execute every task once
-    ret = create_recursive(points.get(), n, maxLeafSize);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t r = 0; r < level.size(); r++)
+        {
+            const Range& range = level[r];
+            Node& node = nodes[range.node];
+            node.axis = -1;
+            node.first = range.first;
+            node.count = range.count;
 
-    ret->points = points;
+            if (range.count <= (unsigned int)maxLeafSize)
+            {
+                continue;
+            }
 
-    return ret;
+            Point* rangePoints = points + range.first;
+            AABB<float> boundingBox(rangePoints, range.count);
+
+            int splitAxis = boundingBox.longestAxis();
+            double splitValue = boundingBox.avg()(splitAxis);
+
+            if (boundingBox.difference(splitAxis) == 0.0) // all points are exactly the same
+            {
+                // this case is rare, but would lead to an infinite loop if not handled,
+                // since all Points would end up in the "lesser" branch every time
+
+                // there is no need to check all of them later on, so just pretend like there is only one
+                node.count = 1;
+                continue;
+            }
+
+            node.axis = splitAxis;
+            node.split = splitValue;
+            lesserCount[r] = splitPoints(rangePoints, range.count, splitAxis, splitValue);
+        }
+
+        // Append the children of all inner Nodes of this level
+        std::vector<Range> nextLevel;
+        for (size_t r = 0; r < level.size(); r++)
+        {
+            const Range& range = level[r];
+            Node& node = nodes[range.node];
+            if (node.axis < 0)
+            {
+                continue;
+            }
+
+            unsigned int lesser = nodes.size();
+            node.first = lesser;
+            node.count = 0;
+            nodes.push_back(Node());
+            nodes.push_back(Node());
+
+            nextLevel.push_back(Range{ lesser, range.first, lesserCount[r] });
+            nextLevel.push_back(Range{ lesser + 1, range.first + lesserCount[r], range.count - lesserCount[r] });
+        }
+        level.swap(nextLevel);
+    }
 }
 
 
@@ -180,12 +241,13 @@ size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighb
     centroid_m = Vector3d::Zero();
     centroid_d = Vector3d::Zero();
 
-    for (size_t i = 0; i < scan->numPoints(); i++)
+    const std::vector<Vector3d>& points = scan->points();
+    for (size_t i = 0; i < points.size(); i++)
     {
         if (neighbors[i] != nullptr)
         {
             centroid_m += neighbors[i]->cast<double>();
-            centroid_d += scan->point(i);
+            centroid_d += points[i];
         }
     }
 
@@ -200,10 +262,12 @@ size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighb
     size_t found = 0;
     double distance = 0.0;
 
+    const std::vector<Vector3d>& points = scan->points();
+
     #pragma omp parallel for firstprivate(distance) reduction(+:found) schedule(dynamic,8)
-    for (size_t i = 0; i < scan->numPoints(); i++)
+    for (size_t i = 0; i < points.size(); i++)
     {
-        if (tree->nearestNeighbor(scan->point(i), neighbors[i], distance, maxDistance))
+        if (tree->nearestNeighbor(points[i], neighbors[i], distance, maxDistance))
         {
             found++;
         }
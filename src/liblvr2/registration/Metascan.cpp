@@ -33,11 +33,13 @@
  */
 #include "lvr2/registration/Metascan.hpp"
 
+#include <algorithm>
+
 namespace lvr2
 {
 
 Metascan::Metascan()
-    : SLAMScanWrapper(ScanPtr(nullptr))
+    : SLAMScanWrapper(ScanPtr(nullptr)), m_offsets(1, 0), m_treeLeafSize(0), m_treeScans(0)
 {
 
 }
@@ -58,22 +60,78 @@ void Metascan::transform(const Transformd& transform, bool writeFrame, FrameUse
 
 Vector3d Metascan::point(size_t index) const
 {
-    for (auto& scan : m_scans)
+    if (index >= m_numPoints)
     {
-        if (index < scan->numPoints())
+        return Vector3d();
+    }
+    size_t scan = std::upper_bound(m_offsets.begin(), m_offsets.end(), index) - m_offsets.begin() - 1;
+    return m_scans[scan]->point(index - m_offsets[scan]);
+}
+
+const std::vector<Vector3d>& Metascan::points() const
+{
+    std::lock_guard<std::mutex> lock(m_globalMutex);
+    updatePoints();
+    return m_globalPoints;
+}
+
+bool Metascan::updatePoints() const
+{
+    bool changed = false;
+
+    m_globalPoints.resize(m_numPoints);
+    for (size_t i = 0; i < m_scans.size(); i++)
+    {
+        const SLAMScanPtr& scan = m_scans[i];
+        if (i < m_scanPoses.size())
+        {
+            if (m_scanPoses[i] == scan->pose())
+            {
+                continue;
+            }
+            m_scanPoses[i] = scan->pose();
+            changed = true;
+        }
+        else
         {
-            return scan->point(index);
+            m_scanPoses.push_back(scan->pose());
+        }
+
+        if (scan->numPoints() > 0)
+        {
+            transformPoints(&scan->rawPoint(0), scan->numPoints(), scan->pose(), m_globalPoints.data() + m_offsets[i]);
         }
-        index -= scan->numPoints();
     }
-    return Vector3d();
+
+    return changed;
 }
 
 void Metascan::addScan(SLAMScanPtr scan)
 {
     m_scans.push_back(scan);
     m_numPoints += scan->numPoints();
+    m_offsets.push_back(m_numPoints);
     m_deltaPose = scan->deltaPose();
 }
 
+KDTreePtr Metascan::searchTree(int maxLeafSize)
+{
+    std::lock_guard<std::mutex> lock(m_globalMutex);
+    bool changed = updatePoints();
+
+    if (!m_searchTree || changed || maxLeafSize != m_treeLeafSize)
+    {
+        m_searchTree = KDTree::create(m_globalPoints.data(), m_globalPoints.size(), maxLeafSize);
+        m_treeLeafSize = maxLeafSize;
+    }
+    else if (m_treeScans < m_scans.size())
+    {
+        size_t first = m_offsets[m_treeScans];
+        m_searchTree->extend(m_globalPoints.data() + first, m_numPoints - first);
+    }
+    m_treeScans = m_scans.size();
+
+    return m_searchTree;
+}
+
 } /* namespace lvr2 */
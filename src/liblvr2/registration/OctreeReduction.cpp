@@ -2,6 +2,7 @@
 #include "lvr2/registration/OctreeReduction.hpp"
 #include "lvr2/io/IOUtils.hpp"
 
+#include <algorithm>
 #include <vector>
 
 namespace lvr2
@@ -29,9 +30,101 @@ OctreeReduction::OctreeReduction(
         lvr2::Channel<float> points = *pts_opt;
         AABB<float> boundingBox(points, n);
 
-        #pragma omp parallel // allows "pragma omp task"
-        #pragma omp single   // only execute every task once
-        createOctree(pointBuffer, 0, n, m_flags, boundingBox.min(), boundingBox.max(), 0);
+        reducePoints(points, boundingBox.min(), boundingBox.max());
+    }
+    else
+    {
+        std::cout << timestamp << "Error: OctreeReduction: Unable to get point channel." << std::endl;
+    }
+}
+
+uint64_t OctreeReduction::voxelKey(const Vector3f& point, Vector3f min, Vector3f max, Vector3f& center) const
+{
+    uint64_t key = 1;
+    for (int level = 0; ; level++)
+    {
+        int axis = level % 3;
+        center = (max + min) / 2.0;
+        if (max[axis] - min[axis] <= m_voxelSize || level == 63)
+        {
+            return key;
+        }
+
+        // Same split as in splitPoints: smaller values go to the left
+        key <<= 1;
+        if (point[axis] < center[axis])
+        {
+            max[axis] = center[axis];
+        }
+        else
+        {
+            min[axis] = center[axis];
+            key |= 1;
+        }
+    }
+}
+
+void OctreeReduction::reducePoints(const lvr2::Channel<float>& points, const Vector3f& min, const Vector3f& max)
+{
+    size_t n = points.numElements();
+    if (n <= m_minPointsPerVoxel)
+    {
+        return;
+    }
+
+    std::vector<std::pair<uint64_t, size_t>> keys(n);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+    {
+        Vector3f center;
+        keys[i].first = voxelKey(Vector3f(points[i][0], points[i][1], points[i][2]), min, max, center);
+        keys[i].second = i;
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    // Start of every voxel in the sorted keys
+    std::vector<size_t> voxels;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (i == 0 || keys[i].first != keys[i - 1].first)
+        {
+            voxels.push_back(i);
+        }
+    }
+    voxels.push_back(n);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < voxels.size() - 1; v++)
+    {
+        size_t first = voxels[v];
+        size_t last = voxels[v + 1];
+        if (last - first <= m_minPointsPerVoxel)
+        {
+            continue;
+        }
+
+        // Keep the Point closest to the center
+        Vector3f center;
+        size_t closest = keys[first].second;
+        voxelKey(Vector3f(points[closest][0], points[closest][1], points[closest][2]), min, max, center);
+        double minDist = (Vector3f(points[closest][0], points[closest][1], points[closest][2]) - center).squaredNorm();
+        for (size_t i = first + 1; i < last; i++)
+        {
+            size_t index = keys[i].second;
+            double dist = (Vector3f(points[index][0], points[index][1], points[index][2]) - center).squaredNorm();
+            if (dist < minDist)
+            {
+                closest = index;
+                minDist = dist;
+            }
+        }
+
+        // Flag all other Points for deletion
+        for (size_t i = first; i < last; i++)
+        {
+            m_flags[keys[i].second] = keys[i].second != closest;
+        }
     }
 }
 
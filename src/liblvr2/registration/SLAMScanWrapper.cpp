@@ -43,7 +43,7 @@ namespace lvr2
 {
 
 SLAMScanWrapper::SLAMScanWrapper(ScanPtr scan)
-    : m_scan(scan), m_deltaPose(Transformd::Identity())
+    : m_scan(scan), m_deltaPose(Transformd::Identity()), m_globalValid(false)
 {
     if (m_scan)
     {
@@ -90,6 +90,7 @@ void SLAMScanWrapper::reduce(double voxelSize, int maxLeafSize)
 {
     m_numPoints = octreeReduce(m_points.data(), m_numPoints, voxelSize, maxLeafSize);
     m_points.resize(m_numPoints);
+    m_globalValid = false;
 }
 
 void SLAMScanWrapper::setMinDistance(double minDistance)
@@ -110,6 +111,7 @@ void SLAMScanWrapper::setMinDistance(double minDistance)
         }
     }
     m_points.resize(m_numPoints);
+    m_globalValid = false;
 }
 
 void SLAMScanWrapper::setMaxDistance(double maxDistance)
@@ -130,6 +132,7 @@ void SLAMScanWrapper::setMaxDistance(double maxDistance)
         }
     }
     m_points.resize(m_numPoints);
+    m_globalValid = false;
 }
 
 void SLAMScanWrapper::trim()
@@ -145,6 +148,31 @@ Vector3d SLAMScanWrapper::point(size_t index) const
     return (pose() * extended).block<3, 1>(0, 0);
 }
 
+const std::vector<Vector3d>& SLAMScanWrapper::points() const
+{
+    std::lock_guard<std::mutex> lock(m_globalMutex);
+
+    if (!m_globalValid || m_globalPose != pose())
+    {
+        m_globalPoints.resize(m_numPoints);
+        transformPoints(m_points.data(), m_numPoints, pose(), m_globalPoints.data());
+        m_globalPose = pose();
+        m_globalValid = true;
+    }
+    return m_globalPoints;
+}
+
+void SLAMScanWrapper::transformPoints(const Vector3f* in, size_t n, const Transformd& pose, Vector3d* out)
+{
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+    {
+        const Vector3f& p = in[i];
+        Vector4d extended(p.x(), p.y(), p.z(), 1.0);
+        out[i] = (pose * extended).block<3, 1>(0, 0);
+    }
+}
+
 const Vector3f& SLAMScanWrapper::rawPoint(size_t index) const
 {
     return m_points[index];
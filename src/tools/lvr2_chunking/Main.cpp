@@ -62,6 +62,20 @@ int main(int argc, char** argv)
             // loading a hdf5 file and extracting the chunks for a given bounding box
             lvr2::ChunkManager chunkLoader(options.getChunkedMesh(), options.getCacheSize());
 
+            if (options.getReductionRatio() > 0.0f)
+            {
+                if (options.getReductionRatio() > 1.0f)
+                {
+                    std::cerr << "The reduction ratio needs to be between 0 and 1!" << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                chunkLoader.reduceChunks(options.getReductionRatio(),
+                                         options.getReducedLayer(),
+                                         options.getLayer(),
+                                         options.getReduceSeams());
+            }
+
             // TODO: remove tmp test later
             // beginn: tmp test of extractArea method for dat/scan.pts with chunkSize 200
             if (!boost::filesystem::exists("area"))
@@ -62,7 +62,12 @@ Options::Options(int argc, char** argv) : m_descr("Supported options")
         "y_max", value<float>()->default_value(10.0f), "bounding box maximum value in y-dimension")(
         "z_max", value<float>()->default_value(10.0f), "bounding box maximum value in z-dimension")(
         "cacheSize", value<int>()->default_value(200), "while loading the maximum number of chunks in RAM")(
-        "meshName", value<std::string>()->default_value(""), "group name of the mesh if the HDF5 contains multiple meshes");
+        "meshName", value<std::string>()->default_value(""), "group name of the mesh if the HDF5 contains multiple meshes")(
+        "reductionRatio", value<float>()->default_value(0.0f),
+        "while loading: percentage of edges to collapse in every chunk (0.0 means no reduction)")(
+        "layer", value<std::string>()->default_value("mesh0"), "while loading: layer of the chunks to reduce")(
+        "reducedLayer", value<std::string>()->default_value("reduced"), "while loading: layer to store the reduced chunks in")(
+        "reduceSeams", value<bool>()->default_value(false), "while loading: also reduce the faces along the chunk borders");
 
     // Parse command line and generate variables map
     store(command_line_parser(argc, argv).options(m_descr).positional(m_posDescr).run(),
@@ -164,6 +169,23 @@ std::string Options::getMeshGroup() const
     return m_variables["meshName"].as<std::string>();
 }
 
+float Options::getReductionRatio() const
+{
+    return m_variables["reductionRatio"].as<float>();
+}
+std::string Options::getLayer() const
+{
+    return m_variables["layer"].as<std::string>();
+}
+std::string Options::getReducedLayer() const
+{
+    return m_variables["reducedLayer"].as<std::string>();
+}
+bool Options::getReduceSeams() const
+{
+    return m_variables["reduceSeams"].as<bool>();
+}
+
 Options::~Options()
 {
     // TODO Auto-generated destructor stub
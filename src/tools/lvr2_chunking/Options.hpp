@@ -128,6 +128,22 @@ class Options
      * @brief   Returns the mesh group in the HDF5
      */
     std::string getMeshGroup() const;
+    /**
+     * @brief   Returns the percentage of edges to collapse in every chunk
+     */
+    float getReductionRatio() const;
+    /**
+     * @brief   Returns the layer of the chunks to reduce
+     */
+    std::string getLayer() const;
+    /**
+     * @brief   Returns the layer to store the reduced chunks in
+     */
+    std::string getReducedLayer() const;
+    /**
+     * @brief   Returns whether the chunk borders should be reduced too
+     */
+    bool getReduceSeams() const;
 
 private:
     /// The internally used variable map
@@ -150,6 +150,7 @@ int main(int argc, char** argv)
     gcs.setWithCollapse(options.getWithCollapse());
     gcs.setInterior(options.isInterior());
     gcs.setNumBalances(options.getNumBalances());
+    gcs.setUseVertexGrid(options.isUseVertexGrid());
 
     gcs.getMesh(mesh);
 
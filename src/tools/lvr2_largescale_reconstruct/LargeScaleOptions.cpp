@@ -169,6 +169,16 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "nodeSize, ns",
         value<unsigned int>(&m_octreeNodeSize)->default_value(1000000),
         "Max. Number of Points in a leaf (used to devide pointcloud)")(
+        "partitions",
+        value<unsigned int>(&m_parallelPartitions)->default_value(0),
+        "Number of partitions that are reconstructed at once (0 = one per 4 threads)")(
+        "partitionMemory",
+        value<size_t>(&m_partitionMemoryBudget)->default_value(8192),
+        "Estimated memory in MB that partitions reconstructed at once may use (0 = unlimited)")(
+        "gridDirectory",
+        value<string>(&m_gridDirectory)->default_value(""),
+        "Directory of the BigGrid. An existing grid in it is reused and only new scan positions are added. "
+        "If not set, a temporary directory is used for each run")(
         "outputFolder",
         value<string>(&m_outputFolderPath)->default_value(""),
         "Output Folder Path")("useGPU", "Use GPU for normal estimation")(
@@ -240,6 +250,12 @@ int Options::getChunkSize() const { return (m_variables["chunkSize"].as<int>());
 
 unsigned int Options::getNodeSize() const { return m_variables["nodeSize"].as<unsigned int>(); }
 
+unsigned int Options::getParallelPartitions() const { return m_variables["partitions"].as<unsigned int>(); }
+
+size_t Options::getPartitionMemoryBudget() const { return m_variables["partitionMemory"].as<size_t>(); }
+
+string Options::getGridDirectory() const { return m_variables["gridDirectory"].as<string>(); }
+
 int Options::getPartMethod() const { return (m_variables["partMethod"].as<int>()); }
 
 int Options::getKi() const { return m_variables["ki"].as<int>(); }
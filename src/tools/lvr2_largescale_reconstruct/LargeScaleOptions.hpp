@@ -116,6 +116,21 @@ class Options : public lvr2::BaseOption
      */
     int getPartMethod() const;
 
+    /**
+     * @brief   Returns the number of partitions that are reconstructed at once (0 = one per 4 threads)
+     */
+    unsigned int getParallelPartitions() const;
+
+    /**
+     * @brief   Returns the memory budget in MB for partitions that are reconstructed at once
+     */
+    size_t getPartitionMemoryBudget() const;
+
+    /**
+     * @brief   Returns the directory of the BigGrid (empty = temporary directory per run)
+     */
+    string getGridDirectory() const;
+
     /**
      * @brief    Returns the number of neighbors
      *             for normal interpolation
@@ -536,6 +551,12 @@ class Options : public lvr2::BaseOption
 
     unsigned int m_octreeNodeSize;
 
+    unsigned int m_parallelPartitions;
+
+    size_t m_partitionMemoryBudget;
+
+    string m_gridDirectory;
+
     bool m_interpolateBoxes;
 
     bool m_use_normals;
@@ -670,6 +691,13 @@ inline ostream& operator<<(ostream& os, const Options& o)
         cout << "##### Leaf Size \t\t: " << o.getNodeSize() << endl;
     }
 
+    cout << "##### Parallel partitions \t: " << o.getParallelPartitions() << endl;
+    cout << "##### Partition memory (MB) \t: " << o.getPartitionMemoryBudget() << endl;
+    if (!o.getGridDirectory().empty())
+    {
+        cout << "##### Grid directory \t\t: " << o.getGridDirectory() << endl;
+    }
+
     cout << "##### Interpolating Boxes \t: " << o.interpolateBoxes() << endl;
 
     if (o.getBufferSize())
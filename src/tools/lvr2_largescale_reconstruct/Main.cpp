@@ -67,6 +67,22 @@ using BaseHDF5IO = lvr2::Hdf5IO<>;
 // Extend IO with features (dependencies are automatically fetched)
 using HDF5IO = BaseHDF5IO::AddFeatures<lvr2::hdf5features::ScanProjectIO>;
 
+/**
+ * @brief Creates a scan position with a single scan whose points are read from
+ *        the given .ply file when they are needed
+ */
+ScanPositionPtr lazyPlyScanPosition(const boost::filesystem::path& file)
+{
+    ScanPtr scan(new Scan);
+    scan->scanRoot = file.parent_path();
+    scan->scanFile = file.filename();
+    scan->pointsLoaded = false;
+
+    ScanPositionPtr scanPosPtr = ScanPositionPtr(new ScanPosition());
+    scanPosPtr->scans.push_back(scan);
+    return scanPosPtr;
+}
+
 int main(int argc, char** argv)
 {
     // =======================================================================
@@ -98,7 +114,9 @@ int main(int argc, char** argv)
                                       options.useRansac(), options.getFlippoint(), options.extrude(), options.getDanglingArtifacts(),
                                       options.getCleanContourIterations(), options.getFillHoles(), options.optimizePlanes(),
                                       options.getNormalThreshold(), options.getPlaneIterations(), options.getMinPlaneSize(), options.getSmallRegionThreshold(),
-                                      options.retesselate(), options.getLineFusionThreshold(), options.getBigMesh(), options.getDebugChunks(), options.useGPU());
+                                      options.retesselate(), options.getLineFusionThreshold(), options.getBigMesh(), options.getDebugChunks(), options.useGPU(),
+                                      options.getParallelPartitions(), options.getPartitionMemoryBudget(),
+                                      options.getGridDirectory());
 
     
 
@@ -113,6 +131,7 @@ int main(int argc, char** argv)
     if (extension == ".h5")
     {
         // loadAllPreviewsFromHDF5(in, *project->project.get());
+        // Note: The points of HDF5 projects are still loaded completely
         HDF5IO hdf;
         hdf.open(in);
         ScanProjectPtr scanProjectPtr = hdf.loadScanProject();
@@ -127,8 +146,10 @@ int main(int argc, char** argv)
     else
     {
 
+        // Only meta data is read here. The points are streamed from the scan
+        // files while the BigGrid is built.
         ScanProject dirScanProject;
-        bool importStatus = loadScanProject(in, dirScanProject);
+        bool importStatus = loadScanProject(in, dirScanProject, false);
         //reconstruction from ScanProject Folder
         if(importStatus) {
             project->project = make_shared<ScanProject>(dirScanProject);
@@ -139,13 +160,7 @@ int main(int argc, char** argv)
         else if(!boost::filesystem::is_directory(selectedFile))
         {
             project->project = ScanProjectPtr(new ScanProject);
-            ModelPtr model = ModelFactory::readModel(in);
-            ScanPtr scan(new Scan);
-
-            scan->points = model->m_pointCloud;
-            ScanPositionPtr scanPosPtr = ScanPositionPtr(new ScanPosition());
-            scanPosPtr->scans.push_back(scan);
-            project->project->positions.push_back(scanPosPtr);
+            project->project->positions.push_back(lazyPlyScanPosition(selectedFile));
             project->changed.push_back(true);
         }
         //reconstruction from a folder of .ply files
@@ -158,13 +173,7 @@ int main(int argc, char** argv)
                 string ext = it->path().extension().string();
                 if(ext == ".ply")
                 {
-                    ModelPtr model = ModelFactory::readModel(it->path().string());
-                    ScanPtr scan(new Scan);
-
-                    scan->points = model->m_pointCloud;
-                    ScanPositionPtr scanPosPtr = ScanPositionPtr(new ScanPosition());
-                    scanPosPtr->scans.push_back(scan);
-                    project->project->positions.push_back(scanPosPtr);
+                    project->project->positions.push_back(lazyPlyScanPosition(it->path()));
                     project->changed.push_back(true);
                 }
                 it++;
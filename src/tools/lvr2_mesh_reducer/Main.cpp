@@ -69,7 +69,7 @@ int main(int argc, char** argv)
     cout << model << endl;
     lvr2::MeshBufferPtr meshBuffer = model->m_mesh;
     cout << meshBuffer << endl;
-    lvr2::HalfEdgeMesh<Vec> mesh(meshBuffer);
+    lvr2::HalfEdgeMesh<Vec, lvr2::BitmapStableVector> mesh(meshBuffer);
 
     std::cout << lvr2::timestamp << "Computing face normals..." << std::endl;
 
@@ -90,7 +90,18 @@ int main(int argc, char** argv)
         // Each edge collapse removes two faces in the general case.
         // TODO: maybe we should calculate this differently...
         const auto count = static_cast<size_t>((mesh.numFaces() / 2) * reductionRatio);
-        auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        if (options.getQuadricReduction())
+        {
+            auto collapsedCount = quadricMeshReduction(mesh, count, faceNormals);
+        }
+        else
+        {
+            auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals, options.getParallelReduction());
+        }
+
+        // Get rid of the deleted elements before finalizing. This
+        // invalidates the face normals, they are not used anymore.
+        mesh.compact();
     }
 
     // =======================================================================
@@ -53,7 +53,12 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "reductionRatio,r",
         value<float>(&m_edgeCollapseReductionRatio)->default_value(0.0),
         "Percentage of faces to remove via edge-collapse (0.0 means no reduction, 1.0 means to "
-        "remove all faces which can be removed)");
+        "remove all faces which can be removed)")(
+        "parallel,p",
+        "Collapse independent edges in parallel rounds instead of one edge at a time")(
+        "qem,q",
+        "Rank edge collapses by the quadric error metric and move the remaining vertices to "
+        "their optimal positions (runs serially)");
     setup();
 }
 
@@ -67,6 +72,16 @@ float Options::getEdgeCollapseReductionRatio() const
     return (m_variables["reductionRatio"].as<float>());
 }
 
+bool Options::getParallelReduction() const
+{
+    return m_variables.count("parallel");
+}
+
+bool Options::getQuadricReduction() const
+{
+    return m_variables.count("qem");
+}
+
 bool Options::printUsage() const
 {
     if (m_variables.count("help"))
@@ -76,6 +76,16 @@ class Options : public lvr2::BaseOption
      */
     float getEdgeCollapseReductionRatio() const;
 
+    /**
+     * @brief Whether edges should be collapsed in parallel rounds
+     */
+    bool getParallelReduction() const;
+
+    /**
+     * @brief Whether edges should be ranked by the quadric error metric
+     */
+    bool getQuadricReduction() const;
+
     bool printUsage() const;
 
   private:
@@ -88,6 +98,10 @@ inline ostream& operator<<(ostream& os, const Options& o)
     {
         cout << "##### Edge collapse reduction ratio\t: " << o.getEdgeCollapseReductionRatio()
              << endl;
+        cout << "##### Parallel reduction\t\t: " << (o.getParallelReduction() ? "YES" : "NO")
+             << endl;
+        cout << "##### Quadric error reduction\t: " << (o.getQuadricReduction() ? "YES" : "NO")
+             << endl;
     }
 
     return os;
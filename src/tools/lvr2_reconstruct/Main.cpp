@@ -380,7 +380,16 @@ int main(int argc, char** argv)
         // Each edge collapse removes two faces in the general case.
         // TODO: maybe we should calculate this differently...
         const auto count = static_cast<size_t>((mesh.numFaces() / 2) * reductionRatio);
-        auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        if (options.useQuadricReduction())
+        {
+            // Keep the borders between planar regions
+            auto clusters = planarClusterGrowing(mesh, faceNormals, options.getNormalThreshold());
+            auto collapsedCount = quadricMeshReduction(mesh, count, faceNormals, &clusters);
+        }
+        else
+        {
+            auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        }
     }
 
     ClusterBiMap<FaceHandle> clusterBiMap;
@@ -98,6 +98,7 @@ Options::Options(int argc, char** argv)
         ("sft", value<float>(&m_sft)->default_value(0.9), "Sharp feature threshold when using sharp feature decomposition")
         ("sct", value<float>(&m_sct)->default_value(0.7), "Sharp corner threshold when using sharp feature decomposition")
         ("reductionRatio", value<float>(&m_edgeCollapseReductionRatio)->default_value(0.0), "Percentage of faces to remove via edge-collapse (0.0 means no reduction, 1.0 means to remove all faces which can be removed)")
+        ("reductionQEM", "Rank edge collapses by the quadric error metric and preserve the borders of planar clusters")
         ("tp", value<string>(&m_texturePack)->default_value(""), "Path to texture pack")
         ("co", value<string>(&m_statsCoeffs)->default_value(""), "Coefficents file for texture matching based on statistics")
         ("nsc", value<unsigned int>(&m_numStatsColors)->default_value(16), "Number of colors for texture statistics")
@@ -204,6 +205,11 @@ float Options::getEdgeCollapseReductionRatio() const
     return (m_variables["reductionRatio"].as<float>());
 }
 
+bool Options::useQuadricReduction() const
+{
+    return m_variables.count("reductionQEM");
+}
+
 int    Options::getDanglingArtifacts() const
 {
     return (m_variables["rda"].as<int> ());
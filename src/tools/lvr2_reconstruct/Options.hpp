@@ -293,6 +293,11 @@ public:
      */
     float getEdgeCollapseReductionRatio() const;
 
+    /**
+     * @brief Whether the edge collapses are ranked by the quadric error metric
+     */
+    bool useQuadricReduction() const;
+
 
     unsigned int getNumStatsColors() const;
 
@@ -574,6 +579,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
     if(o.getEdgeCollapseReductionRatio() > 0.0)
     {
         cout << "##### Edge collapse reduction ratio\t: " << o.getEdgeCollapseReductionRatio() << endl;
+        cout << "##### Quadric error reduction\t\t: " << (o.useQuadricReduction() ? "YES" : "NO") << endl;
     }
 
     if(o.useGPU())
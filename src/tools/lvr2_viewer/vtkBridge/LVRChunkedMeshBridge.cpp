@@ -65,6 +65,10 @@ void LVRChunkedMeshBridge::highResWorker()
        if(m_layers.size() > 1)
        {
             m_chunkManager.extractArea(m_region, m_highRes, m_layers[0]);
+
+            // load the chunks ahead of the camera movement in the background
+            BoundingBox<BaseVector<float> > ahead(m_region.getMin() + diff, m_region.getMax() + diff);
+            m_chunkManager.prefetch<MeshBufferPtr>(m_layers[0], ahead);
        }
        else
        {